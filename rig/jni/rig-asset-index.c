@@ -0,0 +1,323 @@
+/*
+ * Rig
+ *
+ * Copyright (C) 2013  Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <rut.h>
+
+#include "rig-asset-index.h"
+
+struct _RigAssetIndex
+{
+  GPtrArray *assets;
+
+  /* Maps from each inferred tag to a GArray of the ids of the assets
+   * with that tag */
+  GHashTable *tags;
+
+  /* Maps from each sequence of three bytes found in the asset paths,
+   * packed into an integer, to a GArray of the ids of the assets
+   * whose path contains it */
+  GHashTable *trigrams;
+
+  /* The ids of all of the assets, for searches that match
+   * everything */
+  GArray *all;
+
+  /* The previous search string and the assets whose path matched it
+   * so that the matches can be refined if the search grows */
+  char *last_search;
+  GArray *last_path_matches;
+
+  GArray *tag_matches;
+  GArray *results;
+  GArray *scratch;
+};
+
+#define TRIGRAM(S) \
+  GUINT_TO_POINTER (((guint8) (S)[0] << 16) | \
+                    ((guint8) (S)[1] << 8) | \
+                    (guint8) (S)[2])
+
+static void
+free_id_array (void *array)
+{
+  g_array_free (array, TRUE);
+}
+
+/* The ids are always added in ascending order so an asset is only
+ * added once by checking the last id */
+static void
+add_id (GHashTable *table,
+        void *key,
+        int id)
+{
+  GArray *ids = g_hash_table_lookup (table, key);
+
+  if (ids == NULL)
+    {
+      ids = g_array_new (FALSE, FALSE, sizeof (int));
+      g_hash_table_insert (table, key, ids);
+    }
+  else if (g_array_index (ids, int, ids->len - 1) == id)
+    return;
+
+  g_array_append_val (ids, id);
+}
+
+/* Removes the ids from @ids that aren't also in @other */
+static void
+intersect_ids (GArray *ids,
+               GArray *other)
+{
+  int i = 0, j = 0, n = 0;
+
+  while (i < ids->len && j < other->len)
+    {
+      int id = g_array_index (ids, int, i);
+      int other_id = g_array_index (other, int, j);
+
+      if (id < other_id)
+        i++;
+      else if (id > other_id)
+        j++;
+      else
+        {
+          g_array_index (ids, int, n++) = id;
+          i++;
+          j++;
+        }
+    }
+
+  g_array_set_size (ids, n);
+}
+
+/* Replaces the contents of @dst with the ids that are in either @a
+ * or @b */
+static void
+union_ids (GArray *dst,
+           GArray *a,
+           GArray *b)
+{
+  int i = 0, j = 0;
+
+  g_array_set_size (dst, 0);
+
+  while (i < a->len || j < b->len)
+    {
+      int id;
+
+      if (j >= b->len ||
+          (i < a->len && g_array_index (a, int, i) < g_array_index (b, int, j)))
+        id = g_array_index (a, int, i++);
+      else if (i >= a->len ||
+               g_array_index (b, int, j) < g_array_index (a, int, i))
+        id = g_array_index (b, int, j++);
+      else
+        {
+          id = g_array_index (a, int, i++);
+          j++;
+        }
+
+      g_array_append_val (dst, id);
+    }
+}
+
+static void
+copy_ids (GArray *dst,
+          GArray *src)
+{
+  g_array_set_size (dst, src->len);
+  memcpy (dst->data, src->data, src->len * sizeof (int));
+}
+
+RigAssetIndex *
+rig_asset_index_new (GList *assets)
+{
+  RigAssetIndex *index = g_slice_new (RigAssetIndex);
+  GList *l;
+  int id;
+
+  index->assets = g_ptr_array_new_with_free_func (rut_refable_unref);
+  index->tags = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                       NULL, /* tags are interned */
+                                       free_id_array);
+  index->trigrams = g_hash_table_new_full (NULL, NULL, NULL, free_id_array);
+  index->all = g_array_new (FALSE, FALSE, sizeof (int));
+
+  index->last_search = NULL;
+  index->last_path_matches = g_array_new (FALSE, FALSE, sizeof (int));
+  index->tag_matches = g_array_new (FALSE, FALSE, sizeof (int));
+  index->results = g_array_new (FALSE, FALSE, sizeof (int));
+  index->scratch = g_array_new (FALSE, FALSE, sizeof (int));
+
+  for (l = assets, id = 0; l; l = l->next, id++)
+    {
+      RutAsset *asset = l->data;
+      const char *path = rut_asset_get_path (asset);
+      const GList *t;
+
+      g_ptr_array_add (index->assets, rut_refable_ref (asset));
+      g_array_append_val (index->all, id);
+
+      for (t = rut_asset_get_inferred_tags (asset); t; t = t->next)
+        add_id (index->tags, t->data, id);
+
+      if (path)
+        {
+          int len = strlen (path);
+          int i;
+
+          for (i = 0; i + 3 <= len; i++)
+            add_id (index->trigrams, TRIGRAM (path + i), id);
+        }
+    }
+
+  return index;
+}
+
+void
+rig_asset_index_free (RigAssetIndex *index)
+{
+  g_ptr_array_free (index->assets, TRUE);
+  g_hash_table_destroy (index->tags);
+  g_hash_table_destroy (index->trigrams);
+  g_array_free (index->all, TRUE);
+
+  g_free (index->last_search);
+  g_array_free (index->last_path_matches, TRUE);
+  g_array_free (index->tag_matches, TRUE);
+  g_array_free (index->results, TRUE);
+  g_array_free (index->scratch, TRUE);
+
+  g_slice_free (RigAssetIndex, index);
+}
+
+int
+rig_asset_index_get_n_assets (RigAssetIndex *index)
+{
+  return index->assets->len;
+}
+
+RutAsset *
+rig_asset_index_get_asset (RigAssetIndex *index,
+                           int id)
+{
+  return g_ptr_array_index (index->assets, id);
+}
+
+/* Finds the assets whose path contains @search and leaves them in
+ * last_path_matches */
+static void
+search_paths (RigAssetIndex *index,
+              const char *search)
+{
+  GArray *candidates = index->scratch;
+  int len = strlen (search);
+  int i, n;
+
+  if (index->last_search && strstr (search, index->last_search))
+    {
+      /* Any path containing the new search must also contain the old
+       * one so only the previous matches need to be checked */
+      copy_ids (candidates, index->last_path_matches);
+    }
+  else if (len >= 3)
+    {
+      copy_ids (candidates, index->all);
+
+      for (i = 0; i + 3 <= len && candidates->len; i++)
+        {
+          GArray *ids = g_hash_table_lookup (index->trigrams,
+                                             TRIGRAM (search + i));
+
+          if (ids)
+            intersect_ids (candidates, ids);
+          else
+            g_array_set_size (candidates, 0);
+        }
+    }
+  else
+    copy_ids (candidates, index->all);
+
+  g_array_set_size (index->last_path_matches, 0);
+
+  for (i = 0, n = candidates->len; i < n; i++)
+    {
+      int id = g_array_index (candidates, int, i);
+      const char *path =
+        rut_asset_get_path (g_ptr_array_index (index->assets, id));
+
+      if (path && strstr (path, search))
+        g_array_append_val (index->last_path_matches, id);
+    }
+
+  g_free (index->last_search);
+  index->last_search = g_strdup (search);
+}
+
+/* Finds the assets that have every word of @search as a tag and
+ * leaves them in tag_matches */
+static void
+search_tags (RigAssetIndex *index,
+             const char *search)
+{
+  char **words = g_strsplit_set (search, " \t", 0);
+  int i;
+
+  copy_ids (index->tag_matches, index->all);
+
+  for (i = 0; words[i] && index->tag_matches->len; i++)
+    {
+      GArray *ids = g_hash_table_lookup (index->tags, words[i]);
+
+      if (ids)
+        intersect_ids (index->tag_matches, ids);
+      else
+        g_array_set_size (index->tag_matches, 0);
+    }
+
+  g_strfreev (words);
+}
+
+const int *
+rig_asset_index_search (RigAssetIndex *index,
+                        const char *search,
+                        int *n_matches)
+{
+  if (search == NULL)
+    {
+      *n_matches = index->all->len;
+      return (const int *) index->all->data;
+    }
+
+  search_paths (index, search);
+  search_tags (index, search);
+
+  union_ids (index->results, index->last_path_matches, index->tag_matches);
+
+  *n_matches = index->results->len;
+  return (const int *) index->results->data;
+}
@@ -0,0 +1,76 @@
+/*
+ * Rig
+ *
+ * Copyright (C) 2013  Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _RIG_ASSET_INDEX_H_
+#define _RIG_ASSET_INDEX_H_
+
+#include <glib.h>
+
+#include <rut.h>
+
+/*
+ * An index of a list of assets to make searching them cheap enough
+ * to do on every keystroke.
+ *
+ * An asset matches a search if its path contains the whole search
+ * string or if every word of the search is one of the asset's
+ * inferred tags. The tags are looked up in a table that maps each
+ * tag to the assets that have it and the path matches are narrowed
+ * down using a table of the trigrams in each path. When a search
+ * string contains the previous search string, such as when the user
+ * types another character, the previous path matches are refined
+ * instead of starting again.
+ *
+ * Each asset is identified by its position in the list that the
+ * index was created from.
+ */
+
+typedef struct _RigAssetIndex RigAssetIndex;
+
+RigAssetIndex *
+rig_asset_index_new (GList *assets);
+
+void
+rig_asset_index_free (RigAssetIndex *index);
+
+int
+rig_asset_index_get_n_assets (RigAssetIndex *index);
+
+RutAsset *
+rig_asset_index_get_asset (RigAssetIndex *index,
+                           int id);
+
+/**
+ * rig_asset_index_search:
+ * @index: A #RigAssetIndex
+ * @search: The search string or %NULL to match everything
+ * @n_matches: Return location for the number of matches
+ *
+ * Return value: The ids of the matching assets in ascending order.
+ *   The array is owned by the index and is only valid until the next
+ *   search.
+ */
+const int *
+rig_asset_index_search (RigAssetIndex *index,
+                        const char *search,
+                        int *n_matches);
+
+#endif /* _RIG_ASSET_INDEX_H_ */
@@ -0,0 +1,434 @@
+/*
+ * Rig Benchmark
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This renders a UI into an offscreen framebuffer while stepping
+ * through one of its transitions. It reports the CPU time and
+ * statistics for each of the render passes together with the time
+ * taken for each whole frame. Each frame waits for the GPU to finish
+ * so the frame times include the time spent drawing.
+ *
+ * If no UI file is given then a synthetic scene is generated with a
+ * grid of animated entities so that the renderer can be measured
+ * without needing any assets.
+ *
+ * A window is never shown. On a machine without a GPU it can be run
+ * with Mesa's software rasterizer, e.g.:
+ *
+ *   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run rig-bench -e 5000
+ *
+ * Usage:
+ * rig-bench [OPTION...] [UI]
+ *
+ * Application Options:
+ *   -f, --frames=N        Number of frames to measure
+ *   -w, --warmup=N        Number of frames to render before measuring
+ *   -t, --transition=ID   Transition to step through
+ *   -e, --entities=N      Number of entities in a synthetic scene
+ *   -k, --keyframes=N     Number of keyframes in each synthetic path
+ *   -W, --width=N         Width of the offscreen framebuffer
+ *   -H, --height=N        Height of the offscreen framebuffer
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <glib.h>
+
+#include <rut.h>
+
+#include "rig-engine.h"
+#include "rig-renderer.h"
+#include "rig-transition.h"
+
+static char **remaining_args = NULL;
+static int n_frames = 300;
+static int n_warmup_frames = 10;
+static int transition_id = -1;
+static int n_entities = 1000;
+static int n_keyframes = 8;
+static int width = 0;
+static int height = 0;
+
+static const GOptionEntry options[] =
+{
+  { "frames", 'f', 0, G_OPTION_ARG_INT, &n_frames,
+    "Number of frames to measure", "N" },
+  { "warmup", 'w', 0, G_OPTION_ARG_INT, &n_warmup_frames,
+    "Number of frames to render before measuring", "N" },
+  { "transition", 't', 0, G_OPTION_ARG_INT, &transition_id,
+    "Transition to step through", "ID" },
+  { "entities", 'e', 0, G_OPTION_ARG_INT, &n_entities,
+    "Number of entities in a synthetic scene", "N" },
+  { "keyframes", 'k', 0, G_OPTION_ARG_INT, &n_keyframes,
+    "Number of keyframes in each synthetic path", "N" },
+  { "width", 'W', 0, G_OPTION_ARG_INT, &width,
+    "Width of the offscreen framebuffer", "N" },
+  { "height", 'H', 0, G_OPTION_ARG_INT, &height,
+    "Height of the offscreen framebuffer", "N" },
+  { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY,
+    &remaining_args, "UI" },
+  { 0 }
+};
+
+static const char *pass_names[] =
+{
+  "color-unblended",
+  "color-blended",
+  "shadow",
+  "dof-depth"
+};
+
+typedef struct
+{
+  int64_t paint_time;
+  int64_t n_drawn;
+  int64_t n_culled;
+  int64_t n_draw_calls;
+  int64_t n_uploaded;
+} PassTotals;
+
+static void
+animate_entity (RigTransition *transition,
+                RutEntity *entity,
+                const float *base_position,
+                GRand *rand)
+{
+  RutProperty *position =
+    rut_introspectable_lookup_property (entity, "position");
+  RutProperty *rotation =
+    rut_introspectable_lookup_property (entity, "rotation");
+  RigPath *position_path =
+    rig_transition_get_path_for_property (transition, position);
+  RigPath *rotation_path =
+    rig_transition_get_path_for_property (transition, rotation);
+  int i;
+
+  for (i = 0; i < n_keyframes; i++)
+    {
+      float t = i / (float) MAX (1, n_keyframes - 1);
+      float position_value[3];
+      CoglQuaternion rotation_value;
+
+      position_value[0] = base_position[0] + g_rand_double_range (rand, -20, 20);
+      position_value[1] = base_position[1] + g_rand_double_range (rand, -20, 20);
+      position_value[2] = base_position[2] + g_rand_double_range (rand, -50, 50);
+      rig_path_insert_vec3 (position_path, t, position_value);
+
+      cogl_quaternion_init (&rotation_value,
+                            g_rand_double_range (rand, 0, 360),
+                            0, 0, 1);
+      rig_path_insert_quaternion (rotation_path, t, &rotation_value);
+    }
+
+  rig_transition_set_property_animated (transition, position, TRUE);
+  rig_transition_set_property_animated (transition, rotation, TRUE);
+}
+
+/* Lays out a grid of shapes covering the device area so that the
+ * scene roughly resembles a busy UI */
+static void
+create_synthetic_scene (RigEngine *engine)
+{
+  RigTransition *transition = rig_create_transition (engine, 0);
+  int columns = MAX (1, (int) ceilf (sqrtf (n_entities)));
+  int rows = (n_entities + columns - 1) / columns;
+  float cell_width = engine->device_width / (float) columns;
+  float cell_height = engine->device_height / (float) rows;
+  GRand *rand = g_rand_new_with_seed (n_entities);
+  int i;
+
+  for (i = 0; i < n_entities; i++)
+    {
+      RutEntity *entity = rut_entity_new (engine->ctx);
+      RutMaterial *material = rut_material_new (engine->ctx, NULL);
+      RutShape *shape = rut_shape_new (engine->ctx,
+                                       FALSE, /* shaped */
+                                       MAX (1, cell_width * 0.8f),
+                                       MAX (1, cell_height * 0.8f));
+      CoglColor color;
+      float position[3];
+
+      cogl_color_init_from_4f (&color,
+                               g_rand_double (rand),
+                               g_rand_double (rand),
+                               g_rand_double (rand),
+                               1);
+      rut_material_set_diffuse (material, &color);
+
+      rut_entity_add_component (entity, material);
+      rut_refable_unref (material);
+      rut_entity_add_component (entity, shape);
+      rut_refable_unref (shape);
+
+      position[0] = (i % columns + 0.5f) * cell_width;
+      position[1] = (i / columns + 0.5f) * cell_height;
+      position[2] = 0;
+      rut_entity_set_position (entity, position);
+
+      rut_graphable_add_child (engine->scene, entity);
+      rut_refable_unref (entity);
+
+      animate_entity (transition, entity, position, rand);
+    }
+
+  g_rand_free (rand);
+
+  engine->transitions = g_list_prepend (engine->transitions, transition);
+
+  rig_engine_handle_ui_update (engine);
+}
+
+static RigTransition *
+find_transition (RigEngine *engine,
+                 int id)
+{
+  GList *l;
+
+  if (id < 0)
+    return engine->transitions ? engine->transitions->data : NULL;
+
+  for (l = engine->transitions; l; l = l->next)
+    {
+      RigTransition *transition = l->data;
+
+      if (transition->id == id)
+        return transition;
+    }
+
+  return NULL;
+}
+
+static int
+compare_times (const void *a,
+               const void *b)
+{
+  int64_t time_a = *(const int64_t *) a;
+  int64_t time_b = *(const int64_t *) b;
+
+  return time_a < time_b ? -1 : time_a > time_b ? 1 : 0;
+}
+
+static double
+get_percentile (const int64_t *sorted_times,
+                int n_times,
+                int percentile)
+{
+  return sorted_times[(n_times - 1) * percentile / 100] / 1000.0;
+}
+
+static void
+print_pool_cb (RutObjectPool *pool,
+               void *user_data)
+{
+  g_print ("%-20s %10u %10.1f %10.1f\n",
+           rut_object_pool_get_name (pool),
+           (unsigned int) rut_object_pool_get_n_live (pool),
+           rut_object_pool_get_live_bytes (pool) / 1024.0,
+           rut_object_pool_get_reserved_bytes (pool) / 1024.0);
+}
+
+static void
+render_frame (RigEngine *engine,
+              RigTransition *transition,
+              float progress)
+{
+  if (transition)
+    rig_transition_set_progress (transition, progress);
+
+  rut_shell_paint (engine->shell);
+
+  /* Wait for the GPU so that the frame time includes the drawing */
+  cogl_framebuffer_finish (COGL_FRAMEBUFFER (engine->offscreen));
+}
+
+static void
+run_benchmark (RigEngine *engine,
+               RigTransition *transition)
+{
+  int64_t *frame_times = g_new (int64_t, n_frames);
+  PassTotals pass_totals[RIG_N_PASSES];
+  int64_t total_time = 0;
+  int i, pass;
+
+  memset (pass_totals, 0, sizeof (pass_totals));
+
+  for (i = 0; i < n_warmup_frames; i++)
+    render_frame (engine, transition, 0);
+
+  for (i = 0; i < n_frames; i++)
+    {
+      float progress = i / (float) MAX (1, n_frames - 1);
+      int64_t start = g_get_monotonic_time ();
+
+      render_frame (engine, transition, progress);
+
+      frame_times[i] = g_get_monotonic_time () - start;
+      total_time += frame_times[i];
+
+      for (pass = 0; pass < RIG_N_PASSES; pass++)
+        {
+          const RigCullCounters *cull_counters =
+            rig_renderer_get_cull_counters (engine, pass);
+          const RigUniformCounters *uniform_counters =
+            rig_renderer_get_uniform_counters (engine, pass);
+          PassTotals *totals = pass_totals + pass;
+
+          totals->paint_time += cull_counters->paint_time;
+          totals->n_drawn += cull_counters->n_drawn;
+          totals->n_culled += cull_counters->n_culled;
+          totals->n_draw_calls += cull_counters->n_draw_calls;
+          totals->n_uploaded += uniform_counters->n_uploaded;
+        }
+    }
+
+  qsort (frame_times, n_frames, sizeof (int64_t), compare_times);
+
+  g_print ("%d frames at %dx%d\n", n_frames, engine->width, engine->height);
+  g_print ("frame time: mean %.3fms, p50 %.3fms, p90 %.3fms, "
+           "p99 %.3fms, max %.3fms\n",
+           total_time / (double) n_frames / 1000.0,
+           get_percentile (frame_times, n_frames, 50),
+           get_percentile (frame_times, n_frames, 90),
+           get_percentile (frame_times, n_frames, 99),
+           frame_times[n_frames - 1] / 1000.0);
+
+  g_print ("%-16s %10s %10s %10s %10s %10s\n",
+           "pass", "cpu ms", "drawn", "culled", "draws", "uploads");
+
+  for (pass = 0; pass < RIG_N_PASSES; pass++)
+    {
+      PassTotals *totals = pass_totals + pass;
+
+      g_print ("%-16s %10.3f %10.1f %10.1f %10.1f %10.1f\n",
+               pass_names[pass],
+               totals->paint_time / (double) n_frames / 1000.0,
+               totals->n_drawn / (double) n_frames,
+               totals->n_culled / (double) n_frames,
+               totals->n_draw_calls / (double) n_frames,
+               totals->n_uploaded / (double) n_frames);
+    }
+
+  g_print ("%-20s %10s %10s %10s\n",
+           "pool", "live", "live KB", "reserved KB");
+  rut_object_pool_foreach (print_pool_cb, NULL);
+
+  g_free (frame_times);
+}
+
+static void
+bench_init (RutShell *shell, void *user_data)
+{
+  RigEngine *engine = user_data;
+
+  rig_engine_init (shell, engine);
+}
+
+int
+main (int argc, char **argv)
+{
+  RigEngine engine;
+  GOptionContext *context = g_option_context_new (NULL);
+  GError *error = NULL;
+  RigTransition *transition;
+  char *assets_location;
+
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("option parsing failed: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  G_STATIC_ASSERT (G_N_ELEMENTS (pass_names) == RIG_N_PASSES);
+
+  n_frames = MAX (1, n_frames);
+  n_warmup_frames = MAX (0, n_warmup_frames);
+  n_entities = MAX (1, n_entities);
+  n_keyframes = MAX (1, n_keyframes);
+
+  memset (&engine, 0, sizeof (RigEngine));
+
+  if (remaining_args && remaining_args[0])
+    {
+      engine.ui_filename = g_strdup (remaining_args[0]);
+      assets_location = g_path_get_dirname (engine.ui_filename);
+    }
+  else
+    assets_location = g_get_current_dir ();
+
+  engine.headless = TRUE;
+  engine.width = width;
+  engine.height = height;
+
+  /* The benchmark only plays back the UI */
+  _rig_in_device_mode = TRUE;
+
+  engine.shell = rut_shell_new (bench_init,
+                                rig_engine_fini,
+                                rig_engine_paint,
+                                &engine);
+
+  engine.ctx = rut_context_new (engine.shell);
+  if (engine.ctx == NULL)
+    return EXIT_FAILURE;
+
+  rut_context_init (engine.ctx);
+
+  rut_set_assets_location (engine.ctx, assets_location);
+  g_free (assets_location);
+
+  /* The main loop isn't used so the shell's init callback is called
+   * directly */
+  bench_init (engine.shell, &engine);
+
+  /* rig_engine_init() only loads the UI if the file exists */
+  if (engine.ui_filename == NULL)
+    create_synthetic_scene (&engine);
+  else if (engine.light == NULL)
+    {
+      g_printerr ("Failed to load %s\n", engine.ui_filename);
+      return EXIT_FAILURE;
+    }
+
+  transition = find_transition (&engine, transition_id);
+  if (transition == NULL && transition_id >= 0)
+    {
+      g_printerr ("No transition with id %d\n", transition_id);
+      return EXIT_FAILURE;
+    }
+
+  run_benchmark (&engine, transition);
+
+  rig_engine_fini (engine.shell, &engine);
+
+  rut_refable_unref (engine.ctx);
+  rut_refable_unref (engine.shell);
+
+  g_free (engine.ui_filename);
+
+  return EXIT_SUCCESS;
+}
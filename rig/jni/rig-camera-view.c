@@ -1128,17 +1128,6 @@ entitygraph_pre_pick_cb (RutObject *object,
       float transformed_ray_direction[3];
       CoglMatrix transform;
 
-      if (!rut_entity_get_visible (entity))
-        return RUT_TRAVERSE_VISIT_CONTINUE;
-
-      geometry = rut_entity_get_component (entity, RUT_COMPONENT_TYPE_GEOMETRY);
-
-      /* Get a model we can pick against */
-      if (!(geometry &&
-            rut_object_is (geometry, RUT_INTERFACE_ID_PICKABLE) &&
-            (mesh = rut_pickable_get_mesh (geometry))))
-        return RUT_TRAVERSE_VISIT_CONTINUE;
-
       /* transform the ray into the model space */
       memcpy (transformed_ray_origin,
               pick_ctx->ray_origin, 3 * sizeof (float));
@@ -1152,6 +1141,24 @@ entitygraph_pre_pick_cb (RutObject *object,
                      transformed_ray_origin,
                      transformed_ray_direction);
 
+      /* The bounds of an entity include all of its descendants so if
+       * the ray misses them then nothing in the subtree can be hit */
+      if (!rut_entity_bounds_intersect_ray (entity,
+                                            transformed_ray_origin,
+                                            transformed_ray_direction))
+        return RUT_TRAVERSE_VISIT_SKIP_CHILDREN;
+
+      if (!rut_entity_get_visible (entity))
+        return RUT_TRAVERSE_VISIT_CONTINUE;
+
+      geometry = rut_entity_get_component (entity, RUT_COMPONENT_TYPE_GEOMETRY);
+
+      /* Get a model we can pick against */
+      if (!(geometry &&
+            rut_object_is (geometry, RUT_INTERFACE_ID_PICKABLE) &&
+            (mesh = rut_pickable_get_mesh (geometry))))
+        return RUT_TRAVERSE_VISIT_CONTINUE;
+
       /* intersect the transformed ray with the model engine */
       hit = rut_util_intersect_mesh (mesh,
                                      transformed_ray_origin,
@@ -1223,6 +1230,14 @@ pick (RigEngine *engine,
 {
   PickContext pick_ctx;
 
+  RUT_STATIC_TIMER (pick_timer,
+                    NULL, /* no parent */
+                    "Entity pick",
+                    "Time spent picking entities in the scene",
+                    0 /* no application private data */);
+
+  RUT_TIMER_START (_rut_uprof_context, pick_timer);
+
   pick_ctx.camera = camera;
   pick_ctx.fb = fb;
   pick_ctx.selected_distance = -G_MAXFLOAT;
@@ -1240,6 +1255,8 @@ pick (RigEngine *engine,
                           entitygraph_post_pick_cb,
                           &pick_ctx);
 
+  RUT_TIMER_STOP (_rut_uprof_context, pick_timer);
+
   if (pick_ctx.selected_entity)
     {
       g_message ("Hit entity, triangle #%d, distance %.2f",
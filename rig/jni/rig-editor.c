@@ -8,8 +8,14 @@
 
 static char **_rig_editor_remaining_args = NULL;
 
+/* Roughly one update per frame */
+static int _rig_editor_slave_sync_interval = 16;
+
 static const GOptionEntry rut_editor_entries[] =
 {
+  { "slave-sync-interval", 0, 0, G_OPTION_ARG_INT,
+    &_rig_editor_slave_sync_interval,
+    "Minimum time in milliseconds between updates sent to slaves", "MS" },
   { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY,
     &_rig_editor_remaining_args, "Project" },
   { 0 }
@@ -52,6 +58,7 @@ main (int argc, char **argv)
   memset (&engine, 0, sizeof (RigEngine));
 
   engine.ui_filename = g_strdup (_rig_editor_remaining_args[0]);
+  engine.slave_sync_interval = MAX (0, _rig_editor_slave_sync_interval);
 
   engine.shell = rut_shell_new (rig_editor_init,
                               rig_engine_fini,
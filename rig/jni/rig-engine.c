@@ -181,10 +181,15 @@ CoglBool
 rig_engine_paint (RutShell *shell, void *user_data)
 {
   RigEngine *engine = user_data;
-  CoglFramebuffer *fb = COGL_FRAMEBUFFER (engine->onscreen);
+  CoglFramebuffer *fb;
   RigPaintContext paint_ctx;
   RutPaintContext *rut_paint_ctx = &paint_ctx._parent;
 
+  if (engine->headless)
+    fb = COGL_FRAMEBUFFER (engine->offscreen);
+  else
+    fb = COGL_FRAMEBUFFER (engine->onscreen);
+
   rut_camera_set_framebuffer (engine->camera, fb);
 
   cogl_framebuffer_clear4f (fb,
@@ -202,7 +207,8 @@ rig_engine_paint (RutShell *shell, void *user_data)
                                rut_paint_ctx);
   rut_camera_end_frame (engine->camera);
 
-  cogl_onscreen_swap_buffers (COGL_ONSCREEN (fb));
+  if (!engine->headless)
+    cogl_onscreen_swap_buffers (COGL_ONSCREEN (fb));
 
   return FALSE;
 }
@@ -581,10 +587,22 @@ data_onscreen_resize (CoglOnscreen *onscreen,
   allocate (engine);
 }
 
+/* There is one of these for each cell of the asset grid. The asset
+ * is NULL while the cell isn't bound to anything */
 typedef struct _AssetInputClosure
 {
   RutAsset *asset;
   RigEngine *engine;
+
+  RutObject *cell;
+  RutStack *stack;
+  RutInputRegion *region;
+
+  /* Either an image of the asset or, if there is no thumbnail for it
+   * yet, a placeholder showing its name until the thumbnail can
+   * replace it */
+  RutObject *content;
+  CoglBool placeholder;
 } AssetInputClosure;
 
 static void
@@ -593,11 +611,35 @@ free_asset_input_closures (RigEngine *engine)
   GList *l;
 
   for (l = engine->asset_input_closures; l; l = l->next)
-    g_slice_free (AssetInputClosure, l->data);
+    {
+      AssetInputClosure *closure = l->data;
+
+      rut_refable_unref (closure->stack);
+      if (closure->content)
+        rut_refable_unref (closure->content);
+
+      g_slice_free (AssetInputClosure, closure);
+    }
   g_list_free (engine->asset_input_closures);
   engine->asset_input_closures = NULL;
 }
 
+static void
+free_asset_index (RigEngine *engine)
+{
+  if (engine->asset_matches)
+    {
+      g_array_free (engine->asset_matches, TRUE);
+      engine->asset_matches = NULL;
+    }
+
+  if (engine->asset_index)
+    {
+      rig_asset_index_free (engine->asset_index);
+      engine->asset_index = NULL;
+    }
+}
+
 static RutInputEventStatus
 asset_input_cb (RutInputRegion *region,
                 RutInputEvent *event,
@@ -619,6 +661,11 @@ asset_input_cb (RutInputRegion *region,
         {
           RutAssetType type = rut_asset_get_type (asset);
 
+          /* Assets that failed to load are still listed but there's
+           * nothing to add */
+          if (!rut_asset_get_texture (asset) && !rut_asset_get_mesh (asset))
+            return RUT_INPUT_EVENT_STATUS_HANDLED;
+
           if (engine->selected_entity)
             entity = engine->selected_entity;
           else
@@ -782,9 +829,10 @@ asset_input_cb (RutInputRegion *region,
                     {
                       RutAsset *texture_asset =
                         rut_material_get_texture_asset (material);
-                      if (texture_asset)
+                      CoglTexture *texture =
+                        texture_asset ? rut_asset_get_texture (texture_asset) : NULL;
+                      if (texture)
                         {
-                          CoglTexture *texture = rut_asset_get_texture (texture_asset);
                           tex_width = cogl_texture_get_width (texture);
                           tex_height = cogl_texture_get_height (texture);
                         }
@@ -818,9 +866,10 @@ asset_input_cb (RutInputRegion *region,
                     {
                       RutAsset *texture_asset =
                         rut_material_get_texture_asset (material);
-                      if (texture_asset)
+                      CoglTexture *texture =
+                        texture_asset ? rut_asset_get_texture (texture_asset) : NULL;
+                      if (texture)
                         {
-                          CoglTexture *texture = rut_asset_get_texture (texture_asset);
                           tex_width = cogl_texture_get_width (texture);
                           tex_height = cogl_texture_get_height (texture);
                         }
@@ -847,67 +896,126 @@ asset_input_cb (RutInputRegion *region,
   return status;
 }
 
-static CoglBool
-asset_matches_search (RutAsset *asset,
-                      const char *search)
+/* Returns a small texture to represent the asset in the asset browser
+ * without having to decode the whole asset */
+static CoglTexture *
+get_asset_icon_texture (RigEngine *engine,
+                        RutAsset *asset)
 {
-  const GList *inferred_tags;
-  char **tags;
-  const char *path;
-  int i;
+  const char *path = rut_asset_get_path (asset);
+  CoglTexture *texture;
+  char *real_path;
 
-  if (!search)
-    return TRUE;
+  if (rut_asset_is_loaded (asset))
+    return rut_asset_get_texture (asset);
 
-  inferred_tags = rut_asset_get_inferred_tags (asset);
-  tags = g_strsplit_set (search, " \t", 0);
+  if (!engine->thumbnail_cache)
+    return NULL;
 
-  path = rut_asset_get_path (asset);
-  if (path)
+  switch (rut_asset_get_type (asset))
     {
-      if (strstr (path, search))
-        return TRUE;
+    case RUT_ASSET_TYPE_TEXTURE:
+    case RUT_ASSET_TYPE_NORMAL_MAP:
+    case RUT_ASSET_TYPE_ALPHA_MASK:
+      real_path = g_build_filename (engine->ctx->assets_location, path, NULL);
+      texture = rut_thumbnail_cache_get (engine->thumbnail_cache,
+                                         path,
+                                         real_path);
+      g_free (real_path);
+      return texture;
+    default:
+      return NULL;
     }
+}
 
-  for (i = 0; tags[i]; i++)
+static void
+set_asset_icon_content (AssetInputClosure *closure,
+                        RutObject *content,
+                        CoglBool placeholder)
+{
+  if (closure->content)
     {
-      const GList *l;
-      CoglBool found = FALSE;
+      rut_graphable_remove_child (closure->content);
+      rut_refable_unref (closure->content);
+    }
 
-      for (l = inferred_tags; l; l = l->next)
-        {
-          if (strcmp (tags[i], l->data) == 0)
-            {
-              found = TRUE;
-              break;
-            }
-        }
+  closure->content = content;
+  closure->placeholder = placeholder;
 
-      if (!found)
-        {
-          g_strfreev (tags);
-          return FALSE;
-        }
-    }
+  if (content)
+    {
+      rut_stack_add (closure->stack, content);
 
-  g_strfreev (tags);
-  return TRUE;
+      /* The input region has to stay on top of the content, otherwise
+       * the input region of a placeholder's text would take the
+       * clicks instead */
+      rut_stack_add (closure->stack, closure->region);
+    }
 }
 
 static void
-add_asset_icon (RigEngine *engine,
-                RutAsset *asset)
+thumbnail_ready_cb (RutThumbnailCache *cache,
+                    const char *path,
+                    void *user_data)
 {
+  RigEngine *engine = user_data;
+  GList *l;
+
+  /* Only the cells that are currently bound need updating. Any other
+   * asset will pick up the thumbnail when it scrolls into view */
+  for (l = engine->asset_input_closures; l; l = l->next)
+    {
+      AssetInputClosure *closure = l->data;
+      CoglTexture *texture;
+
+      if (!closure->asset || !closure->placeholder ||
+          strcmp (rut_asset_get_path (closure->asset), path) != 0)
+        continue;
+
+      texture = get_asset_icon_texture (engine, closure->asset);
+      if (!texture)
+        continue;
+
+      set_asset_icon_content (closure,
+                              rut_image_new (engine->ctx, texture),
+                              FALSE);
+
+      rut_shell_queue_redraw (engine->ctx->shell);
+    }
+}
+
+static AssetInputClosure *
+find_asset_input_closure (RigEngine *engine,
+                          RutObject *cell)
+{
+  GList *l;
+
+  for (l = engine->asset_input_closures; l; l = l->next)
+    {
+      AssetInputClosure *closure = l->data;
+
+      if (closure->cell == cell)
+        return closure;
+    }
+
+  return NULL;
+}
+
+static RutObject *
+create_asset_icon_cb (RutVirtualGrid *grid,
+                      void *user_data)
+{
+  RigEngine *engine = user_data;
   AssetInputClosure *closure;
   RutStack *stack;
   RutBin *bin;
-  CoglTexture *texture;
-  RutImage *image;
   RutInputRegion *region;
 
   closure = g_slice_new (AssetInputClosure);
-  closure->asset = asset;
+  closure->asset = NULL;
   closure->engine = engine;
+  closure->content = NULL;
+  closure->placeholder = FALSE;
 
   bin = rut_bin_new (engine->ctx);
 
@@ -915,21 +1023,8 @@ add_asset_icon (RigEngine *engine,
   rut_bin_set_child (bin, stack);
   rut_refable_unref (stack);
 
-  texture = rut_asset_get_texture (asset);
-  if (texture)
-    {
-      image = rut_image_new (engine->ctx, texture);
-      rut_stack_add (stack, image);
-      rut_refable_unref (image);
-    }
-  else
-    {
-      char *basename = g_path_get_basename (rut_asset_get_path (asset));
-      RutText *text = rut_text_new_with_text (engine->ctx, NULL, basename);
-      rut_stack_add (stack, text);
-      rut_refable_unref (text);
-      g_free (basename);
-    }
+  closure->cell = bin;
+  closure->stack = rut_refable_ref (stack);
 
   region = rut_input_region_new_rectangle (0, 0, 100, 100,
                                            asset_input_cb,
@@ -937,55 +1032,137 @@ add_asset_icon (RigEngine *engine,
   rut_stack_add (stack, region);
   rut_refable_unref (region);
 
-  rut_flow_layout_add (engine->assets_flow, bin);
-  rut_refable_unref (bin);
+  closure->region = region;
 
   /* XXX: It could be nicer to have some form of weak pointer
    * mechanism to manage the lifetime of these closures... */
   engine->asset_input_closures = g_list_prepend (engine->asset_input_closures,
                                                closure);
+
+  return bin;
 }
 
-static CoglBool
-rig_search_asset_list (RigEngine *engine, const char *search)
+static void
+bind_asset_icon_cb (RutVirtualGrid *grid,
+                    RutObject *cell,
+                    int index,
+                    void *user_data)
 {
-  GList *l;
-  int i;
-  CoglBool found = FALSE;
+  RigEngine *engine = user_data;
+  AssetInputClosure *closure = find_asset_input_closure (engine, cell);
+  RutAsset *asset;
+  CoglTexture *texture;
+  int id;
+
+  if (!closure || !engine->asset_matches)
+    return;
 
-  if (engine->assets_flow)
+  id = g_array_index (engine->asset_matches, int, index);
+  asset = rig_asset_index_get_asset (engine->asset_index, id);
+
+  closure->asset = asset;
+
+  /* If there is no thumbnail yet then the name is shown instead */
+  texture = get_asset_icon_texture (engine, asset);
+
+  if (texture)
+    set_asset_icon_content (closure,
+                            rut_image_new (engine->ctx, texture),
+                            FALSE);
+  else
+    {
+      char *basename = g_path_get_basename (rut_asset_get_path (asset));
+
+      set_asset_icon_content (closure,
+                              rut_text_new_with_text (engine->ctx,
+                                                      NULL, basename),
+                              TRUE);
+      g_free (basename);
+    }
+}
+
+static void
+unbind_asset_icon_cb (RutVirtualGrid *grid,
+                      RutObject *cell,
+                      int index,
+                      void *user_data)
+{
+  AssetInputClosure *closure = find_asset_input_closure (user_data, cell);
+
+  if (!closure)
+    return;
+
+  set_asset_icon_content (closure, NULL, FALSE);
+  closure->asset = NULL;
+}
+
+/* Creates the grid that shows the assets along with the index used
+ * to search them. The grid only creates icons for the assets that
+ * can be seen through the assets viewport so searching only needs to
+ * update the list of matches */
+static void
+rig_rebuild_asset_browser (RigEngine *engine)
+{
+  int i, n_assets;
+
+  if (engine->assets_grid)
     {
       rut_fold_set_child (engine->assets_results_fold, NULL);
       free_asset_input_closures (engine);
     }
 
-  engine->assets_flow =
-    rut_flow_layout_new (engine->ctx, RUT_FLOW_LAYOUT_PACKING_LEFT_TO_RIGHT);
+  free_asset_index (engine);
+
+  engine->asset_index = rig_asset_index_new (engine->assets);
+  engine->asset_matches = g_array_new (FALSE, FALSE, sizeof (int));
+
+  engine->assets_grid = rut_virtual_grid_new (engine->ctx,
+                                              100, 100,
+                                              create_asset_icon_cb,
+                                              bind_asset_icon_cb,
+                                              unbind_asset_icon_cb,
+                                              engine);
 
-  rut_flow_layout_set_x_padding (engine->assets_flow, 5);
-  rut_flow_layout_set_y_padding (engine->assets_flow, 5);
-  rut_flow_layout_set_max_child_height (engine->assets_flow, 100);
+  rut_virtual_grid_set_x_padding (engine->assets_grid, 5);
+  rut_virtual_grid_set_y_padding (engine->assets_grid, 5);
+  rut_virtual_grid_set_viewport (engine->assets_grid, engine->assets_vp);
 
 #if 0
   if (engine->transparency_grid)
     rut_graphable_add_child (engine->assets_list, engine->transparency_grid);
 #endif
 
-  rut_fold_set_child (engine->assets_results_fold, engine->assets_flow);
-  rut_refable_unref (engine->assets_flow);
+  rut_fold_set_child (engine->assets_results_fold, engine->assets_grid);
+  rut_refable_unref (engine->assets_grid);
 
-  for (l = engine->assets, i= 0; l; l = l->next, i++)
-    {
-      RutAsset *asset = l->data;
+  /* Initially every asset is shown */
+  n_assets = rig_asset_index_get_n_assets (engine->asset_index);
+  for (i = 0; i < n_assets; i++)
+    g_array_append_val (engine->asset_matches, i);
 
-      if (!asset_matches_search (asset, search))
-        continue;
+  rut_virtual_grid_set_n_items (engine->assets_grid, n_assets);
+}
 
-      found = TRUE;
-      add_asset_icon (engine, asset);
-    }
+static CoglBool
+rig_search_asset_list (RigEngine *engine, const char *search)
+{
+  const int *matches;
+  int n_matches;
+
+  if (!engine->asset_index)
+    return FALSE;
 
-  return found;
+  matches = rig_asset_index_search (engine->asset_index, search, &n_matches);
+
+  if (n_matches == 0)
+    return FALSE;
+
+  g_array_set_size (engine->asset_matches, 0);
+  g_array_append_vals (engine->asset_matches, matches, n_matches);
+
+  rut_virtual_grid_set_n_items (engine->assets_grid, n_matches);
+
+  return TRUE;
 }
 
 static void
@@ -1810,6 +1987,10 @@ rig_engine_free_ui (RigEngine *engine)
       engine->shadow_fb = NULL;
     }
 
+  /* The batch cache holds references on the meshes of the UI */
+  if (engine->batch_positions)
+    g_hash_table_remove_all (engine->batch_positions);
+
   for (l = engine->transitions; l; l = l->next)
     rig_transition_free (l->data);
   g_list_free (engine->transitions);
@@ -1820,7 +2001,19 @@ rig_engine_free_ui (RigEngine *engine)
   g_list_free (engine->assets);
   engine->assets = NULL;
 
+  for (l = engine->slave_masters; l; l = l->next)
+    rig_slave_master_forget_assets (l->data);
+
   free_asset_input_closures (engine);
+  free_asset_index (engine);
+
+#ifdef RIG_EDITOR_ENABLED
+  if (engine->thumbnail_cache)
+    {
+      rut_thumbnail_cache_free (engine->thumbnail_cache);
+      engine->thumbnail_cache = NULL;
+    }
+#endif
 
   /* NB: no extra reference is held on the light other than the
    * reference for it being in the scenegraph. */
@@ -1854,6 +2047,38 @@ rig_engine_set_onscreen_size (RigEngine *engine,
 #endif
 }
 
+static void
+init_headless_framebuffer (RigEngine *engine)
+{
+  CoglTexture2D *color_buffer;
+  CoglFramebuffer *fb;
+
+  if (engine->width <= 0 || engine->height <= 0)
+    {
+      engine->width = engine->device_width / 2;
+      engine->height = engine->device_height / 2;
+    }
+
+  color_buffer = cogl_texture_2d_new_with_size (engine->ctx->cogl_context,
+                                                engine->width,
+                                                engine->height,
+                                                COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+
+  /* The offscreen keeps its own reference on the texture */
+  engine->offscreen =
+    cogl_offscreen_new_to_texture (COGL_TEXTURE (color_buffer));
+  cogl_object_unref (color_buffer);
+
+  if (engine->offscreen == NULL)
+    g_error ("could not create offscreen framebuffer");
+
+  fb = COGL_FRAMEBUFFER (engine->offscreen);
+  cogl_framebuffer_allocate (fb, NULL);
+
+  engine->width = cogl_framebuffer_get_width (fb);
+  engine->height = cogl_framebuffer_get_height (fb);
+}
+
 void
 rig_engine_init (RutShell *shell, void *user_data)
 {
@@ -1863,6 +2088,14 @@ rig_engine_init (RutShell *shell, void *user_data)
 
   cogl_matrix_init_identity (&engine->identity);
 
+  /* Devices only play back the UI so nothing needs to read the value
+   * of a bound property before the next paint. That means we can
+   * batch up property updates so that each binding is only updated
+   * once per frame. */
+  if (_rig_in_device_mode)
+    rut_property_context_set_defer_updates (&engine->ctx->property_ctx,
+                                            TRUE);
+
   for (i = 0; i < RIG_ENGINE_N_PROPS; i++)
     rut_property_init (&engine->properties[i],
                        &rut_data_property_specs[i],
@@ -1979,6 +2212,13 @@ rig_engine_init (RutShell *shell, void *user_data)
     }
 #endif
 
+  if (engine->headless)
+    {
+      init_headless_framebuffer (engine);
+      allocate (engine);
+      return;
+    }
+
 #ifdef RIG_EDITOR_ENABLED
   if (!_rig_in_device_mode)
     {
@@ -2083,7 +2323,10 @@ rig_engine_fini (RutShell *shell, void *user_data)
     }
 #endif
 
-  cogl_object_unref (engine->onscreen);
+  if (engine->headless)
+    cogl_object_unref (engine->offscreen);
+  else
+    cogl_object_unref (engine->onscreen);
 
 #ifdef __APPLE__
   rig_osx_deinit (engine);
@@ -2224,29 +2467,43 @@ rig_lookup_asset (RigEngine *engine,
   return g_hash_table_lookup (engine->assets_registry, path);
 }
 
-RutAsset *
-rig_load_asset (RigEngine *engine, GFileInfo *info, GFile *asset_file)
+static RutAsset *
+load_asset_full (RigEngine *engine,
+                 GFileInfo *info,
+                 GFile *asset_file,
+                 CoglBool lazy)
 {
   GFile *assets_dir = g_file_new_for_path (engine->ctx->assets_location);
   GFile *dir = g_file_get_parent (asset_file);
   char *path = g_file_get_relative_path (assets_dir, asset_file);
   GList *inferred_tags = NULL;
+  RutAssetType type;
   RutAsset *asset = NULL;
 
   inferred_tags = rut_infer_asset_tags (engine->ctx, info, asset_file);
 
   if (rut_util_find_tag (inferred_tags, "normal-maps"))
-    asset = rut_asset_new_normal_map (engine->ctx, path);
+    type = RUT_ASSET_TYPE_NORMAL_MAP;
   else if (rut_util_find_tag (inferred_tags, "alpha-masks"))
-    asset = rut_asset_new_alpha_mask (engine->ctx, path);
+    type = RUT_ASSET_TYPE_ALPHA_MASK;
   else if (rut_util_find_tag (inferred_tags, "image"))
-    asset = rut_asset_new_texture (engine->ctx, path);
+    type = RUT_ASSET_TYPE_TEXTURE;
   else if (rut_util_find_tag (inferred_tags, "ply"))
-    asset = rut_asset_new_ply_model (engine->ctx, path);
+    type = RUT_ASSET_TYPE_PLY_MODEL;
+  else
+    goto DONE;
 
-  if (asset)
-    rut_asset_set_inferred_tags (asset, inferred_tags);
+  /* Lazy assets aren't decoded until something needs them. Otherwise
+   * the assets are decoded on separate threads so that loading lots
+   * of them doesn't block the UI */
+  if (lazy)
+    asset = rut_asset_new_lazy (engine->ctx, path, type);
+  else
+    asset = rut_asset_new_async (engine->ctx, path, type);
 
+  rut_asset_set_inferred_tags (asset, inferred_tags);
+
+DONE:
   g_list_free (inferred_tags);
 
   g_object_unref (assets_dir);
@@ -2256,6 +2513,12 @@ rig_load_asset (RigEngine *engine, GFileInfo *info, GFile *asset_file)
   return asset;
 }
 
+RutAsset *
+rig_load_asset (RigEngine *engine, GFileInfo *info, GFile *asset_file)
+{
+  return load_asset_full (engine, info, asset_file, FALSE);
+}
+
 #ifdef RIG_EDITOR_ENABLED
 
 static void
@@ -2275,7 +2538,9 @@ add_asset (RigEngine *engine, GFileInfo *info, GFile *asset_file)
         return;
     }
 
-  asset = rig_load_asset (engine, info, asset_file);
+  /* The asset browser only shows thumbnails so the assets themselves
+   * aren't decoded until they are added to the scene */
+  asset = load_asset_full (engine, info, asset_file, TRUE);
   if (asset)
     engine->assets = g_list_prepend (engine->assets, asset);
 }
@@ -2475,6 +2740,21 @@ rig_load_asset_list (RigEngine *engine)
 {
   GFile *assets_dir = g_file_new_for_path (engine->ctx->assets_location);
 
+  if (!engine->thumbnail_cache)
+    {
+      char *filename = g_build_filename (engine->ctx->assets_location,
+                                         ".rig-cache",
+                                         "thumbnails.atlas",
+                                         NULL);
+      engine->thumbnail_cache =
+        rut_thumbnail_cache_new (engine->ctx, filename);
+      rut_thumbnail_cache_add_ready_callback (engine->thumbnail_cache,
+                                              thumbnail_ready_cb,
+                                              engine,
+                                              NULL); /* destroy */
+      g_free (filename);
+    }
+
   enumerate_dir_for_assets (engine, assets_dir);
 
   rut_refable_ref (engine->diamond_builtin_asset);
@@ -2491,7 +2771,7 @@ rig_load_asset_list (RigEngine *engine)
 
   g_object_unref (assets_dir);
 
-  rig_search_asset_list (engine, NULL);
+  rig_rebuild_asset_browser (engine);
 }
 #endif
 
@@ -2503,3 +2783,13 @@ rig_engine_sync_slaves (RigEngine *engine)
   for (l = engine->slave_masters; l; l = l->next)
     rig_slave_master_sync_ui (l->data);
 }
+
+void
+rig_engine_sync_slaves_edit (RigEngine *engine,
+                             UndoRedo *undo_redo)
+{
+  GList *l;
+
+  for (l = engine->slave_masters; l; l = l->next)
+    rig_slave_master_sync_edit (l->data, undo_redo);
+}
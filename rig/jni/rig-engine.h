@@ -31,9 +31,12 @@
 #include "rig-types.h"
 #include "rig-undo-journal.h"
 #include "rut-box-layout.h"
+#include "rut-thumbnail-cache.h"
+#include "rig-asset-index.h"
 #include "rig-osx.h"
 #include "rig-split-view.h"
 #include "rig-camera-view.h"
+#include "rig-renderer.h"
 
 enum {
   RIG_ENGINE_PROP_WIDTH,
@@ -44,6 +47,10 @@ enum {
   RIG_ENGINE_N_PROPS
 };
 
+/* How much memory the serialization stack keeps hold of after
+ * loading or saving a large UI */
+#define RIG_SERIALIZATION_STACK_RETAINED_SIZE (1024 * 1024)
+
 struct _RigEngine
 {
   CoglBool play_mode;
@@ -73,11 +80,20 @@ struct _RigEngine
   RutContext *ctx;
   CoglOnscreen *onscreen;
 
+  /* If this is set before calling rig_engine_init() then the engine
+   * renders into an offscreen framebuffer instead of creating a
+   * window. The size of the framebuffer can be given by setting
+   * width and height beforehand. */
+  CoglBool headless;
+  CoglOffscreen *offscreen;
+
 #ifdef RIG_EDITOR_ENABLED
   RutMemoryStack *serialization_stack;
 #endif
 
   GArray *journal;
+  RigCullCounters cull_counters[RIG_N_PASSES];
+  RigUniformCounters uniform_counters[RIG_N_PASSES];
 
   RigUndoJournal *undo_journal;
 
@@ -138,12 +154,18 @@ struct _RigEngine
 
   RutUIViewport *assets_vp;
   RutFold *assets_results_fold;
-  RutFlowLayout *assets_flow;
+  RutVirtualGrid *assets_grid;
+  /* An index of the assets for searching along with the ids of the
+   * assets that match the current search. Each item of assets_grid
+   * shows the asset of the corresponding id */
+  RigAssetIndex *asset_index;
+  GArray *asset_matches;
   RutAsset *text_builtin_asset;
   RutAsset *circle_builtin_asset;
   RutAsset *diamond_builtin_asset;
   GList *asset_input_closures;
   GList *asset_enumerators;
+  RutThumbnailCache *thumbnail_cache;
 
   RutUIViewport *tool_vp;
   RutBoxLayout *inspector_box_layout;
@@ -217,6 +239,13 @@ struct _RigEngine
   CoglSnippet *simple_lighting_snippet;
   CoglSnippet *shadow_mapping_fragment_snippet;
 
+  /* State used to draw batches of models. See draw_batch() in
+   * rig-renderer.c */
+  GHashTable *batch_positions;
+  CoglVertexP3 *batch_vertices;
+  CoglAttributeBuffer *batch_buffer;
+  CoglPrimitive *batch_primitive;
+
   GHashTable *assets_registry;
 
   int rpc_server_port;
@@ -233,6 +262,10 @@ struct _RigEngine
 
   GList *slave_masters;
 
+  /* The minimum time in milliseconds between updates sent to each
+   * slave. Edits made in between are coalesced. */
+  int slave_sync_interval;
+
   RutProperty properties[RIG_ENGINE_N_PROPS];
 };
 
@@ -297,4 +330,10 @@ rig_set_play_mode_enabled (RigEngine *engine, CoglBool enabled);
 void
 rig_engine_sync_slaves (RigEngine *engine);
 
+/* Sends just the effect of an operation that has been applied to the
+ * UI to all of the connected slaves */
+void
+rig_engine_sync_slaves_edit (RigEngine *engine,
+                             UndoRedo *undo_redo);
+
 #endif /* _RUT_ENGINE_H_ */
@@ -0,0 +1,141 @@
+/*
+ * Rig
+ *
+ * Copyright (C) 2013  Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _RIG_JOURNAL_SORT_H_
+#define _RIG_JOURNAL_SORT_H_
+
+#include <stdint.h>
+
+#include <glib.h>
+
+#include "rut-util.h"
+
+/*
+ * The renderer's journal entries are sorted according to a 64-bit
+ * key. The most significant bits hold the pass and whether the
+ * geometry is blended. For blended geometry the depth comes next so
+ * that entries are drawn back-to-front and only entries at the same
+ * depth are grouped by state. For everything else the entries are
+ * grouped by pipeline and then by material to minimize state changes
+ * and within each group they are drawn front-to-back.
+ *
+ *  63-62 | 61      | 60 ................................... 0
+ *  pass  | blended | pipeline:20 | material:16 | depth:24
+ *  pass  | blended | ~depth:24   | pipeline:20 | material:16
+ *
+ * The material bits also include the geometry so that entries which
+ * can be batched together end up adjacent.
+ *
+ * This only depends on Rut so that tools/journal-sort-bench.c can
+ * measure exactly what the renderer does.
+ */
+
+#define RIG_SORT_KEY_PASS_SHIFT 62
+#define RIG_SORT_KEY_BLENDED_SHIFT 61
+#define RIG_SORT_KEY_PIPELINE_BITS 20
+#define RIG_SORT_KEY_MATERIAL_BITS 16
+#define RIG_SORT_KEY_DEPTH_BITS 24
+
+/* Maps a float to an unsigned integer with the same ordering */
+static inline uint32_t
+rig_journal_float_to_sortable_bits (float value)
+{
+  union { float f; uint32_t i; } bits;
+
+  bits.f = value;
+
+  /* Flipping the sign bit of positive numbers puts them above the
+   * negative numbers and inverting the negative numbers reverses
+   * their order because their magnitude is stored separately */
+  if (bits.i & 0x80000000)
+    return ~bits.i;
+  else
+    return bits.i | 0x80000000;
+}
+
+static inline uint64_t
+rig_journal_hash_pointer_bits (void *pointer, int n_bits)
+{
+  unsigned int hash = rut_util_one_at_a_time_hash (0,
+                                                   &pointer,
+                                                   sizeof (pointer));
+
+  return rut_util_one_at_a_time_mix (hash) & ((1 << n_bits) - 1);
+}
+
+/* @distance is the distance from the camera along the view
+ * direction. @geometry should be the same for all entries that could
+ * be drawn with the same vertex data */
+static inline uint64_t
+rig_journal_make_sort_key (int pass,
+                           gboolean blended,
+                           void *pipeline,
+                           void *material,
+                           void *geometry,
+                           float distance)
+{
+  uint64_t depth =
+    rig_journal_float_to_sortable_bits (distance) >>
+    (32 - RIG_SORT_KEY_DEPTH_BITS);
+  uint64_t pipeline_bits =
+    rig_journal_hash_pointer_bits (pipeline, RIG_SORT_KEY_PIPELINE_BITS);
+  void *state[2] = { material, geometry };
+  unsigned int state_hash =
+    rut_util_one_at_a_time_hash (0, state, sizeof (state));
+  uint64_t material_bits =
+    rut_util_one_at_a_time_mix (state_hash) &
+    ((1 << RIG_SORT_KEY_MATERIAL_BITS) - 1);
+  uint64_t key = (uint64_t) pass << RIG_SORT_KEY_PASS_SHIFT;
+
+  if (blended)
+    {
+      /* Inverting the depth sorts the furthest entries first */
+      depth = ~depth & ((1 << RIG_SORT_KEY_DEPTH_BITS) - 1);
+
+      key |= (uint64_t) 1 << RIG_SORT_KEY_BLENDED_SHIFT;
+      key |= depth << (RIG_SORT_KEY_PIPELINE_BITS +
+                       RIG_SORT_KEY_MATERIAL_BITS);
+      key |= pipeline_bits << RIG_SORT_KEY_MATERIAL_BITS;
+      key |= material_bits;
+    }
+  else
+    {
+      key |= pipeline_bits << (RIG_SORT_KEY_MATERIAL_BITS +
+                               RIG_SORT_KEY_DEPTH_BITS);
+      key |= material_bits << RIG_SORT_KEY_DEPTH_BITS;
+      key |= depth;
+    }
+
+  return key;
+}
+
+/* Sorts an array of entries that each contain a key made with
+ * rig_journal_make_sort_key() at @key_offset */
+static inline void
+rig_journal_sort (void *entries,
+                  size_t n_entries,
+                  size_t entry_size,
+                  size_t key_offset)
+{
+  rut_util_radix_sort (entries, n_entries, entry_size, key_offset);
+}
+
+#endif /* _RIG_JOURNAL_SORT_H_ */
@@ -86,10 +86,16 @@ rig_save (RigEngine *engine, const char *path)
   if (stat (engine->ctx->assets_location, &sb) == -1)
     mkdir (engine->ctx->assets_location, 0777);
 
+  rut_memory_stack_push_frame (engine->serialization_stack);
+
   ui = rig_pb_serialize_ui (engine, NULL, NULL);
 
   rig__ui__pack_to_buffer (ui, &buffered_file.base );
 
+  rut_memory_stack_pop_frame (engine->serialization_stack);
+  rut_memory_stack_trim (engine->serialization_stack,
+                         RIG_SERIALIZATION_STACK_RETAINED_SIZE);
+
   fclose (fp);
 }
 
@@ -113,8 +119,8 @@ rig_load (RigEngine *engine, const char *file)
   /* We use a special allocator while unpacking protocol buffers
    * that lets us use the serialization_stack. This means much
    * less mucking about with the heap since the serialization_stack
-   * is a persistant, growable stack which we can just rewind
-   * very cheaply before unpacking */
+   * is a persistant, growable stack from which everything can be
+   * freed very cheaply by popping a frame after unserializing */
   ProtobufCAllocator protobuf_c_allocator =
     {
       rut_memory_stack_alloc,
@@ -151,12 +157,18 @@ rig_load (RigEngine *engine, const char *file)
       return;
     }
 
+  rut_memory_stack_push_frame (engine->serialization_stack);
+
   ui = rig__ui__unpack (&protobuf_c_allocator, len, contents);
 
   rig_pb_unserialize_ui (engine, ui);
 
   rig__ui__free_unpacked (ui, &protobuf_c_allocator);
 
+  rut_memory_stack_pop_frame (engine->serialization_stack);
+  rut_memory_stack_trim (engine->serialization_stack,
+                         RIG_SERIALIZATION_STACK_RETAINED_SIZE);
+
   if (needs_munmap)
     munmap (contents, len);
   else
@@ -22,9 +22,29 @@
 #endif
 
 #include <math.h>
+#include <string.h>
 
 #include "rig-node.h"
 
+/* Transitions can have very large numbers of nodes so they are
+ * allocated from pools */
+static RutObjectPool float_node_pool =
+  RUT_OBJECT_POOL_INIT ("RigNodeFloat", RigNodeFloat);
+static RutObjectPool double_node_pool =
+  RUT_OBJECT_POOL_INIT ("RigNodeDouble", RigNodeDouble);
+static RutObjectPool integer_node_pool =
+  RUT_OBJECT_POOL_INIT ("RigNodeInteger", RigNodeInteger);
+static RutObjectPool uint32_node_pool =
+  RUT_OBJECT_POOL_INIT ("RigNodeUint32", RigNodeUint32);
+static RutObjectPool vec3_node_pool =
+  RUT_OBJECT_POOL_INIT ("RigNodeVec3", RigNodeVec3);
+static RutObjectPool vec4_node_pool =
+  RUT_OBJECT_POOL_INIT ("RigNodeVec4", RigNodeVec4);
+static RutObjectPool quaternion_node_pool =
+  RUT_OBJECT_POOL_INIT ("RigNodeQuaternion", RigNodeQuaternion);
+static RutObjectPool color_node_pool =
+  RUT_OBJECT_POOL_INIT ("RigNodeColor", RigNodeColor);
+
 void
 rig_node_integer_lerp (RigNodeInteger *a,
                        RigNodeInteger *b,
@@ -278,43 +298,27 @@ rig_node_box (RutPropertyType type,
   return FALSE;
 }
 
-void
-rig_node_free (RutPropertyType type,
-               void *node)
+static RutObjectPool *
+get_node_pool (RutPropertyType type)
 {
   switch (type)
     {
     case RUT_PROPERTY_TYPE_FLOAT:
-      g_slice_free (RigNodeFloat, node);
-      return;
-
+      return &float_node_pool;
     case RUT_PROPERTY_TYPE_DOUBLE:
-      g_slice_free (RigNodeDouble, node);
-      return;
-
+      return &double_node_pool;
     case RUT_PROPERTY_TYPE_INTEGER:
-      g_slice_free (RigNodeInteger, node);
-      return;
-
+      return &integer_node_pool;
     case RUT_PROPERTY_TYPE_UINT32:
-      g_slice_free (RigNodeUint32, node);
-      return;
-
+      return &uint32_node_pool;
     case RUT_PROPERTY_TYPE_VEC3:
-      g_slice_free (RigNodeVec3, node);
-      return;
-
+      return &vec3_node_pool;
     case RUT_PROPERTY_TYPE_VEC4:
-      g_slice_free (RigNodeVec4, node);
-      return;
-
+      return &vec4_node_pool;
     case RUT_PROPERTY_TYPE_QUATERNION:
-      g_slice_free (RigNodeQuaternion, node);
-      return;
-
+      return &quaternion_node_pool;
     case RUT_PROPERTY_TYPE_COLOR:
-      g_slice_free (RigNodeColor, node);
-      return;
+      return &color_node_pool;
 
       /* These types shouldn't become nodes */
     case RUT_PROPERTY_TYPE_ENUM:
@@ -326,12 +330,40 @@ rig_node_free (RutPropertyType type,
     }
 
   g_warn_if_reached ();
+
+  return NULL;
+}
+
+void
+rig_node_free (RutPropertyType type,
+               void *node)
+{
+  RutObjectPool *pool = get_node_pool (type);
+
+  if (pool)
+    rut_object_pool_free (pool, node);
+}
+
+RigNode *
+rig_node_copy (RutPropertyType type,
+               RigNode *node)
+{
+  RutObjectPool *pool = get_node_pool (type);
+  RigNode *copy;
+
+  if (pool == NULL)
+    return NULL;
+
+  copy = rut_object_pool_alloc (pool);
+  memcpy (copy, node, pool->object_size);
+
+  return copy;
 }
 
 RigNodeInteger *
 rig_node_new_for_integer (float t, int value)
 {
-  RigNodeInteger *node = g_slice_new (RigNodeInteger);
+  RigNodeInteger *node = rut_object_pool_alloc (&integer_node_pool);
   node->base.t = t;
   node->value = value;
   return node;
@@ -340,7 +372,7 @@ rig_node_new_for_integer (float t, int value)
 RigNodeUint32 *
 rig_node_new_for_uint32 (float t, uint32_t value)
 {
-  RigNodeUint32 *node = g_slice_new (RigNodeUint32);
+  RigNodeUint32 *node = rut_object_pool_alloc (&uint32_node_pool);
   node->base.t = t;
   node->value = value;
   return node;
@@ -349,7 +381,7 @@ rig_node_new_for_uint32 (float t, uint32_t value)
 RigNodeFloat *
 rig_node_new_for_float (float t, float value)
 {
-  RigNodeFloat *node = g_slice_new (RigNodeFloat);
+  RigNodeFloat *node = rut_object_pool_alloc (&float_node_pool);
   node->base.t = t;
   node->value = value;
   return node;
@@ -358,7 +390,7 @@ rig_node_new_for_float (float t, float value)
 RigNodeDouble *
 rig_node_new_for_double (float t, double value)
 {
-  RigNodeDouble *node = g_slice_new (RigNodeDouble);
+  RigNodeDouble *node = rut_object_pool_alloc (&double_node_pool);
   node->base.t = t;
   node->value = value;
   return node;
@@ -367,7 +399,7 @@ rig_node_new_for_double (float t, double value)
 RigNodeVec3 *
 rig_node_new_for_vec3 (float t, const float value[3])
 {
-  RigNodeVec3 *node = g_slice_new (RigNodeVec3);
+  RigNodeVec3 *node = rut_object_pool_alloc (&vec3_node_pool);
   node->base.t = t;
   memcpy (node->value, value, sizeof (float) * 3);
   return node;
@@ -376,7 +408,7 @@ rig_node_new_for_vec3 (float t, const float value[3])
 RigNodeVec4 *
 rig_node_new_for_vec4 (float t, const float value[4])
 {
-  RigNodeVec4 *node = g_slice_new (RigNodeVec4);
+  RigNodeVec4 *node = rut_object_pool_alloc (&vec4_node_pool);
   node->base.t = t;
   memcpy (node->value, value, sizeof (float) * 4);
   return node;
@@ -385,7 +417,7 @@ rig_node_new_for_vec4 (float t, const float value[4])
 RigNodeQuaternion *
 rig_node_new_for_quaternion (float t, const CoglQuaternion *value)
 {
-  RigNodeQuaternion *node = g_slice_new (RigNodeQuaternion);
+  RigNodeQuaternion *node = rut_object_pool_alloc (&quaternion_node_pool);
   node->base.t = t;
   node->value = *value;
 
@@ -395,7 +427,7 @@ rig_node_new_for_quaternion (float t, const CoglQuaternion *value)
 RigNodeColor *
 rig_node_new_for_color (float t, const CoglColor *value)
 {
-  RigNodeColor *node = g_slice_new (RigNodeColor);
+  RigNodeColor *node = rut_object_pool_alloc (&color_node_pool);
   node->base.t = t;
   node->value = *value;
 
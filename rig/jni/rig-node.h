@@ -134,6 +134,10 @@ void
 rig_node_free (RutPropertyType type,
                void *node);
 
+RigNode *
+rig_node_copy (RutPropertyType type,
+               RigNode *node);
+
 RigNodeFloat *
 rig_node_new_for_float (float t, float value);
 
@@ -37,6 +37,8 @@ _rig_path_free (void *object)
   rut_list_for_each_safe (node, t, &path->nodes, list_node)
     rig_node_free (path->type, node);
 
+  g_array_free (path->index, TRUE);
+
   rut_refable_unref (path->ctx);
   g_slice_free (RigPath, path);
 }
@@ -81,67 +83,132 @@ rig_path_new (RutContext *ctx,
   path->type = type;
 
   rut_list_init (&path->nodes);
-  path->pos = NULL;
+  path->index = g_array_new (FALSE, FALSE, sizeof (RigPathIndexEntry));
+  path->pos = 0;
   path->length = 0;
+  path->age = 0;
 
   rut_list_init (&path->operation_cb_list);
 
   return path;
 }
 
-static size_t
-get_type_size (RutPropertyType type)
-{
-  switch (type)
-    {
-    case RUT_PROPERTY_TYPE_FLOAT:
-      return sizeof (RigNodeFloat);
-    case RUT_PROPERTY_TYPE_DOUBLE:
-      return sizeof (RigNodeDouble);
-    case RUT_PROPERTY_TYPE_INTEGER:
-      return sizeof (RigNodeInteger);
-    case RUT_PROPERTY_TYPE_UINT32:
-      return sizeof (RigNodeUint32);
-    case RUT_PROPERTY_TYPE_VEC3:
-      return sizeof (RigNodeVec3);
-    case RUT_PROPERTY_TYPE_VEC4:
-      return sizeof (RigNodeVec4);
-    case RUT_PROPERTY_TYPE_COLOR:
-      return sizeof (RigNodeColor);
-    case RUT_PROPERTY_TYPE_QUATERNION:
-      return sizeof (RigNodeQuaternion);
-      /* These types of properties can't be interoplated so they
-       * probably shouldn't end up in a path */
-    case RUT_PROPERTY_TYPE_ENUM:
-    case RUT_PROPERTY_TYPE_BOOLEAN:
-    case RUT_PROPERTY_TYPE_TEXT:
-    case RUT_PROPERTY_TYPE_OBJECT:
-    case RUT_PROPERTY_TYPE_POINTER:
-      break;
-    }
-
-  g_warn_if_reached ();
-
-  return sizeof (RigNode);
-}
-
 RigPath *
 rig_path_copy (RigPath *old_path)
 {
   RigPath *new_path = rig_path_new (old_path->ctx, old_path->type);
-  size_t node_size = get_type_size (old_path->type);
   RigNode *node;
 
+  g_array_set_size (new_path->index, old_path->length);
+
   rut_list_for_each (node, &old_path->nodes, list_node)
     {
-      RigNode *new_node = g_slice_copy (node_size, node);
+      RigNode *new_node = rig_node_copy (old_path->type, node);
+      RigPathIndexEntry *entry = &g_array_index (new_path->index,
+                                                 RigPathIndexEntry,
+                                                 new_path->length);
+
       rut_list_insert (new_path->nodes.prev, &new_node->list_node);
+
+      entry->t = new_node->t;
+      entry->node = new_node;
+      new_path->length++;
     }
-  new_path->length = old_path->length;
 
   return new_path;
 }
 
+/* Returns the index of the first node with a time greater than t,
+ * or path->length if there isn't one */
+static int
+path_find_upper_bound (RigPath *path,
+                       float t)
+{
+  RigPathIndexEntry *entries = (RigPathIndexEntry *) path->index->data;
+  int low = 0, high = path->length;
+
+  while (low < high)
+    {
+      int mid = low + (high - low) / 2;
+
+      if (entries[mid].t > t)
+        high = mid;
+      else
+        low = mid + 1;
+    }
+
+  return low;
+}
+
+/* Returns the index of the first node with a time greater than or
+ * equal to t, or path->length if there isn't one */
+static int
+path_find_lower_bound (RigPath *path,
+                       float t)
+{
+  RigPathIndexEntry *entries = (RigPathIndexEntry *) path->index->data;
+  int low = 0, high = path->length;
+
+  while (low < high)
+    {
+      int mid = low + (high - low) / 2;
+
+      if (entries[mid].t >= t)
+        high = mid;
+      else
+        low = mid + 1;
+    }
+
+  return low;
+}
+
+/* Returns the index of the last node with a time less than or equal
+ * to t or -1 if there isn't one. The cached position and the node
+ * following it are checked before resorting to a binary search. */
+static int
+path_find_forwards (RigPath *path,
+                    float t)
+{
+  RigPathIndexEntry *entries = (RigPathIndexEntry *) path->index->data;
+  int pos;
+
+  for (pos = path->pos; pos < path->pos + 2 && pos < path->length; pos++)
+    {
+      if (entries[pos].t <= t &&
+          (pos + 1 >= path->length || entries[pos + 1].t > t))
+        return pos;
+    }
+
+  return path_find_upper_bound (path, t) - 1;
+}
+
+/* Returns the index of the first node with a time greater than or
+ * equal to t or path->length if there isn't one */
+static int
+path_find_backwards (RigPath *path,
+                     float t)
+{
+  RigPathIndexEntry *entries = (RigPathIndexEntry *) path->index->data;
+  int pos;
+
+  for (pos = path->pos; pos > path->pos - 2 && pos >= 0; pos--)
+    {
+      if (pos < path->length &&
+          entries[pos].t >= t &&
+          (pos == 0 || entries[pos - 1].t < t))
+        return pos;
+    }
+
+  return path_find_lower_bound (path, t);
+}
+
+static RigNode *
+path_get_node (RigPath *path,
+               int pos)
+{
+  return g_array_index (path->index, RigPathIndexEntry, pos).node;
+}
+
 /* Finds 1 point either side of the given t using the direction to resolve
  * which points to choose if t corresponds to a specific node.
  */
@@ -152,16 +219,11 @@ path_find_control_points2 (RigPath *path,
                            RigNode **n0,
                            RigNode **n1)
 {
-  RigNode *pos;
+  int pos;
 
-  if (G_UNLIKELY (rut_list_empty (&path->nodes)))
+  if (G_UNLIKELY (path->length == 0))
     return FALSE;
 
-  if (G_UNLIKELY (path->pos == NULL))
-    path->pos = rut_container_of (path->nodes.next, path->pos, list_node);
-
-  pos = path->pos;
-
   /*
    * Note:
    *
@@ -171,70 +233,39 @@ path_find_control_points2 (RigPath *path,
 
   if (direction > 0)
     {
-      if (pos->t > t)
-        {
-          /* > --- T -------- Pos ---- */
-          RigNode *tmp = rig_nodes_find_less_than_equal (pos, &path->nodes, t);
-          if (!tmp)
-            {
-              *n0 = *n1 = path->pos =
-                rut_container_of (path->nodes.next, path->pos, list_node);
-              return TRUE;
-            }
-          pos = tmp;
-        }
-      else
+      pos = path_find_forwards (path, t);
+
+      if (pos < 0)
         {
-          /* > --- Pos -------- T ---- */
-          RigNode *tmp = rig_nodes_find_greater_than (pos, &path->nodes, t);
-          if (!tmp)
-            {
-              *n0 = *n1 = path->pos =
-                rut_container_of (path->nodes.prev, path->pos, list_node);
-              return TRUE;
-            }
-          pos = rut_container_of (tmp->list_node.prev, pos, list_node);
+          /* > --- T -------- First ---- */
+          path->pos = 0;
+          *n0 = *n1 = path_get_node (path, 0);
+          return TRUE;
         }
 
-      *n0 = pos;
-      if (pos->list_node.next == &path->nodes)
-        *n1 = pos;
+      *n0 = path_get_node (path, pos);
+      if (pos + 1 >= path->length)
+        *n1 = *n0;
       else
-        *n1 = rut_container_of (pos->list_node.next, *n1, list_node);
+        *n1 = path_get_node (path, pos + 1);
     }
   else
     {
-      if (pos->t > t)
-        {
-          /* < --- T -------- Pos ---- */
-          RigNode *tmp = rig_nodes_find_less_than (pos, &path->nodes, t);
-          if (!tmp)
-            {
-              *n0 = *n1 = path->pos =
-                rut_container_of (path->nodes.next, path->pos, list_node);
-              return TRUE;
-            }
-          pos = rut_container_of (tmp->list_node.next, pos, list_node);
-        }
-      else
+      pos = path_find_backwards (path, t);
+
+      if (pos >= path->length)
         {
-          /* < --- Pos -------- T ---- */
-          RigNode *tmp =
-            rig_nodes_find_greater_than_equal (pos, &path->nodes, t);
-          if (!tmp)
-            {
-              *n0 = *n1 = path->pos =
-                rut_container_of (path->nodes.prev, path->pos, list_node);
-              return TRUE;
-            }
-          pos = tmp;
+          /* < --- Last -------- T ---- */
+          path->pos = path->length - 1;
+          *n0 = *n1 = path_get_node (path, path->pos);
+          return TRUE;
         }
 
-      *n0 = pos;
-      if (pos->list_node.prev == &path->nodes)
-        *n1 = pos;
+      *n0 = path_get_node (path, pos);
+      if (pos == 0)
+        *n1 = *n0;
       else
-        *n1 = rut_container_of (pos->list_node.prev, *n1, list_node);
+        *n1 = path_get_node (path, pos - 1);
     }
 
   path->pos = pos;
@@ -334,6 +365,8 @@ static void
 notify_node_added (RigPath *path,
                    RigNode *node)
 {
+  path->age++;
+
   rut_closure_list_invoke (&path->operation_cb_list,
                            RigPathOperationCallback,
                            path,
@@ -345,6 +378,8 @@ static void
 notify_node_modified (RigPath *path,
                       RigNode *node)
 {
+  path->age++;
+
   rut_closure_list_invoke (&path->operation_cb_list,
                            RigPathOperationCallback,
                            path,
@@ -356,30 +391,61 @@ RigNode *
 rig_path_find_node (RigPath *path,
                     float t)
 {
-  RigNode *node;
+  int pos = path_find_lower_bound (path, t);
 
-  rut_list_for_each (node, &path->nodes, list_node)
-    if (node->t == t)
-      return node;
+  if (pos < path->length && path_get_node (path, pos)->t == t)
+    return path_get_node (path, pos);
 
   return NULL;
 }
 
+/* Returns the position of the node in the index */
+static int
+path_find_node_index (RigPath *path,
+                      RigNode *node)
+{
+  int pos;
+
+  /* Nodes normally have unique times but we check the pointer
+   * anyway in case moving a node has made two of them equal */
+  for (pos = path_find_lower_bound (path, node->t);
+       pos < path->length && path_get_node (path, pos)->t == node->t;
+       pos++)
+    if (path_get_node (path, pos) == node)
+      return pos;
+
+  /* If the time of the node was modified without going through
+   * rig_path_move_node() then the index will be out of date so we
+   * fallback to a linear search */
+  for (pos = 0; pos < path->length; pos++)
+    if (path_get_node (path, pos) == node)
+      return pos;
+
+  g_warn_if_reached ();
+
+  return -1;
+}
+
 static void
 insert_sorted_node (RigPath *path,
                     RigNode *node)
 {
-  RigNode *insertion_point;
-
-  rut_list_for_each (insertion_point, &path->nodes, list_node)
-    if (insertion_point->t >= node->t)
-      break;
+  int pos = path_find_lower_bound (path, node->t);
+  RigPathIndexEntry entry;
+  RutList *insertion_point;
+
+  /* If there is no later node then we insert before the list head
+   * which is the same as appending */
+  if (pos < path->length)
+    insertion_point = &path_get_node (path, pos)->list_node;
+  else
+    insertion_point = &path->nodes;
 
-  /* If no node was found then insertion_point will be pointing to an
-   * imaginary node containing the list head which is what we want
-   * anyway */
+  rut_list_insert (insertion_point->prev, &node->list_node);
 
-  rut_list_insert (insertion_point->list_node.prev, &node->list_node);
+  entry.t = node->t;
+  entry.node = node;
+  g_array_insert_val (path->index, pos, entry);
 
   path->length++;
 }
@@ -767,17 +833,25 @@ void
 rig_path_remove_node (RigPath *path,
                       RigNode *node)
 {
+  int pos;
+
+  path->age++;
+
   rut_closure_list_invoke (&path->operation_cb_list,
                            RigPathOperationCallback,
                            path,
                            RIG_PATH_OPERATION_REMOVED,
                            node);
+  pos = path_find_node_index (path, node);
+  if (pos >= 0)
+    g_array_remove_index (path->index, pos);
+
   rut_list_remove (&node->list_node);
   rig_node_free (path->type, node);
   path->length--;
 
-  if (path->pos == node)
-    path->pos = NULL;
+  if (path->pos >= path->length)
+    path->pos = 0;
 }
 
 void
@@ -785,8 +859,17 @@ rig_path_move_node (RigPath *path,
                     RigNode *node,
                     float new_value)
 {
+  int pos = path_find_node_index (path, node);
+
   node->t = new_value;
 
+  /* The node isn't allowed to change order so only the time in the
+   * index needs updating */
+  if (pos >= 0)
+    g_array_index (path->index, RigPathIndexEntry, pos).t = new_value;
+
+  path->age++;
+
   rut_closure_list_invoke (&path->operation_cb_list,
                            RigPathOperationCallback,
                            path,
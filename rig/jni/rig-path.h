@@ -26,6 +26,12 @@
 
 typedef struct _RigPath RigPath;
 
+typedef struct _RigPathIndexEntry
+{
+  float t;
+  RigNode *node;
+} RigPathIndexEntry;
+
 struct _RigPath
 {
   RutObjectProps _parent;
@@ -34,7 +40,21 @@ struct _RigPath
   RutPropertyType type;
   RutList nodes;
   int length;
-  RigNode *pos;
+
+  /* An array of RigPathIndexEntrys in the same order as the nodes
+   * list so that the nodes either side of a time can be found with a
+   * binary search */
+  GArray *index;
+  /* The position in the index of the last node found by
+   * path_find_control_points2(). This is checked first so that
+   * sequential playback usually doesn't need to search at all. */
+  int pos;
+
+  /* This is incremented whenever a node is added, removed, modified
+   * or moved so that anything caching data derived from the nodes
+   * can tell when it needs to be updated */
+  unsigned int age;
+
   RutList operation_cb_list;
 
   int ref_count;
@@ -41,10 +41,33 @@ typedef struct _Serializer
   int n_pb_properties;
   GList *pb_properties;
 
+  int n_pb_edits;
+  GList *pb_edits;
+
+  /* Assets referenced while serializing an edit */
+  int n_pb_assets;
+  GList *pb_assets;
+
+  CoglBool serializing_edit;
+
+  /* Set if an edit refers to an object that has no id */
+  CoglBool missing_ids;
+
   int next_id;
   GHashTable *id_map;
 } Serializer;
 
+struct _RigPBRegistry
+{
+  /* Maps object pointers to uint64_t ids while serializing */
+  GHashTable *object_to_id;
+
+  /* Maps uint64_t ids to objects while unserializing */
+  GHashTable *id_to_object;
+
+  int next_id;
+};
+
 typedef void (*PBMessageInitFunc) (void *message);
 
 static void *
@@ -338,12 +361,27 @@ serializer_lookup_object_id (Serializer *serializer, void *object)
 {
   uint64_t *id = g_hash_table_lookup (serializer->id_map, object);
 
-  g_warn_if_fail (id);
+  /* An edit may refer to an object that was created after the UI was
+   * serialized in which case the whole UI has to be sent again */
+  if (id == NULL)
+    {
+      g_warn_if_fail (serializer->serializing_edit);
+      serializer->missing_ids = TRUE;
+      return 0;
+    }
 
   if (rut_object_get_type (object) == &rut_asset_type)
     {
       if (serializer->asset_callback)
         serializer->asset_callback (object, serializer->user_data);
+
+      if (serializer->serializing_edit &&
+          !g_list_find (serializer->pb_assets, object))
+        {
+          serializer->n_pb_assets++;
+          serializer->pb_assets = g_list_prepend (serializer->pb_assets,
+                                                  object);
+        }
     }
 
   return *id;
@@ -684,10 +722,12 @@ _rut_entitygraph_pre_serialize_cb (RutObject *object,
 }
 
 static void
-serialize_property_cb (RigTransitionPropData *prop_data,
-                  void *user_data)
+serialize_property (Serializer *serializer,
+                    RutProperty *property,
+                    CoglBool animated,
+                    RigPath *path,
+                    const RutBoxed *constant_value)
 {
-  Serializer *serializer = user_data;
   RigEngine *engine = serializer->engine;
   RutObject *object;
   uint64_t id;
@@ -700,7 +740,7 @@ serialize_property_cb (RigTransitionPropData *prop_data,
   serializer->n_pb_properties++;
   serializer->pb_properties = g_list_prepend (serializer->pb_properties, pb_property);
 
-  object = prop_data->property->object;
+  object = property->object;
 
   id = serializer_lookup_object_id (serializer, object);
   if (!id)
@@ -710,15 +750,28 @@ serialize_property_cb (RigTransitionPropData *prop_data,
   pb_property->has_object_id = TRUE;
   pb_property->object_id = id;
 
-  pb_property->name = (char *)prop_data->property->spec->name;
+  pb_property->name = (char *)property->spec->name;
 
   pb_property->has_animated = TRUE;
-  pb_property->animated = prop_data->animated;
+  pb_property->animated = animated;
 
-  pb_property->constant = pb_property_value_new (engine, &prop_data->constant_value);
+  pb_property->constant = pb_property_value_new (engine, constant_value);
 
-  if (prop_data->path && prop_data->path->length)
-    pb_property->path = pb_path_new (engine, prop_data->path);
+  if (path && path->length)
+    pb_property->path = pb_path_new (engine, path);
+}
+
+static void
+serialize_property_cb (RigTransitionPropData *prop_data,
+                  void *user_data)
+{
+  Serializer *serializer = user_data;
+
+  serialize_property (serializer,
+                      prop_data->property,
+                      prop_data->animated,
+                      prop_data->path,
+                      &prop_data->constant_value);
 }
 
 static void
@@ -727,10 +780,66 @@ free_id_slice (void *id)
   g_slice_free (uint64_t, id);
 }
 
+RigPBRegistry *
+rig_pb_registry_new (void)
+{
+  RigPBRegistry *registry = g_slice_new (RigPBRegistry);
+
+  registry->object_to_id = g_hash_table_new_full (NULL, /* direct hash */
+                                                  NULL, /* direct key equal */
+                                                  NULL,
+                                                  free_id_slice);
+  registry->id_to_object = g_hash_table_new_full (g_int64_hash,
+                                                  g_int64_equal,
+                                                  free_id_slice,
+                                                  NULL);
+
+  /* NB: We have to reserve 0 here so we can tell if lookups into the
+   * id_map fail. */
+  registry->next_id = 1;
+
+  return registry;
+}
+
+void
+rig_pb_registry_clear (RigPBRegistry *registry)
+{
+  g_hash_table_remove_all (registry->object_to_id);
+  g_hash_table_remove_all (registry->id_to_object);
+  registry->next_id = 1;
+}
+
+void
+rig_pb_registry_free (RigPBRegistry *registry)
+{
+  g_hash_table_destroy (registry->object_to_id);
+  g_hash_table_destroy (registry->id_to_object);
+  g_slice_free (RigPBRegistry, registry);
+}
+
 Rig__UI *
 rig_pb_serialize_ui (RigEngine *engine,
                      RigAssetReferenceCallback asset_callback,
                      void *user_data)
+{
+  RigPBRegistry *registry = rig_pb_registry_new ();
+  Rig__UI *ui;
+
+  ui = rig_pb_serialize_ui_with_registry (engine,
+                                          asset_callback,
+                                          user_data,
+                                          registry);
+
+  rig_pb_registry_free (registry);
+
+  return ui;
+}
+
+Rig__UI *
+rig_pb_serialize_ui_with_registry (RigEngine *engine,
+                                   RigAssetReferenceCallback asset_callback,
+                                   void *user_data,
+                                   RigPBRegistry *registry)
 {
   Serializer serializer;
   GList *l;
@@ -738,8 +847,15 @@ rig_pb_serialize_ui (RigEngine *engine,
   Rig__UI *ui;
   Rig__Device *device;
 
+  RUT_STATIC_TIMER (serialize_timer,
+                    NULL, /* no parent */
+                    "Serialize UI",
+                    "Time spent serializing the whole UI",
+                    0 /* no application private data */);
+
+  RUT_TIMER_START (_rut_uprof_context, serialize_timer);
+
   memset (&serializer, 0, sizeof (serializer));
-  rut_memory_stack_rewind (engine->serialization_stack);
 
   ui = pb_new (engine, sizeof (Rig__UI), rig__ui__init);
   device = pb_new (engine, sizeof (Rig__Device), rig__device__init);
@@ -747,14 +863,9 @@ rig_pb_serialize_ui (RigEngine *engine,
   serializer.engine = engine;
 
   /* This hash table maps object pointers to uint64_t ids while saving */
-  serializer.id_map = g_hash_table_new_full (NULL, /* direct hash */
-                                             NULL, /* direct key equal */
-                                             NULL,
-                                             free_id_slice);
-
-  /* NB: We have to reserve 0 here so we can tell if lookups into the
-   * id_map fail. */
-  serializer.next_id = 1;
+  rig_pb_registry_clear (registry);
+  serializer.id_map = registry->object_to_id;
+  serializer.next_id = registry->next_id;
 
   serializer.asset_callback = asset_callback;
   serializer.user_data = user_data;
@@ -842,11 +953,338 @@ rig_pb_serialize_ui (RigEngine *engine,
         }
     }
 
-  g_hash_table_destroy (serializer.id_map);
+  registry->next_id = serializer.next_id;
+
+  RUT_TIMER_STOP (_rut_uprof_context, serialize_timer);
 
   return ui;
 }
 
+static Rig__Edit *
+pb_edit_new (Serializer *serializer,
+             Rig__Edit__Type type,
+             RutProperty *property)
+{
+  RigEngine *engine = serializer->engine;
+  Rig__Edit *pb_edit = pb_new (engine, sizeof (Rig__Edit), rig__edit__init);
+
+  serializer->n_pb_edits++;
+  serializer->pb_edits = g_list_prepend (serializer->pb_edits, pb_edit);
+
+  pb_edit->has_type = TRUE;
+  pb_edit->type = type;
+
+  pb_edit->has_transition_id = TRUE;
+  pb_edit->transition_id = engine->selected_transition->id;
+
+  if (property)
+    {
+      pb_edit->has_object_id = TRUE;
+      pb_edit->object_id =
+        serializer_lookup_object_id (serializer, property->object);
+      pb_edit->property_name = (char *)property->spec->name;
+    }
+
+  return pb_edit;
+}
+
+static Rig__PropertyValue *
+pb_edit_value_new (Serializer *serializer,
+                   const RutBoxed *value)
+{
+  /* Objects and pointers can't be sent so the only way to keep the
+   * slave in sync is to send the whole UI again */
+  if (value->type == RUT_PROPERTY_TYPE_OBJECT ||
+      value->type == RUT_PROPERTY_TYPE_POINTER)
+    {
+      serializer->missing_ids = TRUE;
+      return NULL;
+    }
+
+  return pb_property_value_new (serializer->engine, value);
+}
+
+static void
+unregister_component_cb (RutComponent *component,
+                         void *user_data)
+{
+  Serializer *serializer = user_data;
+
+  g_hash_table_remove (serializer->id_map, component);
+}
+
+static RutTraverseVisitFlags
+unregister_entity_cb (RutObject *object,
+                      int depth,
+                      void *user_data)
+{
+  Serializer *serializer = user_data;
+
+  if (rut_object_get_type (object) == &rut_entity_type)
+    rut_entity_foreach_component (object, unregister_component_cb, serializer);
+
+  g_hash_table_remove (serializer->id_map, object);
+
+  return RUT_TRAVERSE_VISIT_CONTINUE;
+}
+
+static void
+serialize_add_entity_edit (Serializer *serializer,
+                           UndoRedoAddDeleteEntity *add_entity)
+{
+  RigEngine *engine = serializer->engine;
+  Rig__Edit *pb_edit = pb_edit_new (serializer, RIG__EDIT__TYPE__ADD_ENTITY,
+                                    NULL);
+  UndoRedoPropData *prop_data;
+  GList *l;
+  int i;
+
+  serializer->n_pb_entities = 0;
+  serializer->pb_entities = NULL;
+  rut_graphable_traverse (add_entity->deleted_entity,
+                          RUT_TRAVERSE_DEPTH_FIRST,
+                          _rut_entitygraph_pre_serialize_cb,
+                          NULL,
+                          serializer);
+
+  /* The slave needs to see each parent before its children */
+  serializer->pb_entities = g_list_reverse (serializer->pb_entities);
+
+  pb_edit->n_entities = serializer->n_pb_entities;
+  pb_edit->entities =
+    rut_memory_stack_alloc (engine->serialization_stack,
+                            sizeof (void *) * pb_edit->n_entities);
+  for (i = 0, l = serializer->pb_entities; l; i++, l = l->next)
+    pb_edit->entities[i] = l->data;
+  g_list_free (serializer->pb_entities);
+
+  serializer->n_pb_properties = 0;
+  serializer->pb_properties = NULL;
+  rut_list_for_each (prop_data, &add_entity->properties, link)
+    serialize_property (serializer,
+                        prop_data->property,
+                        prop_data->animated,
+                        prop_data->path,
+                        &prop_data->constant_value);
+
+  pb_edit->n_properties = serializer->n_pb_properties;
+  pb_edit->properties =
+    rut_memory_stack_alloc (engine->serialization_stack,
+                            sizeof (void *) * pb_edit->n_properties);
+  for (i = 0, l = serializer->pb_properties; l; i++, l = l->next)
+    pb_edit->properties[i] = l->data;
+  g_list_free (serializer->pb_properties);
+}
+
+static void
+serialize_undo_redo (Serializer *serializer,
+                     UndoRedo *undo_redo)
+{
+  Rig__Edit *pb_edit;
+
+  switch (undo_redo->op)
+    {
+    case UNDO_REDO_SUBJOURNAL_OP:
+      {
+        UndoRedo *sub_undo_redo;
+
+        rut_list_for_each (sub_undo_redo,
+                           &undo_redo->d.subjournal->undo_ops,
+                           list_node)
+          serialize_undo_redo (serializer, sub_undo_redo);
+        break;
+      }
+
+    case UNDO_REDO_CONST_PROPERTY_CHANGE_OP:
+      {
+        UndoRedoConstPropertyChange *prop_change =
+          &undo_redo->d.const_prop_change;
+
+        pb_edit = pb_edit_new (serializer,
+                               RIG__EDIT__TYPE__SET_PROPERTY,
+                               prop_change->property);
+        pb_edit->value = pb_edit_value_new (serializer, &prop_change->value1);
+        break;
+      }
+
+    case UNDO_REDO_PATH_ADD_OP:
+    case UNDO_REDO_PATH_REMOVE_OP:
+      {
+        UndoRedoPathAddRemove *add_remove = &undo_redo->d.path_add_remove;
+
+        if (undo_redo->op == UNDO_REDO_PATH_ADD_OP)
+          {
+            pb_edit = pb_edit_new (serializer,
+                                   RIG__EDIT__TYPE__SET_PATH_NODE,
+                                   add_remove->property);
+            pb_edit->value = pb_edit_value_new (serializer,
+                                                &add_remove->value);
+          }
+        else
+          pb_edit = pb_edit_new (serializer,
+                                 RIG__EDIT__TYPE__REMOVE_PATH_NODE,
+                                 add_remove->property);
+
+        pb_edit->has_t = TRUE;
+        pb_edit->t = add_remove->t;
+        break;
+      }
+
+    case UNDO_REDO_PATH_MODIFY_OP:
+      {
+        UndoRedoPathModify *modify = &undo_redo->d.path_modify;
+
+        pb_edit = pb_edit_new (serializer,
+                               RIG__EDIT__TYPE__SET_PATH_NODE,
+                               modify->property);
+        pb_edit->has_t = TRUE;
+        pb_edit->t = modify->t;
+        pb_edit->value = pb_edit_value_new (serializer, &modify->value1);
+        break;
+      }
+
+    case UNDO_REDO_SET_ANIMATED_OP:
+      {
+        UndoRedoSetAnimated *set_animated = &undo_redo->d.set_animated;
+
+        pb_edit = pb_edit_new (serializer,
+                               RIG__EDIT__TYPE__SET_ANIMATED,
+                               set_animated->property);
+        pb_edit->has_animated = TRUE;
+        pb_edit->animated = set_animated->value;
+        break;
+      }
+
+    case UNDO_REDO_MOVE_PATH_NODES_OP:
+      {
+        UndoRedoMovePathNodes *move_path_nodes = &undo_redo->d.move_path_nodes;
+        int i;
+
+        for (i = 0; i < move_path_nodes->n_nodes; i++)
+          {
+            UndoRedoMovedPathNode *node = move_path_nodes->nodes + i;
+
+            pb_edit = pb_edit_new (serializer,
+                                   RIG__EDIT__TYPE__MOVE_PATH_NODE,
+                                   node->property);
+            pb_edit->has_t = TRUE;
+            pb_edit->t = node->old_time;
+            pb_edit->has_new_t = TRUE;
+            pb_edit->new_t = node->new_time;
+          }
+        break;
+      }
+
+    case UNDO_REDO_ADD_ENTITY_OP:
+      serialize_add_entity_edit (serializer, &undo_redo->d.add_delete_entity);
+      break;
+
+    case UNDO_REDO_DELETE_ENTITY_OP:
+      {
+        RutEntity *entity = undo_redo->d.add_delete_entity.deleted_entity;
+
+        pb_edit = pb_edit_new (serializer,
+                               RIG__EDIT__TYPE__DELETE_ENTITY,
+                               NULL);
+        pb_edit->has_object_id = TRUE;
+        pb_edit->object_id = serializer_lookup_object_id (serializer, entity);
+
+        /* The ids of the deleted objects won't be valid on the slave
+         * any more so if the entity gets added back again it will be
+         * given new ids */
+        rut_graphable_traverse (entity,
+                                RUT_TRAVERSE_DEPTH_FIRST,
+                                unregister_entity_cb,
+                                NULL,
+                                serializer);
+        break;
+      }
+
+    case UNDO_REDO_N_OPS:
+      g_warn_if_reached ();
+      break;
+    }
+}
+
+Rig__UIEdit *
+rig_pb_serialize_edit (RigEngine *engine,
+                       RigPBRegistry *registry,
+                       UndoRedo *undo_redo,
+                       RigAssetReferenceCallback asset_callback,
+                       void *user_data)
+{
+  Serializer serializer;
+  Rig__UIEdit *pb_ui_edit;
+  GList *l;
+  int i;
+
+  RUT_STATIC_TIMER (serialize_timer,
+                    NULL, /* no parent */
+                    "Serialize edit",
+                    "Time spent serializing undo journal edits",
+                    0 /* no application private data */);
+
+  RUT_TIMER_START (_rut_uprof_context, serialize_timer);
+
+  memset (&serializer, 0, sizeof (serializer));
+
+  serializer.engine = engine;
+  serializer.asset_callback = asset_callback;
+  serializer.user_data = user_data;
+  serializer.serializing_edit = TRUE;
+  serializer.id_map = registry->object_to_id;
+  serializer.next_id = registry->next_id;
+
+  serialize_undo_redo (&serializer, undo_redo);
+
+  registry->next_id = serializer.next_id;
+
+  if (serializer.missing_ids)
+    {
+      g_list_free (serializer.pb_edits);
+      g_list_free (serializer.pb_assets);
+      RUT_TIMER_STOP (_rut_uprof_context, serialize_timer);
+      return NULL;
+    }
+
+  pb_ui_edit = pb_new (engine, sizeof (Rig__UIEdit), rig__uiedit__init);
+
+  pb_ui_edit->n_assets = serializer.n_pb_assets;
+  pb_ui_edit->assets =
+    rut_memory_stack_alloc (engine->serialization_stack,
+                            sizeof (void *) * pb_ui_edit->n_assets);
+  for (i = 0, l = serializer.pb_assets; l; i++, l = l->next)
+    {
+      RutAsset *asset = l->data;
+      uint64_t *id = g_hash_table_lookup (serializer.id_map, asset);
+      Rig__Asset *pb_asset =
+        pb_new (engine, sizeof (Rig__Asset), rig__asset__init);
+
+      pb_asset->has_id = TRUE;
+      pb_asset->id = *id;
+      pb_asset->path = (char *)rut_asset_get_path (asset);
+
+      pb_ui_edit->assets[i] = pb_asset;
+    }
+  g_list_free (serializer.pb_assets);
+
+  /* The edits were prepended so they need to be reversed to be
+   * applied in the same order */
+  serializer.pb_edits = g_list_reverse (serializer.pb_edits);
+
+  pb_ui_edit->n_edits = serializer.n_pb_edits;
+  pb_ui_edit->edits =
+    rut_memory_stack_alloc (engine->serialization_stack,
+                            sizeof (void *) * pb_ui_edit->n_edits);
+  for (i = 0, l = serializer.pb_edits; l; i++, l = l->next)
+    pb_ui_edit->edits[i] = l->data;
+  g_list_free (serializer.pb_edits);
+
+  RUT_TIMER_STOP (_rut_uprof_context, serialize_timer);
+
+  return pb_ui_edit;
+}
+
 static void
 _rig_serialized_asset_free (void *object)
 {
@@ -854,6 +1292,7 @@ _rig_serialized_asset_free (void *object)
 
   rut_refable_unref (serialized_asset->asset);
   g_free (serialized_asset->pb_data.data.data);
+  g_free (serialized_asset->pb_data.hash);
 
   g_slice_free (RigSerializedAsset, serialized_asset);
 }
@@ -936,6 +1375,9 @@ rig_pb_serialize_asset (RutAsset *asset)
   serialized_asset->pb_data.data.data = (uint8_t *)contents;
   serialized_asset->pb_data.data.len = len;
 
+  serialized_asset->pb_data.hash =
+    g_compute_checksum_for_data (G_CHECKSUM_SHA256, (guchar *)contents, len);
+
   return serialized_asset;
 #endif
 }
@@ -1859,20 +2301,36 @@ update_transition_property_cb (RigTransitionPropData *prop_data,
 
 void
 rig_pb_unserialize_ui (RigEngine *engine, const Rig__UI *pb_ui)
+{
+  RigPBRegistry *registry = rig_pb_registry_new ();
+
+  rig_pb_unserialize_ui_with_registry (engine, pb_ui, registry);
+
+  rig_pb_registry_free (registry);
+}
+
+void
+rig_pb_unserialize_ui_with_registry (RigEngine *engine,
+                                     const Rig__UI *pb_ui,
+                                     RigPBRegistry *registry)
 {
   UnSerializer unserializer;
   GList *l;
 
+  RUT_STATIC_TIMER (unserialize_timer,
+                    NULL, /* no parent */
+                    "Unserialize UI",
+                    "Time spent loading a serialized UI",
+                    0 /* no application private data */);
+
+  RUT_TIMER_START (_rut_uprof_context, unserialize_timer);
+
   memset (&unserializer, 0, sizeof (unserializer));
   unserializer.engine = engine;
 
   /* This hash table maps from uint64_t ids to objects while loading */
-  unserializer.id_map = g_hash_table_new_full (g_int64_hash,
-                                               g_int64_equal,
-                                               free_id_slice,
-                                               NULL);
-
-  rut_memory_stack_rewind (engine->serialization_stack);
+  rig_pb_registry_clear (registry);
+  unserializer.id_map = registry->id_to_object;
 
   if (pb_ui->device)
     {
@@ -1900,8 +2358,6 @@ rig_pb_unserialize_ui (RigEngine *engine, const Rig__UI *pb_ui)
                            pb_ui->n_transitions,
                            pb_ui->transitions);
 
-  g_hash_table_destroy (unserializer.id_map);
-
   rig_engine_free_ui (engine);
 
   engine->scene = rut_graph_new (engine->ctx);
@@ -1927,5 +2383,348 @@ rig_pb_unserialize_ui (RigEngine *engine, const Rig__UI *pb_ui)
 
   rig_engine_handle_ui_update (engine);
 
+  RUT_TIMER_STOP (_rut_uprof_context, unserialize_timer);
+
   rut_shell_queue_redraw (engine->ctx->shell);
 }
+
+static RigTransition *
+find_transition (RigEngine *engine, uint64_t id)
+{
+  GList *l;
+
+  for (l = engine->transitions; l; l = l->next)
+    {
+      RigTransition *transition = l->data;
+
+      if (transition->id == id)
+        return transition;
+    }
+
+  return NULL;
+}
+
+static void
+update_edited_properties (UnSerializer *unserializer,
+                          RigTransition *transition,
+                          int n_properties,
+                          Rig__Transition__Property **properties)
+{
+  int i;
+
+  for (i = 0; i < n_properties; i++)
+    {
+      Rig__Transition__Property *pb_property = properties[i];
+      RutObject *object;
+      RutProperty *property;
+
+      if (!pb_property->has_object_id || pb_property->name == NULL)
+        continue;
+
+      object = unserializer_find_introspectable (unserializer,
+                                                 pb_property->object_id);
+      if (!object)
+        continue;
+
+      property = rut_introspectable_lookup_property (object,
+                                                     pb_property->name);
+      if (property)
+        rig_transition_update_property (transition, property);
+    }
+}
+
+static CoglBool
+apply_add_entity_edit (UnSerializer *unserializer,
+                       RigTransition *transition,
+                       const Rig__Edit *pb_edit)
+{
+  RigEngine *engine = unserializer->engine;
+  CoglBool status = TRUE;
+  GList *l;
+
+  unserializer->entities = NULL;
+
+  unserialize_entities (unserializer,
+                        pb_edit->n_entities,
+                        pb_edit->entities);
+
+  if (g_list_length (unserializer->entities) != pb_edit->n_entities)
+    status = FALSE;
+
+  /* The graph takes ownership of the new entities */
+  for (l = unserializer->entities; l; l = l->next)
+    {
+      if (rut_graphable_get_parent (l->data) == NULL)
+        rut_graphable_add_child (engine->scene, l->data);
+      rut_refable_unref (l->data);
+    }
+  g_list_free (unserializer->entities);
+  unserializer->entities = NULL;
+
+  unserialize_transition_properties (unserializer,
+                                     transition,
+                                     pb_edit->n_properties,
+                                     pb_edit->properties);
+  update_edited_properties (unserializer,
+                            transition,
+                            pb_edit->n_properties,
+                            pb_edit->properties);
+
+  return status;
+}
+
+static void
+collect_component_cb (RutComponent *component,
+                      void *user_data)
+{
+  GHashTable *objects = user_data;
+
+  g_hash_table_insert (objects, component, component);
+}
+
+static RutTraverseVisitFlags
+collect_entity_cb (RutObject *object,
+                   int depth,
+                   void *user_data)
+{
+  GHashTable *objects = user_data;
+
+  if (rut_object_get_type (object) == &rut_entity_type)
+    rut_entity_foreach_component (object, collect_component_cb, objects);
+
+  g_hash_table_insert (objects, object, object);
+
+  return RUT_TRAVERSE_VISIT_CONTINUE;
+}
+
+typedef struct
+{
+  GHashTable *objects;
+  GList *properties;
+} CollectPropertiesState;
+
+static void
+collect_object_properties_cb (RigTransitionPropData *prop_data,
+                              void *user_data)
+{
+  CollectPropertiesState *state = user_data;
+
+  if (g_hash_table_lookup (state->objects, prop_data->property->object))
+    state->properties = g_list_prepend (state->properties,
+                                        prop_data->property);
+}
+
+static gboolean
+is_deleted_object_cb (void *key,
+                      void *value,
+                      void *user_data)
+{
+  GHashTable *objects = user_data;
+
+  return g_hash_table_lookup (objects, value) != NULL;
+}
+
+static CoglBool
+apply_delete_entity_edit (UnSerializer *unserializer,
+                          const Rig__Edit *pb_edit)
+{
+  RigEngine *engine = unserializer->engine;
+  CollectPropertiesState state;
+  RutEntity *entity;
+  GList *l, *l2;
+
+  if (!pb_edit->has_object_id)
+    return FALSE;
+
+  entity = unserializer_find_entity (unserializer, pb_edit->object_id);
+  if (!entity)
+    return FALSE;
+
+  /* Find the entity, its children and all of their components so that
+   * their ids and transition properties can be forgotten */
+  state.objects = g_hash_table_new (NULL, NULL);
+  rut_graphable_traverse (entity,
+                          RUT_TRAVERSE_DEPTH_FIRST,
+                          collect_entity_cb,
+                          NULL,
+                          state.objects);
+
+  for (l = engine->transitions; l; l = l->next)
+    {
+      state.properties = NULL;
+      rig_transition_foreach_property (l->data,
+                                       collect_object_properties_cb,
+                                       &state);
+
+      for (l2 = state.properties; l2; l2 = l2->next)
+        rig_transition_remove_property (l->data, l2->data);
+      g_list_free (state.properties);
+    }
+
+  g_hash_table_foreach_remove (unserializer->id_map,
+                               is_deleted_object_cb,
+                               state.objects);
+  g_hash_table_destroy (state.objects);
+
+  rut_graphable_remove_child (entity);
+
+  return TRUE;
+}
+
+static CoglBool
+apply_edit (UnSerializer *unserializer,
+            const Rig__Edit *pb_edit)
+{
+  RigEngine *engine = unserializer->engine;
+  RigTransition *transition;
+  RigTransitionPropData *prop_data;
+  RutProperty *property;
+  RutObject *object;
+  RigPath *path;
+  RigNode *node;
+  RutBoxed value;
+
+  if (!pb_edit->has_type || !pb_edit->has_transition_id)
+    return FALSE;
+
+  transition = find_transition (engine, pb_edit->transition_id);
+  if (!transition)
+    {
+      collect_error (unserializer,
+                     "Invalid transition id %d referenced in edit",
+                     (int)pb_edit->transition_id);
+      return FALSE;
+    }
+
+  /* Entity edits don't refer to a property */
+  if (pb_edit->type == RIG__EDIT__TYPE__ADD_ENTITY)
+    return apply_add_entity_edit (unserializer, transition, pb_edit);
+  else if (pb_edit->type == RIG__EDIT__TYPE__DELETE_ENTITY)
+    return apply_delete_entity_edit (unserializer, pb_edit);
+
+  if (!pb_edit->has_object_id || pb_edit->property_name == NULL)
+    return FALSE;
+
+  object = unserializer_find_introspectable (unserializer,
+                                             pb_edit->object_id);
+  if (!object)
+    {
+      collect_error (unserializer,
+                     "Invalid object id %d referenced in edit",
+                     (int)pb_edit->object_id);
+      return FALSE;
+    }
+
+  prop_data = rig_transition_get_prop_data (transition,
+                                            object,
+                                            pb_edit->property_name);
+  if (!prop_data)
+    return FALSE;
+
+  property = prop_data->property;
+
+  switch (pb_edit->type)
+    {
+    case RIG__EDIT__TYPE__SET_PROPERTY:
+      if (!pb_edit->value)
+        return FALSE;
+
+      /* NB: the value may point into the message so it is copied */
+      pb_init_boxed_value (unserializer, &value,
+                           property->spec->type, pb_edit->value);
+      rut_boxed_destroy (&prop_data->constant_value);
+      rut_boxed_copy (&prop_data->constant_value, &value);
+      break;
+
+    case RIG__EDIT__TYPE__SET_ANIMATED:
+      if (!pb_edit->has_animated)
+        return FALSE;
+
+      rig_transition_set_property_animated (transition,
+                                            property,
+                                            pb_edit->animated);
+      break;
+
+    case RIG__EDIT__TYPE__SET_PATH_NODE:
+      if (!pb_edit->has_t || !pb_edit->value)
+        return FALSE;
+
+      path = rig_transition_get_path_for_property (transition, property);
+      pb_init_boxed_value (unserializer, &value,
+                           property->spec->type, pb_edit->value);
+      rig_path_insert_boxed (path, pb_edit->t, &value);
+      break;
+
+    case RIG__EDIT__TYPE__REMOVE_PATH_NODE:
+      if (!pb_edit->has_t)
+        return FALSE;
+
+      path = rig_transition_get_path_for_property (transition, property);
+      rig_path_remove (path, pb_edit->t);
+      break;
+
+    case RIG__EDIT__TYPE__MOVE_PATH_NODE:
+      if (!pb_edit->has_t || !pb_edit->has_new_t)
+        return FALSE;
+
+      path = rig_transition_get_path_for_property (transition, property);
+      node = rig_path_find_node (path, pb_edit->t);
+      if (!node)
+        return FALSE;
+      rig_path_move_node (path, node, pb_edit->new_t);
+      break;
+
+    default:
+      return FALSE;
+    }
+
+  rig_transition_update_property (transition, property);
+
+  return TRUE;
+}
+
+CoglBool
+rig_pb_apply_edit (RigEngine *engine,
+                   RigPBRegistry *registry,
+                   const Rig__UIEdit *pb_edit)
+{
+  UnSerializer unserializer;
+  CoglBool status = TRUE;
+  GList *l;
+  int i;
+
+  memset (&unserializer, 0, sizeof (unserializer));
+  unserializer.engine = engine;
+  unserializer.id_map = registry->id_to_object;
+
+  /* Assets that the slave already knows about keep their original
+   * ids */
+  for (i = 0; i < pb_edit->n_assets; i++)
+    {
+      Rig__Asset *pb_asset = pb_edit->assets[i];
+      uint64_t id = pb_asset->id;
+
+      if (!pb_asset->has_id ||
+          g_hash_table_lookup (unserializer.id_map, &id))
+        continue;
+
+      unserialize_assets (&unserializer, 1, &pb_edit->assets[i]);
+    }
+
+  for (l = unserializer.assets; l; l = l->next)
+    {
+      if (!g_list_find (engine->assets, l->data))
+        engine->assets = g_list_prepend (engine->assets, l->data);
+    }
+  g_list_free (unserializer.assets);
+
+  for (i = 0; i < pb_edit->n_edits; i++)
+    {
+      if (!apply_edit (&unserializer, pb_edit->edits[i]))
+        status = FALSE;
+    }
+
+  rut_shell_queue_redraw (engine->ctx->shell);
+
+  return status;
+}
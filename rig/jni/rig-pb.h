@@ -29,11 +29,50 @@
 typedef void (*RigAssetReferenceCallback) (RutAsset *asset,
                                            void *user_data);
 
+/* A registry remembers the ids that objects were given in a
+ * serialized UI so that later edits can refer to the same objects.
+ * A slave master keeps one while serializing and the slave keeps
+ * another while unserializing. */
+typedef struct _RigPBRegistry RigPBRegistry;
+
+RigPBRegistry *
+rig_pb_registry_new (void);
+
+void
+rig_pb_registry_clear (RigPBRegistry *registry);
+
+void
+rig_pb_registry_free (RigPBRegistry *registry);
+
+/* The message is allocated on the engine's serialization stack. The
+ * caller should push a frame on the stack beforehand and pop it once
+ * it has finished with the message. */
 Rig__UI *
 rig_pb_serialize_ui (RigEngine *engine,
                      RigAssetReferenceCallback asset_callback,
                      void *user_data);
 
+/* Like rig_pb_serialize_ui() except that the ids given to objects are
+ * kept in @registry so that rig_pb_serialize_edit() can be used
+ * afterwards. The registry is cleared first. */
+Rig__UI *
+rig_pb_serialize_ui_with_registry (RigEngine *engine,
+                                   RigAssetReferenceCallback asset_callback,
+                                   void *user_data,
+                                   RigPBRegistry *registry);
+
+/* Serializes the effect of applying @undo_redo to the engine's
+ * selected transition. Returns NULL if the operation refers to an
+ * object that isn't in @registry in which case the whole UI needs to
+ * be serialized again. Like rig_pb_serialize_ui() the message is
+ * allocated on the engine's serialization stack. */
+Rig__UIEdit *
+rig_pb_serialize_edit (RigEngine *engine,
+                       RigPBRegistry *registry,
+                       UndoRedo *undo_redo,
+                       RigAssetReferenceCallback asset_callback,
+                       void *user_data);
+
 typedef struct _RigSerializedAsset
 {
   RutObjectProps _parent;
@@ -51,4 +90,17 @@ rig_pb_serialize_asset (RutAsset *asset);
 void
 rig_pb_unserialize_ui (RigEngine *engine, const Rig__UI *pb_ui);
 
+void
+rig_pb_unserialize_ui_with_registry (RigEngine *engine,
+                                     const Rig__UI *pb_ui,
+                                     RigPBRegistry *registry);
+
+/* Applies edits to a UI previously loaded with
+ * rig_pb_unserialize_ui_with_registry() without rebuilding it.
+ * Returns FALSE if any of the edits couldn't be applied. */
+CoglBool
+rig_pb_apply_edit (RigEngine *engine,
+                   RigPBRegistry *registry,
+                   const Rig__UIEdit *pb_edit);
+
 #endif /* __RIG_PB_H__ */
@@ -24,6 +24,7 @@
 
 #include "rig-engine.h"
 #include "rig-renderer.h"
+#include "rig-journal-sort.h"
 
 typedef enum _CacheSlot
 {
@@ -35,9 +36,21 @@ typedef enum _CacheSlot
 typedef struct _RigJournalEntry
 {
   RutEntity *entity;
+  CoglPipeline *pipeline;
   CoglMatrix matrix;
+
+  /* See rig-journal-sort.h */
+  uint64_t sort_key;
 } RigJournalEntry;
 
+/* Runs of entries in the shadow and depth-of-field passes that share
+ * a pipeline and a small mesh are drawn with a single primitive by
+ * transforming the vertices on the CPU. This is the maximum number
+ * of vertices in the mesh of each entity... */
+#define BATCH_MAX_ENTITY_VERTICES 1024
+/* ...and the maximum number of vertices in a batch */
+#define BATCH_MAX_VERTICES (16 * 1024)
+
 /* In the shaders, any alpha value greater than or equal to this is
  * considered to be fully opaque. We can't just compare for equality
  * against 1.0 because at least on a Mac Mini there seems to be some
@@ -63,43 +76,88 @@ typedef struct _RigJournalEntry
  */
 #define OPAQUE_THRESHOLD 0.9999
 
-static void
-rig_journal_log (GArray *journal,
-                 RigPaintContext *paint_ctx,
-                 RutEntity *entity,
-                 const CoglMatrix *matrix)
+GArray *
+rig_journal_new (void)
 {
+  return g_array_new (FALSE, FALSE, sizeof (RigJournalEntry));
+}
 
-  RigJournalEntry *entry;
+/* State that we track for each pipeline so that we only need to
+ * update its uniforms when something has actually changed. This is
+ * attached to the pipelines as user data so it goes away whenever
+ * the pipeline is discarded. The objects are referenced so that a
+ * new object allocated at the same address can't be mistaken for
+ * one we've already seen. */
+typedef struct _RigPipelineUniforms
+{
+  RutLight *light;
+  unsigned int light_age;
 
-  g_array_set_size (journal, journal->len + 1);
-  entry = &g_array_index (journal, RigJournalEntry, journal->len - 1);
+  RutMaterial *material;
+  int material_age;
 
-  entry->entity = rut_refable_ref (entity);
-  entry->matrix = *matrix;
-}
+  RutCamera *camera;
+  unsigned int focal_age;
 
-GArray *
-rig_journal_new (void)
+  /* The modelview matrix the current normal matrix was derived from */
+  CoglMatrix modelview;
+  CoglBool modelview_valid;
+
+  int normal_matrix_location;
+} RigPipelineUniforms;
+
+static CoglUserDataKey pipeline_uniforms_key;
+
+static void
+free_pipeline_uniforms (void *user_data)
 {
-  return g_array_new (FALSE, FALSE, sizeof (RigJournalEntry));
+  RigPipelineUniforms *uniforms = user_data;
+
+  if (uniforms->light)
+    rut_refable_unref (uniforms->light);
+  if (uniforms->material)
+    rut_refable_unref (uniforms->material);
+  if (uniforms->camera)
+    rut_refable_unref (uniforms->camera);
+
+  g_slice_free (RigPipelineUniforms, uniforms);
 }
 
-static int
-sort_entry_cb (const RigJournalEntry *entry0,
-               const RigJournalEntry *entry1)
+static RigPipelineUniforms *
+get_pipeline_uniforms (CoglPipeline *pipeline)
 {
-  float z0 = entry0->matrix.zw;
-  float z1 = entry1->matrix.zw;
+  RigPipelineUniforms *uniforms =
+    cogl_object_get_user_data (COGL_OBJECT (pipeline),
+                               &pipeline_uniforms_key);
 
-  /* TODO: also sort based on the state */
+  if (uniforms)
+    return uniforms;
 
-  if (z0 < z1)
-    return -1;
-  else if (z0 > z1)
-    return 1;
+  uniforms = g_slice_new0 (RigPipelineUniforms);
+  uniforms->normal_matrix_location =
+    cogl_pipeline_get_uniform_location (pipeline, "normal_matrix");
+
+  cogl_object_set_user_data (COGL_OBJECT (pipeline),
+                             &pipeline_uniforms_key,
+                             uniforms,
+                             free_pipeline_uniforms);
 
-  return 0;
+  return uniforms;
+}
+
+static void
+set_tracked_object (void **slot,
+                    RutObject *object)
+{
+  if (*slot == object)
+    return;
+
+  if (object)
+    rut_refable_ref (object);
+  if (*slot)
+    rut_refable_unref (*slot);
+
+  *slot = object;
 }
 
 static void
@@ -140,6 +198,12 @@ set_focal_parameters (CoglPipeline *pipeline,
                                    &depth_of_field);
 }
 
+static void
+free_batch_positions (void *positions)
+{
+  g_array_free (positions, TRUE);
+}
+
 void
 rig_renderer_init (RigEngine *engine)
 {
@@ -373,11 +437,23 @@ rig_renderer_init (RigEngine *engine)
                       "  shadow = 0.5;\n"
 
                       "cogl_color_out.rgb = shadow * cogl_color_out.rgb;\n");
+
+  engine->batch_positions = g_hash_table_new_full (NULL, NULL,
+                                                   rut_refable_unref,
+                                                   free_batch_positions);
 }
 
 void
 rig_renderer_fini (RigEngine *engine)
 {
+  g_hash_table_destroy (engine->batch_positions);
+  if (engine->batch_primitive)
+    {
+      cogl_object_unref (engine->batch_primitive);
+      cogl_object_unref (engine->batch_buffer);
+      g_free (engine->batch_vertices);
+    }
+
   cogl_object_unref (engine->alpha_mask_snippet);
   cogl_object_unref (engine->lighting_vertex_snippet);
   cogl_object_unref (engine->normal_map_vertex_snippet);
@@ -874,6 +950,266 @@ get_normal_matrix (const CoglMatrix *matrix,
   normal_matrix[8] = inverse_matrix.zz;
 }
 
+static void *
+get_geometry_identity (RutComponent *geometry)
+{
+  /* Each model has its own primitive but models created from the same
+   * asset share a mesh */
+  if (rut_object_get_type (geometry) == &rut_model_type &&
+      RUT_MODEL (geometry)->mesh)
+    return RUT_MODEL (geometry)->mesh;
+  else
+    return geometry;
+}
+
+static uint64_t
+make_sort_key (RigPass pass,
+               CoglPipeline *pipeline,
+               RutMaterial *material,
+               RutComponent *geometry,
+               const CoglMatrix *modelview)
+{
+  return rig_journal_make_sort_key (pass,
+                                    pass == RIG_PASS_COLOR_BLENDED,
+                                    pipeline,
+                                    material,
+                                    get_geometry_identity (geometry),
+                                    /* The distance from the camera
+                                     * along the view direction */
+                                    -modelview->zw);
+}
+
+static void
+rig_journal_log (GArray *journal,
+                 RigPaintContext *paint_ctx,
+                 RutEntity *entity,
+                 const CoglMatrix *matrix)
+{
+  RutComponent *geometry =
+    rut_entity_get_component (entity, RUT_COMPONENT_TYPE_GEOMETRY);
+  RutMaterial *material =
+    rut_entity_get_component (entity, RUT_COMPONENT_TYPE_MATERIAL);
+  RigJournalEntry *entry;
+
+  g_array_set_size (journal, journal->len + 1);
+  entry = &g_array_index (journal, RigJournalEntry, journal->len - 1);
+
+  entry->entity = rut_refable_ref (entity);
+  entry->pipeline = get_entity_pipeline (paint_ctx->engine,
+                                         entity,
+                                         geometry,
+                                         paint_ctx->pass);
+  entry->matrix = *matrix;
+
+  /* The mask pipelines don't use the material so we don't want it to
+   * split up runs of entries that could otherwise be batched */
+  if (paint_ctx->pass == RIG_PASS_SHADOW ||
+      paint_ctx->pass == RIG_PASS_DOF_DEPTH)
+    material = NULL;
+
+  entry->sort_key = make_sort_key (paint_ctx->pass,
+                                   entry->pipeline,
+                                   material,
+                                   geometry,
+                                   matrix);
+}
+
+/* Returns the mesh of the entry if it could be drawn as part of a
+ * batch, or NULL otherwise */
+static RutMesh *
+get_batchable_mesh (RigJournalEntry *entry)
+{
+  RutObject *geometry =
+    rut_entity_get_component (entry->entity, RUT_COMPONENT_TYPE_GEOMETRY);
+  RutMesh *mesh;
+  RutAttribute *attribute;
+  int n_vertices;
+
+  /* Only models have vertex data that we can access on the CPU */
+  if (rut_object_get_type (geometry) != &rut_model_type)
+    return NULL;
+
+  mesh = RUT_MODEL (geometry)->mesh;
+  if (!mesh)
+    return NULL;
+
+  n_vertices = mesh->indices_buffer ? mesh->n_indices : mesh->n_vertices;
+  if (n_vertices > BATCH_MAX_ENTITY_VERTICES)
+    return NULL;
+
+  attribute = rut_mesh_find_attribute (mesh, "cogl_position_in");
+  if (!attribute ||
+      attribute->type != RUT_ATTRIBUTE_TYPE_FLOAT ||
+      attribute->n_components != 3)
+    return NULL;
+
+  return mesh;
+}
+
+static CoglBool
+collect_triangle_positions_cb (void **attributes_v0,
+                               void **attributes_v1,
+                               void **attributes_v2,
+                               int index_v0,
+                               int index_v1,
+                               int index_v2,
+                               void *user_data)
+{
+  GArray *positions = user_data;
+
+  g_array_append_vals (positions, attributes_v0[0], 1);
+  g_array_append_vals (positions, attributes_v1[0], 1);
+  g_array_append_vals (positions, attributes_v2[0], 1);
+
+  return TRUE;
+}
+
+/* Returns the positions of the triangles of @mesh without any
+ * indices. These are cached for each mesh because de-indexing the
+ * mesh every time it is drawn would cost more than batching saves.
+ * The cache holds a reference on the mesh so that a new mesh can't
+ * be confused with a freed one at the same address */
+static GArray *
+get_batch_positions (RigEngine *engine,
+                     RutMesh *mesh)
+{
+  GArray *positions = g_hash_table_lookup (engine->batch_positions, mesh);
+
+  if (positions)
+    return positions;
+
+  positions = g_array_new (FALSE, FALSE, sizeof (CoglVertexP3));
+  rut_mesh_foreach_triangle (mesh,
+                             collect_triangle_positions_cb,
+                             positions,
+                             "cogl_position_in",
+                             NULL);
+
+  g_hash_table_insert (engine->batch_positions,
+                       rut_refable_ref (mesh),
+                       positions);
+
+  return positions;
+}
+
+/* Returns the number of entries starting at @first that can be drawn
+ * together. The mask pipelines for models are shared and only depend
+ * on per-camera uniforms so in the shadow and depth-of-field passes
+ * consecutive models with the same mesh can be combined. The color
+ * pipelines have per-entity uniforms so they are always drawn
+ * individually. */
+static int
+get_batch_length (RigPaintContext *paint_ctx,
+                  GArray *journal,
+                  int first,
+                  RutMesh **mesh_out)
+{
+  RigJournalEntry *first_entry =
+    &g_array_index (journal, RigJournalEntry, first);
+  RutMesh *mesh;
+  int n_mesh_vertices;
+  int n_vertices;
+  int i;
+
+  if (paint_ctx->pass != RIG_PASS_SHADOW &&
+      paint_ctx->pass != RIG_PASS_DOF_DEPTH)
+    return 1;
+
+  mesh = get_batchable_mesh (first_entry);
+  if (!mesh)
+    return 1;
+
+  /* The batch is drawn from the de-indexed triangles so that is what
+   * counts towards the size of the batch buffer */
+  n_mesh_vertices = get_batch_positions (paint_ctx->engine, mesh)->len;
+  n_vertices = n_mesh_vertices;
+
+  for (i = first + 1; i < journal->len; i++)
+    {
+      RigJournalEntry *entry = &g_array_index (journal, RigJournalEntry, i);
+
+      if (n_vertices + n_mesh_vertices > BATCH_MAX_VERTICES ||
+          entry->pipeline != first_entry->pipeline ||
+          get_batchable_mesh (entry) != mesh)
+        break;
+
+      n_vertices += n_mesh_vertices;
+    }
+
+  *mesh_out = mesh;
+
+  return i - first;
+}
+
+static void
+draw_batch (RigPaintContext *paint_ctx,
+            CoglFramebuffer *fb,
+            CoglPipeline *pipeline,
+            GArray *journal,
+            int first,
+            int n_entries,
+            RutMesh *mesh)
+{
+  RigEngine *engine = paint_ctx->engine;
+  GArray *positions = get_batch_positions (engine, mesh);
+  int n_mesh_vertices = positions->len;
+  int n_vertices = n_mesh_vertices * n_entries;
+  int i;
+
+  /* A single buffer and primitive big enough for the largest batch
+   * are reused for every batch */
+  if (engine->batch_primitive == NULL)
+    {
+      CoglContext *ctx = engine->ctx->cogl_context;
+      CoglAttribute *attribute;
+
+      engine->batch_vertices =
+        g_new (CoglVertexP3, BATCH_MAX_VERTICES);
+      engine->batch_buffer =
+        cogl_attribute_buffer_new_with_size (ctx,
+                                             sizeof (CoglVertexP3) *
+                                             BATCH_MAX_VERTICES);
+      attribute = cogl_attribute_new (engine->batch_buffer,
+                                      "cogl_position_in",
+                                      sizeof (CoglVertexP3),
+                                      0, /* offset */
+                                      3, /* n_components */
+                                      COGL_ATTRIBUTE_TYPE_FLOAT);
+      engine->batch_primitive =
+        cogl_primitive_new (COGL_VERTICES_MODE_TRIANGLES,
+                            0, /* n_vertices */
+                            attribute,
+                            NULL);
+      cogl_object_unref (attribute);
+    }
+
+  for (i = 0; i < n_entries; i++)
+    {
+      RigJournalEntry *entry =
+        &g_array_index (journal, RigJournalEntry, first + i);
+
+      cogl_matrix_transform_points (&entry->matrix,
+                                    3, /* n_components */
+                                    sizeof (CoglVertexP3),
+                                    positions->data,
+                                    sizeof (CoglVertexP3),
+                                    engine->batch_vertices +
+                                    i * n_mesh_vertices,
+                                    n_mesh_vertices);
+    }
+
+  cogl_buffer_set_data (COGL_BUFFER (engine->batch_buffer),
+                        0, /* offset */
+                        engine->batch_vertices,
+                        sizeof (CoglVertexP3) * n_vertices,
+                        NULL);
+  cogl_primitive_set_n_vertices (engine->batch_primitive, n_vertices);
+
+  /* The vertices are already in eye coordinates */
+  cogl_framebuffer_identity_matrix (fb);
+  cogl_framebuffer_draw_primitive (fb, pipeline, engine->batch_primitive);
+}
+
 static void
 rig_journal_flush (GArray *journal,
                    RigPaintContext *paint_ctx)
@@ -881,108 +1217,164 @@ rig_journal_flush (GArray *journal,
   RutPaintContext *rut_paint_ctx = &paint_ctx->_parent;
   RutCamera *camera = rut_paint_ctx->camera;
   CoglFramebuffer *fb = rut_camera_get_framebuffer (camera);
-  int start, dir, end;
-  int i;
-
-  /* TODO: use an inline qsort implementation */
-  g_array_sort (journal, (void *)sort_entry_cb);
+  RigUniformCounters *counters =
+    &paint_ctx->engine->uniform_counters[paint_ctx->pass];
+  RigCullCounters *draw_counters =
+    &paint_ctx->engine->cull_counters[paint_ctx->pass];
+  RutLight *light = rut_entity_get_component (paint_ctx->engine->light,
+                                              RUT_COMPONENT_TYPE_LIGHT);
+  unsigned int light_age = 0;
+  int n_entries;
+  int i, j;
+
+  RUT_STATIC_TIMER (flush_timer,
+                    "Paint", /* parent */
+                    "Journal flush",
+                    "Time spent sorting and drawing the render journal",
+                    0 /* no application private data */);
+
+  RUT_TIMER_START (_rut_uprof_context, flush_timer);
+
+  /* Finding the light's direction requires walking up the graph so we
+   * only want to do it once per flush */
+  if (paint_ctx->pass == RIG_PASS_COLOR_UNBLENDED ||
+      paint_ctx->pass == RIG_PASS_COLOR_BLENDED)
+    light_age = rut_light_get_uniforms_age (light);
 
   /* We draw opaque geometry front-to-back so we are more likely to be
    * able to discard later fragments earlier by depth testing.
    *
    * We draw transparent geometry back-to-front so it blends
    * correctly.
-   */
-  if ( paint_ctx->pass == RIG_PASS_COLOR_BLENDED)
-    {
-      start = 0;
-      dir = 1;
-      end = journal->len;
-    }
-  else
-    {
-      start = journal->len - 1;
-      dir = -1;
-      end = -1;
-    }
+   *
+   * Both orders are encoded in the sort keys (see rig-journal-sort.h) */
+  rig_journal_sort (journal->data,
+                    journal->len,
+                    sizeof (RigJournalEntry),
+                    G_STRUCT_OFFSET (RigJournalEntry, sort_key));
 
   cogl_framebuffer_push_matrix (fb);
 
-  for (i = start; i != end; i += dir)
+  for (i = 0; i < journal->len; i += n_entries)
     {
       RigJournalEntry *entry = &g_array_index (journal, RigJournalEntry, i);
+      RutMesh *batch_mesh = NULL;
       RutEntity *entity = entry->entity;
       RutComponent *geometry =
         rut_entity_get_component (entity, RUT_COMPONENT_TYPE_GEOMETRY);
-      CoglPipeline *pipeline;
+      CoglPipeline *pipeline = entry->pipeline;
+      RigPipelineUniforms *uniforms = get_pipeline_uniforms (pipeline);
       CoglPrimitive *primitive;
       float normal_matrix[9];
       RutMaterial *material;
 
-      pipeline = get_entity_pipeline (paint_ctx->engine,
-                                      entity,
-                                      geometry,
-                                      paint_ctx->pass);
+      n_entries = get_batch_length (paint_ctx, journal, i, &batch_mesh);
 
       if (paint_ctx->pass == RIG_PASS_DOF_DEPTH ||
           paint_ctx->pass == RIG_PASS_SHADOW)
         {
-          /* FIXME: avoid updating these uniforms for every primitive if
-           * the focal parameters haven't change! */
-          set_focal_parameters (pipeline,
-                                camera->focal_distance,
-                                camera->depth_of_field);
+          if (uniforms->camera != camera ||
+              uniforms->focal_age != camera->focal_age)
+            {
+              set_focal_parameters (pipeline,
+                                    camera->focal_distance,
+                                    camera->depth_of_field);
+              set_tracked_object ((void **)&uniforms->camera, camera);
+              uniforms->focal_age = camera->focal_age;
+              counters->n_uploaded++;
+            }
+          else
+            counters->n_skipped++;
         }
       else if (paint_ctx->pass == RIG_PASS_COLOR_UNBLENDED ||
                paint_ctx->pass == RIG_PASS_COLOR_BLENDED)
         {
-          int location;
-          RutLight *light = rut_entity_get_component (paint_ctx->engine->light,
-                                                      RUT_COMPONENT_TYPE_LIGHT);
-          /* FIXME: only update the lighting uniforms when the light has
-           * actually moved! */
-          rut_light_set_uniforms (light, pipeline);
-
-          /* FIXME: only update the material uniforms when the material has
-           * actually changed! */
+          if (uniforms->light != light || uniforms->light_age != light_age)
+            {
+              rut_light_set_uniforms (light, pipeline);
+              set_tracked_object ((void **)&uniforms->light, light);
+              uniforms->light_age = light_age;
+              counters->n_uploaded++;
+            }
+          else
+            counters->n_skipped++;
+
           material = rut_entity_get_component (entity, RUT_COMPONENT_TYPE_MATERIAL);
           if (material)
-            rut_material_flush_uniforms (material, pipeline);
-
-          get_normal_matrix (&entry->matrix, normal_matrix);
+            {
+              if (uniforms->material != material ||
+                  uniforms->material_age != material->uniforms_age)
+                {
+                  rut_material_flush_uniforms (material, pipeline);
+                  set_tracked_object ((void **)&uniforms->material, material);
+                  uniforms->material_age = material->uniforms_age;
+                  counters->n_uploaded++;
+                }
+              else
+                counters->n_skipped++;
+            }
 
-          location = cogl_pipeline_get_uniform_location (pipeline, "normal_matrix");
-          cogl_pipeline_set_uniform_matrix (pipeline,
-                                            location,
-                                            3, /* dimensions */
-                                            1, /* count */
-                                            FALSE, /* don't transpose again */
-                                            normal_matrix);
+          /* The normal matrix only depends on the modelview so if the
+           * entity hasn't moved relative to the camera then the
+           * pipeline already has the right value */
+          if (!uniforms->modelview_valid ||
+              !cogl_matrix_equal (&uniforms->modelview, &entry->matrix))
+            {
+              get_normal_matrix (&entry->matrix, normal_matrix);
+
+              cogl_pipeline_set_uniform_matrix (pipeline,
+                                                uniforms->normal_matrix_location,
+                                                3, /* dimensions */
+                                                1, /* count */
+                                                FALSE, /* don't transpose again */
+                                                normal_matrix);
+
+              uniforms->modelview = entry->matrix;
+              uniforms->modelview_valid = TRUE;
+              counters->n_uploaded++;
+            }
+          else
+            counters->n_skipped++;
         }
 
-      if (rut_object_is (geometry, RUT_INTERFACE_ID_PRIMABLE))
+      if (n_entries > 1)
+        {
+          draw_batch (paint_ctx, fb, pipeline,
+                      journal, i, n_entries, batch_mesh);
+          draw_counters->n_draw_calls++;
+        }
+      else if (rut_object_is (geometry, RUT_INTERFACE_ID_PRIMABLE))
         {
           primitive = rut_primable_get_primitive (geometry);
           cogl_framebuffer_set_modelview_matrix (fb, &entry->matrix);
           cogl_framebuffer_draw_primitive (fb,
                                            pipeline,
                                            primitive);
+          draw_counters->n_draw_calls++;
         }
       else if (rut_object_get_type (geometry) == &rut_text_type &&
                paint_ctx->pass == RIG_PASS_COLOR_BLENDED)
         {
           cogl_framebuffer_set_modelview_matrix (fb, &entry->matrix);
           rut_paintable_paint (geometry, rut_paint_ctx);
+          draw_counters->n_draw_calls++;
         }
 
-      cogl_object_unref (pipeline);
+      for (j = i; j < i + n_entries; j++)
+        {
+          RigJournalEntry *drawn_entry =
+            &g_array_index (journal, RigJournalEntry, j);
 
-      rut_refable_unref (entry->entity);
+          cogl_object_unref (drawn_entry->pipeline);
+          rut_refable_unref (drawn_entry->entity);
+        }
     }
 
   cogl_framebuffer_pop_matrix (fb);
 
   g_array_set_size (journal, 0);
+
+  RUT_TIMER_STOP (_rut_uprof_context, flush_timer);
 }
 
 void
@@ -1059,9 +1451,24 @@ entitygraph_pre_paint_cb (RutObject *object,
   if (rut_object_get_type (object) == &rut_entity_type)
     {
       RutEntity *entity = RUT_ENTITY (object);
+      RigCullCounters *counters =
+        &paint_ctx->engine->cull_counters[paint_ctx->pass];
       RutObject *geometry;
       CoglMatrix matrix;
 
+      cogl_framebuffer_get_modelview_matrix (fb, &matrix);
+
+      /* If the bounds of the entity and all of its descendants are
+       * outside of the frustum then we can skip the whole subtree.
+       * NB: the post-paint callback is still called for this entity
+       * so the matrix stack stays balanced. */
+      if (rut_entity_cull (entity, &matrix, paint_ctx->cull_planes) ==
+          RUT_CULL_RESULT_OUT)
+        {
+          counters->n_culled++;
+          return RUT_TRAVERSE_VISIT_SKIP_CHILDREN;
+        }
+
       if (!rut_entity_get_visible (entity) ||
           (paint_ctx->pass == RIG_PASS_SHADOW && !rut_entity_get_cast_shadow (entity)))
         return RUT_TRAVERSE_VISIT_CONTINUE;
@@ -1076,11 +1483,11 @@ entitygraph_pre_paint_cb (RutObject *object,
           return RUT_TRAVERSE_VISIT_CONTINUE;
         }
 
-      cogl_framebuffer_get_modelview_matrix (fb, &matrix);
       rig_journal_log (paint_ctx->engine->journal,
                        paint_ctx,
                        entity,
                        &matrix);
+      counters->n_drawn++;
 
       return RUT_TRAVERSE_VISIT_CONTINUE;
     }
@@ -1103,6 +1510,30 @@ entitygraph_post_paint_cb (RutObject *object,
   return RUT_TRAVERSE_VISIT_CONTINUE;
 }
 
+static void
+get_camera_cull_planes (RutCamera *camera,
+                        RutPlane *planes)
+{
+  const float *viewport = rut_camera_get_viewport (camera);
+  float x1 = viewport[0];
+  float y1 = viewport[1];
+  float x2 = viewport[0] + viewport[2];
+  float y2 = viewport[1] + viewport[3];
+  float polygon[8] = {
+    x1, y1,
+    x2, y1,
+    x2, y2,
+    x1, y2
+  };
+
+  rut_get_eye_planes_for_screen_poly (polygon,
+                                      4, /* n_vertices */
+                                      (float *)viewport,
+                                      rut_camera_get_projection (camera),
+                                      rut_camera_get_inverse_projection (camera),
+                                      planes);
+}
+
 static void
 paint_scene (RigPaintContext *paint_ctx)
 {
@@ -1110,6 +1541,17 @@ paint_scene (RigPaintContext *paint_ctx)
   RigEngine *engine = paint_ctx->engine;
   CoglContext *ctx = engine->ctx->cogl_context;
   CoglFramebuffer *fb = rut_camera_get_framebuffer (rut_paint_ctx->camera);
+  RigCullCounters *counters = &engine->cull_counters[paint_ctx->pass];
+  int64_t start_time = g_get_monotonic_time ();
+
+  counters->n_drawn = 0;
+  counters->n_culled = 0;
+  counters->n_draw_calls = 0;
+
+  engine->uniform_counters[paint_ctx->pass].n_uploaded = 0;
+  engine->uniform_counters[paint_ctx->pass].n_skipped = 0;
+
+  get_camera_cull_planes (rut_paint_ctx->camera, paint_ctx->cull_planes);
 
   if (paint_ctx->pass == RIG_PASS_COLOR_UNBLENDED)
     {
@@ -1134,6 +1576,8 @@ paint_scene (RigPaintContext *paint_ctx)
                           paint_ctx);
 
   rig_journal_flush (engine->journal, paint_ctx);
+
+  counters->paint_time = g_get_monotonic_time () - start_time;
 }
 
 void
@@ -1160,3 +1604,21 @@ rig_dirty_entity_pipelines (RutEntity *entity)
   rut_entity_set_pipeline_cache (entity, CACHE_SLOT_COLOR_BLENDED, NULL);
   rut_entity_set_pipeline_cache (entity, CACHE_SLOT_SHADOW, NULL);
 }
+
+const RigCullCounters *
+rig_renderer_get_cull_counters (RigEngine *engine,
+                                RigPass pass)
+{
+  g_return_val_if_fail (pass < RIG_N_PASSES, NULL);
+
+  return &engine->cull_counters[pass];
+}
+
+const RigUniformCounters *
+rig_renderer_get_uniform_counters (RigEngine *engine,
+                                   RigPass pass)
+{
+  g_return_val_if_fail (pass < RIG_N_PASSES, NULL);
+
+  return &engine->uniform_counters[pass];
+}
@@ -21,12 +21,18 @@
 #ifndef _RIG_RENDERER_H_
 #define _RIG_RENDERER_H_
 
+#include "rut.h"
+
+#include "rig-types.h"
+
 typedef enum _RigPass
 {
   RIG_PASS_COLOR_UNBLENDED,
   RIG_PASS_COLOR_BLENDED,
   RIG_PASS_SHADOW,
-  RIG_PASS_DOF_DEPTH
+  RIG_PASS_DOF_DEPTH,
+
+  RIG_N_PASSES
 } RigPass;
 
 typedef struct _RigPaintContext
@@ -39,8 +45,43 @@ typedef struct _RigPaintContext
 
   RigPass pass;
 
+  /* The eye-space planes of the current camera's view frustum, used
+   * to cull entities during the paint traversal */
+  RutPlane cull_planes[4];
+
 } RigPaintContext;
 
+/* Statistics about the most recent paint of a particular pass */
+typedef struct _RigCullCounters
+{
+  /* The number of entities that were logged into the journal */
+  int n_drawn;
+  /* The number of entities that were skipped because their bounds,
+   * including all of their descendants, were outside the frustum.
+   * The descendants of a culled entity are not counted separately. */
+  int n_culled;
+  /* The number of primitives submitted to Cogl. This can be less
+   * than n_drawn when entries of the journal are batched together */
+  int n_draw_calls;
+  /* The CPU time in microseconds spent traversing the scene and
+   * flushing the journal. This doesn't include the time taken by the
+   * GPU to draw anything. */
+  int64_t paint_time;
+} RigCullCounters;
+
+/* Statistics about the uniform updates in the most recent paint of a
+ * particular pass. Each group of related uniforms (the light, the
+ * material, the focal parameters and the normal matrix) that is
+ * needed for a draw counts once. */
+typedef struct _RigUniformCounters
+{
+  /* The number of groups that were uploaded to a pipeline */
+  int n_uploaded;
+  /* The number of groups that were skipped because the pipeline
+   * already had the latest values */
+  int n_skipped;
+} RigUniformCounters;
+
 GArray *
 rig_journal_new (void);
 
@@ -59,4 +100,12 @@ rig_renderer_init (RigEngine *engine);
 void
 rig_renderer_fini (RigEngine *engine);
 
+const RigCullCounters *
+rig_renderer_get_cull_counters (RigEngine *engine,
+                                RigPass pass);
+
+const RigUniformCounters *
+rig_renderer_get_uniform_counters (RigEngine *engine,
+                                   RigPass pass);
+
 #endif /* _RIG_RENDERER_H_ */
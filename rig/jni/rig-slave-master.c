@@ -21,6 +21,8 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include <glib.h>
 
 #include <rut.h>
@@ -34,11 +36,43 @@
 
 #include "rig.pb-c.h"
 
+static void
+send_ui (RigSlaveMaster *master);
+
+static void
+schedule_sync (RigSlaveMaster *master);
+
+static void
+free_pending_edits (RigSlaveMaster *master)
+{
+  GList *l;
+
+  for (l = master->pending_edits; l; l = l->next)
+    g_byte_array_free (l->data, TRUE);
+  g_list_free (master->pending_edits);
+  master->pending_edits = NULL;
+}
+
+static void
+sync_finished (RigSlaveMaster *master)
+{
+  master->sync_in_flight = FALSE;
+
+  /* Anything that changed while waiting for the reply can be sent
+   * now */
+  if (master->connected && (master->ui_dirty || master->pending_edits))
+    schedule_sync (master);
+}
+
 static void
 handle_load_response (const Rig__LoadResult *result,
                       void *closure_data)
 {
+  RigSlaveMaster *master = closure_data;
+
   g_print ("UI loaded by slave\n");
+
+  sync_finished (master);
 }
 
 static void
@@ -47,6 +81,9 @@ required_asset_cb (RutAsset *asset,
 {
   RigSlaveMaster *master = user_data;
 
+  if (g_list_find (master->required_assets, asset))
+    return;
+
   master->required_assets = g_list_prepend (master->required_assets, asset);
 
   g_print ("Serialization requires asset %s\n", rut_asset_get_path (asset));
@@ -59,13 +96,109 @@ handle_asset_load_response (const Rig__LoadAssetResult *result,
   g_print ("Asset loaded by slave\n");
 }
 
+static void
+free_pending_assets (RigSlaveMaster *master)
+{
+  GList *l;
+
+  for (l = master->pending_assets; l; l = l->next)
+    rut_refable_unref (l->data);
+  g_list_free (master->pending_assets);
+  master->pending_assets = NULL;
+}
+
+static CoglBool
+is_hash_missing (const Rig__AssetQueryResult *result,
+                 const char *hash)
+{
+  int i;
+
+  for (i = 0; i < result->n_missing; i++)
+    if (strcmp (result->missing[i], hash) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+static void
+handle_query_assets_response (const Rig__AssetQueryResult *result,
+                              void *closure_data)
+{
+  RigSlaveMaster *master = closure_data;
+  ProtobufCService *service;
+  GList *l;
+
+  master->querying_assets = FALSE;
+
+  if (!master->connected)
+    {
+      free_pending_assets (master);
+      return;
+    }
+
+  if (!result)
+    {
+      free_pending_assets (master);
+      master->ui_dirty = TRUE;
+      sync_finished (master);
+      return;
+    }
+
+  service = (ProtobufCService *)master->rpc_client->pb_rpc_client;
+
+  /* Only the assets that the slave doesn't already have in its cache
+   * need to be transferred */
+  for (l = master->pending_assets; l; l = l->next)
+    {
+      RigSerializedAsset *serialized_asset = l->data;
+
+      if (is_hash_missing (result, serialized_asset->pb_data.hash))
+        {
+          rig__slave__load_asset (service,
+                                  &serialized_asset->pb_data,
+                                  handle_asset_load_response, NULL);
+        }
+
+      g_hash_table_insert (master->sent_assets,
+                           rut_refable_ref (serialized_asset->asset),
+                           serialized_asset->asset);
+    }
+
+  free_pending_assets (master);
+
+  /* The UI is serialized again in case it was edited while waiting
+   * for the reply */
+  send_ui (master);
+}
+
+static void
+handle_edit_response (const Rig__UIEditResult *result,
+                      void *closure_data)
+{
+  RigSlaveMaster *master = closure_data;
+
+  /* If the slave couldn't apply an edit then its UI no longer matches
+   * ours so the only option is to start again */
+  if (result && result->has_status && !result->status)
+    {
+      g_warning ("Slave failed to apply edit; re-sending UI");
+      free_pending_edits (master);
+      master->ui_dirty = TRUE;
+    }
+
+  sync_finished (master);
+}
+
 void
 slave_master_connected (PB_RPC_Client *pb_client,
                         void *user_data)
 {
   RigSlaveMaster *master = user_data;
 
-  rig_slave_master_sync_ui (master);
+  master->connected = TRUE;
+
+  /* The first sync is sent straight away */
+  send_ui (master);
 
   g_print ("XXXXXXXXXXXX Slave Connected and serialized UI sent!");
 }
@@ -83,6 +216,16 @@ destroy_slave_master (RigSlaveMaster *master)
   master->rpc_client = NULL;
 
   master->connected = FALSE;
+  master->ui_synced = FALSE;
+  master->sync_in_flight = FALSE;
+
+  if (master->sync_source_id)
+    {
+      g_source_remove (master->sync_source_id);
+      master->sync_source_id = 0;
+    }
+
+  free_pending_edits (master);
 
   engine->slave_masters = g_list_remove (engine->slave_masters, master);
 
@@ -110,6 +253,12 @@ _rig_slave_master_free (void *object)
 
   destroy_slave_master (master);
 
+  rig_pb_registry_free (master->registry);
+  g_hash_table_destroy (master->sent_assets);
+  g_list_free (master->required_assets);
+  free_pending_assets (master);
+  free_pending_edits (master);
+
   g_slice_free (RigSlaveMaster, master);
 }
 
@@ -168,9 +317,22 @@ rig_slave_master_new (RigEngine *engine,
 
   master->connected = FALSE;
 
+  master->registry = rig_pb_registry_new ();
+  /* The assets are referenced so that a new asset can't be mistaken
+   * for one that was sent if it's allocated at the same address */
+  master->sent_assets = g_hash_table_new_full (NULL, NULL,
+                                               rut_refable_unref,
+                                               NULL);
+
   return master;
 }
 
+void
+rig_slave_master_forget_assets (RigSlaveMaster *master)
+{
+  g_hash_table_remove_all (master->sent_assets);
+}
+
 void
 rig_connect_to_slave (RigEngine *engine, RigSlaveAddress *slave_address)
 {
@@ -179,32 +341,353 @@ rig_connect_to_slave (RigEngine *engine, RigSlaveAddress *slave_address)
   engine->slave_masters = g_list_prepend (engine->slave_masters, slave_master);
 }
 
-void
-rig_slave_master_sync_ui (RigSlaveMaster *master)
+/* Asks the slave which of the required assets it doesn't already
+ * have. Returns FALSE if the slave is known to have all of them */
+static CoglBool
+query_required_assets (RigSlaveMaster *master)
+{
+  ProtobufCService *service =
+    (ProtobufCService *)master->rpc_client->pb_rpc_client;
+  Rig__AssetQuery query = RIG__ASSET_QUERY__INIT;
+  Rig__AssetHash *pb_hashes;
+  int n_assets = 0;
+  GList *l;
+  int i;
+
+  for (l = master->required_assets; l; l = l->next)
+    {
+      RutAsset *asset = l->data;
+      RigSerializedAsset *serialized_asset;
+
+      if (g_hash_table_lookup (master->sent_assets, asset))
+        continue;
+
+      serialized_asset = rig_pb_serialize_asset (asset);
+      if (!serialized_asset)
+        continue;
+
+      master->pending_assets =
+        g_list_prepend (master->pending_assets, serialized_asset);
+      n_assets++;
+    }
+
+  g_list_free (master->required_assets);
+  master->required_assets = NULL;
+
+  if (n_assets == 0)
+    return FALSE;
+
+  pb_hashes = g_new (Rig__AssetHash, n_assets);
+  query.n_assets = n_assets;
+  query.assets = g_new (Rig__AssetHash *, n_assets);
+
+  for (i = 0, l = master->pending_assets; l; i++, l = l->next)
+    {
+      RigSerializedAsset *serialized_asset = l->data;
+      Rig__AssetHash *pb_hash = &pb_hashes[i];
+
+      rig__asset_hash__init (pb_hash);
+      pb_hash->path = serialized_asset->pb_data.path;
+      pb_hash->has_type = TRUE;
+      pb_hash->type = serialized_asset->pb_data.type;
+      pb_hash->hash = serialized_asset->pb_data.hash;
+
+      query.assets[i] = pb_hash;
+    }
+
+  rig__slave__query_assets (service, &query,
+                            handle_query_assets_response, master);
+
+  g_free (query.assets);
+  g_free (pb_hashes);
+
+  master->querying_assets = TRUE;
+
+  return TRUE;
+}
+
+static CoglBool
+has_unsent_assets (RigSlaveMaster *master)
+{
+  GList *l;
+
+  for (l = master->required_assets; l; l = l->next)
+    if (!g_hash_table_lookup (master->sent_assets, l->data))
+      return TRUE;
+
+  return FALSE;
+}
+
+static void
+send_ui (RigSlaveMaster *master)
 {
   RigEngine *engine = master->engine;
   ProtobufCService *service =
     (ProtobufCService *)master->rpc_client->pb_rpc_client;
   Rig__UI *ui;
-  GList *l;
+
+  /* The UI will be sent once the slave has replied */
+  if (master->querying_assets)
+    return;
 
   g_warn_if_fail (master->required_assets == NULL);
 
-  ui = rig_pb_serialize_ui (engine,
-                            required_asset_cb,
-                            master);
+  rut_memory_stack_push_frame (engine->serialization_stack);
 
-  for (l = master->required_assets; l; l = l->next)
+  ui = rig_pb_serialize_ui_with_registry (engine,
+                                          required_asset_cb,
+                                          master,
+                                          master->registry);
+
+  /* The whole UI supersedes any edits that haven't been sent yet */
+  free_pending_edits (master);
+  master->ui_dirty = FALSE;
+
+  if (query_required_assets (master))
+    master->ui_synced = FALSE;
+  else
     {
-      RutAsset *asset = l->data;
-      RigSerializedAsset *serialized_asset = rig_pb_serialize_asset (asset);
+      rig__slave__load (service, ui, handle_load_response, master);
+
+      master->ui_synced = TRUE;
+      master->sync_in_flight = TRUE;
+    }
+
+  rut_memory_stack_pop_frame (engine->serialization_stack);
+}
+
+/* Returns a key that identifies the property that a SET_PROPERTY edit
+ * changes so that only the last change to each property needs to be
+ * sent */
+static char *
+get_set_property_key (const Rig__Edit *pb_edit)
+{
+  if (pb_edit->type != RIG__EDIT__TYPE__SET_PROPERTY ||
+      !pb_edit->has_object_id ||
+      !pb_edit->property_name)
+    return NULL;
+
+  return g_strdup_printf ("%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT ":%s",
+                          pb_edit->transition_id,
+                          pb_edit->object_id,
+                          pb_edit->property_name);
+}
+
+static void
+send_edits (RigSlaveMaster *master)
+{
+  ProtobufCService *service =
+    (ProtobufCService *)master->rpc_client->pb_rpc_client;
+  Rig__UIEdit combined = RIG__UIEDIT__INIT;
+  Rig__UIEdit **pb_edits;
+  GHashTable *changed_properties;
+  int n_pb_edits = 0;
+  int n_edits = 0, n_assets = 0;
+  GList *l;
+  int i, j;
+
+  /* The edits were prepended */
+  master->pending_edits = g_list_reverse (master->pending_edits);
+
+  pb_edits = g_new (Rig__UIEdit *, g_list_length (master->pending_edits));
+
+  for (l = master->pending_edits; l; l = l->next)
+    {
+      GByteArray *packed = l->data;
+      Rig__UIEdit *pb_edit =
+        rig__uiedit__unpack (&protobuf_c_default_allocator,
+                             packed->len,
+                             packed->data);
+
+      if (pb_edit == NULL)
+        {
+          g_warning ("Failed to unpack queued edit; re-sending UI");
+          master->ui_dirty = TRUE;
+          break;
+        }
+
+      pb_edits[n_pb_edits++] = pb_edit;
+      n_edits += pb_edit->n_edits;
+      n_assets += pb_edit->n_assets;
+    }
+
+  free_pending_edits (master);
+
+  if (master->ui_dirty)
+    {
+      for (i = 0; i < n_pb_edits; i++)
+        rig__uiedit__free_unpacked (pb_edits[i],
+                                    &protobuf_c_default_allocator);
+      g_free (pb_edits);
+
+      send_ui (master);
+      return;
+    }
+
+  combined.assets = g_new (Rig__Asset *, n_assets);
+  combined.edits = g_new (Rig__Edit *, n_edits);
+
+  for (i = 0; i < n_pb_edits; i++)
+    for (j = 0; j < pb_edits[i]->n_assets; j++)
+      combined.assets[combined.n_assets++] = pb_edits[i]->assets[j];
+
+  /* Walk the edits backwards so that if a property was set more than
+   * once then only the last value is kept. The edits are added to
+   * the end of the array and reversed afterwards. */
+  changed_properties = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free, NULL);
+
+  for (i = n_pb_edits - 1; i >= 0; i--)
+    for (j = pb_edits[i]->n_edits - 1; j >= 0; j--)
+      {
+        Rig__Edit *pb_edit = pb_edits[i]->edits[j];
+        char *key = get_set_property_key (pb_edit);
+
+        if (key)
+          {
+            if (g_hash_table_lookup (changed_properties, key))
+              {
+                g_free (key);
+                continue;
+              }
+
+            g_hash_table_insert (changed_properties, key, key);
+          }
+
+        combined.edits[combined.n_edits++] = pb_edit;
+      }
+
+  g_hash_table_destroy (changed_properties);
+
+  for (i = 0; i < combined.n_edits / 2; i++)
+    {
+      Rig__Edit *tmp = combined.edits[i];
+      combined.edits[i] = combined.edits[combined.n_edits - 1 - i];
+      combined.edits[combined.n_edits - 1 - i] = tmp;
+    }
+
+  /* The request is packed immediately so everything can be freed
+   * straight away */
+  rig__slave__edit (service, &combined, handle_edit_response, master);
+  master->sync_in_flight = TRUE;
 
-      rig__slave__load_asset (service,
-                              &serialized_asset->pb_data,
-                              handle_asset_load_response, NULL);
+  g_free (combined.assets);
+  g_free (combined.edits);
 
-      rut_refable_unref (serialized_asset);
+  for (i = 0; i < n_pb_edits; i++)
+    rig__uiedit__free_unpacked (pb_edits[i], &protobuf_c_default_allocator);
+  g_free (pb_edits);
+}
+
+static gboolean
+sync_timeout_cb (void *user_data)
+{
+  RigSlaveMaster *master = user_data;
+
+  master->sync_source_id = 0;
+
+  if (!master->connected)
+    return FALSE; /* remove the source */
+
+  /* The reply will schedule another sync */
+  if (master->sync_in_flight || master->querying_assets)
+    return FALSE;
+
+  if (master->ui_dirty || !master->ui_synced)
+    send_ui (master);
+  else if (master->pending_edits)
+    send_edits (master);
+
+  return FALSE; /* remove the source */
+}
+
+static void
+schedule_sync (RigSlaveMaster *master)
+{
+  if (master->sync_source_id || master->sync_in_flight)
+    return;
+
+  master->sync_source_id =
+    g_timeout_add (master->engine->slave_sync_interval,
+                   sync_timeout_cb,
+                   master);
+}
+
+void
+rig_slave_master_sync_ui (RigSlaveMaster *master)
+{
+  if (!master->connected)
+    return;
+
+  free_pending_edits (master);
+  master->ui_dirty = TRUE;
+
+  schedule_sync (master);
+}
+
+static void
+queue_edit (RigSlaveMaster *master,
+            const Rig__UIEdit *pb_edit)
+{
+  GByteArray *packed = g_byte_array_new ();
+
+  g_byte_array_set_size (packed, rig__uiedit__get_packed_size (pb_edit));
+  rig__uiedit__pack (pb_edit, packed->data);
+
+  master->pending_edits = g_list_prepend (master->pending_edits, packed);
+}
+
+void
+rig_slave_master_sync_edit (RigSlaveMaster *master,
+                            UndoRedo *undo_redo)
+{
+  RigEngine *engine = master->engine;
+  Rig__UIEdit *pb_edit;
+
+  /* The whole UI will be sent once the slave is connected */
+  if (!master->connected)
+    return;
+
+  /* If the whole UI is going to be sent anyway then there's no need
+   * to serialize the edit */
+  if (!master->ui_synced || master->ui_dirty)
+    {
+      rig_slave_master_sync_ui (master);
+      return;
+    }
+
+  /* The edit has to be serialized now because the objects it refers
+   * to may have changed by the time the sync happens. It is packed
+   * straight away so it only needs to live in a temporary frame */
+  rut_memory_stack_push_frame (engine->serialization_stack);
+
+  pb_edit = rig_pb_serialize_edit (engine,
+                                   master->registry,
+                                   undo_redo,
+                                   required_asset_cb,
+                                   master);
+
+  /* New assets have to go through the asset query so in that case
+   * the whole UI is sent instead */
+  if (!pb_edit || has_unsent_assets (master))
+    {
+      rut_memory_stack_pop_frame (engine->serialization_stack);
+
+      g_list_free (master->required_assets);
+      master->required_assets = NULL;
+
+      rig_slave_master_sync_ui (master);
+      return;
+    }
+
+  g_list_free (master->required_assets);
+  master->required_assets = NULL;
+
+  if (pb_edit->n_edits)
+    {
+      queue_edit (master, pb_edit);
+      schedule_sync (master);
     }
 
-  rig__slave__load (service, ui, handle_load_response, NULL);
+  rut_memory_stack_pop_frame (engine->serialization_stack);
 }
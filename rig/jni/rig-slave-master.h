@@ -29,6 +29,7 @@
 #include "rig-slave-address.h"
 #include "rig-rpc-network.h"
 #include "rig-engine.h"
+#include "rig-pb.h"
 
 typedef struct _RigSlaveMaster
 {
@@ -40,16 +41,58 @@ typedef struct _RigSlaveMaster
   RigSlaveAddress *slave_address;
   RigRPCClient *rpc_client;
   gboolean connected;
-  GHashTable *registry;
+
+  /* The ids that objects were given when the UI was last sent to the
+   * slave. This is only valid while ui_synced is TRUE and after that
+   * the slave is only sent edits. */
+  RigPBRegistry *registry;
+  CoglBool ui_synced;
 
   GList *required_assets;
 
+  /* Set of the assets that the slave is known to have */
+  GHashTable *sent_assets;
+
+  /* Serialized assets that are waiting for the slave to say whether
+   * it has them cached */
+  GList *pending_assets;
+  CoglBool querying_assets;
+
+  /* Changes aren't sent to the slave straight away. Instead they are
+   * accumulated here and sent together from a timeout so that a burst
+   * of edits results in a single transfer. Each pending edit is a
+   * packed Rig__UIEdit message. */
+  GList *pending_edits;
+  CoglBool ui_dirty;
+  unsigned int sync_source_id;
+
+  /* Set while a Load or Edit request hasn't been replied to yet.
+   * Nothing else is sent until the reply arrives so a slow slave
+   * never has more than one sync queued. */
+  CoglBool sync_in_flight;
+
 } RigSlaveMaster;
 
 void
 rig_connect_to_slave (RigEngine *engine, RigSlaveAddress *slave_address);
 
+/* Schedules sending the whole UI to the slave */
 void
 rig_slave_master_sync_ui (RigSlaveMaster *master);
 
+/* Schedules sending the effect of an operation that has just been
+ * applied to the engine. If the slave hasn't been sent the UI yet or
+ * the operation can't be expressed as an edit then the whole UI is
+ * sent instead. */
+void
+rig_slave_master_sync_edit (RigSlaveMaster *master,
+                            UndoRedo *undo_redo);
+
+/* Forgets which assets have been sent to the slave. This is called
+ * when the engine's assets are freed so that they aren't kept alive
+ * just to remember that the slave has them. The slave's cache is
+ * still queried before anything is transferred again. */
+void
+rig_slave_master_forget_assets (RigSlaveMaster *master);
+
 #endif /* __RIG_SLAVE_MASTER__ */
@@ -1,6 +1,9 @@
 #include <config.h>
 
+#include <string.h>
+
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <rut.h>
 #include <rig-engine.h>
 #include <rig-engine.h>
@@ -24,6 +27,18 @@ typedef struct _RigSlave
 {
   RigEngine *engine;
 
+  /* Maps the ids used by the master to the objects in the loaded UI
+   * so that edits can be applied to them */
+  RigPBRegistry *registry;
+
+  /* Assets sent by a master are kept in this directory named by the
+   * SHA-256 sum of their contents so that they don't need to be sent
+   * again */
+  char *asset_cache_dir;
+
+  /* Maps asset paths to the hash of the currently registered asset */
+  GHashTable *asset_hashes;
+
 } RigSlave;
 
 static void
@@ -42,6 +57,168 @@ slave__test (Rig__Slave_Service *service,
   closure (&result, closure_data);
 }
 
+static CoglBool
+is_valid_hash (const char *hash)
+{
+  int i;
+
+  /* The hash is used as a filename so make sure it can't refer to
+   * anything outside of the cache */
+  if (hash == NULL || strlen (hash) != 64)
+    return FALSE;
+
+  for (i = 0; i < 64; i++)
+    if (!g_ascii_isxdigit (hash[i]))
+      return FALSE;
+
+  return TRUE;
+}
+
+static CoglBool
+check_hash (const char *hash,
+            const uint8_t *data,
+            size_t len)
+{
+  char *data_hash = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+                                                 data, len);
+  CoglBool ret = g_ascii_strcasecmp (data_hash, hash) == 0;
+
+  g_free (data_hash);
+
+  return ret;
+}
+
+static CoglBool
+register_asset_data (RigSlave *slave,
+                     const char *path,
+                     RutAssetType type,
+                     const char *hash,
+                     uint8_t *data,
+                     size_t len)
+{
+  RigEngine *engine = slave->engine;
+  RutAsset *asset = rut_asset_new_from_data (engine->ctx,
+                                             path,
+                                             type,
+                                             data,
+                                             len);
+
+  if (!asset)
+    return FALSE;
+
+  rig_register_asset (engine, asset);
+  rut_refable_unref (asset);
+
+  if (hash)
+    g_hash_table_insert (slave->asset_hashes, g_strdup (path), g_strdup (hash));
+  else
+    g_hash_table_remove (slave->asset_hashes, path);
+
+  return TRUE;
+}
+
+static CoglBool
+load_cached_asset (RigSlave *slave,
+                   const Rig__AssetHash *pb_hash)
+{
+  const char *registered_hash =
+    g_hash_table_lookup (slave->asset_hashes, pb_hash->path);
+  char *filename;
+  char *contents;
+  size_t len;
+  CoglBool ret = FALSE;
+
+  if (registered_hash &&
+      strcmp (registered_hash, pb_hash->hash) == 0 &&
+      rig_lookup_asset (slave->engine, pb_hash->path))
+    return TRUE;
+
+  filename = g_build_filename (slave->asset_cache_dir, pb_hash->hash, NULL);
+
+  if (g_file_get_contents (filename, &contents, &len, NULL))
+    {
+      if (check_hash (pb_hash->hash, (uint8_t *)contents, len))
+        ret = register_asset_data (slave,
+                                   pb_hash->path,
+                                   pb_hash->type,
+                                   pb_hash->hash,
+                                   (uint8_t *)contents,
+                                   len);
+      else
+        {
+          g_warning ("Removing corrupt cached asset %s", filename);
+          g_unlink (filename);
+        }
+
+      g_free (contents);
+    }
+
+  g_free (filename);
+
+  return ret;
+}
+
+static void
+cache_asset (RigSlave *slave,
+             const char *hash,
+             const uint8_t *data,
+             size_t len)
+{
+  char *filename = g_build_filename (slave->asset_cache_dir, hash, NULL);
+  GError *error = NULL;
+
+  if (!g_file_set_contents (filename, (const char *)data, len, &error))
+    {
+      g_warning ("Failed to cache asset: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (filename);
+}
+
+static void
+slave__query_assets (Rig__Slave_Service *service,
+                     const Rig__AssetQuery *query,
+                     Rig__AssetQueryResult_Closure closure,
+                     void *closure_data)
+{
+  Rig__AssetQueryResult result = RIG__ASSET_QUERY_RESULT__INIT;
+  RigSlave *slave = rig_pb_rpc_closure_get_connection_data (closure_data);
+  int i;
+
+  g_return_if_fail (query != NULL);
+
+  g_print ("Asset Query\n");
+
+  result.missing = g_new (char *, query->n_assets);
+
+  for (i = 0; i < query->n_assets; i++)
+    {
+      Rig__AssetHash *pb_hash = query->assets[i];
+
+      /* The master can only match up the reply by the hash so there
+       * is no way to ask for an asset without one */
+      if (!pb_hash->hash)
+        {
+          g_warning ("Ignoring queried asset without a hash");
+          continue;
+        }
+
+      /* Anything that can't be looked up in the cache is reported as
+       * missing so that the master sends the asset itself instead of
+       * assuming that we already have it */
+      if (!pb_hash->path ||
+          !pb_hash->has_type ||
+          !is_valid_hash (pb_hash->hash) ||
+          !load_cached_asset (slave, pb_hash))
+        result.missing[result.n_missing++] = pb_hash->hash;
+    }
+
+  closure (&result, closure_data);
+
+  g_free (result.missing);
+}
+
 static void
 slave__load_asset (Rig__Slave_Service *service,
                    const Rig__SerializedAsset *query,
@@ -50,20 +227,25 @@ slave__load_asset (Rig__Slave_Service *service,
 {
   Rig__LoadAssetResult result = RIG__LOAD_ASSET_RESULT__INIT;
   RigSlave *slave = rig_pb_rpc_closure_get_connection_data (closure_data);
-  RigEngine *engine = slave->engine;
+  const char *hash = NULL;
 
   g_return_if_fail (query != NULL);
 
   if (query->has_type)
     {
-      RutAsset *asset =
-        rut_asset_new_from_data (engine->ctx,
-                                 query->path,
-                                 query->type,
-                                 query->data.data,
-                                 query->data.len);
-
-      rig_register_asset (engine, asset);
+      if (is_valid_hash (query->hash) &&
+          check_hash (query->hash, query->data.data, query->data.len))
+        {
+          hash = query->hash;
+          cache_asset (slave, hash, query->data.data, query->data.len);
+        }
+
+      register_asset_data (slave,
+                           query->path,
+                           query->type,
+                           hash,
+                           query->data.data,
+                           query->data.len);
 
       g_print ("Load Asset Request\n");
     }
@@ -85,7 +267,7 @@ slave__load (Rig__Slave_Service *service,
 
   g_print ("UI Load Request\n");
 
-  rig_pb_unserialize_ui (engine, ui);
+  rig_pb_unserialize_ui_with_registry (engine, ui, slave->registry);
 
   rig_engine_set_onscreen_size (engine,
                                 engine->device_width / 2,
@@ -94,6 +276,26 @@ slave__load (Rig__Slave_Service *service,
   closure (&result, closure_data);
 }
 
+static void
+slave__edit (Rig__Slave_Service *service,
+             const Rig__UIEdit *pb_edit,
+             Rig__UIEditResult_Closure closure,
+             void *closure_data)
+{
+  Rig__UIEditResult result = RIG__UIEDIT_RESULT__INIT;
+  RigSlave *slave = rig_pb_rpc_closure_get_connection_data (closure_data);
+  RigEngine *engine = slave->engine;
+
+  g_return_if_fail (pb_edit != NULL);
+
+  g_print ("UI Edit Request\n");
+
+  result.has_status = TRUE;
+  result.status = rig_pb_apply_edit (engine, slave->registry, pb_edit);
+
+  closure (&result, closure_data);
+}
+
 
 static Rig__Slave_Service rig_slave_service =
   RIG__SLAVE__INIT(slave__);
@@ -147,6 +349,16 @@ rig_slave_init (RutShell *shell, void *user_data)
                         new_client_handler,
                         slave);
 
+  slave->registry = rig_pb_registry_new ();
+
+  slave->asset_cache_dir =
+    g_build_filename (g_get_user_cache_dir (), "rig", "assets", NULL);
+  if (g_mkdir_with_parents (slave->asset_cache_dir, 0700) == -1)
+    g_warning ("Failed to create asset cache directory %s",
+               slave->asset_cache_dir);
+  slave->asset_hashes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, g_free);
+
   rig_engine_init (shell, slave->engine);
 }
 
@@ -156,6 +368,14 @@ rig_slave_fini (RutShell *shell, void *user_data)
   RigSlave *slave = user_data;
 
   rig_engine_fini (shell, slave->engine);
+
+  rig_pb_registry_free (slave->registry);
+  slave->registry = NULL;
+
+  g_hash_table_destroy (slave->asset_hashes);
+  slave->asset_hashes = NULL;
+  g_free (slave->asset_cache_dir);
+  slave->asset_cache_dir = NULL;
 }
 
 CoglBool
@@ -0,0 +1,435 @@
+/*
+ * Transition Benchmark
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This measures the CPU cost of updating all of the animated
+ * properties of a transition when its progress changes. It compares
+ * interpolating each path individually with rig_path_lerp_property()
+ * against evaluating the transition's compiled plan with
+ * rig_transition_set_progress().
+ *
+ * Each object has an animated float, vec3, vec4, color and quaternion
+ * property so that every type the plan handles is measured. Before
+ * timing anything the results of the plan are checked against
+ * rig_path_lerp_property() for every property.
+ *
+ * Usage:
+ * rig-transition-bench [OPTION...]
+ *
+ * Application Options:
+ *   -o, --objects=N       Number of animated objects
+ *   -k, --keyframes=N     Number of keyframes in each path
+ *   -f, --frames=N        Number of progress updates to measure
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#include <glib.h>
+
+#include <rut.h>
+
+#include "rig-transition.h"
+
+static int n_objects = 300;
+static int n_keyframes = 16;
+static int n_frames = 1000;
+
+static const GOptionEntry options[] =
+{
+  { "objects", 'o', 0, G_OPTION_ARG_INT, &n_objects,
+    "Number of animated objects", "N" },
+  { "keyframes", 'k', 0, G_OPTION_ARG_INT, &n_keyframes,
+    "Number of keyframes in each path", "N" },
+  { "frames", 'f', 0, G_OPTION_ARG_INT, &n_frames,
+    "Number of progress updates to measure", "N" },
+  { 0 }
+};
+
+enum
+{
+  BENCH_PROP_FLOAT,
+  BENCH_PROP_VEC3,
+  BENCH_PROP_VEC4,
+  BENCH_PROP_COLOR,
+  BENCH_PROP_QUATERNION,
+  BENCH_N_PROPS
+};
+
+typedef struct
+{
+  float float_value;
+  float vec3_value[3];
+  float vec4_value[4];
+  CoglColor color_value;
+  CoglQuaternion quaternion_value;
+
+  RutProperty properties[BENCH_N_PROPS];
+} BenchObject;
+
+static RutPropertySpec bench_prop_specs[] =
+{
+  {
+    .name = "float",
+    .type = RUT_PROPERTY_TYPE_FLOAT,
+    .data_offset = offsetof (BenchObject, float_value),
+    .flags = RUT_PROPERTY_FLAG_READWRITE,
+    .animatable = TRUE
+  },
+  {
+    .name = "vec3",
+    .type = RUT_PROPERTY_TYPE_VEC3,
+    .data_offset = offsetof (BenchObject, vec3_value),
+    .flags = RUT_PROPERTY_FLAG_READWRITE,
+    .animatable = TRUE
+  },
+  {
+    .name = "vec4",
+    .type = RUT_PROPERTY_TYPE_VEC4,
+    .data_offset = offsetof (BenchObject, vec4_value),
+    .flags = RUT_PROPERTY_FLAG_READWRITE,
+    .animatable = TRUE
+  },
+  {
+    .name = "color",
+    .type = RUT_PROPERTY_TYPE_COLOR,
+    .data_offset = offsetof (BenchObject, color_value),
+    .flags = RUT_PROPERTY_FLAG_READWRITE,
+    .animatable = TRUE
+  },
+  {
+    .name = "quaternion",
+    .type = RUT_PROPERTY_TYPE_QUATERNION,
+    .data_offset = offsetof (BenchObject, quaternion_value),
+    .flags = RUT_PROPERTY_FLAG_READWRITE,
+    .animatable = TRUE
+  }
+};
+
+static float
+random_float (GRand *rand)
+{
+  return g_rand_double_range (rand, -100, 100);
+}
+
+static void
+insert_random_key (RigPath *path,
+                   float t,
+                   GRand *rand)
+{
+  switch (path->type)
+    {
+    case RUT_PROPERTY_TYPE_FLOAT:
+      rig_path_insert_float (path, t, random_float (rand));
+      break;
+    case RUT_PROPERTY_TYPE_VEC3:
+      {
+        float value[3] =
+          { random_float (rand), random_float (rand), random_float (rand) };
+
+        rig_path_insert_vec3 (path, t, value);
+        break;
+      }
+    case RUT_PROPERTY_TYPE_VEC4:
+      {
+        float value[4] =
+          { random_float (rand), random_float (rand),
+            random_float (rand), random_float (rand) };
+
+        rig_path_insert_vec4 (path, t, value);
+        break;
+      }
+    case RUT_PROPERTY_TYPE_COLOR:
+      {
+        CoglColor value;
+
+        cogl_color_init_from_4f (&value,
+                                 g_rand_double (rand),
+                                 g_rand_double (rand),
+                                 g_rand_double (rand),
+                                 g_rand_double (rand));
+        rig_path_insert_color (path, t, &value);
+        break;
+      }
+    case RUT_PROPERTY_TYPE_QUATERNION:
+      {
+        CoglQuaternion value;
+
+        /* Use an arbitrary axis so that all of the components are
+         * exercised */
+        cogl_quaternion_init (&value,
+                              g_rand_double_range (rand, 0, 360),
+                              random_float (rand),
+                              random_float (rand),
+                              random_float (rand) + 200);
+        rig_path_insert_quaternion (path, t, &value);
+        break;
+      }
+    default:
+      g_warn_if_reached ();
+    }
+}
+
+static void
+animate_object (RigTransition *transition,
+                BenchObject *object,
+                GRand *rand)
+{
+  int i, j;
+
+  for (i = 0; i < BENCH_N_PROPS; i++)
+    {
+      RutProperty *property = &object->properties[i];
+      RigPath *path =
+        rig_transition_get_path_for_property (transition, property);
+
+      for (j = 0; j < n_keyframes; j++)
+        insert_random_key (path, j / (float) MAX (1, n_keyframes - 1), rand);
+
+      rig_transition_set_property_animated (transition, property, TRUE);
+    }
+}
+
+/* Copies the value of @property into @components. The returned value
+ * is the number of components */
+static int
+get_property_components (RutProperty *property,
+                         float *components)
+{
+  switch (property->spec->type)
+    {
+    case RUT_PROPERTY_TYPE_FLOAT:
+      components[0] = rut_property_get_float (property);
+      return 1;
+    case RUT_PROPERTY_TYPE_VEC3:
+      memcpy (components, rut_property_get_vec3 (property),
+              sizeof (float) * 3);
+      return 3;
+    case RUT_PROPERTY_TYPE_VEC4:
+      memcpy (components, rut_property_get_vec4 (property),
+              sizeof (float) * 4);
+      return 4;
+    case RUT_PROPERTY_TYPE_COLOR:
+      {
+        const CoglColor *color = rut_property_get_color (property);
+
+        components[0] = cogl_color_get_red_float (color);
+        components[1] = cogl_color_get_green_float (color);
+        components[2] = cogl_color_get_blue_float (color);
+        components[3] = cogl_color_get_alpha_float (color);
+        return 4;
+      }
+    case RUT_PROPERTY_TYPE_QUATERNION:
+      {
+        const CoglQuaternion *quaternion =
+          rut_property_get_quaternion (property);
+
+        components[0] = quaternion->w;
+        components[1] = quaternion->x;
+        components[2] = quaternion->y;
+        components[3] = quaternion->z;
+        return 4;
+      }
+    default:
+      g_warn_if_reached ();
+      return 0;
+    }
+}
+
+/* Checks that evaluating the plan gives the same value for every
+ * property as interpolating its path individually. Returns the
+ * number of mismatched properties */
+static int
+verify_plan (RigTransition *transition,
+             BenchObject *objects,
+             GRand *rand)
+{
+  int n_mismatches = 0;
+  int frame, i, j, k;
+
+  for (frame = 0; frame < n_frames; frame++)
+    {
+      float progress = g_rand_double (rand);
+
+      rig_transition_set_progress (transition, progress);
+
+      for (i = 0; i < n_objects; i++)
+        for (j = 0; j < BENCH_N_PROPS; j++)
+          {
+            RutProperty *property = &objects[i].properties[j];
+            RigPath *path =
+              rig_transition_get_path_for_property (transition, property);
+            float plan_value[4], path_value[4];
+            int n_components;
+
+            n_components = get_property_components (property, plan_value);
+            rig_path_lerp_property (path, property, progress);
+            get_property_components (property, path_value);
+
+            for (k = 0; k < n_components; k++)
+              if (fabsf (plan_value[k] - path_value[k]) >
+                  1e-4f * MAX (1.0f, fabsf (path_value[k])))
+                break;
+
+            if (k < n_components)
+              {
+                if (n_mismatches == 0)
+                  g_printerr ("%s property of object %i differs from "
+                              "the path at progress %f\n",
+                              property->spec->name, i, progress);
+                n_mismatches++;
+              }
+          }
+    }
+
+  return n_mismatches;
+}
+
+static void
+lerp_path_cb (RigTransitionPropData *prop_data,
+              void *user_data)
+{
+  float *progress = user_data;
+
+  if (prop_data->animated && prop_data->path)
+    rig_path_lerp_property (prop_data->path,
+                            prop_data->property,
+                            *progress);
+}
+
+static float
+get_frame_progress (int frame, CoglBool sequential, GRand *rand)
+{
+  if (sequential)
+    return frame / (float) MAX (1, n_frames - 1);
+  else
+    return g_rand_double (rand);
+}
+
+static void
+run_benchmark (RigTransition *transition,
+               CoglBool sequential)
+{
+  GRand *rand;
+  int64_t start, per_property_time, plan_time;
+  int i;
+
+  rand = g_rand_new_with_seed (0);
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_frames; i++)
+    {
+      float progress = get_frame_progress (i, sequential, rand);
+
+      rig_transition_foreach_property (transition, lerp_path_cb, &progress);
+    }
+  per_property_time = g_get_monotonic_time () - start;
+  g_rand_free (rand);
+
+  rand = g_rand_new_with_seed (0);
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_frames; i++)
+    {
+      float progress = get_frame_progress (i, sequential, rand);
+
+      rig_transition_set_progress (transition, progress);
+    }
+  plan_time = g_get_monotonic_time () - start;
+  g_rand_free (rand);
+
+  g_print ("%-10s %6d properties: per-property %8.2fus/frame, "
+           "plan %8.2fus/frame\n",
+           sequential ? "sequential" : "random",
+           n_objects * BENCH_N_PROPS,
+           per_property_time / (double) n_frames,
+           plan_time / (double) n_frames);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context = g_option_context_new (NULL);
+  GError *error = NULL;
+  RutShell *shell;
+  RutContext *ctx;
+  RigTransition *transition;
+  BenchObject *objects;
+  GRand *rand;
+  int n_mismatches;
+  int i, j;
+
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("option parsing failed: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  n_objects = MAX (1, n_objects);
+  n_keyframes = MAX (1, n_keyframes);
+  n_frames = MAX (1, n_frames);
+
+  shell = rut_shell_new (NULL, NULL, NULL, NULL);
+  ctx = rut_context_new (shell);
+  if (ctx == NULL)
+    return EXIT_FAILURE;
+
+  transition = rig_transition_new (ctx, 0);
+  objects = g_new0 (BenchObject, n_objects);
+  rand = g_rand_new_with_seed (n_objects);
+
+  for (i = 0; i < n_objects; i++)
+    {
+      for (j = 0; j < BENCH_N_PROPS; j++)
+        rut_property_init (&objects[i].properties[j],
+                           &bench_prop_specs[j],
+                           &objects[i]);
+
+      animate_object (transition, &objects[i], rand);
+    }
+
+  /* This also builds the plan before timing anything */
+  n_mismatches = verify_plan (transition, objects, rand);
+  if (n_mismatches)
+    g_printerr ("%i property updates differ between the plan and "
+                "the paths\n", n_mismatches);
+
+  run_benchmark (transition, TRUE);
+  run_benchmark (transition, FALSE);
+
+  rig_transition_free (transition);
+
+  for (i = 0; i < n_objects; i++)
+    for (j = 0; j < BENCH_N_PROPS; j++)
+      rut_property_destroy (&objects[i].properties[j]);
+  g_free (objects);
+  g_rand_free (rand);
+
+  rut_refable_unref (ctx);
+  rut_refable_unref (shell);
+
+  return n_mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1904,7 +1904,9 @@ rig_transition_view_commit_dragged_nodes (RigTransitionView *view)
     {
       /* Reset all of the nodes to their original position so that the
        * undo journal can see it */
-      selected_node->node->t = selected_node->original_time;
+      rig_path_move_node (selected_node->prop_data->path,
+                          selected_node->node,
+                          selected_node->original_time);
 
       nodes[i].property = selected_node->prop_data->property;
       nodes[i].node = selected_node->node;
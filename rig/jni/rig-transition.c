@@ -21,8 +21,73 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+#include <math.h>
+
 #include "rig-transition.h"
 
+/* The types of property that the plan can evaluate directly. Paths
+ * for any other type are evaluated individually with
+ * rig_path_lerp_property() */
+typedef enum
+{
+  RIG_TRANSITION_PLAN_GROUP_FLOAT,
+  RIG_TRANSITION_PLAN_GROUP_VEC3,
+  RIG_TRANSITION_PLAN_GROUP_VEC4,
+  RIG_TRANSITION_PLAN_GROUP_COLOR,
+  RIG_TRANSITION_PLAN_GROUP_QUATERNION,
+
+  RIG_TRANSITION_PLAN_N_GROUPS
+} RigTransitionPlanGroupType;
+
+/* All of the animated properties of one type. The keyframes for all
+ * of the paths are stored back to back with the times and values in
+ * separate arrays. */
+typedef struct
+{
+  int n_components;
+  int n_tracks;
+
+  /* These arrays have one entry per track */
+  RutProperty **properties;
+  int *first_key;
+  int *n_keys;
+  /* The index of the key that the last segment started at so that
+   * sequential playback usually doesn't need to search */
+  int *cursor;
+  /* The keys and interpolation factors for the current progress */
+  int *key0;
+  int *key1;
+  float *factors;
+
+  /* One entry per key */
+  float *times;
+  /* n_components entries per key */
+  float *values;
+
+  /* n_components entries per track */
+  float *results;
+} RigTransitionPlanGroup;
+
+/* A path that the plan was built from. If any of these change then
+ * the plan needs to be rebuilt */
+typedef struct
+{
+  RigTransitionPropData *prop_data;
+  RigPath *path;
+  unsigned int path_age;
+} RigTransitionPlanDependency;
+
+struct _RigTransitionPlan
+{
+  RigTransitionPlanGroup groups[RIG_TRANSITION_PLAN_N_GROUPS];
+
+  /* Animated properties that can't be evaluated by the groups */
+  GArray *fallback_prop_datas;
+
+  GArray *dependencies;
+};
+
 static RutPropertySpec _rig_transition_prop_specs[] = {
   {
     .name = "progress",
@@ -111,11 +176,15 @@ rig_transition_new (RutContext *context,
   return transition;
 }
 
+static void rig_transition_invalidate_plan (RigTransition *transition);
+
 void
 rig_transition_free (RigTransition *transition)
 {
   rut_closure_list_disconnect_all (&transition->operation_cb_list);
 
+  rig_transition_invalidate_plan (transition);
+
   rut_simple_introspectable_destroy (transition);
 
   g_hash_table_destroy (transition->properties);
@@ -228,15 +297,485 @@ rig_transition_get_path (RigTransition *transition,
 }
 
 static void
-update_progress_cb (RigTransitionPropData *prop_data,
-                    void *user_data)
+rig_transition_invalidate_plan (RigTransition *transition)
+{
+  RigTransitionPlan *plan = transition->plan;
+  int i;
+
+  if (plan == NULL)
+    return;
+
+  for (i = 0; i < RIG_TRANSITION_PLAN_N_GROUPS; i++)
+    {
+      RigTransitionPlanGroup *group = &plan->groups[i];
+
+      g_free (group->properties);
+      g_free (group->first_key);
+      g_free (group->n_keys);
+      g_free (group->cursor);
+      g_free (group->key0);
+      g_free (group->key1);
+      g_free (group->factors);
+      g_free (group->times);
+      g_free (group->values);
+      g_free (group->results);
+    }
+
+  for (i = 0; i < plan->dependencies->len; i++)
+    {
+      RigTransitionPlanDependency *dependency =
+        &g_array_index (plan->dependencies, RigTransitionPlanDependency, i);
+
+      if (dependency->path)
+        rut_refable_unref (dependency->path);
+    }
+
+  g_array_free (plan->dependencies, TRUE);
+  g_array_free (plan->fallback_prop_datas, TRUE);
+
+  g_slice_free (RigTransitionPlan, plan);
+
+  transition->plan = NULL;
+}
+
+static CoglBool
+get_plan_group_type (RutPropertyType type,
+                     RigTransitionPlanGroupType *group_type,
+                     int *n_components)
+{
+  switch (type)
+    {
+    case RUT_PROPERTY_TYPE_FLOAT:
+      *group_type = RIG_TRANSITION_PLAN_GROUP_FLOAT;
+      *n_components = 1;
+      return TRUE;
+    case RUT_PROPERTY_TYPE_VEC3:
+      *group_type = RIG_TRANSITION_PLAN_GROUP_VEC3;
+      *n_components = 3;
+      return TRUE;
+    case RUT_PROPERTY_TYPE_VEC4:
+      *group_type = RIG_TRANSITION_PLAN_GROUP_VEC4;
+      *n_components = 4;
+      return TRUE;
+    case RUT_PROPERTY_TYPE_COLOR:
+      *group_type = RIG_TRANSITION_PLAN_GROUP_COLOR;
+      *n_components = 4;
+      return TRUE;
+    case RUT_PROPERTY_TYPE_QUATERNION:
+      *group_type = RIG_TRANSITION_PLAN_GROUP_QUATERNION;
+      *n_components = 4;
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+static void
+get_node_components (RutPropertyType type,
+                     RigNode *node,
+                     float *components)
+{
+  switch (type)
+    {
+    case RUT_PROPERTY_TYPE_FLOAT:
+      components[0] = ((RigNodeFloat *) node)->value;
+      break;
+    case RUT_PROPERTY_TYPE_VEC3:
+      memcpy (components, ((RigNodeVec3 *) node)->value, sizeof (float) * 3);
+      break;
+    case RUT_PROPERTY_TYPE_VEC4:
+      memcpy (components, ((RigNodeVec4 *) node)->value, sizeof (float) * 4);
+      break;
+    case RUT_PROPERTY_TYPE_COLOR:
+      {
+        const CoglColor *color = &((RigNodeColor *) node)->value;
+
+        components[0] = cogl_color_get_red_float (color);
+        components[1] = cogl_color_get_green_float (color);
+        components[2] = cogl_color_get_blue_float (color);
+        components[3] = cogl_color_get_alpha_float (color);
+        break;
+      }
+    case RUT_PROPERTY_TYPE_QUATERNION:
+      {
+        const CoglQuaternion *quaternion =
+          &((RigNodeQuaternion *) node)->value;
+
+        components[0] = quaternion->w;
+        components[1] = quaternion->x;
+        components[2] = quaternion->y;
+        components[3] = quaternion->z;
+        break;
+      }
+    default:
+      g_warn_if_reached ();
+    }
+}
+
+typedef struct
+{
+  RigTransitionPlan *plan;
+  /* The number of tracks and keys in each group */
+  int n_tracks[RIG_TRANSITION_PLAN_N_GROUPS];
+  int n_keys[RIG_TRANSITION_PLAN_N_GROUPS];
+  int n_components[RIG_TRANSITION_PLAN_N_GROUPS];
+} BuildPlanState;
+
+static void
+count_plan_tracks_cb (RigTransitionPropData *prop_data,
+                      void *user_data)
+{
+  BuildPlanState *state = user_data;
+  RigTransitionPlanDependency dependency;
+  RigTransitionPlanGroupType group_type;
+  int n_components;
+
+  if (!prop_data->animated)
+    return;
+
+  /* Animated properties without a path are still tracked because a
+   * path may be assigned to them later */
+  dependency.prop_data = prop_data;
+  dependency.path = prop_data->path;
+  dependency.path_age = prop_data->path ? prop_data->path->age : 0;
+  if (dependency.path)
+    rut_refable_ref (dependency.path);
+  g_array_append_val (state->plan->dependencies, dependency);
+
+  if (prop_data->path == NULL || prop_data->path->length == 0)
+    return;
+
+  if (get_plan_group_type (prop_data->path->type, &group_type, &n_components))
+    {
+      state->n_tracks[group_type]++;
+      state->n_keys[group_type] += prop_data->path->length;
+      state->n_components[group_type] = n_components;
+    }
+  else
+    g_array_append_val (state->plan->fallback_prop_datas, prop_data);
+}
+
+static void
+add_plan_track (RigTransitionPlan *plan,
+                RigTransitionPropData *prop_data)
+{
+  RigPath *path = prop_data->path;
+  RigTransitionPlanGroupType group_type;
+  RigTransitionPlanGroup *group;
+  int n_components;
+  int track, key;
+  RigNode *node;
+
+  if (!get_plan_group_type (path->type, &group_type, &n_components))
+    return;
+
+  group = &plan->groups[group_type];
+  track = group->n_tracks++;
+
+  /* The first key of the track is after the last key of the previous
+   * track */
+  key = track ? group->first_key[track - 1] + group->n_keys[track - 1] : 0;
+
+  group->properties[track] = prop_data->property;
+  group->first_key[track] = key;
+  group->n_keys[track] = path->length;
+  group->cursor[track] = key;
+
+  rut_list_for_each (node, &path->nodes, list_node)
+    {
+      group->times[key] = node->t;
+      get_node_components (path->type,
+                           node,
+                           group->values + key * n_components);
+      key++;
+    }
+}
+
+static RigTransitionPlan *
+rig_transition_build_plan (RigTransition *transition)
+{
+  RigTransitionPlan *plan = g_slice_new0 (RigTransitionPlan);
+  BuildPlanState state;
+  int i;
+
+  plan->dependencies =
+    g_array_new (FALSE, FALSE, sizeof (RigTransitionPlanDependency));
+  plan->fallback_prop_datas =
+    g_array_new (FALSE, FALSE, sizeof (RigTransitionPropData *));
+
+  memset (&state, 0, sizeof (state));
+  state.plan = plan;
+
+  rig_transition_foreach_property (transition, count_plan_tracks_cb, &state);
+
+  for (i = 0; i < RIG_TRANSITION_PLAN_N_GROUPS; i++)
+    {
+      RigTransitionPlanGroup *group = &plan->groups[i];
+      int n_tracks = state.n_tracks[i];
+      int n_keys = state.n_keys[i];
+
+      if (n_tracks == 0)
+        continue;
+
+      group->n_components = state.n_components[i];
+
+      group->properties = g_new (RutProperty *, n_tracks);
+      group->first_key = g_new (int, n_tracks);
+      group->n_keys = g_new (int, n_tracks);
+      group->cursor = g_new (int, n_tracks);
+      group->key0 = g_new (int, n_tracks);
+      group->key1 = g_new (int, n_tracks);
+      group->factors = g_new (float, n_tracks);
+      group->times = g_new (float, n_keys);
+      group->values = g_new (float, n_keys * group->n_components);
+      group->results = g_new (float, n_tracks * group->n_components);
+    }
+
+  for (i = 0; i < plan->dependencies->len; i++)
+    {
+      RigTransitionPlanDependency *dependency =
+        &g_array_index (plan->dependencies, RigTransitionPlanDependency, i);
+
+      if (dependency->path && dependency->path->length)
+        add_plan_track (plan, dependency->prop_data);
+    }
+
+  return plan;
+}
+
+static CoglBool
+rig_transition_plan_is_valid (RigTransitionPlan *plan)
+{
+  int i;
+
+  for (i = 0; i < plan->dependencies->len; i++)
+    {
+      RigTransitionPlanDependency *dependency =
+        &g_array_index (plan->dependencies, RigTransitionPlanDependency, i);
+      RigPath *path = dependency->prop_data->path;
+
+      if (path != dependency->path ||
+          (path && path->age != dependency->path_age))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Finds the keys either side of t for each track in the same way as
+ * path_find_control_points2() does when moving forwards */
+static void
+find_plan_group_keys (RigTransitionPlanGroup *group,
+                      float t)
+{
+  const float *times = group->times;
+  int i;
+
+  for (i = 0; i < group->n_tracks; i++)
+    {
+      int first = group->first_key[i];
+      int last = first + group->n_keys[i] - 1;
+      int pos = group->cursor[i];
+      int key0, key1;
+
+      if (times[first] > t)
+        key0 = key1 = first;
+      else if (times[last] <= t)
+        key0 = key1 = last;
+      else
+        {
+          /* The cursor is valid if t is within the segment starting
+           * at the cursor. During playback t will often have moved
+           * on to the next segment so we try that too before
+           * searching for the last key that is less than or equal to
+           * t */
+          if (times[pos] > t || times[pos + 1] <= t)
+            {
+              if (pos + 2 <= last &&
+                  times[pos + 1] <= t && times[pos + 2] > t)
+                pos++;
+              else
+                {
+                  int low = first, high = last;
+
+                  while (low < high)
+                    {
+                      int mid = low + (high - low) / 2;
+
+                      if (times[mid] > t)
+                        high = mid;
+                      else
+                        low = mid + 1;
+                    }
+
+                  pos = low - 1;
+                }
+
+              group->cursor[i] = pos;
+            }
+
+          key0 = pos;
+          key1 = pos + 1;
+        }
+
+      group->key0[i] = key0;
+      group->key1[i] = key1;
+
+      if (key0 == key1)
+        group->factors[i] = 0.0f;
+      else
+        group->factors[i] = (t - times[key0]) / (times[key1] - times[key0]);
+    }
+}
+
+static void
+lerp_plan_group (RigTransitionPlanGroup *group)
+{
+  const float *values = group->values;
+  const int *key0 = group->key0;
+  const int *key1 = group->key1;
+  const float *factors = group->factors;
+  float *results = group->results;
+  int n_components = group->n_components;
+  int i, j;
+
+  for (i = 0; i < group->n_tracks; i++)
+    {
+      const float *a = values + key0[i] * n_components;
+      const float *b = values + key1[i] * n_components;
+      float *result = results + i * n_components;
+      float factor = factors[i];
+
+      for (j = 0; j < n_components; j++)
+        result[j] = a[j] + (b[j] - a[j]) * factor;
+    }
+}
+
+/* This matches cogl_quaternion_nlerp() */
+static void
+nlerp_plan_group (RigTransitionPlanGroup *group)
+{
+  const float *values = group->values;
+  float *results = group->results;
+  int i, j;
+
+  for (i = 0; i < group->n_tracks; i++)
+    {
+      const float *a = values + group->key0[i] * 4;
+      const float *b = values + group->key1[i] * 4;
+      float *result = results + i * 4;
+      float factor = group->factors[i];
+      float fa = 1.0f - factor, fb = factor;
+      float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+      float magnitude;
+
+      if (factor == 0.0f)
+        {
+          memcpy (result, a, sizeof (float) * 4);
+          continue;
+        }
+
+      /* Take the shortest path around the hypersphere */
+      if (dot < 0.0f)
+        fb = -fb;
+
+      for (j = 0; j < 4; j++)
+        result[j] = fa * a[j] + fb * b[j];
+
+      magnitude = sqrtf (result[0] * result[0] +
+                         result[1] * result[1] +
+                         result[2] * result[2] +
+                         result[3] * result[3]);
+      for (j = 0; j < 4; j++)
+        result[j] /= magnitude;
+    }
+}
+
+static void
+write_plan_group_results (RigTransition *transition,
+                          RigTransitionPlanGroupType group_type,
+                          RigTransitionPlanGroup *group)
 {
-  RigTransition *transition = user_data;
+  RutPropertyContext *property_ctx = &transition->context->property_ctx;
+  const float *results = group->results;
+  int i;
 
-  if (prop_data->animated && prop_data->path)
-    rig_path_lerp_property (prop_data->path,
-                            prop_data->property,
-                            transition->progress);
+  for (i = 0; i < group->n_tracks; i++)
+    {
+      RutProperty *property = group->properties[i];
+      const float *result = results + i * group->n_components;
+
+      switch (group_type)
+        {
+        case RIG_TRANSITION_PLAN_GROUP_FLOAT:
+          rut_property_set_float (property_ctx, property, result[0]);
+          break;
+        case RIG_TRANSITION_PLAN_GROUP_VEC3:
+          rut_property_set_vec3 (property_ctx, property, result);
+          break;
+        case RIG_TRANSITION_PLAN_GROUP_VEC4:
+          rut_property_set_vec4 (property_ctx, property, result);
+          break;
+        case RIG_TRANSITION_PLAN_GROUP_COLOR:
+          {
+            CoglColor color;
+
+            cogl_color_init_from_4f (&color,
+                                     result[0], result[1],
+                                     result[2], result[3]);
+            rut_property_set_color (property_ctx, property, &color);
+            break;
+          }
+        case RIG_TRANSITION_PLAN_GROUP_QUATERNION:
+          {
+            CoglQuaternion quaternion;
+
+            /* The components are packed as w, x, y, z which is the
+             * same order that Cogl uses for arrays */
+            cogl_quaternion_init_from_array (&quaternion, result);
+            rut_property_set_quaternion (property_ctx,
+                                         property,
+                                         &quaternion);
+            break;
+          }
+        case RIG_TRANSITION_PLAN_N_GROUPS:
+          g_warn_if_reached ();
+          break;
+        }
+    }
+}
+
+static void
+rig_transition_evaluate_plan (RigTransition *transition)
+{
+  RigTransitionPlan *plan = transition->plan;
+  float t = transition->progress;
+  int i;
+
+  for (i = 0; i < RIG_TRANSITION_PLAN_N_GROUPS; i++)
+    {
+      RigTransitionPlanGroup *group = &plan->groups[i];
+
+      if (group->n_tracks == 0)
+        continue;
+
+      find_plan_group_keys (group, t);
+
+      if (i == RIG_TRANSITION_PLAN_GROUP_QUATERNION)
+        nlerp_plan_group (group);
+      else
+        lerp_plan_group (group);
+
+      write_plan_group_results (transition, i, group);
+    }
+
+  for (i = 0; i < plan->fallback_prop_datas->len; i++)
+    {
+      RigTransitionPropData *prop_data =
+        g_array_index (plan->fallback_prop_datas, RigTransitionPropData *, i);
+
+      rig_path_lerp_property (prop_data->path, prop_data->property, t);
+    }
 }
 
 void
@@ -247,9 +786,13 @@ rig_transition_set_progress (RigTransition *transition,
   rut_property_dirty (&transition->context->property_ctx,
                       &transition->props[RUT_TRANSITION_PROP_PROGRESS]);
 
-  rig_transition_foreach_property (transition,
-                                   update_progress_cb,
-                                   transition);
+  if (transition->plan && !rig_transition_plan_is_valid (transition->plan))
+    rig_transition_invalidate_plan (transition);
+
+  if (transition->plan == NULL)
+    transition->plan = rig_transition_build_plan (transition);
+
+  rig_transition_evaluate_plan (transition);
 }
 
 typedef struct
@@ -351,6 +894,7 @@ rig_transition_set_property_animated (RigTransition *transition,
   if (animated != prop_data->animated)
     {
       prop_data->animated = animated;
+      rig_transition_invalidate_plan (transition);
       rut_closure_list_invoke (&transition->operation_cb_list,
                                RigTransitionOperationCallback,
                                transition,
@@ -374,6 +918,8 @@ rig_transition_remove_property (RigTransition *transition,
                                RIG_TRANSITION_OPERATION_REMOVED,
                                prop_data);
 
+      rig_transition_invalidate_plan (transition);
+
       g_hash_table_remove (transition->properties, property);
     }
 }
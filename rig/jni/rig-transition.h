@@ -27,6 +27,7 @@
 extern RutType rig_transition_type;
 
 typedef struct _RigTransition RigTransition;
+typedef struct _RigTransitionPlan RigTransitionPlan;
 
 enum {
   RUT_TRANSITION_PROP_PROGRESS,
@@ -66,6 +67,12 @@ struct _RigTransition
    * RigTransitionPropData struct */
   GHashTable *properties;
 
+  /* A flattened copy of the animated paths grouped by type so that
+   * they can all be evaluated together when the progress changes.
+   * This is created lazily and is thrown away whenever the set of
+   * animated properties or any of their paths changes. */
+  RigTransitionPlan *plan;
+
   RutContext *context;
 
   RutList operation_cb_list;
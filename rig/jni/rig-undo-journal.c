@@ -44,6 +44,15 @@ undo_redo_invert (UndoRedo *undo_redo);
 static void
 undo_redo_free (UndoRedo *undo_redo);
 
+static void
+sync_slaves (RigUndoJournal *journal, UndoRedo *undo_redo)
+{
+  /* Operations logged in a subjournal are only sent once the
+   * subjournal itself is logged */
+  if (journal == journal->engine->undo_journal)
+    rig_engine_sync_slaves_edit (journal->engine, undo_redo);
+}
+
 static void
 dump_op (UndoRedo *op,
          GString *buf)
@@ -1149,8 +1158,6 @@ rig_undo_journal_insert (RigUndoJournal *journal, UndoRedo *undo_redo)
 
   g_return_val_if_fail (undo_redo != NULL, FALSE);
 
-  rig_engine_sync_slaves (journal->engine);
-
   rig_undo_journal_flush_redos (journal);
 
   /* Purely for testing purposes we now redundantly apply
@@ -1163,6 +1170,8 @@ rig_undo_journal_insert (RigUndoJournal *journal, UndoRedo *undo_redo)
   undo_redo_apply (journal, undo_redo);
   undo_redo_free (inverse);
 
+  sync_slaves (journal, undo_redo);
+
   rut_list_insert (journal->undo_ops.prev, &undo_redo->list_node);
 
   dump_journal (journal);
@@ -1189,6 +1198,7 @@ rig_undo_journal_undo (RigUndoJournal *journal)
       rut_list_insert (journal->redo_ops.prev, &op->list_node);
 
       undo_redo_apply (journal, inverse);
+      sync_slaves (journal, inverse);
       undo_redo_free (inverse);
 
       rut_shell_queue_redraw (journal->engine->shell);
@@ -1214,6 +1224,7 @@ rig_undo_journal_redo (RigUndoJournal *journal)
   g_print ("REDO\n");
 
   undo_redo_apply (journal, op);
+  sync_slaves (journal, op);
   rut_list_remove (&op->list_node);
   rut_list_insert (journal->undo_ops.prev, &op->list_node);
 
@@ -26,6 +26,7 @@
 #include <math.h>
 
 #include "rut-camera.h"
+#include "rut-object-pool.h"
 #include "rut-context.h"
 #include "rut-global.h"
 #include "rut-camera-private.h"
@@ -151,6 +152,9 @@ static RutPropertySpec _rut_camera_prop_specs[] = {
 };
 
 
+static RutObjectPool camera_pool =
+  RUT_OBJECT_POOL_INIT ("RutCamera", RutCamera);
+
 static void
 _rut_camera_free (void *object)
 {
@@ -163,7 +167,7 @@ _rut_camera_free (void *object)
 
   rut_simple_introspectable_destroy (camera);
 
-  g_slice_free (RutCamera, object);
+  rut_object_pool_free (&camera_pool, object);
 }
 
 RutRefCountableVTable _rut_camera_ref_countable = {
@@ -363,7 +367,7 @@ _rut_camera_init_type (void)
 RutCamera *
 rut_camera_new (RutContext *ctx, CoglFramebuffer *framebuffer)
 {
-  RutCamera *camera = g_slice_new0 (RutCamera);
+  RutCamera *camera = rut_object_pool_alloc0 (&camera_pool);
 
   camera->ctx = rut_refable_ref (ctx);
 
@@ -989,6 +993,7 @@ rut_camera_set_focal_distance (RutObject *obj,
     return;
 
   camera->focal_distance = focal_distance;
+  camera->focal_age++;
 
   rut_shell_queue_redraw (camera->ctx->shell);
 
@@ -1014,11 +1019,12 @@ rut_camera_set_depth_of_field (RutObject *obj,
     return;
 
   camera->depth_of_field = depth_of_field;
+  camera->focal_age++;
 
   rut_shell_queue_redraw (camera->ctx->shell);
 
   rut_property_dirty (&camera->ctx->property_ctx,
-                      &camera->properties[RUT_CAMERA_PROP_FOCAL_DISTANCE]);
+                      &camera->properties[RUT_CAMERA_PROP_DEPTH_OF_FIELD]);
 }
 
 float
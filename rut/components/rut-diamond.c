@@ -21,11 +21,18 @@
 #include <config.h>
 
 #include "rut-diamond.h"
+#include "rut-object-pool.h"
 #include "rut-global.h"
 #include "math.h"
 
 #define MESA_CONST_ATTRIB_BUG_WORKAROUND
 
+static RutObjectPool diamond_slice_pool =
+  RUT_OBJECT_POOL_INIT ("RutDiamondSlice", RutDiamondSlice);
+
+static RutObjectPool diamond_pool =
+  RUT_OBJECT_POOL_INIT ("RutDiamond", RutDiamond);
+
 static void
 _diamond_slice_free (void *object)
 {
@@ -33,7 +40,7 @@ _diamond_slice_free (void *object)
 
   cogl_object_unref (diamond_slice->primitive);
 
-  g_slice_free (RutDiamondSlice, object);
+  rut_object_pool_free (&diamond_slice_pool, object);
 }
 
 static RutRefCountableVTable _diamond_slice_ref_countable_vtable = {
@@ -159,7 +166,7 @@ diamond_slice_new (RutContext *ctx,
                    int tex_width,
                    int tex_height)
 {
-  RutDiamondSlice *diamond_slice = g_slice_new (RutDiamondSlice);
+  RutDiamondSlice *diamond_slice = rut_object_pool_alloc (&diamond_slice_pool);
   float width = size;
   float height = size;
 #define DIAMOND_SLICE_CORNER_RADIUS 20
@@ -330,7 +337,7 @@ _rut_diamond_free (void *object)
   rut_refable_unref (diamond->slice);
   rut_refable_unref (diamond->pick_mesh);
 
-  g_slice_free (RutDiamond, diamond);
+  rut_object_pool_free (&diamond_pool, diamond);
 }
 
 static RutRefCountableVTable _rut_diamond_ref_countable_vtable = {
@@ -379,7 +386,7 @@ rut_diamond_new (RutContext *ctx,
                  int tex_width,
                  int tex_height)
 {
-  RutDiamond *diamond = g_slice_new0 (RutDiamond);
+  RutDiamond *diamond = rut_object_pool_alloc0 (&diamond_pool);
   RutBuffer *buffer = rut_buffer_new (sizeof (CoglVertexP3) * 6);
   RutMesh *pick_mesh = rut_mesh_new_from_buffer_p3 (COGL_VERTICES_MODE_TRIANGLES,
                                                     6,
@@ -402,14 +409,18 @@ rut_diamond_new (RutContext *ctx,
 
   pick_vertices[0].x = 0;
   pick_vertices[0].y = 0;
+  pick_vertices[0].z = 0;
   pick_vertices[1].x = 0;
   pick_vertices[1].y = size;
+  pick_vertices[1].z = 0;
   pick_vertices[2].x = size;
   pick_vertices[2].y = size;
+  pick_vertices[2].z = 0;
   pick_vertices[3] = pick_vertices[0];
   pick_vertices[4] = pick_vertices[2];
   pick_vertices[5].x = size;
   pick_vertices[5].y = 0;
+  pick_vertices[5].z = 0;
 
   cogl_matrix_transform_points (&diamond->slice->rotate_matrix,
                                 2,
@@ -19,7 +19,10 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include "rut-light.h"
+#include "rut-object-pool.h"
 #include "rut-color.h"
 
 static RutPropertySpec
@@ -67,28 +70,51 @@ get_color_array (CoglColor *color)
   return array;
 }
 
-void
-rut_light_set_uniforms (RutLight *light,
-                        CoglPipeline *pipeline)
+static void
+update_direction (RutLight *light)
 {
   RutComponentableProps *component =
     rut_object_get_properties (light, RUT_INTERFACE_ID_COMPONENTABLE);
   RutEntity *entity = component->entity;
   float origin[3] = {0, 0, 0};
   float norm_direction[3] = {0, 0, 1};
-  int location;
 
   rut_entity_get_transformed_position (entity, origin);
   rut_entity_get_transformed_position (entity, norm_direction);
   cogl_vector3_subtract (norm_direction, norm_direction, origin);
   cogl_vector3_normalize (norm_direction);
 
+  if (!cogl_vector3_equal (norm_direction, light->direction))
+    {
+      memcpy (light->direction, norm_direction, sizeof (norm_direction));
+      light->uniforms_age++;
+    }
+}
+
+unsigned int
+rut_light_get_uniforms_age (RutLight *light)
+{
+  /* We don't get notified when the light's entity or any of its
+   * ancestors move so we have to check the direction here */
+  update_direction (light);
+
+  return light->uniforms_age;
+}
+
+void
+rut_light_set_uniforms (RutLight *light,
+                        CoglPipeline *pipeline)
+{
+  int location;
+
+  update_direction (light);
+
   location = cogl_pipeline_get_uniform_location (pipeline,
                                                  "light0_direction_norm");
   cogl_pipeline_set_uniform_float (pipeline,
                                    location,
                                    3, 1,
-                                   norm_direction);
+                                   light->direction);
 
   location = cogl_pipeline_get_uniform_location (pipeline,
                                                  "light0_ambient");
@@ -124,11 +150,14 @@ static RutComponentableVTable _rut_light_componentable_vtable = {
   .update = rut_light_update
 };
 
+static RutObjectPool light_pool =
+  RUT_OBJECT_POOL_INIT ("RutLight", RutLight);
+
 static void
 _rut_light_free (void *object)
 {
   RutLight *light = object;
-  g_slice_free (RutLight, light);
+  rut_object_pool_free (&light_pool, light);
 }
 
 static RutRefCountableVTable _rut_light_ref_countable_vtable = {
@@ -169,7 +198,7 @@ rut_light_new (RutContext *context)
 {
   RutLight *light;
 
-  light = g_slice_new0 (RutLight);
+  light = rut_object_pool_alloc0 (&light_pool);
   rut_object_init (&light->_parent, &rut_light_type);
 
   light->ref_count = 1;
@@ -194,7 +223,7 @@ rut_light_free (RutLight *light)
 
   rut_simple_introspectable_destroy (light);
 
-  g_slice_free (RutLight, light);
+  rut_object_pool_free (&light_pool, light);
 }
 
 void
@@ -204,6 +233,7 @@ rut_light_set_ambient (RutObject *obj,
   RutLight *light = RUT_LIGHT (obj);
 
   light->ambient = *ambient;
+  light->uniforms_age++;
 
   rut_property_dirty (&light->context->property_ctx,
                       &light->properties[RUT_LIGHT_PROP_AMBIENT]);
@@ -224,6 +254,7 @@ rut_light_set_diffuse (RutObject *obj,
   RutLight *light = RUT_LIGHT (obj);
 
   light->diffuse = *diffuse;
+  light->uniforms_age++;
 
   rut_property_dirty (&light->context->property_ctx,
                       &light->properties[RUT_LIGHT_PROP_DIFFUSE]);
@@ -242,6 +273,7 @@ rut_light_set_specular (RutObject *obj,
   RutLight *light = RUT_LIGHT (obj);
 
   light->specular = *specular;
+  light->uniforms_age++;
 
   rut_property_dirty (&light->context->property_ctx,
                       &light->properties[RUT_LIGHT_PROP_SPECULAR]);
@@ -43,6 +43,14 @@ struct _RutLight
   CoglColor diffuse;
   CoglColor specular;
 
+  /* The normalized direction of the light in world coordinates. This
+   * is updated lazily in rut_light_get_uniforms_age() */
+  float direction[3];
+
+  /* Incremented whenever any of the values set by
+   * rut_light_set_uniforms() change */
+  unsigned int uniforms_age;
+
   RutContext *context;
 
   RutSimpleIntrospectableProps introspectable;
@@ -79,6 +87,13 @@ rut_light_set_specular (RutObject *light,
 const CoglColor *
 rut_light_get_specular (RutLight *light);
 
+/* Returns a counter that changes whenever the uniforms set by
+ * rut_light_set_uniforms() would change, including when the entity
+ * the light is attached to is moved. This can be used to avoid
+ * redundantly updating the uniforms of a pipeline. */
+unsigned int
+rut_light_get_uniforms_age (RutLight *light);
+
 void
 rut_light_add_pipeline (RutLight *light,
                         CoglPipeline *pipeline);
@@ -21,6 +21,7 @@
 #include <config.h>
 
 #include "rut-material.h"
+#include "rut-object-pool.h"
 #include "rut-global.h"
 #include "rut-asset.h"
 #include "rut-color.h"
@@ -89,6 +90,9 @@ static RutIntrospectableVTable _rut_material_introspectable_vtable = {
   rut_simple_introspectable_foreach_property
 };
 
+static RutObjectPool material_pool =
+  RUT_OBJECT_POOL_INIT ("RutMaterial", RutMaterial);
+
 static void
 _rut_material_free (void *object)
 {
@@ -105,7 +109,7 @@ _rut_material_free (void *object)
 
   rut_simple_introspectable_destroy (material);
 
-  g_slice_free (RutMaterial, material);
+  rut_object_pool_free (&material_pool, material);
 }
 
 static RutRefCountableVTable _rut_material_ref_countable_vtable = {
@@ -141,7 +145,7 @@ RutMaterial *
 rut_material_new (RutContext *ctx,
                   RutAsset *asset)
 {
-  RutMaterial *material = g_slice_new0 (RutMaterial);
+  RutMaterial *material = rut_object_pool_alloc0 (&material_pool);
 
   rut_object_init (&material->_parent, &rut_material_type);
 
@@ -338,6 +342,7 @@ rut_material_set_alpha_mask_threshold (RutObject *obj,
     return;
 
   material->alpha_mask_threshold = threshold;
+  material->uniforms_age++;
 
   entity = material->component.entity;
   ctx = rut_entity_get_context (entity);
@@ -30,6 +30,7 @@
 
 #include "components/rut-material.h"
 #include "components/rut-model.h"
+#include "rut-object-pool.h"
 
 CoglPrimitive *
 rut_model_get_primitive (RutObject *object)
@@ -62,6 +63,9 @@ static RutPickableVTable _rut_model_pickable_vtable = {
   .get_mesh = rut_model_get_mesh
 };
 
+static RutObjectPool model_pool =
+  RUT_OBJECT_POOL_INIT ("RutModel", RutModel);
+
 static void
 _rut_model_free (void *object)
 {
@@ -73,7 +77,7 @@ _rut_model_free (void *object)
   if (model->mesh)
     rut_refable_unref (model->mesh);
 
-  g_slice_free (RutModel, model);
+  rut_object_pool_free (&model_pool, model);
 }
 
 static RutRefCountableVTable _rut_model_ref_countable_vtable = {
@@ -109,7 +113,7 @@ _rut_model_new (RutContext *ctx)
 {
   RutModel *model;
 
-  model = g_slice_new0 (RutModel);
+  model = rut_object_pool_alloc0 (&model_pool);
   rut_object_init (&model->_parent, &rut_model_type);
   model->ref_count = 1;
   model->component.type = RUT_COMPONENT_TYPE_GEOMETRY;
@@ -218,12 +222,30 @@ RutModel *
 rut_model_new_from_asset (RutContext *ctx, RutAsset *asset)
 {
   RutMesh *mesh = rut_asset_get_mesh (asset);
+  RutMeshBounds bounds;
   RutModel *model;
 
   if (!mesh)
     return NULL;
 
-  model = rut_model_new_from_mesh (ctx, mesh);
+  /* If the asset already knows the bounds, e.g. because it was loaded
+   * from the mesh cache, then we can avoid touching every vertex */
+  if (rut_asset_get_mesh_bounds (asset, &bounds))
+    {
+      model = _rut_model_new (ctx);
+      model->type = RUT_MODEL_TYPE_FILE;
+      model->mesh = rut_refable_ref (mesh);
+
+      model->min_x = bounds.min[0];
+      model->max_x = bounds.max[0];
+      model->min_y = bounds.min[1];
+      model->max_y = bounds.max[1];
+      model->min_z = bounds.min[2];
+      model->max_z = bounds.max[2];
+    }
+  else
+    model = rut_model_new_from_mesh (ctx, mesh);
+
   model->asset = rut_refable_ref (asset);
 
   return model;
@@ -21,6 +21,7 @@
 #include <config.h>
 
 #include "rut-shape.h"
+#include "rut-object-pool.h"
 #include "rut-global.h"
 #include "math.h"
 
@@ -38,6 +39,12 @@ static RutPropertySpec _rut_shape_prop_specs[] = {
   { NULL }
 };
 
+static RutObjectPool shape_model_pool =
+  RUT_OBJECT_POOL_INIT ("RutShapeModel", RutShapeModel);
+
+static RutObjectPool shape_pool =
+  RUT_OBJECT_POOL_INIT ("RutShape", RutShape);
+
 static void
 _shape_model_free (void *object)
 {
@@ -47,7 +54,7 @@ _shape_model_free (void *object)
   cogl_object_unref (shape_model->primitive);
   rut_refable_unref (shape_model->pick_mesh);
 
-  g_slice_free (RutShapeModel, object);
+  rut_object_pool_free (&shape_model_pool, object);
 }
 
 static RutRefCountableVTable _shape_model_ref_countable_vtable = {
@@ -172,7 +179,7 @@ shape_model_new (RutContext *ctx,
                  float tex_width,
                  float tex_height)
 {
-  RutShapeModel *shape_model = g_slice_new (RutShapeModel);
+  RutShapeModel *shape_model = rut_object_pool_alloc (&shape_model_pool);
   RutBuffer *buffer = rut_buffer_new (sizeof (CoglVertexP3) * 6);
   RutMesh *pick_mesh = rut_mesh_new_from_buffer_p3 (COGL_VERTICES_MODE_TRIANGLES,
                                                     6,
@@ -295,14 +302,18 @@ shape_model_new (RutContext *ctx,
 
   pick_vertices[0].x = -half_size_x;
   pick_vertices[0].y = -half_size_y;
+  pick_vertices[0].z = 0;
   pick_vertices[1].x = -half_size_x;
   pick_vertices[1].y = half_size_y;
+  pick_vertices[1].z = 0;
   pick_vertices[2].x = half_size_x;
   pick_vertices[2].y = half_size_y;
+  pick_vertices[2].z = 0;
   pick_vertices[3] = pick_vertices[0];
   pick_vertices[4] = pick_vertices[2];
   pick_vertices[5].x = half_size_x;
   pick_vertices[5].y = -half_size_y;
+  pick_vertices[5].z = 0;
 
   shape_model->pick_mesh = pick_mesh;
 
@@ -323,7 +334,7 @@ _rut_shape_free (void *object)
 
   rut_closure_list_disconnect_all (&shape->reshaped_cb_list);
 
-  g_slice_free (RutShape, shape);
+  rut_object_pool_free (&shape_pool, shape);
 }
 
 static RutRefCountableVTable _rut_shape_ref_countable_vtable = {
@@ -385,7 +396,7 @@ rut_shape_new (RutContext *ctx,
                int tex_width,
                int tex_height)
 {
-  RutShape *shape = g_slice_new0 (RutShape);
+  RutShape *shape = rut_object_pool_alloc0 (&shape_pool);
 
   rut_object_init (&shape->_parent, &rut_shape_type);
 
@@ -468,6 +479,9 @@ rut_shape_set_shaped (RutObject *obj,
                            RutShapeReShapedCallback,
                            shape);
 
+  if (shape->component.entity)
+    rut_entity_dirty_bounds (shape->component.entity);
+
   rut_property_dirty (&shape->ctx->property_ctx,
                       &shape->properties[RUT_SHAPE_PROP_SHAPED]);
 }
@@ -514,4 +528,7 @@ rut_shape_set_texture_size (RutShape *shape,
   rut_closure_list_invoke (&shape->reshaped_cb_list,
                            RutShapeReShapedCallback,
                            shape);
+
+  if (shape->component.entity)
+    rut_entity_dirty_bounds (shape->component.entity);
 }
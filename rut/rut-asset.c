@@ -30,6 +30,13 @@
 #include "rut-asset.h"
 #include "rut-util.h"
 #include "rut-mesh-ply.h"
+#include "rut-mesh-cache.h"
+#include "rut-closure.h"
+#include "rut-texture-cache-private.h"
+
+#ifndef G_SOURCE_REMOVE
+#define G_SOURCE_REMOVE FALSE
+#endif
 
 #if 0
 enum {
@@ -37,6 +44,8 @@ enum {
 };
 #endif
 
+typedef struct _RutAssetLoad RutAssetLoad;
+
 struct _RutAsset
 {
   RutObjectProps _parent;
@@ -55,9 +64,16 @@ struct _RutAsset
   char *path;
   CoglTexture *texture;
   RutMesh  *mesh;
+  CoglBool has_mesh_bounds;
+  RutMeshBounds mesh_bounds;
 
   GList *inferred_tags;
 
+  /* If the asset is being decoded asynchronously then this tracks
+   * the decoding until the results are handed back to the asset */
+  RutAssetLoad *load;
+  RutList ready_cb_list;
+
 };
 
 #if 0
@@ -73,14 +89,30 @@ static RutIntrospectableVTable _asset_introspectable_vtable = {
 };
 #endif
 
+static void
+rut_asset_load_unref (RutAssetLoad *load);
+
 static void
 _rut_asset_free (void *object)
 {
   RutAsset *asset = object;
 
+  if (asset->load)
+    {
+      /* The decoding thread may still be using the load so we just
+       * let it know that the results aren't wanted anymore */
+      asset->load->asset = NULL;
+      rut_asset_load_unref (asset->load);
+    }
+
+  rut_closure_list_disconnect_all (&asset->ready_cb_list);
+
   if (asset->texture)
     cogl_object_unref (asset->texture);
 
+  if (asset->mesh)
+    rut_refable_unref (asset->mesh);
+
   if (asset->path)
     g_free (asset->path);
 
@@ -180,16 +212,14 @@ static RutPLYAttribute ply_attributes[] =
   }
 };
 
-static RutAsset *
-rut_asset_new_full (RutContext *ctx,
-                    const char *path,
-                    RutAssetType type)
+static char *
+get_full_path (RutContext *ctx,
+               const char *path,
+               RutAssetType type)
 {
-  RutAsset *asset = g_slice_new0 (RutAsset);
-  const char *real_path;
+#ifndef __ANDROID__
   char *full_path;
 
-#ifndef __ANDROID__
   if (type == RUT_ASSET_TYPE_BUILTIN)
     {
       full_path = rut_find_data_file (path);
@@ -198,17 +228,97 @@ rut_asset_new_full (RutContext *ctx,
     }
   else
     full_path = g_build_filename (ctx->assets_location, path, NULL);
-  real_path = full_path;
+
+  return full_path;
 #else
-  real_path = path;
+  return g_strdup (path);
+#endif
+}
+
+static CoglBool
+has_uint32_indices (RutContext *ctx)
+{
+  return cogl_has_feature (ctx->cogl_context,
+                           COGL_FEATURE_ID_UNSIGNED_INT_INDICES);
+}
+
+/* Loads a PLY model either from the mesh cache or by importing it
+ * and updating the cache. This may be called from a decoding thread
+ * so whether unsigned int indices are supported needs to be checked
+ * by the caller on the main thread. */
+static RutMesh *
+load_ply_model (RutContext *ctx,
+                CoglBool uint32_indices,
+                const char *path,
+                const char *real_path,
+                RutMeshBounds *bounds,
+                GError **error)
+{
+  RutPLYAttributeStatus padding_status[G_N_ELEMENTS (ply_attributes)];
+  RutMesh *mesh;
+#ifndef __ANDROID__
+  char *cache_path =
+    rut_mesh_cache_get_filename (ctx->assets_location, path);
+  GError *cache_error = NULL;
+
+  mesh = rut_mesh_cache_load (cache_path, real_path, bounds, NULL);
+  if (mesh)
+    {
+      g_free (cache_path);
+      return mesh;
+    }
+#endif
+
+  mesh = rut_mesh_new_from_ply_file (real_path,
+                                     uint32_indices,
+                                     ply_attributes,
+                                     G_N_ELEMENTS (ply_attributes),
+                                     padding_status,
+                                     error);
+  if (!mesh)
+    {
+#ifndef __ANDROID__
+      g_free (cache_path);
+#endif
+      return NULL;
+    }
+
+  rut_mesh_get_bounds (mesh, bounds);
+
+#ifndef __ANDROID__
+  /* Save an imported copy so the model doesn't need to be
+   * parsed again next time */
+  if (!rut_mesh_cache_save (mesh,
+                            bounds,
+                            cache_path,
+                            real_path,
+                            &cache_error))
+    {
+      g_warning ("Failed to cache model %s: %s", path, cache_error->message);
+      g_error_free (cache_error);
+    }
+  g_free (cache_path);
 #endif
 
+  return mesh;
+}
+
+static RutAsset *
+rut_asset_new_full (RutContext *ctx,
+                    const char *path,
+                    RutAssetType type)
+{
+  RutAsset *asset = g_slice_new0 (RutAsset);
+  char *real_path = get_full_path (ctx, path, type);
+
   asset->ref_count = 1;
 
   asset->ctx = ctx;
 
   asset->type = type;
 
+  rut_list_init (&asset->ready_cb_list);
+
   switch (type)
     {
     case RUT_ASSET_TYPE_BUILTIN:
@@ -233,15 +343,14 @@ rut_asset_new_full (RutContext *ctx,
       }
     case RUT_ASSET_TYPE_PLY_MODEL:
       {
-        RutPLYAttributeStatus padding_status[G_N_ELEMENTS (ply_attributes)];
         GError *error = NULL;
 
-        asset->mesh = rut_mesh_new_from_ply (ctx,
-                                             real_path,
-                                             ply_attributes,
-                                             G_N_ELEMENTS (ply_attributes),
-                                             padding_status,
-                                             &error);
+        asset->mesh = load_ply_model (ctx,
+                                      has_uint32_indices (ctx),
+                                      path,
+                                      real_path,
+                                      &asset->mesh_bounds,
+                                      &error);
         if (!asset->mesh)
           {
             g_slice_free (RutAsset, asset);
@@ -251,6 +360,8 @@ rut_asset_new_full (RutContext *ctx,
             goto DONE;
           }
 
+        asset->has_mesh_bounds = TRUE;
+
         break;
       }
     }
@@ -262,9 +373,7 @@ rut_asset_new_full (RutContext *ctx,
 
 DONE:
 
-#ifndef __ANDROID__
-  g_free (full_path);
-#endif
+  g_free (real_path);
 
   return asset;
 }
@@ -347,6 +456,8 @@ rut_asset_new_from_data (RutContext *ctx,
 
   asset->type = type;
 
+  rut_list_init (&asset->ready_cb_list);
+
   switch (type)
     {
     case RUT_ASSET_TYPE_BUILTIN:
@@ -454,6 +565,399 @@ rut_asset_new_ply_model (RutContext *ctx,
   return rut_asset_new_full (ctx, path, RUT_ASSET_TYPE_PLY_MODEL);
 }
 
+/*
+ * Asynchronous loading
+ *
+ * Decoding images and parsing meshes is done on a pool of threads.
+ * The decoded GdkPixbuf or RutMesh is handed back to the main thread
+ * from an idle callback where textures are uploaded since only the
+ * main thread may use Cogl. Until then the asset has no texture or
+ * mesh and rut_asset_is_loaded() returns FALSE. Anything that asks
+ * for the texture or mesh before that waits for the decoding to
+ * finish, or does the decoding itself if no thread has started it
+ * yet.
+ */
+
+typedef enum _RutAssetLoadState
+{
+  RUT_ASSET_LOAD_STATE_QUEUED,
+  RUT_ASSET_LOAD_STATE_DECODING,
+  RUT_ASSET_LOAD_STATE_DECODED
+} RutAssetLoadState;
+
+struct _RutAssetLoad
+{
+  /* One reference is owned by the asset and one by the decoding
+   * thread (or the idle callback it queues) */
+  int ref_count;
+
+  /* This is only touched by the main thread and is cleared if the
+   * asset is destroyed before the load completes */
+  RutAsset *asset;
+
+  /* These are read-only while the load is in progress */
+  RutContext *ctx;
+  RutAssetType type;
+  char *path;
+  char *real_path;
+  /* Checked on the main thread because Cogl can't be used from the
+   * decoding threads */
+  CoglBool uint32_indices;
+
+  GMutex mutex;
+  GCond cond;
+  RutAssetLoadState state;
+
+  /* Results of decoding */
+  GdkPixbuf *pixbuf;
+  RutMesh *mesh;
+  RutMeshBounds mesh_bounds;
+  GError *error;
+};
+
+static void
+rut_asset_load_unref (RutAssetLoad *load)
+{
+  if (!g_atomic_int_dec_and_test (&load->ref_count))
+    return;
+
+  if (load->pixbuf)
+    g_object_unref (load->pixbuf);
+  if (load->mesh)
+    rut_refable_unref (load->mesh);
+  if (load->error)
+    g_error_free (load->error);
+
+  g_mutex_clear (&load->mutex);
+  g_cond_clear (&load->cond);
+
+  g_free (load->path);
+  g_free (load->real_path);
+
+  g_slice_free (RutAssetLoad, load);
+}
+
+static void
+decode_asset (RutAssetLoad *load)
+{
+  switch (load->type)
+    {
+    case RUT_ASSET_TYPE_BUILTIN:
+    case RUT_ASSET_TYPE_TEXTURE:
+    case RUT_ASSET_TYPE_NORMAL_MAP:
+    case RUT_ASSET_TYPE_ALPHA_MASK:
+      load->pixbuf = gdk_pixbuf_new_from_file (load->real_path, &load->error);
+      break;
+    case RUT_ASSET_TYPE_PLY_MODEL:
+      load->mesh = load_ply_model (load->ctx,
+                                   load->uint32_indices,
+                                   load->path,
+                                   load->real_path,
+                                   &load->mesh_bounds,
+                                   &load->error);
+      break;
+    }
+}
+
+/* Takes the results of a decoded load and makes them available from
+ * the asset. This must be called on the main thread */
+static void
+complete_load (RutAsset *asset)
+{
+  RutAssetLoad *load = asset->load;
+  CoglBool success = FALSE;
+
+  asset->load = NULL;
+  load->asset = NULL;
+
+  if (load->pixbuf)
+    {
+      CoglBitmap *bitmap =
+        bitmap_new_from_pixbuf (asset->ctx->cogl_context, load->pixbuf);
+      CoglError *cogl_error = NULL;
+      CoglTexture *texture = NULL;
+
+      if (bitmap)
+        {
+          texture = COGL_TEXTURE (
+            cogl_texture_2d_new_from_bitmap (bitmap,
+                                             COGL_PIXEL_FORMAT_ANY,
+                                             &cogl_error));
+          cogl_object_unref (bitmap);
+        }
+
+      /* The texture is shared and accounted for in the same way as
+       * textures from rut_load_texture() */
+      if (texture)
+        {
+          asset->texture =
+            _rut_texture_cache_add (asset->ctx, load->real_path, texture);
+          success = TRUE;
+        }
+      else if (cogl_error)
+        {
+          g_warning ("Failed to load asset texture %s: %s",
+                     asset->path, cogl_error->message);
+          cogl_error_free (cogl_error);
+        }
+      else
+        g_warning ("Failed to load asset texture %s", asset->path);
+    }
+  else if (load->mesh)
+    {
+      asset->mesh = load->mesh;
+      load->mesh = NULL;
+      asset->mesh_bounds = load->mesh_bounds;
+      asset->has_mesh_bounds = TRUE;
+      success = TRUE;
+    }
+  else
+    g_warning ("Failed to load asset %s: %s",
+               asset->path,
+               load->error ? load->error->message : "unknown error");
+
+  rut_asset_load_unref (load);
+
+  /* The callbacks may drop the last reference on the asset */
+  rut_refable_ref (asset);
+
+  rut_closure_list_invoke (&asset->ready_cb_list,
+                           RutAssetReadyCallback,
+                           asset,
+                           success);
+  rut_closure_list_disconnect_all (&asset->ready_cb_list);
+
+  rut_refable_unref (asset);
+}
+
+static CoglBool
+load_idle_cb (void *user_data)
+{
+  RutAssetLoad *load = user_data;
+
+  /* The asset may have been destroyed or may already have been
+   * completed by rut_asset_wait_for_load() */
+  if (load->asset && load->asset->load == load)
+    complete_load (load->asset);
+
+  rut_asset_load_unref (load);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+decode_thread_cb (void *data, void *user_data)
+{
+  RutAssetLoad *load = data;
+
+  g_mutex_lock (&load->mutex);
+
+  /* The main thread may have already taken over the load because
+   * it needed the results before we got to it. If the context is
+   * being destroyed then the load is left queued so that the asset
+   * can still decode it itself if it is used again */
+  if (load->state != RUT_ASSET_LOAD_STATE_QUEUED ||
+      g_atomic_int_get (&load->ctx->asset_decode_cancelled))
+    {
+      g_mutex_unlock (&load->mutex);
+      rut_asset_load_unref (load);
+      return;
+    }
+
+  load->state = RUT_ASSET_LOAD_STATE_DECODING;
+  g_mutex_unlock (&load->mutex);
+
+  decode_asset (load);
+
+  g_mutex_lock (&load->mutex);
+  load->state = RUT_ASSET_LOAD_STATE_DECODED;
+  g_cond_broadcast (&load->cond);
+  g_mutex_unlock (&load->mutex);
+
+  /* Our reference is passed on to the idle callback */
+  g_idle_add (load_idle_cb, load);
+}
+
+static void
+rut_asset_wait_for_load (RutAsset *asset)
+{
+  RutAssetLoad *load = asset->load;
+
+  if (G_LIKELY (load == NULL))
+    return;
+
+  g_mutex_lock (&load->mutex);
+
+  if (load->state == RUT_ASSET_LOAD_STATE_QUEUED)
+    {
+      /* No thread has started on this yet so it's quicker to just
+       * decode it here than to wait for the queue */
+      load->state = RUT_ASSET_LOAD_STATE_DECODING;
+      g_mutex_unlock (&load->mutex);
+
+      decode_asset (load);
+
+      g_mutex_lock (&load->mutex);
+      load->state = RUT_ASSET_LOAD_STATE_DECODED;
+    }
+  else
+    {
+      while (load->state != RUT_ASSET_LOAD_STATE_DECODED)
+        g_cond_wait (&load->cond, &load->mutex);
+    }
+
+  g_mutex_unlock (&load->mutex);
+
+  complete_load (asset);
+}
+
+static RutAsset *
+rut_asset_alloc (RutContext *ctx,
+                 const char *path,
+                 RutAssetType type)
+{
+  RutAsset *asset = g_slice_new0 (RutAsset);
+
+  asset->ref_count = 1;
+  asset->ctx = ctx;
+  asset->type = type;
+  asset->path = g_strdup (path);
+
+  rut_list_init (&asset->ready_cb_list);
+
+  rut_object_init (&asset->_parent, &rut_asset_type);
+
+  return asset;
+}
+
+/* If the texture for the asset is already in the context's texture
+ * cache then this creates an asset that is loaded straight away
+ * without decoding the file again. Otherwise it returns NULL */
+static RutAsset *
+rut_asset_new_from_texture_cache (RutContext *ctx,
+                                  const char *path,
+                                  RutAssetType type)
+{
+  RutAsset *asset;
+  CoglTexture *texture;
+  char *real_path;
+
+  if (type == RUT_ASSET_TYPE_PLY_MODEL)
+    return NULL;
+
+  real_path = get_full_path (ctx, path, type);
+  texture = _rut_texture_cache_lookup (ctx, real_path);
+  g_free (real_path);
+
+  if (texture == NULL)
+    return NULL;
+
+  asset = rut_asset_alloc (ctx, path, type);
+  asset->texture = texture;
+
+  return asset;
+}
+
+/* Creates an asset whose texture or mesh will come from a
+ * RutAssetLoad that hasn't been started yet */
+static RutAsset *
+rut_asset_new_with_load (RutContext *ctx,
+                         const char *path,
+                         RutAssetType type,
+                         int load_ref_count)
+{
+  RutAsset *asset = rut_asset_alloc (ctx, path, type);
+  RutAssetLoad *load;
+
+  load = g_slice_new0 (RutAssetLoad);
+  load->ref_count = load_ref_count;
+  load->asset = asset;
+  load->ctx = ctx;
+  load->type = type;
+  load->path = g_strdup (path);
+  load->real_path = get_full_path (ctx, path, type);
+  load->uint32_indices = has_uint32_indices (ctx);
+  g_mutex_init (&load->mutex);
+  g_cond_init (&load->cond);
+  load->state = RUT_ASSET_LOAD_STATE_QUEUED;
+
+  asset->load = load;
+
+  return asset;
+}
+
+RutAsset *
+rut_asset_new_async (RutContext *ctx,
+                     const char *path,
+                     RutAssetType type)
+{
+#ifdef __ANDROID__
+  /* There's no GLib mainloop to hand the results back with */
+  return rut_asset_new_full (ctx, path, type);
+#else
+  RutAsset *asset = rut_asset_new_from_texture_cache (ctx, path, type);
+
+  if (asset)
+    return asset;
+
+  if (ctx->asset_decode_pool == NULL)
+    {
+      ctx->asset_decode_pool =
+        g_thread_pool_new (decode_thread_cb,
+                           NULL, /* user data */
+#if GLIB_CHECK_VERSION (2, 36, 0)
+                           g_get_num_processors (),
+#else
+                           4,
+#endif
+                           FALSE, /* not exclusive */
+                           NULL); /* error */
+    }
+
+  /* The second reference on the load is for the decoding thread */
+  asset = rut_asset_new_with_load (ctx, path, type, 2);
+
+  g_thread_pool_push (ctx->asset_decode_pool, asset->load, NULL);
+
+  return asset;
+#endif
+}
+
+RutAsset *
+rut_asset_new_lazy (RutContext *ctx,
+                    const char *path,
+                    RutAssetType type)
+{
+  RutAsset *asset = rut_asset_new_from_texture_cache (ctx, path, type);
+
+  if (asset)
+    return asset;
+
+  /* The load is never queued so it will stay in the queued state
+   * until rut_asset_wait_for_load() decodes it */
+  return rut_asset_new_with_load (ctx, path, type, 1);
+}
+
+CoglBool
+rut_asset_is_loaded (RutAsset *asset)
+{
+  return asset->load == NULL;
+}
+
+RutClosure *
+rut_asset_add_ready_callback (RutAsset *asset,
+                              RutAssetReadyCallback callback,
+                              void *user_data,
+                              RutClosureDestroyCallback destroy_cb)
+{
+  g_return_val_if_fail (!rut_asset_is_loaded (asset), NULL);
+
+  return rut_closure_list_add (&asset->ready_cb_list,
+                               callback,
+                               user_data,
+                               destroy_cb);
+}
+
 RutAssetType
 rut_asset_get_type (RutAsset *asset)
 {
@@ -475,15 +979,33 @@ rut_asset_get_context (RutAsset *asset)
 CoglTexture *
 rut_asset_get_texture (RutAsset *asset)
 {
+  rut_asset_wait_for_load (asset);
+
   return asset->texture;
 }
 
 RutMesh *
 rut_asset_get_mesh (RutAsset *asset)
 {
+  rut_asset_wait_for_load (asset);
+
   return asset->mesh;
 }
 
+CoglBool
+rut_asset_get_mesh_bounds (RutAsset *asset,
+                           RutMeshBounds *bounds)
+{
+  rut_asset_wait_for_load (asset);
+
+  if (!asset->has_mesh_bounds)
+    return FALSE;
+
+  *bounds = asset->mesh_bounds;
+
+  return TRUE;
+}
+
 static GList *
 copy_tags (const GList *tags)
 {
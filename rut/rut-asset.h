@@ -3,6 +3,9 @@
 
 #include <gio/gio.h>
 
+#include "rut-mesh.h"
+#include "rut-closure.h"
+
 typedef enum _RutAssetType {
   RUT_ASSET_TYPE_BUILTIN,
   RUT_ASSET_TYPE_TEXTURE,
@@ -40,6 +43,40 @@ RutAsset *
 rut_asset_new_ply_model (RutContext *ctx,
                          const char *path);
 
+/* Creates an asset whose contents are decoded on a separate thread.
+ * The asset can be used straight away but it has no texture or mesh
+ * until rut_asset_is_loaded() returns TRUE. Asking for the texture or
+ * mesh before then waits for the decoding to finish. If the asset
+ * fails to load then it will have no texture or mesh. */
+RutAsset *
+rut_asset_new_async (RutContext *ctx,
+                     const char *path,
+                     RutAssetType type);
+
+/* Creates an asset that isn't decoded at all until its texture or
+ * mesh is first asked for. This is useful for assets that may only
+ * ever be shown as a thumbnail. */
+RutAsset *
+rut_asset_new_lazy (RutContext *ctx,
+                    const char *path,
+                    RutAssetType type);
+
+typedef void (*RutAssetReadyCallback) (RutAsset *asset,
+                                       CoglBool success,
+                                       void *user_data);
+
+CoglBool
+rut_asset_is_loaded (RutAsset *asset);
+
+/* Registers a callback to be invoked once an asynchronously created
+ * asset has finished loading. This may only be called if
+ * rut_asset_is_loaded() returns FALSE. */
+RutClosure *
+rut_asset_add_ready_callback (RutAsset *asset,
+                              RutAssetReadyCallback callback,
+                              void *user_data,
+                              RutClosureDestroyCallback destroy_cb);
+
 RutAsset *
 rut_asset_new_from_data (RutContext *ctx,
                          const char *path,
@@ -62,6 +99,12 @@ rut_asset_get_texture (RutAsset *asset);
 RutMesh *
 rut_asset_get_mesh (RutAsset *asset);
 
+/* Returns the bounds of the positions of the asset's mesh if they
+ * are known without having to measure the mesh */
+CoglBool
+rut_asset_get_mesh_bounds (RutAsset *asset,
+                           RutMeshBounds *bounds);
+
 void
 rut_asset_set_inferred_tags (RutAsset *asset,
                              const GList *inferred_tags);
@@ -54,6 +54,9 @@ struct _RutCamera
 
   float focal_distance;
   float depth_of_field;
+  /* Incremented whenever the focal distance or depth of field
+   * change */
+  unsigned int focal_age;
 
   CoglMatrix projection;
   unsigned int projection_age;
@@ -41,6 +41,23 @@ typedef enum
 
 typedef struct _RutSettings RutSettings;
 
+typedef struct _RutTextureCacheStats
+{
+  /* Number of texture loads, either from rut_load_texture() or for
+   * assets, that were satisfied from the cache and that had to load
+   * the file */
+  unsigned int hits;
+  unsigned int misses;
+
+  /* Number of textures the cache stopped holding on to because it
+   * went over budget */
+  unsigned int evictions;
+
+  /* Estimated GPU memory used by the textures the cache is holding on
+   * to, whether or not they are also used elsewhere */
+  size_t resident_bytes;
+} RutTextureCacheStats;
+
 /* TODO Make internals private */
 struct _RutContext
 {
@@ -57,7 +74,22 @@ struct _RutContext
 
   char *assets_location;
 
+  /* Textures loaded with rut_load_texture() keyed by filename. The
+   * cache keeps a reference on the most recently loaded textures so
+   * they survive being released for a while. texture_cache_lru is
+   * ordered from most to least recently used and is trimmed to
+   * texture_cache_budget bytes */
   GHashTable *texture_cache;
+  RutList texture_cache_lru;
+  size_t texture_cache_budget;
+  RutTextureCacheStats texture_cache_stats;
+
+  /* Threads used to decode assets created with rut_asset_new_async().
+   * This is created lazily */
+  GThreadPool *asset_decode_pool;
+  /* Set while the context is being destroyed so that queued loads
+   * are dropped without decoding them */
+  int asset_decode_cancelled;
 
   CoglIndices *nine_slice_indices;
 
@@ -111,6 +143,24 @@ rut_settings_get_font_name (RutSettings *settings);
 CoglTexture *
 rut_load_texture (RutContext *ctx, const char *filename, CoglError **error);
 
+/**
+ * rut_set_texture_cache_budget:
+ * @ctx: A #RutContext
+ * @budget: The maximum number of bytes of textures to keep alive
+ *
+ * Sets how much GPU memory worth of textures rut_load_texture() may
+ * keep alive after they have been released so that loading them
+ * again doesn't have to go back to the disk. A budget of 0 means
+ * textures are only shared while something else is using them.
+ */
+void
+rut_set_texture_cache_budget (RutContext *ctx,
+                              size_t budget);
+
+void
+rut_get_texture_cache_stats (RutContext *ctx,
+                             RutTextureCacheStats *stats);
+
 CoglTexture *
 rut_load_texture_from_data_file (RutContext *ctx,
                                  const char *filename,
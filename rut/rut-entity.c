@@ -21,7 +21,9 @@
 #include <config.h>
 
 #include "rut-entity.h"
+#include "rut-object-pool.h"
 #include "rut.h"
+#include "rut-volume-private.h"
 
 /* XXX: at some point we should perhaps separate out the Rig rendering code
  * into a "Renderer" and let that code somehow define how many slots it wants
@@ -67,6 +69,13 @@ struct _RutEntity
 
   CoglPipeline *pipeline_caches[N_PIPELINE_CACHE_SLOTS];
 
+  /* The bounds of this entity's geometry combined with the bounds of
+   * all of its descendants, in the entity's local coordinate space.
+   * This is updated lazily when bounds_dirty is set. We maintain the
+   * invariant that if an entity's bounds are dirty then the bounds
+   * of all of its ancestor entities are also dirty. */
+  RutVolume bounds;
+
   RutSimpleIntrospectableProps introspectable;
   RutProperty properties[N_PROPS];
 
@@ -74,6 +83,11 @@ struct _RutEntity
   unsigned int dirty:1;
   unsigned int cast_shadow:1;
   unsigned int receive_shadow:1;
+  unsigned int bounds_dirty:1;
+
+  /* Set if something within the subtree has unknown extents so the
+   * bounds can't be used for culling */
+  unsigned int bounds_infinite:1;
 };
 
 static RutPropertySpec _rut_entity_prop_specs[] = {
@@ -147,6 +161,9 @@ static RutPropertySpec _rut_entity_prop_specs[] = {
   { 0 }
 };
 
+static RutObjectPool entity_pool =
+  RUT_OBJECT_POOL_INIT ("RutEntity", RutEntity);
+
 static void
 _rut_entity_free (void *object)
 {
@@ -170,7 +187,7 @@ _rut_entity_free (void *object)
         cogl_object_unref (pipeline_caches[i]);
     }
 
-  g_slice_free (RutEntity, entity);
+  rut_object_pool_free (&entity_pool, entity);
 }
 
 static RutRefCountableVTable _rut_entity_ref_countable_vtable = {
@@ -179,9 +196,21 @@ static RutRefCountableVTable _rut_entity_ref_countable_vtable = {
   _rut_entity_free
 };
 
+static void
+_rut_entity_child_removed_cb (RutObject *parent, RutObject *child)
+{
+  rut_entity_dirty_bounds (parent);
+}
+
+static void
+_rut_entity_child_added_cb (RutObject *parent, RutObject *child)
+{
+  rut_entity_dirty_bounds (parent);
+}
+
 static RutGraphableVTable _rut_entity_graphable_vtable = {
-  NULL, /* child_removed */
-  NULL, /* child_added */
+  _rut_entity_child_removed_cb,
+  _rut_entity_child_added_cb,
   NULL, /* parent_changed */
 };
 
@@ -226,7 +255,7 @@ _rut_entity_init_type (void)
 RutEntity *
 rut_entity_new (RutContext *ctx)
 {
-  RutEntity *entity = g_slice_new0 (RutEntity);
+  RutEntity *entity = rut_object_pool_alloc0 (&entity_pool);
 
   rut_object_init (&entity->_parent, &rut_entity_type);
 
@@ -250,6 +279,9 @@ rut_entity_new (RutContext *ctx)
   cogl_matrix_init_identity (&entity->transform);
   entity->components = g_ptr_array_new ();
 
+  rut_volume_init (&entity->bounds);
+  entity->bounds_dirty = TRUE;
+
   rut_graphable_init (entity);
 
   return entity;
@@ -261,6 +293,23 @@ rut_entity_get_context (RutEntity *entity)
   return entity->ctx;
 }
 
+/* This should be called whenever the position, rotation or scale of
+ * the entity changes */
+static void
+_rut_entity_transform_changed (RutEntity *entity)
+{
+  RutObject *parent = entity->graphable.parent;
+
+  entity->dirty = TRUE;
+
+  rut_graphable_dirty_transform (entity);
+
+  /* The entity's own bounds are in its local coordinate space so they
+   * are unaffected, but the bounds of the parent are not */
+  if (parent && rut_object_get_type (parent) == &rut_entity_type)
+    rut_entity_dirty_bounds (parent);
+}
+
 void
 rut_entity_set_label (RutObject *obj,
                       const char *label)
@@ -296,7 +345,7 @@ rut_entity_set_x (RutObject *obj,
   RutEntity *entity = RUT_ENTITY (obj);
 
   entity->position[0] = x;
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 float
@@ -314,7 +363,7 @@ rut_entity_set_y (RutObject *obj,
   RutEntity *entity = RUT_ENTITY (obj);
 
   entity->position[1] = y;
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 float
@@ -332,7 +381,7 @@ rut_entity_set_z (RutObject *obj,
   RutEntity *entity = RUT_ENTITY (obj);
 
   entity->position[2] = z;
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 const float *
@@ -352,7 +401,7 @@ rut_entity_set_position (RutObject *obj,
   entity->position[0] = position[0];
   entity->position[1] = position[1];
   entity->position[2] = position[2];
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 void
@@ -386,7 +435,7 @@ rut_entity_set_rotation (RutObject *obj,
   RutEntity *entity = RUT_ENTITY (obj);
 
   entity->rotation = *rotation;
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 void
@@ -464,7 +513,7 @@ rut_entity_set_scale (RutObject *obj,
   RutEntity *entity = RUT_ENTITY (obj);
 
   entity->scale = scale;
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 float
@@ -519,6 +568,9 @@ rut_entity_add_component (RutEntity *entity,
   component->entity = entity;
   rut_refable_ref (object);
   g_ptr_array_add (entity->components, object);
+
+  if (component->type == RUT_COMPONENT_TYPE_GEOMETRY)
+    rut_entity_dirty_bounds (entity);
 }
 
 void
@@ -528,6 +580,10 @@ rut_entity_remove_component (RutEntity *entity,
   RutComponentableProps *component =
     rut_object_get_properties (object, RUT_INTERFACE_ID_COMPONENTABLE);
   component->entity = NULL;
+
+  if (component->type == RUT_COMPONENT_TYPE_GEOMETRY)
+    rut_entity_dirty_bounds (entity);
+
   rut_refable_unref (object);
   g_warn_if_fail (g_ptr_array_remove_fast (entity->components, object));
 }
@@ -579,7 +635,7 @@ rut_entity_translate (RutEntity *entity,
   entity->position[1] += ty;
   entity->position[2] += tz;
 
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 void
@@ -592,7 +648,7 @@ rut_entity_set_translate (RutEntity *entity,
   entity->position[1] = ty;
   entity->position[2] = tz;
 
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 void
@@ -607,7 +663,7 @@ rut_entity_rotate_x_axis (RutEntity *entity,
   cogl_quaternion_multiply (&entity->rotation, current, &x_rotation);
   cogl_quaternion_free (current);
 
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 void
@@ -622,7 +678,7 @@ rut_entity_rotate_y_axis (RutEntity *entity,
   cogl_quaternion_multiply (&entity->rotation, current, &y_rotation);
   cogl_quaternion_free (current);
 
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 void
@@ -637,7 +693,7 @@ rut_entity_rotate_z_axis (RutEntity *entity,
   cogl_quaternion_multiply (&entity->rotation, current, &z_rotation);
   cogl_quaternion_free (current);
 
-  entity->dirty = TRUE;
+  _rut_entity_transform_changed (entity);
 }
 
 CoglBool
@@ -750,3 +806,211 @@ rut_entity_set_visible (RutObject *obj, CoglBool visible)
 
   entity->visible = visible;
 }
+
+void
+rut_entity_dirty_bounds (RutEntity *entity)
+{
+  RutObject *node = entity;
+
+  do
+    {
+      if (rut_object_get_type (node) == &rut_entity_type)
+        {
+          RutEntity *node_entity = node;
+
+          /* If the bounds are already dirty then all of the ancestors
+           * must be too so we can stop here */
+          if (node_entity->bounds_dirty)
+            return;
+
+          node_entity->bounds_dirty = TRUE;
+        }
+
+      node = rut_graphable_get_parent (node);
+    }
+  while (node);
+}
+
+/* Fills in the volume of the given geometry component in the local
+ * coordinate space of the entity it is attached to. Returns FALSE if
+ * the extents of the geometry aren't known */
+static CoglBool
+get_geometry_volume (RutObject *geometry,
+                     RutVolume *volume)
+{
+  const RutType *type = rut_object_get_type (geometry);
+  RutVector3 origin;
+
+  if (type == &rut_model_type)
+    {
+      RutModel *model = geometry;
+
+      origin.x = model->min_x;
+      origin.y = model->min_y;
+      origin.z = model->min_z;
+      rut_volume_set_origin (volume, &origin);
+      rut_volume_set_width (volume, model->max_x - model->min_x);
+      rut_volume_set_height (volume, model->max_y - model->min_y);
+      rut_volume_set_depth (volume, model->max_z - model->min_z);
+    }
+  else if (type == &rut_shape_type)
+    {
+      RutShape *shape = geometry;
+      float width, height;
+
+      /* This should match the geometry created by shape_model_new() */
+      if (shape->shaped)
+        {
+          width = MIN (shape->tex_width, shape->tex_height) * 2.0f;
+          height = width;
+        }
+      else
+        {
+          width = shape->tex_width;
+          height = shape->tex_height;
+        }
+
+      origin.x = -width / 2.0f;
+      origin.y = -height / 2.0f;
+      origin.z = 0;
+      rut_volume_set_origin (volume, &origin);
+      rut_volume_set_width (volume, width);
+      rut_volume_set_height (volume, height);
+    }
+  else if (type == &rut_diamond_type)
+    {
+      RutDiamond *diamond = geometry;
+      /* The diamond is a square rotated by 45° around its center */
+      float half_diagonal = diamond->size * (float) G_SQRT2 / 2.0f;
+
+      origin.x = -half_diagonal;
+      origin.y = -half_diagonal;
+      origin.z = 0;
+      rut_volume_set_origin (volume, &origin);
+      rut_volume_set_width (volume, half_diagonal * 2.0f);
+      rut_volume_set_height (volume, half_diagonal * 2.0f);
+    }
+  else
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+_rut_entity_update_bounds (RutEntity *entity)
+{
+  RutObject *geometry;
+  GList *l;
+
+  rut_volume_init (&entity->bounds);
+  entity->bounds_infinite = FALSE;
+
+  geometry = rut_entity_get_component (entity, RUT_COMPONENT_TYPE_GEOMETRY);
+  if (geometry && !get_geometry_volume (geometry, &entity->bounds))
+    entity->bounds_infinite = TRUE;
+
+  /* NB: we update all of the children even if we already know the
+   * bounds are infinite so that none of them are left dirty */
+  for (l = entity->graphable.children.head; l; l = l->next)
+    {
+      RutEntity *child = l->data;
+      RutVolume child_bounds;
+
+      /* We don't know how to bound anything other than entities */
+      if (rut_object_get_type (child) != &rut_entity_type)
+        {
+          entity->bounds_infinite = TRUE;
+          continue;
+        }
+
+      if (child->bounds_dirty)
+        _rut_entity_update_bounds (child);
+
+      if (child->bounds_infinite)
+        entity->bounds_infinite = TRUE;
+
+      if (entity->bounds_infinite || child->bounds.is_empty)
+        continue;
+
+      _rut_volume_copy_static (&child->bounds, &child_bounds);
+      rut_volume_transform (&child_bounds, rut_entity_get_transform (child));
+      rut_volume_union (&entity->bounds, &child_bounds);
+      rut_volume_free (&child_bounds);
+    }
+
+  entity->bounds_dirty = FALSE;
+}
+
+RutCullResult
+rut_entity_cull (RutEntity *entity,
+                 const CoglMatrix *modelview,
+                 const RutPlane *planes)
+{
+  RutVolume eye_bounds;
+  RutCullResult result;
+
+  if (entity->bounds_dirty)
+    _rut_entity_update_bounds (entity);
+
+  if (entity->bounds_infinite)
+    return RUT_CULL_RESULT_PARTIAL;
+
+  /* An empty subtree has nothing to draw but the caller may still
+   * want to visit it for other reasons */
+  if (entity->bounds.is_empty)
+    return RUT_CULL_RESULT_PARTIAL;
+
+  _rut_volume_copy_static (&entity->bounds, &eye_bounds);
+  rut_volume_transform (&eye_bounds, modelview);
+  result = rut_volume_cull (&eye_bounds, planes);
+  rut_volume_free (&eye_bounds);
+
+  return result;
+}
+
+CoglBool
+rut_entity_bounds_intersect_ray (RutEntity *entity,
+                                 float ray_origin[3],
+                                 float ray_direction[3])
+{
+  float min[3] = { G_MAXFLOAT, G_MAXFLOAT, G_MAXFLOAT };
+  float max[3] = { -G_MAXFLOAT, -G_MAXFLOAT, -G_MAXFLOAT };
+  float t_near, t_far;
+  int n_vertices;
+  int i;
+
+  if (entity->bounds_dirty)
+    _rut_entity_update_bounds (entity);
+
+  if (entity->bounds_infinite)
+    return TRUE;
+
+  if (entity->bounds.is_empty)
+    return FALSE;
+
+  /* The bounds may not be axis aligned if they were copied from a
+   * transformed child so we find the box that encloses all of the
+   * vertices */
+  if (!entity->bounds.is_complete)
+    _rut_volume_complete (&entity->bounds);
+
+  n_vertices = entity->bounds.is_2d ? 4 : 8;
+
+  for (i = 0; i < n_vertices; i++)
+    {
+      const RutVector3 *vertex = &entity->bounds.vertices[i];
+
+      min[0] = MIN (min[0], vertex->x);
+      min[1] = MIN (min[1], vertex->y);
+      min[2] = MIN (min[2], vertex->z);
+      max[0] = MAX (max[0], vertex->x);
+      max[1] = MAX (max[1], vertex->y);
+      max[2] = MAX (max[2], vertex->z);
+    }
+
+  /* NB: picking only considers hits in front of the ray origin */
+  return (rut_util_intersect_box (min, max,
+                                  ray_origin, ray_direction,
+                                  &t_near, &t_far) &&
+          t_far > 0);
+}
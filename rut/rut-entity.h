@@ -28,6 +28,7 @@
 #include "rut-object.h"
 #include "rut-interfaces.h"
 #include "rut-context.h"
+#include "rut-planes.h"
 
 #define RUT_COMPONENT(X) ((RutComponent *)(X))
 typedef struct _RutComponent RutComponent;
@@ -226,4 +227,58 @@ rut_entity_get_visible (RutObject *entity);
 void
 rut_entity_set_visible (RutObject *entity, CoglBool visible);
 
+/**
+ * rut_entity_dirty_bounds:
+ * @entity: A #RutEntity
+ *
+ * Marks the cached bounds of @entity and all of its ancestors as
+ * needing to be recalculated. This is done automatically when the
+ * transform, children or geometry component of an entity change but
+ * it should also be called if a geometry component changes its
+ * extents.
+ */
+void
+rut_entity_dirty_bounds (RutEntity *entity);
+
+/**
+ * rut_entity_cull:
+ * @entity: A #RutEntity
+ * @modelview: The transform from the entity's local coordinates
+ *   into eye coordinates
+ * @planes: Four eye-space clip planes, as returned from
+ *   rut_get_eye_planes_for_screen_poly()
+ *
+ * Checks the bounds of @entity's geometry combined with the geometry
+ * of all its descendants against the given clip planes.
+ *
+ * Return value: %RUT_CULL_RESULT_OUT if nothing in the subtree can
+ *   be visible, otherwise %RUT_CULL_RESULT_IN or
+ *   %RUT_CULL_RESULT_PARTIAL. If the bounds can't be determined
+ *   %RUT_CULL_RESULT_PARTIAL is returned.
+ */
+RutCullResult
+rut_entity_cull (RutEntity *entity,
+                 const CoglMatrix *modelview,
+                 const RutPlane *planes);
+
+/**
+ * rut_entity_bounds_intersect_ray:
+ * @entity: A #RutEntity
+ * @ray_origin: The origin of the ray in the entity's local coordinates
+ * @ray_direction: The direction of the ray in the entity's local
+ *   coordinates
+ *
+ * Checks whether a ray could hit the geometry of @entity or any of
+ * its descendants by testing it against the cached bounds of the
+ * subtree. This can be used to skip whole subtrees while picking.
+ *
+ * Return value: %FALSE if the ray can't hit anything in the subtree
+ *   in front of the ray origin. If the bounds can't be determined
+ *   %TRUE is returned.
+ */
+CoglBool
+rut_entity_bounds_intersect_ray (RutEntity *entity,
+                                 float ray_origin[3],
+                                 float ray_direction[3]);
+
 #endif /* __RUT_ENTITY_H__ */
@@ -271,6 +271,7 @@ _rut_flow_layout_free (void *object)
   rut_refable_unref (flow->ctx);
 
   rut_simple_introspectable_destroy (flow);
+  rut_graphable_destroy (flow);
 
   g_slice_free (RutFlowLayout, flow);
 }
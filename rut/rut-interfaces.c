@@ -27,6 +27,7 @@
 #include "rut-util.h"
 #include "components/rut-camera.h"
 #include "rut-refcount-debug.h"
+#include "rut-profile.h"
 
 void *
 rut_refable_simple_ref (void *object)
@@ -78,6 +79,25 @@ rut_refable_unref (void *object)
   vtable->unref (obj);
 }
 
+/* Inputables whose world transform or input region has changed
+ * since rut_inputable_flush_dirty() was last called */
+static GPtrArray *_rut_inputable_dirty_list;
+
+/* Called when a dirty inputable is destroyed before the list has
+ * been flushed */
+static void
+_rut_inputable_forget_dirty (RutObject *inputable)
+{
+  RutInputableProps *props =
+    rut_object_get_properties (inputable, RUT_INTERFACE_ID_INPUTABLE);
+
+  if (!props->dirty)
+    return;
+
+  g_ptr_array_remove_fast (_rut_inputable_dirty_list, inputable);
+  props->dirty = FALSE;
+}
+
 void
 rut_graphable_init (RutObject *object)
 {
@@ -88,6 +108,8 @@ rut_graphable_init (RutObject *object)
   props->children.head = NULL;
   props->children.tail = NULL;
   props->children.length = 0;
+  props->world_transform = NULL;
+  props->graph_age = 0;
 }
 
 void
@@ -100,7 +122,39 @@ rut_graphable_destroy (RutObject *object)
    * still have a reference and it shouldn't be being destroyed */
   g_warn_if_fail (props->parent == NULL);
 
+  if (rut_object_is (object, RUT_INTERFACE_ID_INPUTABLE))
+    _rut_inputable_forget_dirty (object);
+
   rut_graphable_remove_all_children (object);
+
+  if (props->world_transform)
+    g_slice_free (RutGraphableWorldTransform, props->world_transform);
+}
+
+/* The graph age of a node and all of its ancestors is bumped when a
+ * child is added or removed so that anything derived from the shape
+ * of a graph can tell when it is out of date without being affected
+ * by changes to unrelated graphs */
+static void
+_rut_graphable_bump_graph_age (RutObject *graphable)
+{
+  while (graphable)
+    {
+      RutGraphableProps *props =
+        rut_object_get_properties (graphable, RUT_INTERFACE_ID_GRAPHABLE);
+
+      props->graph_age++;
+      graphable = props->parent;
+    }
+}
+
+unsigned int
+rut_graphable_get_graph_age (RutObject *graphable)
+{
+  RutGraphableProps *props =
+    rut_object_get_properties (graphable, RUT_INTERFACE_ID_GRAPHABLE);
+
+  return props->graph_age;
 }
 
 void
@@ -122,6 +176,8 @@ rut_graphable_add_child (RutObject *parent, RutObject *child)
     rut_graphable_remove_child (child);
 
   child_props->parent = parent;
+  rut_graphable_dirty_transform (child);
+
   if (child_vtable && child_vtable->parent_changed)
     child_vtable->parent_changed (child, old_parent, parent);
 
@@ -130,6 +186,8 @@ rut_graphable_add_child (RutObject *parent, RutObject *child)
 
   /* XXX: maybe this should be deferred to parent_vtable->child_added ? */
   g_queue_push_tail (&parent_props->children, child);
+
+  _rut_graphable_bump_graph_age (parent);
 }
 
 void
@@ -152,6 +210,8 @@ rut_graphable_remove_child (RutObject *child)
 
   g_queue_remove (&parent_props->children, child);
   child_props->parent = NULL;
+  _rut_graphable_bump_graph_age (parent);
+  rut_graphable_dirty_transform (child);
   rut_refable_unref (child);
 }
 
@@ -280,16 +340,35 @@ rut_graphable_traverse (RutObject *root,
                         RutTraverseCallback after_children_callback,
                         void *user_data)
 {
+  RutTraverseVisitFlags ret;
+
+  RUT_STATIC_TIMER (traverse_timer,
+                    NULL, /* no parent */
+                    "Graph traverse",
+                    "Time spent traversing graphs",
+                    0 /* no application private data */);
+  RUT_STATIC_COUNTER (traverse_counter,
+                      "Graph traversals",
+                      "The number of graph traversals",
+                      0 /* no application private data */);
+
+  RUT_COUNTER_INC (_rut_uprof_context, traverse_counter);
+  RUT_TIMER_START (_rut_uprof_context, traverse_timer);
+
   if (flags & RUT_TRAVERSE_BREADTH_FIRST)
-    return _rut_graphable_traverse_breadth (root,
-                                            before_children_callback,
-                                            user_data);
+    ret = _rut_graphable_traverse_breadth (root,
+                                           before_children_callback,
+                                           user_data);
   else /* DEPTH_FIRST */
-    return _rut_graphable_traverse_depth (root,
-                                          before_children_callback,
-                                          after_children_callback,
-                                          0, /* start depth */
-                                          user_data);
+    ret = _rut_graphable_traverse_depth (root,
+                                         before_children_callback,
+                                         after_children_callback,
+                                         0, /* start depth */
+                                         user_data);
+
+  RUT_TIMER_STOP (_rut_uprof_context, traverse_timer);
+
+  return ret;
 }
 
 #if 0
@@ -344,52 +423,103 @@ rut_graphable_find_camera (RutObject *object)
 }
 #endif
 
+struct _RutGraphableWorldTransform
+{
+  CoglMatrix matrix;
+  unsigned int age;
+
+  /* We maintain the invariant that if a node's world transform is
+   * valid then so are the world transforms of all of its ancestors.
+   * That way invalidating a subtree can stop as soon as it finds a
+   * node that is already invalid */
+  CoglBool valid;
+};
+
 void
-rut_graphable_apply_transform (RutObject *graphable,
-                               CoglMatrix *transform_matrix)
+rut_graphable_dirty_transform (RutObject *graphable)
 {
-  int depth = 0;
-  RutObject **transform_nodes;
-  RutObject *node = graphable;
-  int i;
+  RutGraphableProps *props =
+    rut_object_get_properties (graphable, RUT_INTERFACE_ID_GRAPHABLE);
+  GList *l;
 
-  do {
-    RutGraphableProps *graphable_priv =
-      rut_object_get_properties (node, RUT_INTERFACE_ID_GRAPHABLE);
+  if (props->world_transform == NULL || !props->world_transform->valid)
+    return;
 
-    depth++;
+  props->world_transform->valid = FALSE;
 
-    node = graphable_priv->parent;
-  } while (node);
+  if (rut_object_is (graphable, RUT_INTERFACE_ID_INPUTABLE))
+    rut_inputable_dirty (graphable);
 
-  transform_nodes = g_alloca (sizeof (RutObject *) * depth);
+  for (l = props->children.head; l; l = l->next)
+    rut_graphable_dirty_transform (l->data);
+}
 
-  node = graphable;
-  i = 0;
-  do {
-    RutGraphableProps *graphable_priv;
+static RutGraphableWorldTransform *
+_rut_graphable_update_world_transform (RutObject *graphable)
+{
+  RutGraphableProps *props =
+    rut_object_get_properties (graphable, RUT_INTERFACE_ID_GRAPHABLE);
+  RutGraphableWorldTransform *world_transform = props->world_transform;
 
-    if (rut_object_is (node, RUT_INTERFACE_ID_TRANSFORMABLE))
-      transform_nodes[i++] = node;
+  if (G_LIKELY (world_transform && world_transform->valid))
+    return world_transform;
 
-    graphable_priv =
-      rut_object_get_properties (node, RUT_INTERFACE_ID_GRAPHABLE);
-    node = graphable_priv->parent;
-  } while (node);
+  if (world_transform == NULL)
+    {
+      world_transform = g_slice_new (RutGraphableWorldTransform);
+      world_transform->age = 0;
+      props->world_transform = world_transform;
+    }
 
-  for (i--; i >= 0; i--)
+  if (props->parent)
     {
-      const CoglMatrix *matrix = rut_transformable_get_matrix (transform_nodes[i]);
-      cogl_matrix_multiply (transform_matrix, transform_matrix, matrix);
+      RutGraphableWorldTransform *parent_transform =
+        _rut_graphable_update_world_transform (props->parent);
+
+      if (rut_object_is (graphable, RUT_INTERFACE_ID_TRANSFORMABLE))
+        cogl_matrix_multiply (&world_transform->matrix,
+                              &parent_transform->matrix,
+                              rut_transformable_get_matrix (graphable));
+      else
+        world_transform->matrix = parent_transform->matrix;
     }
+  else if (rut_object_is (graphable, RUT_INTERFACE_ID_TRANSFORMABLE))
+    world_transform->matrix = *rut_transformable_get_matrix (graphable);
+  else
+    cogl_matrix_init_identity (&world_transform->matrix);
+
+  world_transform->age++;
+  world_transform->valid = TRUE;
+
+  return world_transform;
+}
+
+const CoglMatrix *
+rut_graphable_get_world_transform (RutObject *graphable)
+{
+  return &_rut_graphable_update_world_transform (graphable)->matrix;
+}
+
+unsigned int
+rut_graphable_get_world_transform_age (RutObject *graphable)
+{
+  return _rut_graphable_update_world_transform (graphable)->age;
+}
+
+void
+rut_graphable_apply_transform (RutObject *graphable,
+                               CoglMatrix *transform_matrix)
+{
+  cogl_matrix_multiply (transform_matrix,
+                        transform_matrix,
+                        rut_graphable_get_world_transform (graphable));
 }
 
 void
 rut_graphable_get_transform (RutObject *graphable,
                              CoglMatrix *transform)
 {
-  cogl_matrix_init_identity (transform);
-  rut_graphable_apply_transform (graphable, transform);
+  *transform = *rut_graphable_get_world_transform (graphable);
 }
 
 void
@@ -697,3 +827,41 @@ rut_inputable_get_input_region (RutObject *object)
 
   return props->input_region;
 }
+
+void
+rut_inputable_dirty (RutObject *inputable)
+{
+  RutInputableProps *props =
+    rut_object_get_properties (inputable, RUT_INTERFACE_ID_INPUTABLE);
+
+  if (props->dirty)
+    return;
+
+  if (_rut_inputable_dirty_list == NULL)
+    _rut_inputable_dirty_list = g_ptr_array_new ();
+
+  g_ptr_array_add (_rut_inputable_dirty_list, inputable);
+  props->dirty = TRUE;
+}
+
+void
+rut_inputable_flush_dirty (RutInputableDirtyCallback callback,
+                           void *user_data)
+{
+  int i;
+
+  if (_rut_inputable_dirty_list == NULL)
+    return;
+
+  for (i = 0; i < _rut_inputable_dirty_list->len; i++)
+    {
+      RutObject *inputable = g_ptr_array_index (_rut_inputable_dirty_list, i);
+      RutInputableProps *props =
+        rut_object_get_properties (inputable, RUT_INTERFACE_ID_INPUTABLE);
+
+      props->dirty = FALSE;
+      callback (inputable, user_data);
+    }
+
+  g_ptr_array_set_size (_rut_inputable_dirty_list, 0);
+}
@@ -51,10 +51,20 @@ typedef struct _RutGraphableVTable
                           RutObject *new_parent);
 } RutGraphableVTable;
 
+typedef struct _RutGraphableWorldTransform RutGraphableWorldTransform;
+
 typedef struct _RutGraphableProps
 {
   RutObject *parent;
   GQueue children;
+
+  /* Cache of the combined transform of this node and all of its
+   * ancestors. This is allocated the first time it's needed */
+  RutGraphableWorldTransform *world_transform;
+
+  /* Bumped whenever a child is added or removed anywhere below this
+   * node */
+  unsigned int graph_age;
 } RutGraphableProps;
 
 #if 0
@@ -131,10 +141,36 @@ rut_graphable_remove_all_children (RutObject *parent);
 RutObject *
 rut_graphable_get_parent (RutObject *child);
 
+/* Returns a number that changes whenever a child is added to or
+ * removed from @graphable or any of its descendants */
+unsigned int
+rut_graphable_get_graph_age (RutObject *graphable);
+
 void
 rut_graphable_apply_transform (RutObject *graphable,
                                CoglMatrix *transform);
 
+/* Returns the combined transform of @graphable and all of its
+ * ancestors. This is cached so repeated calls are cheap as long as
+ * nothing above @graphable has moved. The returned matrix is only
+ * valid until the next change to the graph. */
+const CoglMatrix *
+rut_graphable_get_world_transform (RutObject *graphable);
+
+/* Returns a number that changes whenever the world transform of
+ * @graphable is recomputed. This can be used to know when anything
+ * derived from the world transform needs updating */
+unsigned int
+rut_graphable_get_world_transform_age (RutObject *graphable);
+
+/* Transformable objects must call this whenever their matrix changes
+ * so that the cached world transforms of the object and its
+ * descendants are recomputed. Any inputables whose cached world
+ * transform is invalidated are marked as dirty with
+ * rut_inputable_dirty() */
+void
+rut_graphable_dirty_transform (RutObject *graphable);
+
 void
 rut_graphable_get_transform (RutObject *graphable,
                              CoglMatrix *transform);
@@ -334,9 +370,29 @@ rut_pickable_get_mesh (RutObject *object);
 typedef struct _RutInputableProps
 {
   RutInputRegion *input_region;
+
+  /* Set while the inputable is in the list of dirty inputables */
+  CoglBool dirty;
 } RutInputableProps;
 
 RutInputRegion *
 rut_inputable_get_input_region (RutObject *object);
 
+/* Records that the world transform or input region of @inputable
+ * has changed so that anything that caches its position on screen,
+ * such as the shell's input indices, can update just that
+ * inputable. Input regions call this on themselves when their shape
+ * changes */
+void
+rut_inputable_dirty (RutObject *inputable);
+
+typedef void (*RutInputableDirtyCallback) (RutObject *inputable,
+                                           void *user_data);
+
+/* Calls @callback for each inputable that has been dirtied since the
+ * last call and empties the list */
+void
+rut_inputable_flush_dirty (RutInputableDirtyCallback callback,
+                           void *user_data);
+
 #endif /* _RUT_INTERFACES_H_ */
@@ -32,9 +32,14 @@
  *      sub-stack or twice as big as the requested allocation size if
  *      that's bigger and the stack-pointer is set to the start of the
  *      new sub-stack.
- * - Allocations can't be freed in a random-order, you can only
- *   rewind the entire stack back to the start. There is no
- *   the concept of stack frames to allow partial rewinds.
+ * - Allocations can't be freed in a random-order. You can either
+ *   rewind the entire stack back to the start or push a frame
+ *   before making allocations and later pop it to free everything
+ *   allocated since. Frames can be nested so different users can
+ *   share the same stack as long as they each pop what they push.
+ * - Sub-stacks that aren't in use can be freed with
+ *   rut_memory_stack_trim() so that a spike in usage doesn't keep
+ *   a huge amount of memory around forever.
  *
  * For example; we plan to use this in our tesselator which has to
  * allocate lots of small vertex, edge and face structures because
@@ -64,12 +69,25 @@ struct _RutMemorySubStack
   uint8_t *data;
 };
 
+/* A frame is allocated on the stack itself and remembers where the
+ * stack pointer was before it was pushed */
+typedef struct _RutMemoryStackFrame RutMemoryStackFrame;
+
+struct _RutMemoryStackFrame
+{
+  RutMemoryStackFrame *parent;
+  RutMemorySubStack *sub_stack;
+  size_t sub_stack_offset;
+};
+
 struct _RutMemoryStack
 {
   RutList sub_stacks;
 
   RutMemorySubStack *sub_stack;
   size_t sub_stack_offset;
+
+  RutMemoryStackFrame *frame;
 };
 
 static RutMemorySubStack *
@@ -171,6 +189,46 @@ rut_memory_stack_rewind (RutMemoryStack *stack)
                                        stack->sub_stack,
                                        list_node);
   stack->sub_stack_offset = 0;
+  stack->frame = NULL;
+}
+
+void
+rut_memory_stack_push_frame (RutMemoryStack *stack)
+{
+  RutMemorySubStack *sub_stack = stack->sub_stack;
+  size_t sub_stack_offset = stack->sub_stack_offset;
+  RutMemoryStackFrame *frame;
+  uintptr_t aligned;
+
+  /* Allocations on the stack aren't aligned so we over-allocate to
+   * be able to align the frame */
+  aligned = (uintptr_t) rut_memory_stack_alloc (stack,
+                                                sizeof (RutMemoryStackFrame) +
+                                                sizeof (void *) - 1);
+  aligned = ((aligned + sizeof (void *) - 1) &
+             ~(uintptr_t) (sizeof (void *) - 1));
+  frame = (RutMemoryStackFrame *) aligned;
+
+  frame->parent = stack->frame;
+  frame->sub_stack = sub_stack;
+  frame->sub_stack_offset = sub_stack_offset;
+
+  stack->frame = frame;
+}
+
+void
+rut_memory_stack_pop_frame (RutMemoryStack *stack)
+{
+  RutMemoryStackFrame *frame = stack->frame;
+
+  g_return_if_fail (frame != NULL);
+
+  /* Any sub-stacks that were moved on to since the frame was pushed
+   * are after the frame's sub-stack in the list so they will be
+   * reused by later allocations */
+  stack->sub_stack = frame->sub_stack;
+  stack->sub_stack_offset = frame->sub_stack_offset;
+  stack->frame = frame->parent;
 }
 
 static void
@@ -180,6 +238,29 @@ rut_memory_sub_stack_free (RutMemorySubStack *sub_stack)
   g_slice_free (RutMemorySubStack, sub_stack);
 }
 
+void
+rut_memory_stack_trim (RutMemoryStack *stack, size_t max_bytes)
+{
+  RutMemorySubStack *sub_stack, *tmp;
+  size_t total = 0;
+
+  rut_list_for_each (sub_stack, &stack->sub_stacks, list_node)
+    total += sub_stack->bytes;
+
+  /* Only the sub-stacks after the current one are unused. The last
+   * ones are the biggest so they are freed first */
+  rut_list_for_each_reverse_safe (sub_stack, tmp,
+                                  &stack->sub_stacks, list_node)
+    {
+      if (total <= max_bytes || sub_stack == stack->sub_stack)
+        break;
+
+      total -= sub_stack->bytes;
+      rut_list_remove (&sub_stack->list_node);
+      rut_memory_sub_stack_free (sub_stack);
+    }
+}
+
 void
 rut_memory_stack_free (RutMemoryStack *stack)
 {
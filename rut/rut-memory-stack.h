@@ -39,6 +39,20 @@ rut_memory_stack_alloc (RutMemoryStack *stack, size_t bytes);
 void
 rut_memory_stack_rewind (RutMemoryStack *stack);
 
+/* Remembers the current position of the stack so that everything
+ * allocated after this can be freed with rut_memory_stack_pop_frame().
+ * Frames can be nested. */
+void
+rut_memory_stack_push_frame (RutMemoryStack *stack);
+
+void
+rut_memory_stack_pop_frame (RutMemoryStack *stack);
+
+/* Frees sub-stacks that aren't currently in use until the stack is
+ * no bigger than @max_bytes or only in use sub-stacks remain */
+void
+rut_memory_stack_trim (RutMemoryStack *stack, size_t max_bytes);
+
 void
 rut_memory_stack_free (RutMemoryStack *stack);
 
@@ -0,0 +1,375 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "rut-mesh-bvh.h"
+#include "rut-util.h"
+
+/* Nodes with this many triangles or less aren't split any further */
+#define MAX_LEAF_TRIANGLES 4
+
+/* The tree is always split at the median triangle so the depth is
+ * at most log2 of the number of triangles. Each level of the
+ * traversal leaves at most one sibling on the stack so this is
+ * plenty for any number of triangles that fits in an int. */
+#define MAX_STACK_SIZE 64
+
+typedef struct _BVHTriangle
+{
+  float v0[3];
+  float v1[3];
+  float v2[3];
+
+  /* The index of the triangle in the order it is visited by
+   * rut_mesh_foreach_triangle() */
+  int index;
+} BVHTriangle;
+
+typedef struct _BVHNode
+{
+  float min[3];
+  float max[3];
+
+  /* If n_triangles is zero then this is an interior node and first
+   * is the index of the left child. The right child always
+   * immediately follows the left child. Otherwise first is the index
+   * of the first triangle of the leaf. */
+  int first;
+  int n_triangles;
+} BVHNode;
+
+typedef struct _BVHStackEntry
+{
+  int node;
+  float t_near;
+} BVHStackEntry;
+
+struct _RutMeshBVH
+{
+  BVHTriangle *triangles;
+  int n_triangles;
+
+  BVHNode *nodes;
+  int n_nodes;
+};
+
+static CoglBool
+collect_triangle_cb (void **attributes_v0,
+                     void **attributes_v1,
+                     void **attributes_v2,
+                     int index_v0,
+                     int index_v1,
+                     int index_v2,
+                     void *user_data)
+{
+  GArray *triangles = user_data;
+  BVHTriangle *triangle;
+
+  g_array_set_size (triangles, triangles->len + 1);
+  triangle = &g_array_index (triangles, BVHTriangle, triangles->len - 1);
+
+  memcpy (triangle->v0, attributes_v0[0], sizeof (float) * 3);
+  memcpy (triangle->v1, attributes_v1[0], sizeof (float) * 3);
+  memcpy (triangle->v2, attributes_v2[0], sizeof (float) * 3);
+  triangle->index = triangles->len - 1;
+
+  return TRUE;
+}
+
+static int
+compare_centroids_cb (const void *a,
+                      const void *b,
+                      void *user_data)
+{
+  const BVHTriangle *triangle_a = a;
+  const BVHTriangle *triangle_b = b;
+  int axis = GPOINTER_TO_INT (user_data);
+  /* There's no need to divide by 3 just to compare the centroids */
+  float centroid_a =
+    triangle_a->v0[axis] + triangle_a->v1[axis] + triangle_a->v2[axis];
+  float centroid_b =
+    triangle_b->v0[axis] + triangle_b->v1[axis] + triangle_b->v2[axis];
+
+  if (centroid_a < centroid_b)
+    return -1;
+  else if (centroid_a > centroid_b)
+    return 1;
+  else
+    return triangle_a->index - triangle_b->index;
+}
+
+static void
+extend_bounds (float min[3], float max[3], const float point[3])
+{
+  int i;
+
+  for (i = 0; i < 3; i++)
+    {
+      if (point[i] < min[i])
+        min[i] = point[i];
+      if (point[i] > max[i])
+        max[i] = point[i];
+    }
+}
+
+static void
+build_node (RutMeshBVH *bvh,
+            GArray *nodes,
+            int node_index,
+            int first,
+            int n_triangles)
+{
+  BVHNode *node = &g_array_index (nodes, BVHNode, node_index);
+  float centroid_min[3] = { G_MAXFLOAT, G_MAXFLOAT, G_MAXFLOAT };
+  float centroid_max[3] = { -G_MAXFLOAT, -G_MAXFLOAT, -G_MAXFLOAT };
+  int left_index;
+  int n_left;
+  int axis;
+  int i;
+
+  for (i = 0; i < 3; i++)
+    {
+      node->min[i] = G_MAXFLOAT;
+      node->max[i] = -G_MAXFLOAT;
+    }
+
+  for (i = first; i < first + n_triangles; i++)
+    {
+      BVHTriangle *triangle = &bvh->triangles[i];
+      float centroid[3];
+      int j;
+
+      extend_bounds (node->min, node->max, triangle->v0);
+      extend_bounds (node->min, node->max, triangle->v1);
+      extend_bounds (node->min, node->max, triangle->v2);
+
+      for (j = 0; j < 3; j++)
+        centroid[j] = triangle->v0[j] + triangle->v1[j] + triangle->v2[j];
+      extend_bounds (centroid_min, centroid_max, centroid);
+    }
+
+  if (n_triangles <= MAX_LEAF_TRIANGLES)
+    {
+      node->first = first;
+      node->n_triangles = n_triangles;
+      return;
+    }
+
+  /* Split along the axis where the centroids are most spread out */
+  axis = 0;
+  for (i = 1; i < 3; i++)
+    {
+      if (centroid_max[i] - centroid_min[i] >
+          centroid_max[axis] - centroid_min[axis])
+        axis = i;
+    }
+
+  g_qsort_with_data (bvh->triangles + first,
+                     n_triangles,
+                     sizeof (BVHTriangle),
+                     compare_centroids_cb,
+                     GINT_TO_POINTER (axis));
+
+  left_index = nodes->len;
+  g_array_set_size (nodes, nodes->len + 2);
+
+  /* NB: the array may have been reallocated */
+  node = &g_array_index (nodes, BVHNode, node_index);
+  node->first = left_index;
+  node->n_triangles = 0;
+
+  n_left = n_triangles / 2;
+  build_node (bvh, nodes, left_index, first, n_left);
+  build_node (bvh, nodes, left_index + 1,
+              first + n_left, n_triangles - n_left);
+}
+
+RutMeshBVH *
+rut_mesh_bvh_new (RutMesh *mesh)
+{
+  RutMeshBVH *bvh = g_slice_new0 (RutMeshBVH);
+  GArray *triangles = g_array_new (FALSE, FALSE, sizeof (BVHTriangle));
+  GArray *nodes;
+
+  rut_mesh_foreach_triangle (mesh,
+                             collect_triangle_cb,
+                             triangles,
+                             "cogl_position_in",
+                             NULL);
+
+  bvh->n_triangles = triangles->len;
+  bvh->triangles = (BVHTriangle *) g_array_free (triangles, FALSE);
+
+  if (bvh->n_triangles == 0)
+    return bvh;
+
+  /* Leaves will usually have between 2 and MAX_LEAF_TRIANGLES
+   * triangles so this is a reasonable guess for the number of nodes */
+  nodes = g_array_sized_new (FALSE, FALSE, sizeof (BVHNode),
+                             MAX (1, bvh->n_triangles / 2));
+  g_array_set_size (nodes, 1);
+
+  build_node (bvh, nodes, 0, 0, bvh->n_triangles);
+
+  bvh->n_nodes = nodes->len;
+  bvh->nodes = (BVHNode *) g_array_free (nodes, FALSE);
+
+  return bvh;
+}
+
+void
+rut_mesh_bvh_free (RutMeshBVH *bvh)
+{
+  g_free (bvh->triangles);
+  g_free (bvh->nodes);
+  g_slice_free (RutMeshBVH, bvh);
+}
+
+static void
+push_node (BVHStackEntry *stack,
+           int *stack_size,
+           int node,
+           float t_near)
+{
+  g_assert (*stack_size < MAX_STACK_SIZE);
+
+  stack[*stack_size].node = node;
+  stack[*stack_size].t_near = t_near;
+  (*stack_size)++;
+}
+
+bool
+rut_mesh_bvh_intersect_ray (RutMeshBVH *bvh,
+                            float ray_origin[3],
+                            float ray_direction[3],
+                            int *index,
+                            float *t_out)
+{
+  BVHStackEntry stack[MAX_STACK_SIZE];
+  int stack_size = 0;
+  float min_t = G_MAXFLOAT;
+  int hit_index = -1;
+  float t_near, t_far;
+
+  if (bvh->n_nodes == 0)
+    return FALSE;
+
+  /* NB: we only want results in front of the ray origin */
+  if (!rut_util_intersect_box (bvh->nodes[0].min, bvh->nodes[0].max,
+                               ray_origin, ray_direction,
+                               &t_near, &t_far) ||
+      t_far <= 0)
+    return FALSE;
+
+  push_node (stack, &stack_size, 0, t_near);
+
+  while (stack_size > 0)
+    {
+      BVHStackEntry *entry = &stack[--stack_size];
+      BVHNode *node = &bvh->nodes[entry->node];
+
+      /* Skip nodes that are entirely behind a closer hit that was
+       * found since the node was pushed */
+      if (entry->t_near > min_t)
+        continue;
+
+      if (node->n_triangles)
+        {
+          int i;
+
+          for (i = node->first; i < node->first + node->n_triangles; i++)
+            {
+              BVHTriangle *triangle = &bvh->triangles[i];
+              float u, v, t;
+
+              if (!rut_util_intersect_triangle (triangle->v0,
+                                                triangle->v1,
+                                                triangle->v2,
+                                                ray_origin,
+                                                ray_direction,
+                                                &u, &v, &t) ||
+                  t <= 0)
+                continue;
+
+              /* The triangles aren't visited in their original order
+               * so to match a linear search we pick the lowest index
+               * if two triangles are hit at exactly the same
+               * distance */
+              if (t < min_t || (t == min_t && triangle->index < hit_index))
+                {
+                  min_t = t;
+                  hit_index = triangle->index;
+                }
+            }
+        }
+      else
+        {
+          BVHNode *left = &bvh->nodes[node->first];
+          BVHNode *right = &bvh->nodes[node->first + 1];
+          float left_near, right_near;
+          bool hit_left, hit_right;
+
+          hit_left = (rut_util_intersect_box (left->min, left->max,
+                                              ray_origin, ray_direction,
+                                              &left_near, &t_far) &&
+                      t_far > 0 && left_near <= min_t);
+          hit_right = (rut_util_intersect_box (right->min, right->max,
+                                               ray_origin, ray_direction,
+                                               &right_near, &t_far) &&
+                       t_far > 0 && right_near <= min_t);
+
+          /* Push the furthest child first so that the nearest one is
+           * visited first and hopefully lets us skip the other */
+          if (hit_left && hit_right)
+            {
+              if (left_near < right_near)
+                {
+                  push_node (stack, &stack_size, node->first + 1, right_near);
+                  push_node (stack, &stack_size, node->first, left_near);
+                }
+              else
+                {
+                  push_node (stack, &stack_size, node->first, left_near);
+                  push_node (stack, &stack_size, node->first + 1, right_near);
+                }
+            }
+          else if (hit_left)
+            push_node (stack, &stack_size, node->first, left_near);
+          else if (hit_right)
+            push_node (stack, &stack_size, node->first + 1, right_near);
+        }
+    }
+
+  if (hit_index == -1)
+    return FALSE;
+
+  if (t_out)
+    *t_out = min_t;
+
+  if (index)
+    *index = hit_index;
+
+  return TRUE;
+}
@@ -0,0 +1,55 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RUT_MESH_BVH_H_
+#define _RUT_MESH_BVH_H_
+
+#include <stdbool.h>
+
+#include "rut-mesh.h"
+
+/* A bounding volume hierarchy over the triangles of a RutMesh which
+ * is used to accelerate ray picking. The triangle positions are
+ * copied out of the mesh when the hierarchy is built so it needs to
+ * be rebuilt if the vertex data of the mesh is modified.
+ *
+ * Normally this doesn't need to be used directly because
+ * rut_util_intersect_mesh() lazily creates a hierarchy and caches it
+ * on the mesh. */
+
+RutMeshBVH *
+rut_mesh_bvh_new (RutMesh *mesh);
+
+void
+rut_mesh_bvh_free (RutMeshBVH *bvh);
+
+/* The results are the same as testing every triangle of the mesh in
+ * order with rut_util_intersect_triangle() and keeping the first
+ * triangle with the smallest positive distance. The triangle index
+ * counts triangles in the order they are visited by
+ * rut_mesh_foreach_triangle() */
+bool
+rut_mesh_bvh_intersect_ray (RutMeshBVH *bvh,
+                            float ray_origin[3],
+                            float ray_direction[3],
+                            int *index,
+                            float *t_out);
+
+#endif /* _RUT_MESH_BVH_H_ */
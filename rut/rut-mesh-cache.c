@@ -0,0 +1,570 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "rut-mesh-cache.h"
+#include "rut-interfaces.h"
+
+/* This should be bumped whenever the layout of the file changes or
+ * when the way meshes are imported changes such that old caches
+ * would give different results */
+#define RUT_MESH_CACHE_VERSION 1
+
+#define RUT_MESH_CACHE_MAGIC "RUTMESH"
+#define RUT_MESH_CACHE_BYTE_ORDER 0x01020304
+
+#define RUT_MESH_CACHE_MAX_NAME 64
+#define RUT_MESH_CACHE_MAX_ATTRIBUTES 16
+
+/* The vertex and index data are aligned to this within the file so
+ * that they can be used directly from the mapping */
+#define RUT_MESH_CACHE_DATA_ALIGNMENT 16
+
+#define SOURCE_HASH_LENGTH 32 /* SHA-256 */
+
+typedef struct _CacheHeader
+{
+  char magic[8];
+  uint32_t version;
+  /* RUT_MESH_CACHE_BYTE_ORDER in the byte order of the machine that
+   * wrote the file. The cache is only used on machines with the same
+   * byte order */
+  uint32_t byte_order;
+
+  int64_t source_mtime;
+  uint64_t source_size;
+  uint8_t source_hash[SOURCE_HASH_LENGTH];
+
+  uint32_t mode;
+  uint32_t n_vertices;
+  uint32_t n_attributes;
+  uint32_t indices_type;
+  uint32_t n_indices;
+  uint32_t padding;
+
+  float bounds_min[3];
+  float bounds_max[3];
+
+  uint64_t vertex_offset;
+  uint64_t vertex_size;
+  uint64_t indices_offset;
+  uint64_t indices_size;
+
+  /* Followed by n_attributes CacheAttributes */
+} CacheHeader;
+
+typedef struct _CacheAttribute
+{
+  char name[RUT_MESH_CACHE_MAX_NAME];
+  uint32_t stride;
+  uint32_t offset;
+  uint32_t n_components;
+  uint32_t type;
+  uint32_t normalized;
+  uint32_t padding;
+} CacheAttribute;
+
+GQuark
+rut_mesh_cache_error_quark (void)
+{
+  return g_quark_from_static_string ("rut-mesh-cache-error-quark");
+}
+
+char *
+rut_mesh_cache_get_filename (const char *assets_location,
+                             const char *path)
+{
+  char *basename = g_strconcat (path, ".mesh", NULL);
+  char *filename = g_build_filename (assets_location,
+                                     ".rig-cache",
+                                     "meshes",
+                                     basename,
+                                     NULL);
+  g_free (basename);
+
+  return filename;
+}
+
+static size_t
+align_offset (size_t offset)
+{
+  return ((offset + RUT_MESH_CACHE_DATA_ALIGNMENT - 1) &
+          ~(size_t) (RUT_MESH_CACHE_DATA_ALIGNMENT - 1));
+}
+
+static int
+get_sizeof_indices_type (CoglIndicesType type)
+{
+  switch (type)
+    {
+    case COGL_INDICES_TYPE_UNSIGNED_BYTE:
+      return 1;
+    case COGL_INDICES_TYPE_UNSIGNED_SHORT:
+      return 2;
+    case COGL_INDICES_TYPE_UNSIGNED_INT:
+      return 4;
+    }
+
+  return 0;
+}
+
+static int
+get_sizeof_attribute_type (RutAttributeType type)
+{
+  switch (type)
+    {
+    case RUT_ATTRIBUTE_TYPE_BYTE:
+    case RUT_ATTRIBUTE_TYPE_UNSIGNED_BYTE:
+      return 1;
+    case RUT_ATTRIBUTE_TYPE_SHORT:
+    case RUT_ATTRIBUTE_TYPE_UNSIGNED_SHORT:
+      return 2;
+    case RUT_ATTRIBUTE_TYPE_FLOAT:
+      return 4;
+    }
+
+  return 0;
+}
+
+static void
+compute_hash (const void *data,
+              size_t len,
+              uint8_t *digest)
+{
+  GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  gsize digest_len = SOURCE_HASH_LENGTH;
+
+  g_checksum_update (checksum, data, len);
+  g_checksum_get_digest (checksum, digest, &digest_len);
+  g_checksum_free (checksum);
+}
+
+static CoglBool
+hash_source (const char *source_filename,
+             uint8_t *digest,
+             GError **error)
+{
+  GMappedFile *mapped_file = g_mapped_file_new (source_filename, FALSE, error);
+
+  if (!mapped_file)
+    return FALSE;
+
+  compute_hash (g_mapped_file_get_contents (mapped_file),
+                g_mapped_file_get_length (mapped_file),
+                digest);
+
+  g_mapped_file_unref (mapped_file);
+
+  return TRUE;
+}
+
+static CoglBool
+stat_source (const char *source_filename,
+             GStatBuf *buf,
+             GError **error)
+{
+  if (g_stat (source_filename, buf) == -1)
+    {
+      g_set_error (error, RUT_MESH_CACHE_ERROR,
+                   RUT_MESH_CACHE_ERROR_IO,
+                   "Failed to stat %s", source_filename);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Rewrites the recorded modification time of the source. This is
+ * used when the source has been touched but its contents are the
+ * same so that it doesn't need to be hashed again next time */
+static void
+update_source_mtime (const char *cache_filename,
+                     int64_t mtime)
+{
+  FILE *file = fopen (cache_filename, "r+b");
+
+  if (file == NULL)
+    return;
+
+  if (fseek (file, G_STRUCT_OFFSET (CacheHeader, source_mtime), SEEK_SET) == 0)
+    fwrite (&mtime, sizeof (mtime), 1, file);
+
+  fclose (file);
+}
+
+static CoglBool
+validate_source (const CacheHeader *header,
+                 const char *cache_filename,
+                 const char *source_filename,
+                 GError **error)
+{
+  uint8_t digest[SOURCE_HASH_LENGTH];
+  GStatBuf buf;
+
+  if (!stat_source (source_filename, &buf, error))
+    return FALSE;
+
+  if (header->source_size != (uint64_t) buf.st_size)
+    goto STALE;
+
+  /* If the source hasn't been touched then we can avoid reading it
+   * at all */
+  if (header->source_mtime == (int64_t) buf.st_mtime)
+    return TRUE;
+
+  if (!hash_source (source_filename, digest, error))
+    return FALSE;
+
+  if (memcmp (digest, header->source_hash, SOURCE_HASH_LENGTH) != 0)
+    goto STALE;
+
+  update_source_mtime (cache_filename, buf.st_mtime);
+
+  return TRUE;
+
+STALE:
+  g_set_error (error, RUT_MESH_CACHE_ERROR,
+               RUT_MESH_CACHE_ERROR_STALE,
+               "The mesh cache %s is out of date", cache_filename);
+  return FALSE;
+}
+
+/* Checks that every index refers to one of the vertices. The mesh
+ * is used to index the mapped vertex data directly when picking and
+ * building the BVH so a bad index would read past the end of it */
+static CoglBool
+validate_indices (const CacheHeader *header)
+{
+  const uint8_t *indices = (const uint8_t *) header + header->indices_offset;
+  uint32_t max_index = 0;
+  uint32_t i;
+
+  switch (header->indices_type)
+    {
+    case COGL_INDICES_TYPE_UNSIGNED_BYTE:
+      for (i = 0; i < header->n_indices; i++)
+        max_index = MAX (max_index, indices[i]);
+      break;
+    case COGL_INDICES_TYPE_UNSIGNED_SHORT:
+      for (i = 0; i < header->n_indices; i++)
+        max_index = MAX (max_index, ((const uint16_t *) indices)[i]);
+      break;
+    case COGL_INDICES_TYPE_UNSIGNED_INT:
+      for (i = 0; i < header->n_indices; i++)
+        max_index = MAX (max_index, ((const uint32_t *) indices)[i]);
+      break;
+    }
+
+  return max_index < header->n_vertices;
+}
+
+static CoglBool
+validate_header (const CacheHeader *header,
+                 const CacheAttribute *attributes,
+                 size_t len)
+{
+  int index_size;
+  int i;
+
+  if (memcmp (header->magic, RUT_MESH_CACHE_MAGIC,
+              sizeof (RUT_MESH_CACHE_MAGIC)) != 0 ||
+      header->version != RUT_MESH_CACHE_VERSION ||
+      header->byte_order != RUT_MESH_CACHE_BYTE_ORDER)
+    return FALSE;
+
+  if (header->n_attributes == 0 ||
+      header->n_attributes > RUT_MESH_CACHE_MAX_ATTRIBUTES ||
+      sizeof (CacheHeader) +
+      header->n_attributes * sizeof (CacheAttribute) > len)
+    return FALSE;
+
+  if (header->vertex_offset > len ||
+      header->vertex_size > len - header->vertex_offset ||
+      header->indices_offset > len ||
+      header->indices_size > len - header->indices_offset)
+    return FALSE;
+
+  if (header->n_indices)
+    {
+      index_size = get_sizeof_indices_type (header->indices_type);
+      if (index_size == 0 ||
+          header->indices_offset % index_size != 0 ||
+          header->indices_size != (uint64_t) header->n_indices * index_size)
+        return FALSE;
+    }
+
+  for (i = 0; i < header->n_attributes; i++)
+    {
+      const CacheAttribute *attribute = &attributes[i];
+      int size = get_sizeof_attribute_type (attribute->type);
+
+      if (memchr (attribute->name, '\0', RUT_MESH_CACHE_MAX_NAME) == NULL)
+        return FALSE;
+
+      if (size == 0 ||
+          attribute->n_components < 1 || attribute->n_components > 4)
+        return FALSE;
+
+      /* Make sure the last vertex doesn't run off the end of the
+       * vertex data */
+      if (header->n_vertices &&
+          (uint64_t) attribute->stride * (header->n_vertices - 1) +
+          attribute->offset + size * attribute->n_components >
+          header->vertex_size)
+        return FALSE;
+    }
+
+  if (header->n_indices && !validate_indices (header))
+    return FALSE;
+
+  return TRUE;
+}
+
+RutMesh *
+rut_mesh_cache_load (const char *cache_filename,
+                     const char *source_filename,
+                     RutMeshBounds *bounds,
+                     GError **error)
+{
+  GMappedFile *mapped_file;
+  const uint8_t *data;
+  size_t len;
+  const CacheHeader *header;
+  const CacheAttribute *cache_attributes;
+  RutAttribute *attributes[RUT_MESH_CACHE_MAX_ATTRIBUTES];
+  RutBuffer *vertex_buffer;
+  RutMesh *mesh;
+  int i;
+
+  mapped_file = g_mapped_file_new (cache_filename, FALSE, error);
+  if (!mapped_file)
+    return NULL;
+
+  data = (const uint8_t *) g_mapped_file_get_contents (mapped_file);
+  len = g_mapped_file_get_length (mapped_file);
+
+  header = (const CacheHeader *) data;
+  cache_attributes = (const CacheAttribute *) (header + 1);
+
+  if (len < sizeof (CacheHeader) ||
+      !validate_header (header, cache_attributes, len))
+    {
+      g_set_error (error, RUT_MESH_CACHE_ERROR,
+                   RUT_MESH_CACHE_ERROR_INVALID,
+                   "Invalid mesh cache %s", cache_filename);
+      g_mapped_file_unref (mapped_file);
+      return NULL;
+    }
+
+  if (!validate_source (header, cache_filename, source_filename, error))
+    {
+      g_mapped_file_unref (mapped_file);
+      return NULL;
+    }
+
+  vertex_buffer = rut_buffer_new_for_mapped_file (mapped_file,
+                                                  header->vertex_offset,
+                                                  header->vertex_size);
+
+  for (i = 0; i < header->n_attributes; i++)
+    {
+      const CacheAttribute *cache_attribute = &cache_attributes[i];
+
+      attributes[i] = rut_attribute_new (vertex_buffer,
+                                         cache_attribute->name,
+                                         cache_attribute->stride,
+                                         cache_attribute->offset,
+                                         cache_attribute->n_components,
+                                         cache_attribute->type);
+      attributes[i]->normalized = cache_attribute->normalized;
+    }
+
+  mesh = rut_mesh_new (header->mode,
+                       header->n_vertices,
+                       attributes,
+                       header->n_attributes);
+
+  for (i = 0; i < header->n_attributes; i++)
+    rut_refable_unref (attributes[i]);
+  rut_refable_unref (vertex_buffer);
+
+  if (header->n_indices)
+    {
+      RutBuffer *indices_buffer =
+        rut_buffer_new_for_mapped_file (mapped_file,
+                                        header->indices_offset,
+                                        header->indices_size);
+
+      rut_mesh_set_indices (mesh,
+                            header->indices_type,
+                            indices_buffer,
+                            header->n_indices);
+
+      rut_refable_unref (indices_buffer);
+    }
+
+  memcpy (bounds->min, header->bounds_min, sizeof (bounds->min));
+  memcpy (bounds->max, header->bounds_max, sizeof (bounds->max));
+
+  /* The buffers keep the file mapped for as long as they need it */
+  g_mapped_file_unref (mapped_file);
+
+  return mesh;
+}
+
+CoglBool
+rut_mesh_cache_save (RutMesh *mesh,
+                     const RutMeshBounds *bounds,
+                     const char *cache_filename,
+                     const char *source_filename,
+                     GError **error)
+{
+  RutBuffer *vertex_buffer;
+  CacheHeader *header;
+  CacheAttribute *cache_attributes;
+  GStatBuf buf;
+  uint8_t *data;
+  size_t len;
+  size_t indices_size = 0;
+  char *dirname;
+  CoglBool ret;
+  int i;
+
+  g_return_val_if_fail (mesh->n_attributes > 0, FALSE);
+
+  if (mesh->n_attributes > RUT_MESH_CACHE_MAX_ATTRIBUTES)
+    {
+      g_set_error (error, RUT_MESH_CACHE_ERROR,
+                   RUT_MESH_CACHE_ERROR_INVALID,
+                   "Too many attributes to cache mesh");
+      return FALSE;
+    }
+
+  /* Only meshes with all of their attributes interleaved in one
+   * buffer are supported which is what the PLY loader creates */
+  vertex_buffer = mesh->attributes[0]->buffer;
+  for (i = 0; i < mesh->n_attributes; i++)
+    {
+      RutAttribute *attribute = mesh->attributes[i];
+
+      if (attribute->buffer != vertex_buffer ||
+          strlen (attribute->name) >= RUT_MESH_CACHE_MAX_NAME)
+        {
+          g_set_error (error, RUT_MESH_CACHE_ERROR,
+                       RUT_MESH_CACHE_ERROR_INVALID,
+                       "Unsupported mesh layout for the mesh cache");
+          return FALSE;
+        }
+    }
+
+  if (!stat_source (source_filename, &buf, error))
+    return FALSE;
+
+  len = sizeof (CacheHeader) + sizeof (CacheAttribute) * mesh->n_attributes;
+  len = align_offset (len);
+  len += vertex_buffer->size;
+  if (mesh->indices_buffer)
+    {
+      indices_size =
+        mesh->n_indices * get_sizeof_indices_type (mesh->indices_type);
+      len = align_offset (len);
+      len += indices_size;
+    }
+
+  data = g_malloc0 (len);
+
+  header = (CacheHeader *) data;
+  cache_attributes = (CacheAttribute *) (header + 1);
+
+  memcpy (header->magic, RUT_MESH_CACHE_MAGIC, sizeof (RUT_MESH_CACHE_MAGIC));
+  header->version = RUT_MESH_CACHE_VERSION;
+  header->byte_order = RUT_MESH_CACHE_BYTE_ORDER;
+
+  header->source_mtime = buf.st_mtime;
+  header->source_size = buf.st_size;
+  if (!hash_source (source_filename, header->source_hash, error))
+    {
+      g_free (data);
+      return FALSE;
+    }
+
+  header->mode = mesh->mode;
+  header->n_vertices = mesh->n_vertices;
+  header->n_attributes = mesh->n_attributes;
+
+  memcpy (header->bounds_min, bounds->min, sizeof (header->bounds_min));
+  memcpy (header->bounds_max, bounds->max, sizeof (header->bounds_max));
+
+  for (i = 0; i < mesh->n_attributes; i++)
+    {
+      RutAttribute *attribute = mesh->attributes[i];
+      CacheAttribute *cache_attribute = &cache_attributes[i];
+
+      strcpy (cache_attribute->name, attribute->name);
+      cache_attribute->stride = attribute->stride;
+      cache_attribute->offset = attribute->offset;
+      cache_attribute->n_components = attribute->n_components;
+      cache_attribute->type = attribute->type;
+      cache_attribute->normalized = attribute->normalized;
+    }
+
+  header->vertex_offset =
+    align_offset (sizeof (CacheHeader) +
+                  sizeof (CacheAttribute) * mesh->n_attributes);
+  header->vertex_size = vertex_buffer->size;
+  memcpy (data + header->vertex_offset,
+          vertex_buffer->data,
+          vertex_buffer->size);
+
+  if (mesh->indices_buffer)
+    {
+      header->indices_type = mesh->indices_type;
+      header->n_indices = mesh->n_indices;
+      header->indices_offset =
+        align_offset (header->vertex_offset + header->vertex_size);
+      header->indices_size = indices_size;
+      memcpy (data + header->indices_offset,
+              mesh->indices_buffer->data,
+              indices_size);
+    }
+
+  dirname = g_path_get_dirname (cache_filename);
+  if (g_mkdir_with_parents (dirname, 0755) == -1)
+    {
+      g_set_error (error, RUT_MESH_CACHE_ERROR,
+                   RUT_MESH_CACHE_ERROR_IO,
+                   "Failed to create mesh cache directory %s", dirname);
+      ret = FALSE;
+    }
+  else
+    ret = g_file_set_contents (cache_filename, (char *) data, len, error);
+
+  g_free (dirname);
+  g_free (data);
+
+  return ret;
+}
@@ -0,0 +1,106 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RUT_MESH_CACHE_H_
+#define _RUT_MESH_CACHE_H_
+
+#include <glib.h>
+
+#include <cogl/cogl.h>
+
+#include "rut-mesh.h"
+
+G_BEGIN_DECLS
+
+/*
+ * A compact on-disk copy of an imported RutMesh so that models don't
+ * have to be parsed again each time they are loaded.
+ *
+ * The file stores the attribute descriptors, the interleaved vertex
+ * data, the indices and the bounds of the positions in exactly the
+ * layout RutMesh uses so the file can be mapped and used directly.
+ * The buffers of a mesh loaded from the cache point into the mapping
+ * and so must not be modified.
+ *
+ * The cache records the modification time, size and SHA-256 sum of
+ * the file the mesh was imported from and is ignored if it doesn't
+ * match the source anymore.
+ */
+
+#define RUT_MESH_CACHE_ERROR rut_mesh_cache_error_quark ()
+
+typedef enum _RutMeshCacheError
+{
+  RUT_MESH_CACHE_ERROR_IO,
+  RUT_MESH_CACHE_ERROR_INVALID,
+  RUT_MESH_CACHE_ERROR_STALE
+} RutMeshCacheError;
+
+GQuark
+rut_mesh_cache_error_quark (void);
+
+/**
+ * rut_mesh_cache_get_filename:
+ * @assets_location: The directory containing the assets
+ * @path: The path of the source asset relative to @assets_location
+ *
+ * Return value: A newly allocated filename for the cached copy of
+ *   the mesh imported from @path.
+ */
+char *
+rut_mesh_cache_get_filename (const char *assets_location,
+                             const char *path);
+
+/**
+ * rut_mesh_cache_load:
+ * @cache_filename: The cache file to load
+ * @source_filename: The file the mesh was originally imported from
+ * @bounds: Returns the bounds of the positions of the mesh
+ * @error: Returns an error if the cache can't be used
+ *
+ * Return value: A new #RutMesh or %NULL if the cache is missing,
+ *   invalid or no longer matches @source_filename.
+ */
+RutMesh *
+rut_mesh_cache_load (const char *cache_filename,
+                     const char *source_filename,
+                     RutMeshBounds *bounds,
+                     GError **error);
+
+/**
+ * rut_mesh_cache_save:
+ * @mesh: The mesh to save
+ * @bounds: The bounds of the positions of @mesh
+ * @cache_filename: The cache file to write
+ * @source_filename: The file @mesh was imported from
+ * @error: Returns an error if the file couldn't be written
+ *
+ * Writes @mesh to @cache_filename, creating any missing directories.
+ */
+CoglBool
+rut_mesh_cache_save (RutMesh *mesh,
+                     const RutMeshBounds *bounds,
+                     const char *cache_filename,
+                     const char *source_filename,
+                     GError **error);
+
+G_END_DECLS
+
+#endif /* _RUT_MESH_CACHE_H_ */
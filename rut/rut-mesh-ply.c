@@ -55,7 +55,7 @@ typedef struct _LoaderProperty
 
 typedef struct _Loader
 {
-  RutContext *ctx;
+  CoglBool uint32_indices;
   p_ply ply;
   GError *error;
 
@@ -282,26 +282,17 @@ find_property (p_ply_element element, const char *property_name)
 }
 
 static CoglBool
-init_indices_array (Loader *loader,
-                    int n_vertices,
-                    GError **error)
+get_indices_type (CoglBool uint32_indices,
+                  int n_vertices,
+                  CoglIndicesType *indices_type,
+                  GError **error)
 {
   if (n_vertices <= 0x100)
-    {
-      loader->indices_type = COGL_INDICES_TYPE_UNSIGNED_BYTE;
-      loader->faces = g_array_new (FALSE, FALSE, sizeof (uint8_t));
-    }
+    *indices_type = COGL_INDICES_TYPE_UNSIGNED_BYTE;
   else if (n_vertices <= 0x10000)
-    {
-      loader->indices_type = COGL_INDICES_TYPE_UNSIGNED_SHORT;
-      loader->faces = g_array_new (FALSE, FALSE, sizeof (uint16_t));
-    }
-  else if (cogl_has_feature (loader->ctx->cogl_context,
-                             COGL_FEATURE_ID_UNSIGNED_INT_INDICES))
-    {
-      loader->indices_type = COGL_INDICES_TYPE_UNSIGNED_INT;
-      loader->faces = g_array_new (FALSE, FALSE, sizeof (uint32_t));
-    }
+    *indices_type = COGL_INDICES_TYPE_UNSIGNED_SHORT;
+  else if (uint32_indices)
+    *indices_type = COGL_INDICES_TYPE_UNSIGNED_INT;
   else
     {
       g_set_error (error, RUT_MESH_PLY_ERROR,
@@ -314,62 +305,64 @@ init_indices_array (Loader *loader,
   return TRUE;
 }
 
-static RutMesh *
-_rut_mesh_new_from_p_ply (RutContext *ctx,
-                          Loader *loader,
-                          p_ply ply,
-                          const char *display_name,
-                          RutPLYAttribute *attributes,
-                          int n_attributes,
-                          RutPLYAttributeStatus *load_status,
-                          GError **error)
+static int
+get_sizeof_indices_type (CoglIndicesType indices_type)
 {
-  LoaderAttribute loader_attributes[n_attributes];
-  int n_loader_attributes;
-  LoaderProperty loader_properties[n_attributes *
-                                   RUT_PLY_MAX_ATTRIBUTE_PROPERTIES];
-  RutAttribute *rut_attributes[n_attributes];
-  p_ply_element vertex_element;
-  RutBuffer *indices_buffer;
-  RutMesh *mesh;
-  int i;
-  int32_t n_vertices;
-  int max_component_size = 1;
-
-  memset (rut_attributes, 0, sizeof (void *) * n_attributes);
-
-  loader->ctx = ctx;
-  loader->loader_attributes = loader_attributes;
-  loader->loader_properties = loader_properties;
-
-  loader->ply = ply;
-
-  if (!ply_read_header (loader->ply))
+  switch (indices_type)
     {
-      g_set_error (&loader->error, RUT_MESH_PLY_ERROR,
-                   RUT_MESH_PLY_ERROR_UNKNOWN,
-                   "Failed to parse header of PLY file %s", display_name);
-      goto EXIT;
+    case COGL_INDICES_TYPE_UNSIGNED_BYTE:
+      return 1;
+    case COGL_INDICES_TYPE_UNSIGNED_SHORT:
+      return 2;
+    case COGL_INDICES_TYPE_UNSIGNED_INT:
+      return 4;
     }
 
-  vertex_element = find_element (loader, "vertex");
-  if (!vertex_element)
-    {
-      g_set_error (&loader->error, RUT_MESH_PLY_ERROR,
-                   RUT_MESH_PLY_ERROR_MISSING_PROPERTY,
-                   "PLY file %s is missing the vertex properties",
-                   display_name);
-      goto EXIT;
-    }
+  g_warn_if_reached ();
+  return 0;
+}
 
-  ply_get_element_info (vertex_element, NULL, &n_vertices);
+static CoglBool
+init_indices_array (Loader *loader,
+                    int n_vertices,
+                    GError **error)
+{
+  if (!get_indices_type (loader->uint32_indices,
+                         n_vertices,
+                         &loader->indices_type,
+                         error))
+    return FALSE;
 
-  if (!init_indices_array (loader, n_vertices, &loader->error))
-    goto EXIT;
+  loader->faces =
+    g_array_new (FALSE, FALSE, get_sizeof_indices_type (loader->indices_type));
 
-  /* Group properties into attributes */
+  return TRUE;
+}
+
+/* Used to look up the type of a vertex property regardless of
+ * whether the header was parsed by rply or by the binary loader */
+typedef CoglBool (*LoaderFindPropertyCallback) (const char *name,
+                                                e_ply_type *type,
+                                                void *user_data);
+
+/* Groups the vertex properties into attributes and lays out the
+ * attributes in an interleaved vertex. Returns the number of loader
+ * attributes or -1 if there was an error */
+static int
+init_loader_attributes (Loader *loader,
+                        LoaderFindPropertyCallback find_property_cb,
+                        void *find_property_data,
+                        const char *display_name,
+                        RutPLYAttribute *attributes,
+                        int n_attributes,
+                        RutPLYAttributeStatus *load_status)
+{
+  LoaderAttribute *loader_attributes = loader->loader_attributes;
+  LoaderProperty *loader_properties = loader->loader_properties;
+  int n_loader_attributes = 0;
+  int max_component_size = 1;
+  int i;
 
-  n_loader_attributes = 0;
   for (i = 0; i < n_attributes; i++)
     {
       RutPLYAttribute *attribute = &attributes[i];
@@ -382,16 +375,15 @@ _rut_mesh_new_from_p_ply (RutContext *ctx,
       for (j = 0; j < attribute->n_properties; j++)
         {
           RutPLYProperty *property = &attribute->properties[j];
-          p_ply_property ply_prop;
           e_ply_type ply_property_type;
 
-          ply_prop = find_property (vertex_element, property->name);
-          if (!ply_prop)
+          if (!find_property_cb (property->name,
+                                 &ply_property_type,
+                                 find_property_data))
             break;
 
           n_components++;
 
-          ply_get_property_info (ply_prop, NULL, &ply_property_type, NULL, NULL);
           if (n_components == 1)
             ply_attribute_type = ply_property_type;
           else if (ply_property_type != ply_attribute_type)
@@ -400,7 +392,7 @@ _rut_mesh_new_from_p_ply (RutContext *ctx,
                            RUT_MESH_PLY_ERROR_INVALID,
                            "Mismatching attribute property types "
                            "in PLY file %s", display_name);
-              goto EXIT;
+              return -1;
             }
         }
 
@@ -421,7 +413,7 @@ _rut_mesh_new_from_p_ply (RutContext *ctx,
                        RUT_MESH_PLY_ERROR_INVALID,
                        "Required attribute properties not found in PLY file %s",
                        display_name);
-          goto EXIT;
+          return -1;
         }
 
       if (load_status[i] == RUT_PLY_ATTRIBUTE_STATUS_MISSING)
@@ -429,6 +421,7 @@ _rut_mesh_new_from_p_ply (RutContext *ctx,
 
       loader_attribute = &loader_attributes[n_loader_attributes];
       loader_attribute->name = attribute->name;
+      loader_attribute->rut_attribute = NULL;
       if (load_status[i] == RUT_PLY_ATTRIBUTE_STATUS_PADDED)
         {
           loader_attribute->type = attribute->pad_type;
@@ -442,7 +435,7 @@ _rut_mesh_new_from_p_ply (RutContext *ctx,
                            RUT_MESH_PLY_ERROR_INVALID,
                            "List property given for vertex attribute "
                            "in PLY file %s", display_name);
-              goto EXIT;
+              return -1;
             }
 
           loader_attribute->type =
@@ -482,49 +475,158 @@ _rut_mesh_new_from_p_ply (RutContext *ctx,
   loader->n_vertex_bytes = ((loader->n_vertex_bytes + max_component_size - 1) &
                            ~(unsigned int) (max_component_size - 1));
 
-  loader->vertex_buffer = rut_buffer_new (loader->n_vertex_bytes * n_vertices);
-  loader->current_vertex_pos = loader->vertex_buffer->data;
+  return n_loader_attributes;
+}
 
-  /* Now that we know what attributes we are loading and their size we
-   * know the full vertex size so we can create corresponding
-   * RutAttributes */
+/* Creates the mesh once the vertex buffer has been filled in. This
+ * takes ownership of the loader's vertex buffer */
+static RutMesh *
+create_mesh (Loader *loader,
+             int n_vertices,
+             int n_loader_attributes,
+             RutBuffer *indices_buffer,
+             int n_indices)
+{
+  RutAttribute *rut_attributes[MAX (1, n_loader_attributes)];
+  RutMesh *mesh;
+  int i;
 
   for (i = 0; i < n_loader_attributes; i++)
     {
-      LoaderAttribute *loader_attribute = &loader_attributes[i];
-      RutAttribute *rut_attribute;
-      int j;
-
-      if (!loader_attribute->padding)
-        {
-            for (j = 0; j < loader_attribute->n_components; j++)
-              {
-                int p = i * RUT_PLY_MAX_ATTRIBUTE_PROPERTIES + j;
-                LoaderProperty *loader_property = &loader_properties[p];
-
-                if (!ply_set_read_cb (loader->ply, "vertex",
-                                      loader_property->name,
-                                      rut_mesh_ply_loader_vertex_read_cb,
-                                      loader, p))
-                  {
-                    g_set_error (&loader->error, RUT_MESH_PLY_ERROR,
-                                 RUT_MESH_PLY_ERROR_UNKNOWN,
-                                 "Failed to parse PLY file %s", display_name);
-                    goto EXIT;
-                  }
-              }
-        }
+      LoaderAttribute *loader_attribute = &loader->loader_attributes[i];
 
-      rut_attribute =
+      rut_attributes[i] =
         rut_attribute_new (loader->vertex_buffer,
                            loader_attribute->name,
                            loader->n_vertex_bytes,
                            loader_attribute->offset,
                            loader_attribute->n_components,
                            loader_attribute->type);
+    }
+
+  mesh = rut_mesh_new (COGL_VERTICES_MODE_TRIANGLES,
+                       n_vertices,
+                       rut_attributes,
+                       n_loader_attributes);
+
+  for (i = 0; i < n_loader_attributes; i++)
+    rut_refable_unref (rut_attributes[i]);
+
+  /* The attributes now hold a reference on the buffer */
+  rut_refable_unref (loader->vertex_buffer);
+  loader->vertex_buffer = NULL;
+
+  rut_mesh_set_indices (mesh,
+                        loader->indices_type,
+                        indices_buffer,
+                        n_indices);
+
+  return mesh;
+}
+
+static CoglBool
+find_ply_property_cb (const char *name,
+                      e_ply_type *type,
+                      void *user_data)
+{
+  p_ply_element vertex_element = user_data;
+  p_ply_property ply_prop = find_property (vertex_element, name);
+
+  if (!ply_prop)
+    return FALSE;
+
+  ply_get_property_info (ply_prop, NULL, type, NULL, NULL);
+
+  return TRUE;
+}
+
+static RutMesh *
+_rut_mesh_new_from_p_ply (CoglBool uint32_indices,
+                          Loader *loader,
+                          p_ply ply,
+                          const char *display_name,
+                          RutPLYAttribute *attributes,
+                          int n_attributes,
+                          RutPLYAttributeStatus *load_status,
+                          GError **error)
+{
+  LoaderAttribute loader_attributes[n_attributes];
+  int n_loader_attributes;
+  LoaderProperty loader_properties[n_attributes *
+                                   RUT_PLY_MAX_ATTRIBUTE_PROPERTIES];
+  p_ply_element vertex_element;
+  RutBuffer *indices_buffer;
+  RutMesh *mesh = NULL;
+  int i;
+  int32_t n_vertices;
+
+  loader->uint32_indices = uint32_indices;
+  loader->loader_attributes = loader_attributes;
+  loader->loader_properties = loader_properties;
+
+  loader->ply = ply;
+
+  if (!ply_read_header (loader->ply))
+    {
+      g_set_error (&loader->error, RUT_MESH_PLY_ERROR,
+                   RUT_MESH_PLY_ERROR_UNKNOWN,
+                   "Failed to parse header of PLY file %s", display_name);
+      goto EXIT;
+    }
+
+  vertex_element = find_element (loader, "vertex");
+  if (!vertex_element)
+    {
+      g_set_error (&loader->error, RUT_MESH_PLY_ERROR,
+                   RUT_MESH_PLY_ERROR_MISSING_PROPERTY,
+                   "PLY file %s is missing the vertex properties",
+                   display_name);
+      goto EXIT;
+    }
+
+  ply_get_element_info (vertex_element, NULL, &n_vertices);
+
+  if (!init_indices_array (loader, n_vertices, &loader->error))
+    goto EXIT;
+
+  /* Group properties into attributes */
+  n_loader_attributes = init_loader_attributes (loader,
+                                                find_ply_property_cb,
+                                                vertex_element,
+                                                display_name,
+                                                attributes,
+                                                n_attributes,
+                                                load_status);
+  if (n_loader_attributes < 0)
+    goto EXIT;
+
+  loader->vertex_buffer = rut_buffer_new (loader->n_vertex_bytes * n_vertices);
+  loader->current_vertex_pos = loader->vertex_buffer->data;
+
+  for (i = 0; i < n_loader_attributes; i++)
+    {
+      LoaderAttribute *loader_attribute = &loader_attributes[i];
+      int j;
+
+      if (loader_attribute->padding)
+        continue;
+
+      for (j = 0; j < loader_attribute->n_components; j++)
+        {
+          int p = i * RUT_PLY_MAX_ATTRIBUTE_PROPERTIES + j;
+          LoaderProperty *loader_property = &loader_properties[p];
 
-      loader_attribute->rut_attribute = rut_attribute;
-      rut_attributes[i] = rut_attribute;
+          if (!ply_set_read_cb (loader->ply, "vertex",
+                                loader_property->name,
+                                rut_mesh_ply_loader_vertex_read_cb,
+                                loader, p))
+            {
+              g_set_error (&loader->error, RUT_MESH_PLY_ERROR,
+                           RUT_MESH_PLY_ERROR_UNKNOWN,
+                           "Failed to parse PLY file %s", display_name);
+              goto EXIT;
+            }
+        }
     }
 
   if (!ply_set_read_cb (loader->ply, "face", "vertex_indices",
@@ -558,22 +660,15 @@ _rut_mesh_new_from_p_ply (RutContext *ctx,
       goto EXIT;
     }
 
-  mesh = rut_mesh_new (COGL_VERTICES_MODE_TRIANGLES,
-                       n_vertices,
-                       rut_attributes,
-                       n_loader_attributes);
-
-  for (i = 0; i < n_loader_attributes; i++)
-    rut_refable_unref (rut_attributes[i]);
-
   indices_buffer = rut_buffer_new (loader->faces->len *
                                    g_array_get_element_size (loader->faces));
   memcpy (indices_buffer->data, loader->faces->data, indices_buffer->size);
 
-  rut_mesh_set_indices (mesh,
-                        loader->indices_type,
-                        indices_buffer,
-                        loader->faces->len);
+  mesh = create_mesh (loader,
+                      n_vertices,
+                      n_loader_attributes,
+                      indices_buffer,
+                      loader->faces->len);
 
   rut_refable_unref (indices_buffer);
 
@@ -586,10 +681,6 @@ EXIT:
       if (loader->vertex_buffer)
         rut_refable_unref (loader->vertex_buffer);
 
-      for (i = 0; i < n_loader_attributes; i++)
-        if (rut_attributes[i])
-          rut_refable_unref (rut_attributes[i]);
-
       mesh = NULL;
     }
 
@@ -599,66 +690,1020 @@ EXIT:
   return mesh;
 }
 
-RutMesh *
-rut_mesh_new_from_ply (RutContext *ctx,
-                       const char *filename,
-                       RutPLYAttribute *attributes,
-                       int n_attributes,
-                       RutPLYAttributeStatus *load_status,
-                       GError **error)
+/*
+ * Binary fast path
+ *
+ * rply calls back for every single value which is far too slow for
+ * large scanned models. For binary files we instead parse the header
+ * ourselves, work out the layout of each element once and then
+ * convert whole columns of vertex properties straight from the
+ * mapped file into the interleaved vertex buffer. ASCII files, and
+ * binary files with a layout this doesn't handle, still go through
+ * rply.
+ */
+
+typedef struct _BinaryProperty
 {
-  Loader loader;
-  p_ply ply;
-  RutMesh *mesh;
-  char *display_name;
+  char *name;
 
-  memset (&loader, 0, sizeof (Loader));
+  /* For list properties type is PLY_LIST */
+  e_ply_type type;
+  e_ply_type length_type;
+  e_ply_type value_type;
 
-  ply = ply_open (filename, rut_mesh_ply_loader_error_cb, error);
+  /* Offset from the start of the element. Only valid for elements
+   * without any list properties */
+  size_t offset;
+} BinaryProperty;
 
-  if (!ply)
-    return NULL;
+typedef struct _BinaryElement
+{
+  char *name;
+  int n_instances;
 
-  display_name = g_filename_display_name (filename);
+  GArray *properties;
 
-  mesh = _rut_mesh_new_from_p_ply (ctx,
-                                   &loader,
-                                   ply,
-                                   display_name,
-                                   attributes,
-                                   n_attributes,
-                                   load_status,
-                                   error);
+  CoglBool has_lists;
+  /* Only valid if there are no list properties */
+  size_t stride;
+} BinaryElement;
 
-  g_free (display_name);
+typedef struct _BinaryHeader
+{
+  /* Whether the file's byte order differs from the host's */
+  CoglBool swap;
 
-  return mesh;
-}
+  GArray *elements;
 
-RutMesh *
-rut_mesh_new_from_ply_data (RutContext *ctx,
-                            const uint8_t *data,
-                            size_t len,
-                            RutPLYAttribute *attributes,
-                            int n_attributes,
-                            RutPLYAttributeStatus *load_status,
-                            GError **error)
+  /* The size of the header including the end_header line */
+  size_t size;
+} BinaryHeader;
+
+typedef enum
 {
-  Loader loader;
-  p_ply ply;
-  RutMesh *mesh;
-  char *display_name;
+  BINARY_PLY_LOADED,
+  BINARY_PLY_ERROR,
+  /* The file should be loaded with rply instead */
+  BINARY_PLY_UNSUPPORTED
+} BinaryPlyStatus;
+
+static const char *const binary_type_names[] = {
+  "int8", "uint8", "int16", "uint16",
+  "int32", "uint32", "float32", "float64",
+  "char", "uchar", "short", "ushort",
+  "int", "uint", "float", "double"
+}; /* order matches e_ply_type */
 
-  memset (&loader, 0, sizeof (Loader));
+static CoglBool
+parse_binary_type (const char *name, e_ply_type *type)
+{
+  int i;
 
-  ply = ply_start (data, len, rut_mesh_ply_loader_error_cb, error);
+  for (i = 0; i < G_N_ELEMENTS (binary_type_names); i++)
+    if (strcmp (name, binary_type_names[i]) == 0)
+      {
+        *type = i;
+        return TRUE;
+      }
 
-  if (!ply)
-    return NULL;
+  return FALSE;
+}
 
-  display_name = g_strdup_printf ("<serialized asset %p>", data);
+static int
+get_sizeof_ply_type (e_ply_type type)
+{
+  switch (type)
+    {
+    case PLY_INT8:
+    case PLY_UINT8:
+    case PLY_CHAR:
+    case PLY_UCHAR:
+      return 1;
+    case PLY_INT16:
+    case PLY_UINT16:
+    case PLY_SHORT:
+    case PLY_USHORT:
+      return 2;
+    case PLY_INT32:
+    case PLY_UIN32:
+    case PLY_FLOAT32:
+    case PLY_INT:
+    case PLY_UINT:
+    case PLY_FLOAT:
+      return 4;
+    case PLY_FLOAT64:
+    case PLY_DOUBLE:
+      return 8;
+    case PLY_LIST:
+      break;
+    }
+
+  g_warn_if_reached ();
+  return 0;
+}
+
+static void
+free_binary_header (BinaryHeader *header)
+{
+  int i, j;
+
+  if (header->elements == NULL)
+    return;
+
+  for (i = 0; i < header->elements->len; i++)
+    {
+      BinaryElement *element =
+        &g_array_index (header->elements, BinaryElement, i);
+
+      for (j = 0; j < element->properties->len; j++)
+        g_free (g_array_index (element->properties, BinaryProperty, j).name);
+
+      g_array_free (element->properties, TRUE);
+      g_free (element->name);
+    }
+
+  g_array_free (header->elements, TRUE);
+  header->elements = NULL;
+}
+
+/* Splits a header line into at most max_tokens whitespace separated
+ * tokens which point into the line. Returns the number of tokens */
+static int
+tokenize_line (char *line, char **tokens, int max_tokens)
+{
+  int n_tokens = 0;
+  char *p = line;
+
+  while (n_tokens < max_tokens)
+    {
+      while (*p == ' ' || *p == '\t' || *p == '\r')
+        p++;
+      if (*p == '\0')
+        break;
+
+      tokens[n_tokens++] = p;
+
+      while (*p && *p != ' ' && *p != '\t' && *p != '\r')
+        p++;
+      if (*p)
+        *(p++) = '\0';
+    }
+
+  return n_tokens;
+}
+
+static BinaryPlyStatus
+parse_binary_header (const uint8_t *data,
+                     size_t len,
+                     BinaryHeader *header)
+{
+  const char *end_marker = "\nend_header";
+  const char *end;
+  char *header_text;
+  char **lines;
+  BinaryElement *element = NULL;
+  CoglBool big_endian = FALSE;
+  CoglBool have_format = FALSE;
+  BinaryPlyStatus status = BINARY_PLY_LOADED;
+  int i;
+
+  if (len < 4 || memcmp (data, "ply", 3) != 0 ||
+      (data[3] != '\n' && data[3] != '\r'))
+    return BINARY_PLY_UNSUPPORTED;
+
+  end = g_strstr_len ((const char *) data, len, end_marker);
+  if (end == NULL)
+    return BINARY_PLY_UNSUPPORTED;
+
+  end += strlen (end_marker);
+  if (end < (const char *) data + len && *end == '\r')
+    end++;
+  if (end >= (const char *) data + len || *end != '\n')
+    return BINARY_PLY_UNSUPPORTED;
+  end++;
+
+  header->size = end - (const char *) data;
+  header->elements = g_array_new (FALSE, FALSE, sizeof (BinaryElement));
+
+  header_text = g_strndup ((const char *) data, header->size);
+  lines = g_strsplit (header_text, "\n", -1);
+  g_free (header_text);
+
+  for (i = 1; lines[i] && status == BINARY_PLY_LOADED; i++)
+    {
+      char *tokens[5];
+      int n_tokens = tokenize_line (lines[i], tokens, G_N_ELEMENTS (tokens));
+
+      if (n_tokens == 0 ||
+          strcmp (tokens[0], "comment") == 0 ||
+          strcmp (tokens[0], "obj_info") == 0 ||
+          strcmp (tokens[0], "end_header") == 0)
+        continue;
+
+      if (strcmp (tokens[0], "format") == 0 && n_tokens >= 2)
+        {
+          if (strcmp (tokens[1], "binary_little_endian") == 0)
+            big_endian = FALSE;
+          else if (strcmp (tokens[1], "binary_big_endian") == 0)
+            big_endian = TRUE;
+          else
+            status = BINARY_PLY_UNSUPPORTED;
+
+          have_format = TRUE;
+        }
+      else if (strcmp (tokens[0], "element") == 0 && n_tokens >= 3)
+        {
+          BinaryElement new_element;
+          char *count_end;
+          gint64 count = g_ascii_strtoll (tokens[2], &count_end, 10);
+
+          if (*count_end != '\0' || count < 0 || count > G_MAXINT32)
+            {
+              status = BINARY_PLY_UNSUPPORTED;
+              break;
+            }
+
+          new_element.name = g_strdup (tokens[1]);
+          new_element.n_instances = count;
+          new_element.properties =
+            g_array_new (FALSE, FALSE, sizeof (BinaryProperty));
+          new_element.has_lists = FALSE;
+          new_element.stride = 0;
+
+          g_array_append_val (header->elements, new_element);
+          element = &g_array_index (header->elements,
+                                    BinaryElement,
+                                    header->elements->len - 1);
+        }
+      else if (strcmp (tokens[0], "property") == 0 && element)
+        {
+          BinaryProperty property;
+
+          if (n_tokens >= 5 && strcmp (tokens[1], "list") == 0 &&
+              parse_binary_type (tokens[2], &property.length_type) &&
+              parse_binary_type (tokens[3], &property.value_type))
+            {
+              property.type = PLY_LIST;
+              property.name = g_strdup (tokens[4]);
+              property.offset = 0;
+              element->has_lists = TRUE;
+            }
+          else if (n_tokens >= 3 &&
+                   parse_binary_type (tokens[1], &property.type))
+            {
+              property.name = g_strdup (tokens[2]);
+              property.offset = element->stride;
+              element->stride += get_sizeof_ply_type (property.type);
+            }
+          else
+            {
+              status = BINARY_PLY_UNSUPPORTED;
+              break;
+            }
+
+          g_array_append_val (element->properties, property);
+        }
+      else
+        status = BINARY_PLY_UNSUPPORTED;
+    }
+
+  g_strfreev (lines);
+
+  if (status == BINARY_PLY_LOADED && !have_format)
+    status = BINARY_PLY_UNSUPPORTED;
+
+  if (status != BINARY_PLY_LOADED)
+    free_binary_header (header);
+
+  header->swap = (big_endian != (G_BYTE_ORDER == G_BIG_ENDIAN));
+
+  return status;
+}
+
+static BinaryElement *
+find_binary_element (BinaryHeader *header, const char *name)
+{
+  int i;
+
+  for (i = 0; i < header->elements->len; i++)
+    {
+      BinaryElement *element =
+        &g_array_index (header->elements, BinaryElement, i);
+
+      if (strcmp (element->name, name) == 0)
+        return element;
+    }
+
+  return NULL;
+}
+
+static BinaryProperty *
+find_binary_property (BinaryElement *element, const char *name)
+{
+  int i;
+
+  for (i = 0; i < element->properties->len; i++)
+    {
+      BinaryProperty *property =
+        &g_array_index (element->properties, BinaryProperty, i);
+
+      if (strcmp (property->name, name) == 0)
+        return property;
+    }
+
+  return NULL;
+}
+
+static CoglBool
+find_binary_property_cb (const char *name,
+                         e_ply_type *type,
+                         void *user_data)
+{
+  BinaryProperty *property = find_binary_property (user_data, name);
+
+  if (!property)
+    return FALSE;
+
+  *type = property->type;
+
+  return TRUE;
+}
+
+/* Converts one property of every vertex into one component of the
+ * interleaved vertex buffer. The destination type is always the one
+ * chosen by get_attribute_type_for_ply_type() so the 8, 16 and 32-bit
+ * float types are plain copies. The type and byte order are only
+ * checked once per column rather than once per value. */
+static void
+convert_vertex_column (const uint8_t *src,
+                       size_t src_stride,
+                       uint8_t *dst,
+                       size_t dst_stride,
+                       int n_vertices,
+                       e_ply_type type,
+                       CoglBool swap)
+{
+  int i;
+
+  switch (type)
+    {
+    case PLY_INT8:
+    case PLY_UINT8:
+    case PLY_CHAR:
+    case PLY_UCHAR:
+      for (i = 0; i < n_vertices; i++, src += src_stride, dst += dst_stride)
+        *dst = *src;
+      break;
+
+    case PLY_INT16:
+    case PLY_UINT16:
+    case PLY_SHORT:
+    case PLY_USHORT:
+      if (swap)
+        for (i = 0; i < n_vertices; i++, src += src_stride, dst += dst_stride)
+          {
+            uint16_t value;
+            memcpy (&value, src, sizeof (value));
+            value = GUINT16_SWAP_LE_BE (value);
+            memcpy (dst, &value, sizeof (value));
+          }
+      else
+        for (i = 0; i < n_vertices; i++, src += src_stride, dst += dst_stride)
+          memcpy (dst, src, sizeof (uint16_t));
+      break;
+
+    case PLY_FLOAT32:
+    case PLY_FLOAT:
+      if (swap)
+        for (i = 0; i < n_vertices; i++, src += src_stride, dst += dst_stride)
+          {
+            uint32_t value;
+            memcpy (&value, src, sizeof (value));
+            value = GUINT32_SWAP_LE_BE (value);
+            memcpy (dst, &value, sizeof (value));
+          }
+      else
+        for (i = 0; i < n_vertices; i++, src += src_stride, dst += dst_stride)
+          memcpy (dst, src, sizeof (float));
+      break;
+
+    case PLY_INT32:
+    case PLY_INT:
+      for (i = 0; i < n_vertices; i++, src += src_stride, dst += dst_stride)
+        {
+          uint32_t value;
+          float result;
+          memcpy (&value, src, sizeof (value));
+          if (swap)
+            value = GUINT32_SWAP_LE_BE (value);
+          result = (int32_t) value;
+          memcpy (dst, &result, sizeof (result));
+        }
+      break;
+
+    case PLY_UIN32:
+    case PLY_UINT:
+      for (i = 0; i < n_vertices; i++, src += src_stride, dst += dst_stride)
+        {
+          uint32_t value;
+          float result;
+          memcpy (&value, src, sizeof (value));
+          if (swap)
+            value = GUINT32_SWAP_LE_BE (value);
+          result = value;
+          memcpy (dst, &result, sizeof (result));
+        }
+      break;
+
+    case PLY_FLOAT64:
+    case PLY_DOUBLE:
+      for (i = 0; i < n_vertices; i++, src += src_stride, dst += dst_stride)
+        {
+          uint64_t bits;
+          double value;
+          float result;
+          memcpy (&bits, src, sizeof (bits));
+          if (swap)
+            bits = GUINT64_SWAP_LE_BE (bits);
+          memcpy (&value, &bits, sizeof (value));
+          result = value;
+          memcpy (dst, &result, sizeof (result));
+        }
+      break;
+
+    case PLY_LIST:
+      g_warn_if_reached ();
+      break;
+    }
+}
+
+/* Reads an integer value for a list length or a face index */
+static inline uint32_t
+read_binary_uint (const uint8_t *p, e_ply_type type, CoglBool swap)
+{
+  switch (type)
+    {
+    case PLY_INT8:
+    case PLY_CHAR:
+      return (int8_t) *p;
+    case PLY_UINT8:
+    case PLY_UCHAR:
+      return *p;
+    case PLY_INT16:
+    case PLY_SHORT:
+    case PLY_UINT16:
+    case PLY_USHORT:
+      {
+        uint16_t value;
+        memcpy (&value, p, sizeof (value));
+        if (swap)
+          value = GUINT16_SWAP_LE_BE (value);
+        if (type == PLY_INT16 || type == PLY_SHORT)
+          return (int16_t) value;
+        return value;
+      }
+    case PLY_INT32:
+    case PLY_INT:
+    case PLY_UIN32:
+    case PLY_UINT:
+      {
+        uint32_t value;
+        memcpy (&value, p, sizeof (value));
+        if (swap)
+          value = GUINT32_SWAP_LE_BE (value);
+        return value;
+      }
+    default:
+      /* Floating point lengths and indices aren't sensible */
+      return G_MAXUINT32;
+    }
+}
+
+typedef struct _IndexWriter
+{
+  CoglIndicesType type;
+  int index_size;
+  uint8_t *data;
+  size_t n_indices;
+  size_t size;
+} IndexWriter;
+
+static inline void
+write_triangle (IndexWriter *writer,
+                uint32_t a,
+                uint32_t b,
+                uint32_t c)
+{
+  if (G_UNLIKELY (writer->n_indices + 3 > writer->size))
+    {
+      writer->size = MAX (writer->size * 2, 64);
+      writer->data = g_realloc (writer->data,
+                                writer->size * writer->index_size);
+    }
+
+  switch (writer->type)
+    {
+    case COGL_INDICES_TYPE_UNSIGNED_BYTE:
+      {
+        uint8_t *p = writer->data + writer->n_indices;
+        p[0] = a;
+        p[1] = b;
+        p[2] = c;
+      }
+      break;
+    case COGL_INDICES_TYPE_UNSIGNED_SHORT:
+      {
+        uint16_t *p = (uint16_t *) writer->data + writer->n_indices;
+        p[0] = a;
+        p[1] = b;
+        p[2] = c;
+      }
+      break;
+    case COGL_INDICES_TYPE_UNSIGNED_INT:
+      {
+        uint32_t *p = (uint32_t *) writer->data + writer->n_indices;
+        p[0] = a;
+        p[1] = b;
+        p[2] = c;
+      }
+      break;
+    }
+
+  writer->n_indices += 3;
+}
+
+/* Skips over the instances of an element that isn't needed. Returns
+ * NULL if the element runs past the end of the data */
+static const uint8_t *
+skip_binary_element (BinaryElement *element,
+                     const uint8_t *p,
+                     const uint8_t *end,
+                     CoglBool swap)
+{
+  int i, j;
+
+  if (!element->has_lists)
+    {
+      if ((size_t) (end - p) / MAX (element->stride, 1) <
+          (size_t) element->n_instances)
+        return NULL;
+      return p + element->stride * element->n_instances;
+    }
+
+  for (i = 0; i < element->n_instances; i++)
+    for (j = 0; j < element->properties->len; j++)
+      {
+        BinaryProperty *property =
+          &g_array_index (element->properties, BinaryProperty, j);
+
+        if (property->type == PLY_LIST)
+          {
+            int length_size = get_sizeof_ply_type (property->length_type);
+            uint32_t length;
+
+            if (end - p < length_size)
+              return NULL;
+            length = read_binary_uint (p, property->length_type, swap);
+            p += length_size;
+
+            if ((size_t) (end - p) / get_sizeof_ply_type (property->value_type) <
+                length)
+              return NULL;
+            p += (size_t) length * get_sizeof_ply_type (property->value_type);
+          }
+        else
+          {
+            int size = get_sizeof_ply_type (property->type);
+
+            if (end - p < size)
+              return NULL;
+            p += size;
+          }
+      }
+
+  return p;
+}
+
+/* Reads the vertex_indices list of every face and triangulates each
+ * polygon as a fan in the same pass. Returns NULL on error */
+static const uint8_t *
+read_binary_faces (BinaryElement *element,
+                   const uint8_t *p,
+                   const uint8_t *end,
+                   CoglBool swap,
+                   int n_vertices,
+                   IndexWriter *writer,
+                   const char *display_name,
+                   GError **error)
+{
+  int i, j;
+
+  for (i = 0; i < element->n_instances; i++)
+    for (j = 0; j < element->properties->len; j++)
+      {
+        BinaryProperty *property =
+          &g_array_index (element->properties, BinaryProperty, j);
+        int value_size;
+        int length_size;
+        uint32_t length;
+        uint32_t first_vertex = 0, last_vertex = 0;
+        uint32_t k;
+
+        if (property->type != PLY_LIST)
+          {
+            int size = get_sizeof_ply_type (property->type);
+
+            if (end - p < size)
+              goto truncated;
+            p += size;
+            continue;
+          }
+
+        length_size = get_sizeof_ply_type (property->length_type);
+        value_size = get_sizeof_ply_type (property->value_type);
+
+        if (end - p < length_size)
+          goto truncated;
+        length = read_binary_uint (p, property->length_type, swap);
+        p += length_size;
+
+        if ((size_t) (end - p) / value_size < length)
+          goto truncated;
+
+        if (strcmp (property->name, "vertex_indices") != 0)
+          {
+            p += (size_t) length * value_size;
+            continue;
+          }
+
+        for (k = 0; k < length; k++, p += value_size)
+          {
+            uint32_t vertex = read_binary_uint (p,
+                                                property->value_type,
+                                                swap);
+
+            if (vertex >= (uint32_t) n_vertices)
+              {
+                g_set_error (error, RUT_MESH_PLY_ERROR,
+                             RUT_MESH_PLY_ERROR_INVALID,
+                             "Invalid vertex index in PLY file %s",
+                             display_name);
+                return NULL;
+              }
+
+            if (k == 0)
+              first_vertex = vertex;
+            else if (k == 1)
+              last_vertex = vertex;
+            else
+              {
+                write_triangle (writer, first_vertex, last_vertex, vertex);
+                last_vertex = vertex;
+              }
+          }
+      }
+
+  return p;
+
+truncated:
+  g_set_error (error, RUT_MESH_PLY_ERROR,
+               RUT_MESH_PLY_ERROR_INVALID,
+               "Unexpected end of data in PLY file %s", display_name);
+  return NULL;
+}
+
+static BinaryPlyStatus
+load_binary_ply (CoglBool uint32_indices,
+                 const uint8_t *data,
+                 size_t len,
+                 const char *display_name,
+                 RutPLYAttribute *attributes,
+                 int n_attributes,
+                 RutPLYAttributeStatus *load_status,
+                 RutMesh **mesh_out,
+                 GError **error)
+{
+  LoaderAttribute loader_attributes[n_attributes];
+  LoaderProperty loader_properties[n_attributes *
+                                   RUT_PLY_MAX_ATTRIBUTE_PROPERTIES];
+  Loader loader;
+  BinaryHeader header;
+  BinaryElement *vertex_element, *face_element;
+  IndexWriter writer;
+  const uint8_t *p, *end = data + len;
+  RutBuffer *indices_buffer;
+  int n_loader_attributes;
+  BinaryPlyStatus status;
+  int i, j;
+
+  memset (&header, 0, sizeof (header));
+  status = parse_binary_header (data, len, &header);
+  if (status != BINARY_PLY_LOADED)
+    return status;
+
+  vertex_element = find_binary_element (&header, "vertex");
+  face_element = find_binary_element (&header, "face");
+
+  /* Let rply deal with anything unusual, including reporting any
+   * missing elements */
+  if (vertex_element == NULL || vertex_element->has_lists ||
+      face_element == NULL ||
+      find_binary_property (face_element, "vertex_indices") == NULL)
+    {
+      free_binary_header (&header);
+      return BINARY_PLY_UNSUPPORTED;
+    }
+
+  memset (&loader, 0, sizeof (loader));
+  memset (&writer, 0, sizeof (writer));
+  loader.uint32_indices = uint32_indices;
+  loader.loader_attributes = loader_attributes;
+  loader.loader_properties = loader_properties;
+
+  if (!get_indices_type (uint32_indices, vertex_element->n_instances,
+                         &writer.type, &loader.error))
+    goto EXIT;
+  loader.indices_type = writer.type;
+  writer.index_size = get_sizeof_indices_type (writer.type);
+
+  n_loader_attributes = init_loader_attributes (&loader,
+                                                find_binary_property_cb,
+                                                vertex_element,
+                                                display_name,
+                                                attributes,
+                                                n_attributes,
+                                                load_status);
+  if (n_loader_attributes < 0)
+    goto EXIT;
+
+  /* The counts come from the header so they can't be trusted to
+   * size the buffers until they have been checked against the amount
+   * of data. Every vertex needs stride bytes and every face needs at
+   * least one byte for its list length */
+  if ((size_t) vertex_element->n_instances >
+      (len - header.size) / MAX (vertex_element->stride, 1) ||
+      (size_t) face_element->n_instances > len - header.size ||
+      (size_t) vertex_element->n_instances >
+      G_MAXSIZE / MAX (loader.n_vertex_bytes, 1))
+    {
+      g_set_error (&loader.error, RUT_MESH_PLY_ERROR,
+                   RUT_MESH_PLY_ERROR_INVALID,
+                   "Unexpected end of data in PLY file %s",
+                   display_name);
+      goto EXIT;
+    }
+
+  loader.vertex_buffer =
+    rut_buffer_new ((size_t) loader.n_vertex_bytes *
+                    vertex_element->n_instances);
+
+  /* Assume the faces are mostly triangles */
+  writer.size = (size_t) face_element->n_instances * 3;
+  writer.data = g_malloc (MAX (writer.size, 1) * writer.index_size);
+
+  p = data + header.size;
+
+  for (i = 0; i < header.elements->len; i++)
+    {
+      BinaryElement *element =
+        &g_array_index (header.elements, BinaryElement, i);
+
+      if (element == vertex_element)
+        {
+          size_t n_bytes = element->stride * element->n_instances;
+          int k;
+
+          if ((size_t) (end - p) < n_bytes)
+            {
+              g_set_error (&loader.error, RUT_MESH_PLY_ERROR,
+                           RUT_MESH_PLY_ERROR_INVALID,
+                           "Unexpected end of data in PLY file %s",
+                           display_name);
+              goto EXIT;
+            }
+
+          for (j = 0; j < n_loader_attributes; j++)
+            {
+              LoaderAttribute *loader_attribute = &loader_attributes[j];
+              int component_size =
+                get_sizeof_attribute_type (loader_attribute->type);
+
+              if (loader_attribute->padding)
+                continue;
+
+              for (k = 0; k < loader_attribute->n_components; k++)
+                {
+                  int prop_num = j * RUT_PLY_MAX_ATTRIBUTE_PROPERTIES + k;
+                  BinaryProperty *property =
+                    find_binary_property (element,
+                                          loader_properties[prop_num].name);
+
+                  convert_vertex_column (p + property->offset,
+                                         element->stride,
+                                         loader.vertex_buffer->data +
+                                         loader_attribute->offset +
+                                         component_size * k,
+                                         loader.n_vertex_bytes,
+                                         element->n_instances,
+                                         property->type,
+                                         header.swap);
+                }
+            }
+
+          p += n_bytes;
+        }
+      else if (element == face_element)
+        {
+          p = read_binary_faces (element, p, end, header.swap,
+                                 vertex_element->n_instances,
+                                 &writer,
+                                 display_name,
+                                 &loader.error);
+          if (p == NULL)
+            goto EXIT;
+        }
+      else
+        {
+          p = skip_binary_element (element, p, end, header.swap);
+          if (p == NULL)
+            {
+              g_set_error (&loader.error, RUT_MESH_PLY_ERROR,
+                           RUT_MESH_PLY_ERROR_INVALID,
+                           "Unexpected end of data in PLY file %s",
+                           display_name);
+              goto EXIT;
+            }
+        }
+    }
+
+  if (writer.n_indices == 0)
+    {
+      g_set_error (&loader.error, RUT_MESH_PLY_ERROR,
+                   RUT_MESH_PLY_ERROR_INVALID,
+                   "No faces found in PLY file %s",
+                   display_name);
+      goto EXIT;
+    }
+
+  indices_buffer = rut_buffer_new (writer.n_indices * writer.index_size);
+  memcpy (indices_buffer->data, writer.data, indices_buffer->size);
+
+  *mesh_out = create_mesh (&loader,
+                           vertex_element->n_instances,
+                           n_loader_attributes,
+                           indices_buffer,
+                           writer.n_indices);
+
+  rut_refable_unref (indices_buffer);
+
+EXIT:
+
+  if (loader.error)
+    {
+      g_propagate_error (error, loader.error);
+
+      if (loader.vertex_buffer)
+        rut_refable_unref (loader.vertex_buffer);
+
+      status = BINARY_PLY_ERROR;
+    }
+
+  g_free (writer.data);
+  free_binary_header (&header);
+
+  return status;
+}
+
+static CoglBool
+has_uint32_indices (RutContext *ctx)
+{
+  return cogl_has_feature (ctx->cogl_context,
+                           COGL_FEATURE_ID_UNSIGNED_INT_INDICES);
+}
+
+RutMesh *
+rut_mesh_new_from_ply_file (const char *filename,
+                            CoglBool uint32_indices,
+                            RutPLYAttribute *attributes,
+                            int n_attributes,
+                            RutPLYAttributeStatus *load_status,
+                            GError **error)
+{
+  Loader loader;
+  p_ply ply;
+  RutMesh *mesh = NULL;
+  char *display_name;
+  GMappedFile *mapped_file;
+
+  display_name = g_filename_display_name (filename);
+
+  /* If the file can't be mapped then rply will report the error */
+  mapped_file = g_mapped_file_new (filename, FALSE, NULL);
+  if (mapped_file)
+    {
+      BinaryPlyStatus status =
+        load_binary_ply (uint32_indices,
+                         (const uint8_t *)
+                         g_mapped_file_get_contents (mapped_file),
+                         g_mapped_file_get_length (mapped_file),
+                         display_name,
+                         attributes,
+                         n_attributes,
+                         load_status,
+                         &mesh,
+                         error);
+
+      g_mapped_file_unref (mapped_file);
+
+      if (status != BINARY_PLY_UNSUPPORTED)
+        {
+          g_free (display_name);
+          return mesh;
+        }
+    }
+
+  memset (&loader, 0, sizeof (Loader));
+
+  ply = ply_open (filename, rut_mesh_ply_loader_error_cb, error);
+
+  if (!ply)
+    {
+      g_free (display_name);
+      return NULL;
+    }
+
+  mesh = _rut_mesh_new_from_p_ply (uint32_indices,
+                                   &loader,
+                                   ply,
+                                   display_name,
+                                   attributes,
+                                   n_attributes,
+                                   load_status,
+                                   error);
+
+  g_free (display_name);
+
+  return mesh;
+}
+
+RutMesh *
+rut_mesh_new_from_ply (RutContext *ctx,
+                       const char *filename,
+                       RutPLYAttribute *attributes,
+                       int n_attributes,
+                       RutPLYAttributeStatus *load_status,
+                       GError **error)
+{
+  return rut_mesh_new_from_ply_file (filename,
+                                     has_uint32_indices (ctx),
+                                     attributes,
+                                     n_attributes,
+                                     load_status,
+                                     error);
+}
+
+RutMesh *
+rut_mesh_new_from_ply_data (RutContext *ctx,
+                            const uint8_t *data,
+                            size_t len,
+                            RutPLYAttribute *attributes,
+                            int n_attributes,
+                            RutPLYAttributeStatus *load_status,
+                            GError **error)
+{
+  CoglBool uint32_indices = has_uint32_indices (ctx);
+  Loader loader;
+  p_ply ply;
+  RutMesh *mesh = NULL;
+  char *display_name;
+
+  display_name = g_strdup_printf ("<serialized asset %p>", data);
+
+  if (load_binary_ply (uint32_indices,
+                       data,
+                       len,
+                       display_name,
+                       attributes,
+                       n_attributes,
+                       load_status,
+                       &mesh,
+                       error) != BINARY_PLY_UNSUPPORTED)
+    {
+      g_free (display_name);
+      return mesh;
+    }
+
+  memset (&loader, 0, sizeof (Loader));
+
+  ply = ply_start (data, len, rut_mesh_ply_loader_error_cb, error);
+
+  if (!ply)
+    {
+      g_free (display_name);
+      return NULL;
+    }
 
-  mesh = _rut_mesh_new_from_p_ply (ctx,
+  mesh = _rut_mesh_new_from_p_ply (uint32_indices,
                                    &loader,
                                    ply,
                                    display_name,
@@ -100,6 +100,18 @@ rut_mesh_new_from_ply (RutContext *ctx,
                        RutPLYAttributeStatus *attribute_status_out,
                        GError **error);
 
+/* This is the same as rut_mesh_new_from_ply() except that it doesn't
+ * use Cogl so it can be called from any thread. @uint32_indices
+ * should be whether COGL_FEATURE_ID_UNSIGNED_INT_INDICES is
+ * available, checked on the thread that owns the Cogl context. */
+RutMesh *
+rut_mesh_new_from_ply_file (const char *filename,
+                            CoglBool uint32_indices,
+                            RutPLYAttribute *attributes,
+                            int n_attributes,
+                            RutPLYAttributeStatus *load_status,
+                            GError **error);
+
 RutMesh *
 rut_mesh_new_from_ply_data (RutContext *ctx,
                             const uint8_t *data,
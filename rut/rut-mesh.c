@@ -21,6 +21,7 @@
 #include <config.h>
 
 #include "rut-mesh.h"
+#include "rut-mesh-bvh.h"
 #include "rut-interfaces.h"
 
 static void
@@ -28,7 +29,11 @@ _rut_buffer_free (void *object)
 {
   RutBuffer *buffer = object;
 
-  g_free (buffer->data);
+  if (buffer->mapped_file)
+    g_mapped_file_unref (buffer->mapped_file);
+  else
+    g_free (buffer->data);
+
   g_slice_free (RutBuffer, buffer);
 }
 
@@ -61,6 +66,30 @@ rut_buffer_new (size_t buffer_size)
 
   buffer->size = buffer_size;
   buffer->data = g_malloc (buffer_size);
+  buffer->mapped_file = NULL;
+
+  return buffer;
+}
+
+RutBuffer *
+rut_buffer_new_for_mapped_file (GMappedFile *mapped_file,
+                                size_t offset,
+                                size_t size)
+{
+  RutBuffer *buffer;
+
+  g_return_val_if_fail (offset + size <=
+                        g_mapped_file_get_length (mapped_file), NULL);
+
+  buffer = g_slice_new (RutBuffer);
+
+  rut_object_init (&buffer->_parent, &rut_buffer_type);
+
+  buffer->ref_count = 1;
+
+  buffer->size = size;
+  buffer->data = (uint8_t *) g_mapped_file_get_contents (mapped_file) + offset;
+  buffer->mapped_file = g_mapped_file_ref (mapped_file);
 
   return buffer;
 }
@@ -122,6 +151,10 @@ _rut_mesh_free (RutMesh *mesh)
     rut_refable_unref (mesh->attributes[i]);
 
   g_slice_free1 (mesh->n_attributes * sizeof (void *), mesh->attributes);
+
+  if (mesh->bvh)
+    rut_mesh_bvh_free (mesh->bvh);
+
   g_slice_free (RutMesh, mesh);
 }
 
@@ -277,6 +310,13 @@ rut_mesh_set_indices (RutMesh *mesh,
   mesh->indices_buffer = rut_refable_ref (buffer);
   mesh->indices_type = type;
   mesh->n_indices = n_indices;
+
+  /* The triangles have changed so any picking hierarchy is stale */
+  if (mesh->bvh)
+    {
+      rut_mesh_bvh_free (mesh->bvh);
+      mesh->bvh = NULL;
+    }
 }
 
 static void
@@ -751,3 +791,63 @@ rut_mesh_find_attribute (RutMesh *mesh,
     }
   return NULL;
 }
+
+typedef struct _MeasureBoundsState
+{
+  RutMeshBounds *bounds;
+  int n_components;
+} MeasureBoundsState;
+
+static CoglBool
+measure_bounds_cb (void **attribute_data,
+                   int vertex_index,
+                   void *user_data)
+{
+  MeasureBoundsState *state = user_data;
+  RutMeshBounds *bounds = state->bounds;
+  float *pos = attribute_data[0];
+  int i;
+
+  for (i = 0; i < state->n_components; i++)
+    {
+      if (pos[i] < bounds->min[i])
+        bounds->min[i] = pos[i];
+      if (pos[i] > bounds->max[i])
+        bounds->max[i] = pos[i];
+    }
+
+  return TRUE;
+}
+
+void
+rut_mesh_get_bounds (RutMesh *mesh,
+                     RutMeshBounds *bounds)
+{
+  RutAttribute *attribute =
+    rut_mesh_find_attribute (mesh, "cogl_position_in");
+  MeasureBoundsState state;
+  int i;
+
+  g_return_if_fail (attribute != NULL);
+  g_return_if_fail (attribute->type == RUT_ATTRIBUTE_TYPE_FLOAT);
+
+  state.bounds = bounds;
+  state.n_components = MIN (attribute->n_components, 3);
+
+  for (i = 0; i < 3; i++)
+    {
+      if (i < state.n_components)
+        {
+          bounds->min[i] = G_MAXFLOAT;
+          bounds->max[i] = -G_MAXFLOAT;
+        }
+      else
+        bounds->min[i] = bounds->max[i] = 0;
+    }
+
+  rut_mesh_foreach_vertex (mesh,
+                           measure_bounds_cb,
+                           &state,
+                           "cogl_position_in",
+                           NULL);
+}
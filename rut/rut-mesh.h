@@ -65,6 +65,11 @@ struct _RutBuffer
 
   uint8_t *data;
   size_t size;
+
+  /* If the data points into a mapped file then this holds a
+   * reference on the file instead of the data being owned by the
+   * buffer. Mapped data is read-only. */
+  GMappedFile *mapped_file;
 };
 
 typedef struct _RutAttribute
@@ -85,6 +90,14 @@ typedef struct _RutMesh RutMesh;
 #define RUT_MESH(X) ((RutMesh *)X)
 extern RutType rut_mesh_type;
 
+typedef struct _RutMeshBVH RutMeshBVH;
+
+typedef struct _RutMeshBounds
+{
+  float min[3];
+  float max[3];
+} RutMeshBounds;
+
 /* This kind of mesh is optimized for size and use by a GPU */
 struct _RutMesh
 {
@@ -106,6 +119,10 @@ struct _RutMesh
   CoglIndicesType indices_type;
   int n_indices;
   RutBuffer *indices_buffer;
+
+  /* A hierarchy of the triangle bounds used to accelerate picking.
+   * This is created lazily by rut_util_intersect_mesh() */
+  RutMeshBVH *bvh;
 };
 
 void
@@ -114,6 +131,11 @@ _rut_buffer_init_type (void);
 RutBuffer *
 rut_buffer_new (size_t buffer_size);
 
+RutBuffer *
+rut_buffer_new_for_mapped_file (GMappedFile *mapped_file,
+                                size_t offset,
+                                size_t size);
+
 void
 _rut_attribute_init_type (void);
 
@@ -196,4 +218,10 @@ rut_mesh_foreach_triangle (RutMesh *mesh,
                            const char *first_attribute,
                            ...) G_GNUC_NULL_TERMINATED;
 
+/* Measures the axis aligned bounds of the "cogl_position_in"
+ * attribute. Missing y or z components are treated as 0. */
+void
+rut_mesh_get_bounds (RutMesh *mesh,
+                     RutMeshBounds *bounds);
+
 #endif /* _RUT_MESH_H_ */
@@ -709,10 +709,29 @@ rut_number_slider_input_cb (RutInputEvent *event,
 
   /* If the cursor has at least a pixel since it was clicked then will
    * mark the button as a drag event so that we don't intepret it as a
-   * click when the button is released */
+   * click when the button is released. The positions of any motion
+   * events that were compressed into this one are checked too in case
+   * the cursor moved away and came back within a frame */
   if (fabsf (x - slider->button_x) >= 1.0f ||
       fabsf (y - slider->button_y) >= 1.0f)
     slider->button_drag = TRUE;
+  else
+    {
+      int n_history = rut_motion_event_get_n_history (event);
+      int i;
+
+      for (i = 0; i < n_history && !slider->button_drag; i++)
+        {
+          float history_x, history_y;
+
+          rut_motion_event_get_history_xy (event, i,
+                                           &history_x, &history_y);
+
+          if (fabsf (history_x - slider->button_x) >= 1.0f ||
+              fabsf (history_y - slider->button_y) >= 1.0f)
+            slider->button_drag = TRUE;
+        }
+    }
 
   /* Update the value based on the position if we're in a drag */
   if (slider->button_drag)
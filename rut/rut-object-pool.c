@@ -0,0 +1,149 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "rut-object-pool.h"
+
+/* All of the pools that have been initialized so we can report
+ * statistics */
+static RutList pools = { &pools, &pools };
+
+static void
+rut_object_pool_init (RutObjectPool *pool)
+{
+  size_t size = MAX (pool->object_size, sizeof (void *));
+
+  pool->object_size = ((size + RUT_OBJECT_POOL_SIZE_CLASS - 1) /
+                       RUT_OBJECT_POOL_SIZE_CLASS *
+                       RUT_OBJECT_POOL_SIZE_CLASS);
+
+  rut_list_insert (pools.prev, &pool->link);
+
+  pool->initialized = TRUE;
+}
+
+static void
+rut_object_pool_add_chunk (RutObjectPool *pool)
+{
+  size_t chunk_size = MAX (RUT_OBJECT_POOL_CHUNK_SIZE, pool->object_size);
+  uint8_t *chunk;
+  uintptr_t aligned;
+
+  /* Over-allocate so the start of the chunk can be aligned to a cache
+   * line. The unaligned pointer is what gets remembered */
+  chunk = g_malloc (chunk_size + RUT_OBJECT_POOL_CHUNK_ALIGNMENT - 1);
+  pool->chunks = g_slist_prepend (pool->chunks, chunk);
+
+  aligned = (((uintptr_t) chunk + RUT_OBJECT_POOL_CHUNK_ALIGNMENT - 1) &
+             ~(uintptr_t) (RUT_OBJECT_POOL_CHUNK_ALIGNMENT - 1));
+
+  pool->chunk_pos = (uint8_t *) aligned;
+  pool->chunk_end = pool->chunk_pos + chunk_size;
+  pool->n_reserved += chunk_size / pool->object_size;
+}
+
+void *
+rut_object_pool_alloc (RutObjectPool *pool)
+{
+  void *object;
+
+  if (G_UNLIKELY (!pool->initialized))
+    rut_object_pool_init (pool);
+
+  pool->n_live++;
+
+  if (pool->free_list)
+    {
+      object = pool->free_list;
+      pool->free_list = *(void **) object;
+      return object;
+    }
+
+  if (G_UNLIKELY (pool->chunk_end - pool->chunk_pos <
+                  (ptrdiff_t) pool->object_size))
+    rut_object_pool_add_chunk (pool);
+
+  object = pool->chunk_pos;
+  pool->chunk_pos += pool->object_size;
+
+  return object;
+}
+
+void *
+rut_object_pool_alloc0 (RutObjectPool *pool)
+{
+  void *object = rut_object_pool_alloc (pool);
+
+  memset (object, 0, pool->object_size);
+
+  return object;
+}
+
+void
+rut_object_pool_free (RutObjectPool *pool,
+                      void *object)
+{
+  if (object == NULL)
+    return;
+
+  *(void **) object = pool->free_list;
+  pool->free_list = object;
+
+  pool->n_live--;
+}
+
+void
+rut_object_pool_foreach (RutObjectPoolForeachCallback callback,
+                         void *user_data)
+{
+  RutObjectPool *pool;
+
+  rut_list_for_each (pool, &pools, link)
+    callback (pool, user_data);
+}
+
+const char *
+rut_object_pool_get_name (RutObjectPool *pool)
+{
+  return pool->name;
+}
+
+size_t
+rut_object_pool_get_n_live (RutObjectPool *pool)
+{
+  return pool->n_live;
+}
+
+size_t
+rut_object_pool_get_live_bytes (RutObjectPool *pool)
+{
+  return pool->n_live * pool->object_size;
+}
+
+size_t
+rut_object_pool_get_reserved_bytes (RutObjectPool *pool)
+{
+  return pool->n_reserved * pool->object_size;
+}
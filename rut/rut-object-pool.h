@@ -0,0 +1,130 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RUT_OBJECT_POOL_H_
+#define _RUT_OBJECT_POOL_H_
+
+#include <stdint.h>
+
+#include <glib.h>
+
+#include <cogl/cogl.h>
+
+#include "rut-list.h"
+
+G_BEGIN_DECLS
+
+/*
+ * RutObjectPool is a free list allocator for objects of a single
+ * type that are created and destroyed in large numbers, such as
+ * entities, components and transition nodes.
+ *
+ * Object sizes are rounded up to a multiple of
+ * RUT_OBJECT_POOL_SIZE_CLASS and the objects are carved out of large
+ * cache line aligned chunks. Freed objects go on a per-type free list
+ * to be reused by the next allocation so scenes that are torn down and
+ * rebuilt keep reusing the same memory. Chunks are never given back.
+ *
+ * Pools are normally declared statically next to the type they
+ * allocate:
+ *
+ * |[
+ *   static RutObjectPool entity_pool =
+ *     RUT_OBJECT_POOL_INIT ("RutEntity", RutEntity);
+ *
+ *   entity = rut_object_pool_alloc0 (&entity_pool);
+ *   ...
+ *   rut_object_pool_free (&entity_pool, entity);
+ * ]|
+ *
+ * Pools aren't thread safe so they should only be used for objects
+ * that are created and destroyed on the main thread.
+ */
+
+#define RUT_OBJECT_POOL_SIZE_CLASS 16
+#define RUT_OBJECT_POOL_CHUNK_SIZE (64 * 1024)
+#define RUT_OBJECT_POOL_CHUNK_ALIGNMENT 64
+
+typedef struct _RutObjectPool
+{
+  /* These are set by RUT_OBJECT_POOL_INIT */
+  const char *name;
+  size_t object_size;
+
+  /* The rest is initialized on the first allocation */
+  CoglBool initialized;
+  RutList link;
+
+  void *free_list;
+  uint8_t *chunk_pos;
+  uint8_t *chunk_end;
+  GSList *chunks;
+
+  size_t n_live;
+  size_t n_reserved;
+} RutObjectPool;
+
+#define RUT_OBJECT_POOL_INIT(NAME, TYPE) { (NAME), sizeof (TYPE) }
+
+void *
+rut_object_pool_alloc (RutObjectPool *pool);
+
+void *
+rut_object_pool_alloc0 (RutObjectPool *pool);
+
+void
+rut_object_pool_free (RutObjectPool *pool,
+                      void *object);
+
+typedef void (*RutObjectPoolForeachCallback) (RutObjectPool *pool,
+                                              void *user_data);
+
+/**
+ * rut_object_pool_foreach:
+ * @callback: Function to call for each pool
+ * @user_data: Data to pass to @callback
+ *
+ * Iterates all the pools that have made any allocations so far. This
+ * can be used to report the memory used per type along with
+ * rut_object_pool_get_live_bytes().
+ */
+void
+rut_object_pool_foreach (RutObjectPoolForeachCallback callback,
+                         void *user_data);
+
+const char *
+rut_object_pool_get_name (RutObjectPool *pool);
+
+/* The number of objects that are currently allocated */
+size_t
+rut_object_pool_get_n_live (RutObjectPool *pool);
+
+/* The number of bytes used by objects that are currently allocated */
+size_t
+rut_object_pool_get_live_bytes (RutObjectPool *pool);
+
+/* The number of bytes of chunks that have been set aside for the
+ * objects, including objects on the free list */
+size_t
+rut_object_pool_get_reserved_bytes (RutObjectPool *pool);
+
+G_END_DECLS
+
+#endif /* _RUT_OBJECT_POOL_H_ */
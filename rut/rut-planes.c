@@ -112,7 +112,6 @@ rut_get_eye_planes_for_screen_poly (float *polygon,
   cogl_vector3_cross_product (&plane->n, &b, &c);
   cogl_vector3_normalize (&plane->n);
 #endif
-  float Wc;
   Vector4 *tmp_poly;
   RutPlane *plane;
   int i;
@@ -122,50 +121,34 @@ rut_get_eye_planes_for_screen_poly (float *polygon,
 
   tmp_poly = g_alloca (sizeof (Vector4) * n_vertices * 2);
 
-#define DEPTH -50
-
-  /* Determine W in clip-space (Wc) for a point (0, 0, DEPTH, 1)
-   *
-   * Note: the depth could be anything except 0.
+  /* We define the clip planes by triangles that extend between the
+   * points of the polygon on the near plane and the corresponding
+   * points on the far plane. We map the polygon into normalized
+   * device coordinates at both depths and then unproject those into
+   * eye coordinates.
    *
-   * We will transform the polygon into clip coordinates using this
-   * depth and then into eye coordinates. Our clip planes will be
-   * defined by triangles that extend between points of the polygon at
-   * DEPTH and corresponding points of the same polygon at DEPTH * 2.
-   *
-   * NB: Wc defines the position of the clip planes in clip
-   * coordinates. Given a screen aligned cross section through the
-   * frustum; coordinates range from [-Wc,Wc] left to right on the
-   * x-axis and [Wc,-Wc] top to bottom on the y-axis.
+   * NB: Unlike unprojecting at an arbitrary clip-space depth this
+   * works for orthographic projections as well as perspective
+   * projections since we divide through by w afterwards.
    */
-  Wc = DEPTH * projection->wz + projection->ww;
-
-#define CLIP_X(X) ((((float)X - viewport[0]) * (2.0 / viewport[2])) - 1) * Wc
-#define CLIP_Y(Y) ((((float)Y - viewport[1]) * (2.0 / viewport[3])) - 1) * -Wc
+#define NDC_X(X) ((((float)X - viewport[0]) * (2.0 / viewport[2])) - 1)
+#define NDC_Y(Y) ((((float)Y - viewport[1]) * (2.0 / viewport[3])) - 1) * -1
 
   for (i = 0; i < n_vertices; i++)
     {
-      tmp_poly[i].x = CLIP_X (polygon[i * 2]);
-      tmp_poly[i].y = CLIP_Y (polygon[i * 2 + 1]);
-      tmp_poly[i].z = DEPTH;
-      tmp_poly[i].w = Wc;
+      tmp_poly[i].x = NDC_X (polygon[i * 2]);
+      tmp_poly[i].y = NDC_Y (polygon[i * 2 + 1]);
+      tmp_poly[i].z = -1;
+      tmp_poly[i].w = 1;
+
+      tmp_poly[n_vertices + i].x = tmp_poly[i].x;
+      tmp_poly[n_vertices + i].y = tmp_poly[i].y;
+      tmp_poly[n_vertices + i].z = 1;
+      tmp_poly[n_vertices + i].w = 1;
     }
 
-  Wc = DEPTH * 2 * projection->wz + projection->ww;
-
-  /* FIXME: technically we don't need to project all of the points
-   * twice, it would be enough project every other point since
-   * we can share points in this set to define the plane vectors. */
-  for (i = 0; i < n_vertices; i++)
-    {
-      tmp_poly[n_vertices + i].x = CLIP_X (polygon[i * 2]);
-      tmp_poly[n_vertices + i].y = CLIP_Y (polygon[i * 2 + 1]);
-      tmp_poly[n_vertices + i].z = DEPTH * 2;
-      tmp_poly[n_vertices + i].w = Wc;
-    }
-
-#undef CLIP_X
-#undef CLIP_Y
+#undef NDC_X
+#undef NDC_Y
 
   cogl_matrix_project_points (inverse_project,
                               4,
@@ -175,10 +158,12 @@ rut_get_eye_planes_for_screen_poly (float *polygon,
                               tmp_poly,
                               n_vertices * 2);
 
-  /* XXX: It's quite ugly that we end up with these casts between
-   * Vector4 types and CoglVector3s, it might be better if the
-   * cogl_vector APIs just took pointers to floats.
-   */
+  for (i = 0; i < n_vertices * 2; i++)
+    {
+      tmp_poly[i].x /= tmp_poly[i].w;
+      tmp_poly[i].y /= tmp_poly[i].w;
+      tmp_poly[i].z /= tmp_poly[i].w;
+    }
 
   count = n_vertices - 1;
   for (i = 0; i < count; i++)
@@ -194,12 +179,11 @@ rut_get_eye_planes_for_screen_poly (float *polygon,
     }
 
   plane = &planes[n_vertices - 1];
-  memcpy (plane->v0, tmp_poly + 0, sizeof (float) * 3);
+  memcpy (plane->v0, tmp_poly + n_vertices - 1, sizeof (float) * 3);
   memcpy (b, tmp_poly + (2 * n_vertices - 1), sizeof (float) * 3);
   memcpy (c, tmp_poly + n_vertices, sizeof (float) * 3);
   cogl_vector3_subtract (b, b, plane->v0);
   cogl_vector3_subtract (c, c, plane->v0);
   cogl_vector3_cross_product (plane->n, b, c);
   cogl_vector3_normalize (plane->n);
-
 }
@@ -0,0 +1,578 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef RUT_ENABLE_PROFILE
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rut-profile.h"
+#include "rut-list.h"
+
+typedef enum
+{
+  RUT_PROFILE_EVENT_BEGIN,
+  RUT_PROFILE_EVENT_END
+} RutProfileEventType;
+
+/* Only recorded when writing a trace */
+typedef struct
+{
+  int64_t timestamp;
+  int timer;
+  RutProfileEventType type;
+} RutProfileEvent;
+
+typedef struct
+{
+  /* The timers can be nested recursively, e.g. when traversing a
+   * graph from a traversal callback, so only the outermost start and
+   * stop is counted */
+  int depth;
+  int64_t start;
+
+  int64_t total;
+  int n_calls;
+} RutProfileTimerState;
+
+/* Each thread records into its own buffer so that the only locking
+ * needed is an uncontended mutex which is only contended while a
+ * frame is being collected */
+typedef struct
+{
+  RutList link;
+
+  GMutex lock;
+
+  int id;
+
+  /* This is set when the thread exits so that the buffer can be freed
+   * after it has been collected for the last time */
+  CoglBool dead;
+
+  /* Indexed by the counter index. Each value is the change since the
+   * last frame */
+  GArray *counters;
+
+  /* Array of RutProfileTimerStates indexed by the timer index */
+  GArray *timers;
+
+  GArray *events;
+} RutProfileThread;
+
+typedef struct
+{
+  /* Protects everything in this struct and the list of threads. The
+   * thread buffers are protected by their own lock */
+  GMutex lock;
+
+  RutList threads;
+  int next_thread_id;
+
+  GPtrArray *counters;
+  GPtrArray *timers;
+
+  /* Totals for the frame being reported */
+  int64_t *counter_totals;
+  RutProfileTimerState *timer_totals;
+
+  CoglBool report;
+
+  FILE *trace_file;
+  CoglBool trace_started;
+
+  int64_t epoch;
+  int64_t frame_start;
+  int frame_number;
+} RutProfileState;
+
+CoglBool _rut_profile_enabled = FALSE;
+
+static RutProfileState profile_state;
+
+static void
+thread_destroy_cb (void *data);
+
+static GPrivate thread_private = G_PRIVATE_INIT (thread_destroy_cb);
+
+static void
+thread_destroy_cb (void *data)
+{
+  RutProfileThread *thread = data;
+
+  g_mutex_lock (&thread->lock);
+  thread->dead = TRUE;
+  g_mutex_unlock (&thread->lock);
+}
+
+static void
+free_thread (RutProfileThread *thread)
+{
+  g_array_free (thread->counters, TRUE);
+  g_array_free (thread->timers, TRUE);
+  g_array_free (thread->events, TRUE);
+  g_mutex_clear (&thread->lock);
+  g_slice_free (RutProfileThread, thread);
+}
+
+static RutProfileThread *
+get_thread (void)
+{
+  RutProfileThread *thread = g_private_get (&thread_private);
+
+  if (G_UNLIKELY (thread == NULL))
+    {
+      RutProfileState *state = &profile_state;
+
+      thread = g_slice_new0 (RutProfileThread);
+      g_mutex_init (&thread->lock);
+      thread->counters = g_array_new (FALSE, TRUE, sizeof (int64_t));
+      thread->timers = g_array_new (FALSE, TRUE,
+                                    sizeof (RutProfileTimerState));
+      thread->events = g_array_new (FALSE, FALSE, sizeof (RutProfileEvent));
+
+      g_mutex_lock (&state->lock);
+      thread->id = state->next_thread_id++;
+      rut_list_insert (state->threads.prev, &thread->link);
+      g_mutex_unlock (&state->lock);
+
+      g_private_set (&thread_private, thread);
+    }
+
+  return thread;
+}
+
+static void
+register_counter (RutProfileCounter *counter)
+{
+  RutProfileState *state = &profile_state;
+
+  g_mutex_lock (&state->lock);
+
+  /* Another thread may have registered the counter while we were
+   * waiting for the lock */
+  if (counter->index == -1)
+    {
+      counter->index = state->counters->len;
+      g_ptr_array_add (state->counters, counter);
+      state->counter_totals = g_renew (int64_t,
+                                       state->counter_totals,
+                                       state->counters->len);
+    }
+
+  g_mutex_unlock (&state->lock);
+}
+
+static void
+register_timer (RutProfileTimer *timer)
+{
+  RutProfileState *state = &profile_state;
+
+  g_mutex_lock (&state->lock);
+
+  if (timer->index == -1)
+    {
+      timer->index = state->timers->len;
+      g_ptr_array_add (state->timers, timer);
+      state->timer_totals = g_renew (RutProfileTimerState,
+                                     state->timer_totals,
+                                     state->timers->len);
+    }
+
+  g_mutex_unlock (&state->lock);
+}
+
+static RutProfileTimerState *
+get_timer_state (RutProfileThread *thread,
+                 int index)
+{
+  if (index >= thread->timers->len)
+    g_array_set_size (thread->timers, index + 1);
+
+  return &g_array_index (thread->timers, RutProfileTimerState, index);
+}
+
+void
+_rut_profile_counter_add (RutProfileCounter *counter,
+                          int value)
+{
+  RutProfileThread *thread = get_thread ();
+
+  if (G_UNLIKELY (counter->index == -1))
+    register_counter (counter);
+
+  g_mutex_lock (&thread->lock);
+
+  if (counter->index >= thread->counters->len)
+    g_array_set_size (thread->counters, counter->index + 1);
+
+  g_array_index (thread->counters, int64_t, counter->index) += value;
+
+  g_mutex_unlock (&thread->lock);
+}
+
+static void
+add_event (RutProfileThread *thread,
+           RutProfileTimer *timer,
+           RutProfileEventType type,
+           int64_t timestamp)
+{
+  RutProfileEvent *event;
+
+  g_array_set_size (thread->events, thread->events->len + 1);
+  event = &g_array_index (thread->events,
+                          RutProfileEvent,
+                          thread->events->len - 1);
+  event->timestamp = timestamp;
+  event->timer = timer->index;
+  event->type = type;
+}
+
+void
+_rut_profile_timer_start (RutProfileTimer *timer)
+{
+  RutProfileThread *thread = get_thread ();
+  int64_t now = g_get_monotonic_time ();
+  RutProfileTimerState *timer_state;
+
+  if (G_UNLIKELY (timer->index == -1))
+    register_timer (timer);
+
+  g_mutex_lock (&thread->lock);
+
+  timer_state = get_timer_state (thread, timer->index);
+  if (timer_state->depth++ == 0)
+    timer_state->start = now;
+
+  if (profile_state.trace_file)
+    add_event (thread, timer, RUT_PROFILE_EVENT_BEGIN, now);
+
+  g_mutex_unlock (&thread->lock);
+}
+
+void
+_rut_profile_timer_stop (RutProfileTimer *timer)
+{
+  RutProfileThread *thread = get_thread ();
+  int64_t now = g_get_monotonic_time ();
+  RutProfileTimerState *timer_state;
+
+  if (G_UNLIKELY (timer->index == -1))
+    register_timer (timer);
+
+  g_mutex_lock (&thread->lock);
+
+  timer_state = get_timer_state (thread, timer->index);
+
+  if (timer_state->depth <= 0)
+    g_warning ("Timer \"%s\" stopped without being started", timer->name);
+  else if (--timer_state->depth == 0)
+    {
+      timer_state->total += now - timer_state->start;
+      timer_state->n_calls++;
+    }
+
+  if (profile_state.trace_file)
+    add_event (thread, timer, RUT_PROFILE_EVENT_END, now);
+
+  g_mutex_unlock (&thread->lock);
+}
+
+static void
+begin_trace_event (RutProfileState *state)
+{
+  if (state->trace_started)
+    fputs (",\n", state->trace_file);
+  else
+    {
+      fputs ("[\n", state->trace_file);
+      state->trace_started = TRUE;
+    }
+}
+
+static void
+write_thread_events (RutProfileState *state,
+                     RutProfileThread *thread)
+{
+  int i;
+
+  for (i = 0; i < thread->events->len; i++)
+    {
+      RutProfileEvent *event =
+        &g_array_index (thread->events, RutProfileEvent, i);
+      RutProfileTimer *timer = g_ptr_array_index (state->timers, event->timer);
+
+      begin_trace_event (state);
+      fprintf (state->trace_file,
+               "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+               "\"pid\":1,\"tid\":%i,\"ts\":%" G_GINT64_FORMAT "}",
+               timer->name,
+               timer->parent_name ? timer->parent_name : "rut",
+               event->type == RUT_PROFILE_EVENT_BEGIN ? 'B' : 'E',
+               thread->id,
+               event->timestamp - state->epoch);
+    }
+}
+
+static void
+write_counters (RutProfileState *state,
+                int64_t timestamp)
+{
+  int i;
+
+  if (state->counters->len == 0)
+    return;
+
+  begin_trace_event (state);
+  fprintf (state->trace_file,
+           "{\"name\":\"Counters\",\"ph\":\"C\",\"pid\":1,"
+           "\"ts\":%" G_GINT64_FORMAT ",\"args\":{",
+           timestamp - state->epoch);
+
+  for (i = 0; i < state->counters->len; i++)
+    {
+      RutProfileCounter *counter = g_ptr_array_index (state->counters, i);
+
+      fprintf (state->trace_file,
+               "%s\"%s\":%" G_GINT64_FORMAT,
+               i > 0 ? "," : "",
+               counter->name,
+               state->counter_totals[i]);
+    }
+
+  fputs ("}}", state->trace_file);
+}
+
+static void
+collect_thread (RutProfileState *state,
+                RutProfileThread *thread)
+{
+  int i;
+
+  for (i = 0; i < thread->counters->len; i++)
+    {
+      state->counter_totals[i] +=
+        g_array_index (thread->counters, int64_t, i);
+      g_array_index (thread->counters, int64_t, i) = 0;
+    }
+
+  for (i = 0; i < thread->timers->len; i++)
+    {
+      RutProfileTimerState *timer_state =
+        &g_array_index (thread->timers, RutProfileTimerState, i);
+
+      state->timer_totals[i].total += timer_state->total;
+      state->timer_totals[i].n_calls += timer_state->n_calls;
+      timer_state->total = 0;
+      timer_state->n_calls = 0;
+    }
+
+  if (state->trace_file)
+    write_thread_events (state, thread);
+  g_array_set_size (thread->events, 0);
+}
+
+static RutProfileTimer *
+find_timer (RutProfileState *state,
+            const char *name)
+{
+  int i;
+
+  if (name == NULL)
+    return NULL;
+
+  for (i = 0; i < state->timers->len; i++)
+    {
+      RutProfileTimer *timer = g_ptr_array_index (state->timers, i);
+
+      if (strcmp (timer->name, name) == 0)
+        return timer;
+    }
+
+  return NULL;
+}
+
+static void
+print_timers (RutProfileState *state,
+              RutProfileTimer *parent,
+              int depth)
+{
+  int i;
+
+  /* Guard against timers that name each other as parents */
+  if (depth > 16)
+    return;
+
+  for (i = 0; i < state->timers->len; i++)
+    {
+      RutProfileTimer *timer = g_ptr_array_index (state->timers, i);
+      RutProfileTimerState *total = state->timer_totals + i;
+
+      if (find_timer (state, timer->parent_name) != parent)
+        continue;
+
+      if (total->n_calls > 0)
+        g_print ("  %*s%-*s %9.3fms %6i call%s\n",
+                 depth * 2, "",
+                 40 - depth * 2, timer->name,
+                 total->total / 1000.0,
+                 total->n_calls,
+                 total->n_calls == 1 ? "" : "s");
+
+      print_timers (state, timer, depth + 1);
+    }
+}
+
+static void
+print_report (RutProfileState *state,
+              int64_t frame_time)
+{
+  int i;
+
+  g_print ("Frame %i (%.3fms)\n",
+           state->frame_number,
+           frame_time / 1000.0);
+
+  print_timers (state, NULL, 0);
+
+  for (i = 0; i < state->counters->len; i++)
+    {
+      RutProfileCounter *counter = g_ptr_array_index (state->counters, i);
+
+      if (state->counter_totals[i])
+        g_print ("  %-40s %11" G_GINT64_FORMAT "\n",
+                 counter->name,
+                 state->counter_totals[i]);
+    }
+}
+
+void
+rut_profile_end_frame (void)
+{
+  RutProfileState *state = &profile_state;
+  RutProfileThread *thread, *tmp;
+  int64_t now;
+
+  if (!_rut_profile_enabled)
+    return;
+
+  now = g_get_monotonic_time ();
+
+  g_mutex_lock (&state->lock);
+
+  memset (state->counter_totals, 0,
+          sizeof (int64_t) * state->counters->len);
+  memset (state->timer_totals, 0,
+          sizeof (RutProfileTimerState) * state->timers->len);
+
+  rut_list_for_each_safe (thread, tmp, &state->threads, link)
+    {
+      CoglBool dead;
+
+      g_mutex_lock (&thread->lock);
+      collect_thread (state, thread);
+      dead = thread->dead;
+      g_mutex_unlock (&thread->lock);
+
+      if (dead)
+        {
+          rut_list_remove (&thread->link);
+          free_thread (thread);
+        }
+    }
+
+  if (state->report)
+    print_report (state, now - state->frame_start);
+
+  if (state->trace_file)
+    {
+      write_counters (state, now);
+      fflush (state->trace_file);
+    }
+
+  state->frame_start = now;
+  state->frame_number++;
+
+  g_mutex_unlock (&state->lock);
+}
+
+static void
+atexit_cb (void)
+{
+  RutProfileState *state = &profile_state;
+
+  rut_profile_end_frame ();
+
+  if (state->trace_file)
+    {
+      if (state->trace_started)
+        fputs ("\n]\n", state->trace_file);
+      fclose (state->trace_file);
+      state->trace_file = NULL;
+    }
+}
+
+void
+_rut_profile_init (void)
+{
+  RutProfileState *state = &profile_state;
+  const char *mode = g_getenv ("RUT_PROFILE");
+  const char *trace_filename = g_getenv ("RUT_PROFILE_TRACE");
+  static CoglBool initialized = FALSE;
+
+  if (initialized)
+    return;
+  initialized = TRUE;
+
+  g_mutex_init (&state->lock);
+  rut_list_init (&state->threads);
+  state->counters = g_ptr_array_new ();
+  state->timers = g_ptr_array_new ();
+
+  state->epoch = g_get_monotonic_time ();
+  state->frame_start = state->epoch;
+
+  if (mode && strcmp (mode, "report") == 0)
+    state->report = TRUE;
+  else if (mode)
+    g_warning ("Unknown RUT_PROFILE mode \"%s\"", mode);
+
+  if (trace_filename)
+    {
+      state->trace_file = fopen (trace_filename, "w");
+      if (state->trace_file == NULL)
+        g_warning ("Failed to open %s for writing", trace_filename);
+    }
+
+  if (state->report || state->trace_file)
+    {
+      _rut_profile_enabled = TRUE;
+      atexit (atexit_cb);
+    }
+}
+
+#endif /* RUT_ENABLE_PROFILE */
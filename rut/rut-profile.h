@@ -0,0 +1,145 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _RUT_PROFILE_H_
+#define _RUT_PROFILE_H_
+
+#include <glib.h>
+
+#include <cogl/cogl.h>
+
+/*
+ * Named counters and nested timers for finding out where the time in
+ * a frame goes. These are only compiled in when configured with
+ * --enable-profile. Even then nothing is recorded unless one of these
+ * environment variables is set:
+ *
+ *   RUT_PROFILE=report      Print a report of each frame to stdout
+ *   RUT_PROFILE_TRACE=FILE  Write the timers to FILE in the Chrome
+ *                           trace event format (load it in
+ *                           chrome://tracing)
+ *
+ * Counters and timers are declared statically where they are used:
+ *
+ *   RUT_STATIC_TIMER (layout_timer,
+ *                     "Mainloop", // parent timer name
+ *                     "Layout", // name
+ *                     "Time spent laying out", // description
+ *                     0); // flags
+ *
+ *   RUT_TIMER_START (_rut_uprof_context, layout_timer);
+ *   ...
+ *   RUT_TIMER_STOP (_rut_uprof_context, layout_timer);
+ *
+ * The first argument of the macros is unused and is only there for
+ * compatibility with the UProf style API that they are modelled on.
+ * Each thread records into its own buffer and the buffers are
+ * collected by rut_profile_end_frame() which the shell calls after
+ * each paint.
+ */
+
+#ifdef RUT_ENABLE_PROFILE
+
+typedef struct _RutProfileCounter
+{
+  const char *name;
+  const char *description;
+
+  /* Assigned when the counter is first used */
+  int index;
+} RutProfileCounter;
+
+typedef struct _RutProfileTimer
+{
+  const char *parent_name;
+  const char *name;
+  const char *description;
+
+  /* Assigned when the timer is first used */
+  int index;
+} RutProfileTimer;
+
+extern CoglBool _rut_profile_enabled;
+
+void
+_rut_profile_init (void);
+
+void
+_rut_profile_counter_add (RutProfileCounter *counter, int value);
+
+void
+_rut_profile_timer_start (RutProfileTimer *timer);
+
+void
+_rut_profile_timer_stop (RutProfileTimer *timer);
+
+void
+rut_profile_end_frame (void);
+
+#define RUT_STATIC_COUNTER(COUNTER, NAME, DESCRIPTION, FLAGS) \
+  static RutProfileCounter COUNTER = { NAME, DESCRIPTION, -1 }
+
+#define RUT_STATIC_TIMER(TIMER, PARENT, NAME, DESCRIPTION, FLAGS) \
+  static RutProfileTimer TIMER = { PARENT, NAME, DESCRIPTION, -1 }
+
+#define RUT_COUNTER_INC(CONTEXT, COUNTER) G_STMT_START {        \
+    if (G_UNLIKELY (_rut_profile_enabled))                      \
+      _rut_profile_counter_add (&(COUNTER), 1);                 \
+  } G_STMT_END
+
+#define RUT_COUNTER_DEC(CONTEXT, COUNTER) G_STMT_START {        \
+    if (G_UNLIKELY (_rut_profile_enabled))                      \
+      _rut_profile_counter_add (&(COUNTER), -1);                \
+  } G_STMT_END
+
+#define RUT_TIMER_START(CONTEXT, TIMER) G_STMT_START {          \
+    if (G_UNLIKELY (_rut_profile_enabled))                      \
+      _rut_profile_timer_start (&(TIMER));                      \
+  } G_STMT_END
+
+#define RUT_TIMER_STOP(CONTEXT, TIMER) G_STMT_START {           \
+    if (G_UNLIKELY (_rut_profile_enabled))                      \
+      _rut_profile_timer_stop (&(TIMER));                       \
+  } G_STMT_END
+
+#else /* RUT_ENABLE_PROFILE */
+
+/* If profiling isn't enabled then all of the instrumentation compiles
+ * to nothing so that it won't be a performance burden */
+
+#ifdef __COUNTER__
+#define RUT_STATIC_TIMER(A,B,C,D,E) extern void G_PASTE (_rut_dummy_decl, __COUNTER__) (void)
+#define RUT_STATIC_COUNTER(A,B,C,D) extern void G_PASTE (_rut_dummy_decl, __COUNTER__) (void)
+#else
+#define RUT_STATIC_TIMER(A,B,C,D,E) extern void G_PASTE (_rut_dummy_decl, __LINE__) (void)
+#define RUT_STATIC_COUNTER(A,B,C,D) extern void G_PASTE (_rut_dummy_decl, __LINE__) (void)
+#endif
+#define RUT_COUNTER_INC(A,B) G_STMT_START { } G_STMT_END
+#define RUT_COUNTER_DEC(A,B) G_STMT_START { } G_STMT_END
+#define RUT_TIMER_START(A,B) G_STMT_START { } G_STMT_END
+#define RUT_TIMER_STOP(A,B) G_STMT_START { } G_STMT_END
+
+#define _rut_profile_init() G_STMT_START { } G_STMT_END
+#define rut_profile_end_frame() G_STMT_START { } G_STMT_END
+
+#endif /* RUT_ENABLE_PROFILE */
+
+#endif /* _RUT_PROFILE_H_ */
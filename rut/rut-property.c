@@ -26,16 +26,298 @@
 #include "rut-property.h"
 #include "rut-interfaces.h"
 
+struct _RutPropertyUpdate
+{
+  RutProperty *property;
+  RutPropertyUpdate *next;
+};
+
+typedef struct
+{
+  RutProperty *dependant;
+  RutProperty *source;
+} RutPropertyFlushEntry;
+
+/* While updates are deferred, RutProperty::queued_count is used to
+ * track the state of each property */
+enum
+{
+  RUT_PROPERTY_STATE_IDLE,
+  /* The property is in the list of dirty properties */
+  RUT_PROPERTY_STATE_QUEUED,
+  /* The dependants of the property are being scheduled. Finding the
+   * property again in this state means there is a cycle */
+  RUT_PROPERTY_STATE_VISITING,
+  /* The binding callback of the property will be invoked later in
+   * the current flush */
+  RUT_PROPERTY_STATE_SCHEDULED,
+  /* The binding callback of the property has been invoked in the
+   * current flush */
+  RUT_PROPERTY_STATE_EVALUATED
+};
+
+/* Binding callbacks can dirty properties that weren't reachable
+ * through the bindings of the originally dirtied properties so
+ * flushing repeats until nothing is queued. If it's still going after
+ * this many iterations then there's probably a cycle that never
+ * settles. */
+#define RUT_PROPERTY_MAX_FLUSH_ITERATIONS 16
+
+/* The contexts that are deferring updates. rut_property_destroy()
+ * doesn't know which context a property belongs to so it has to
+ * check all of them for references to the property. */
+static GSList *deferring_contexts;
+
 void
 rut_property_context_init (RutPropertyContext *context)
 {
+  context->defer_updates = FALSE;
   context->prop_update_stack = rut_memory_stack_new (4096);
+  context->first_update = NULL;
+  context->last_update = NULL;
+  context->flush_roots = g_array_new (FALSE, FALSE, sizeof (RutProperty *));
+  context->flush_order =
+    g_array_new (FALSE, FALSE, sizeof (RutPropertyFlushEntry));
+  context->flushing = FALSE;
+  context->n_notifications = 0;
+  context->n_callbacks = 0;
+  context->n_callbacks_saved = 0;
+  context->n_cycles = 0;
 }
 
 void
 rut_property_context_destroy (RutPropertyContext *context)
 {
+  deferring_contexts = g_slist_remove (deferring_contexts, context);
+
   rut_memory_stack_free (context->prop_update_stack);
+  g_array_free (context->flush_roots, TRUE);
+  g_array_free (context->flush_order, TRUE);
+}
+
+void
+rut_property_context_set_defer_updates (RutPropertyContext *context,
+                                        CoglBool defer_updates)
+{
+  if (context->defer_updates == defer_updates)
+    return;
+
+  if (defer_updates)
+    {
+      context->defer_updates = TRUE;
+      deferring_contexts = g_slist_prepend (deferring_contexts, context);
+    }
+  else
+    {
+      rut_property_context_flush (context);
+
+      context->defer_updates = FALSE;
+      deferring_contexts = g_slist_remove (deferring_contexts, context);
+    }
+}
+
+static void
+queue_property (RutPropertyContext *context,
+                RutProperty *property)
+{
+  RutPropertyUpdate *update;
+
+  /* Each property is only recorded once per flush. If the property
+   * has already been scheduled in the current flush then its
+   * dependants have been scheduled too. */
+  if (property->queued_count != RUT_PROPERTY_STATE_IDLE &&
+      property->queued_count != RUT_PROPERTY_STATE_EVALUATED)
+    return;
+
+  update = rut_memory_stack_alloc (context->prop_update_stack,
+                                   sizeof (RutPropertyUpdate));
+  update->property = property;
+  update->next = NULL;
+
+  if (context->last_update)
+    context->last_update->next = update;
+  else
+    context->first_update = update;
+  context->last_update = update;
+
+  property->queued_count = RUT_PROPERTY_STATE_QUEUED;
+}
+
+/* Removes all references to a property that is being destroyed */
+static void
+forget_property (RutPropertyContext *context,
+                 RutProperty *property)
+{
+  RutPropertyUpdate *update;
+  int i;
+
+  for (update = context->first_update; update; update = update->next)
+    if (update->property == property)
+      update->property = NULL;
+
+  for (i = 0; i < context->flush_roots->len; i++)
+    if (g_array_index (context->flush_roots, RutProperty *, i) == property)
+      g_array_index (context->flush_roots, RutProperty *, i) = NULL;
+
+  for (i = 0; i < context->flush_order->len; i++)
+    {
+      RutPropertyFlushEntry *entry =
+        &g_array_index (context->flush_order, RutPropertyFlushEntry, i);
+
+      if (entry->dependant == property)
+        entry->dependant = NULL;
+      if (entry->source == property)
+        entry->source = NULL;
+    }
+}
+
+/* Appends the dependants of @property to the flush order so that
+ * every property comes after all of the dependants that it depends
+ * on. This is a depth first search so the order is reversed when
+ * the callbacks are invoked */
+static void
+schedule_dependants (RutPropertyContext *context,
+                     RutProperty *property)
+{
+  GSList *l;
+
+  for (l = property->dependants; l; l = l->next)
+    {
+      RutProperty *dependant = l->data;
+      RutPropertyFlushEntry entry;
+
+      if (dependant->binding == NULL)
+        continue;
+
+      if (dependant->queued_count == RUT_PROPERTY_STATE_VISITING)
+        {
+          if (context->n_cycles++ == 0)
+            g_warning ("Cycle detected in the property bindings of "
+                       "\"%s\"", dependant->spec->name);
+          continue;
+        }
+
+      if (dependant->queued_count == RUT_PROPERTY_STATE_SCHEDULED)
+        continue;
+
+      dependant->queued_count = RUT_PROPERTY_STATE_VISITING;
+      schedule_dependants (context, dependant);
+      dependant->queued_count = RUT_PROPERTY_STATE_SCHEDULED;
+
+      entry.dependant = dependant;
+      entry.source = property;
+      g_array_append_val (context->flush_order, entry);
+    }
+}
+
+static void
+discard_queued_properties (RutPropertyContext *context)
+{
+  RutPropertyUpdate *update;
+
+  for (update = context->first_update; update; update = update->next)
+    if (update->property)
+      update->property->queued_count = RUT_PROPERTY_STATE_IDLE;
+
+  context->first_update = NULL;
+  context->last_update = NULL;
+  rut_memory_stack_rewind (context->prop_update_stack);
+}
+
+void
+rut_property_context_flush (RutPropertyContext *context)
+{
+  int iteration;
+
+  if (context->flushing || context->first_update == NULL)
+    return;
+
+  context->flushing = TRUE;
+
+  for (iteration = 0; context->first_update; iteration++)
+    {
+      RutPropertyUpdate *update;
+      int i;
+
+      if (iteration >= RUT_PROPERTY_MAX_FLUSH_ITERATIONS)
+        {
+          context->n_cycles++;
+          g_warning ("Property updates didn't settle after %i iterations",
+                     iteration);
+          discard_queued_properties (context);
+          break;
+        }
+
+      g_array_set_size (context->flush_roots, 0);
+
+      for (update = context->first_update; update; update = update->next)
+        if (update->property)
+          {
+            g_array_append_val (context->flush_roots, update->property);
+            update->property->queued_count = RUT_PROPERTY_STATE_IDLE;
+          }
+
+      /* Properties dirtied by the binding callbacks will be queued
+       * for the next iteration */
+      context->first_update = NULL;
+      context->last_update = NULL;
+      rut_memory_stack_rewind (context->prop_update_stack);
+
+      g_array_set_size (context->flush_order, 0);
+
+      for (i = 0; i < context->flush_roots->len; i++)
+        {
+          RutProperty *root =
+            g_array_index (context->flush_roots, RutProperty *, i);
+
+          if (root)
+            schedule_dependants (context, root);
+        }
+
+      for (i = (int) context->flush_order->len - 1; i >= 0; i--)
+        {
+          RutPropertyFlushEntry *entry =
+            &g_array_index (context->flush_order, RutPropertyFlushEntry, i);
+          RutPropertyBinding *binding;
+
+          /* Either property may have been destroyed by an earlier
+           * callback */
+          if (entry->dependant == NULL || entry->source == NULL)
+            continue;
+
+          binding = entry->dependant->binding;
+          if (binding)
+            {
+              binding->callback (entry->dependant,
+                                 entry->source,
+                                 binding->user_data);
+              context->n_callbacks++;
+            }
+
+          if (entry->dependant)
+            entry->dependant->queued_count = RUT_PROPERTY_STATE_EVALUATED;
+        }
+
+      for (i = 0; i < context->flush_order->len; i++)
+        {
+          RutPropertyFlushEntry *entry =
+            &g_array_index (context->flush_order, RutPropertyFlushEntry, i);
+
+          if (entry->dependant &&
+              entry->dependant->queued_count != RUT_PROPERTY_STATE_QUEUED)
+            entry->dependant->queued_count = RUT_PROPERTY_STATE_IDLE;
+        }
+
+      g_array_set_size (context->flush_order, 0);
+    }
+
+  if (context->n_notifications > context->n_callbacks)
+    context->n_callbacks_saved +=
+      context->n_notifications - context->n_callbacks;
+  context->n_notifications = 0;
+  context->n_callbacks = 0;
+
+  context->flushing = FALSE;
 }
 
 void
@@ -92,6 +374,19 @@ rut_property_destroy (RutProperty *property)
 {
   GSList *l;
 
+  /* The roots of a flush are reset to idle before their dependants'
+   * callbacks are invoked but they are still referenced as the source
+   * of the flush entries so any context that is in the middle of a
+   * flush always needs checking */
+  for (l = deferring_contexts; l; l = l->next)
+    {
+      RutPropertyContext *context = l->data;
+
+      if (property->queued_count != RUT_PROPERTY_STATE_IDLE ||
+          context->flushing)
+        forget_property (context, property);
+    }
+
   _rut_property_destroy_binding (property);
 
   /* XXX: we don't really know if this property was a hard requirement
@@ -286,10 +581,24 @@ rut_property_dirty (RutPropertyContext *ctx,
 {
   GSList *l;
 
-  /* FIXME: The plan is for updates to happen asynchronously by
-   * queueing an update with the context but for now we simply
-   * trigger the updates synchronously.
-   */
+  if (ctx->defer_updates)
+    {
+      if (property->dependants == NULL)
+        return;
+
+      /* Keep track of how many callbacks would have been invoked
+       * synchronously so we know how much work was saved */
+      for (l = property->dependants; l; l = l->next)
+        {
+          RutProperty *dependant = l->data;
+          if (dependant->binding)
+            ctx->n_notifications++;
+        }
+
+      queue_property (ctx, property);
+      return;
+    }
+
   for (l = property->dependants; l; l = l->next)
     {
       RutProperty *dependant = l->data;
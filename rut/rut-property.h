@@ -10,9 +10,36 @@
 #include "rut-object.h"
 #include "rut-closure.h"
 
+typedef struct _RutPropertyUpdate RutPropertyUpdate;
+
 typedef struct _RutPropertyContext
 {
+  /* If this is TRUE then rut_property_dirty() only records the
+   * property and its dependants aren't notified until
+   * rut_property_context_flush() is called. */
+  CoglBool defer_updates;
+
+  /* A list of the properties that have been dirtied since the last
+   * flush. The records are allocated from prop_update_stack */
   RutMemoryStack *prop_update_stack;
+  RutPropertyUpdate *first_update;
+  RutPropertyUpdate *last_update;
+
+  /* Scratch state used while flushing */
+  GArray *flush_roots;
+  GArray *flush_order;
+  CoglBool flushing;
+
+  /* Statistics about deferred updates. n_notifications is the number
+   * of binding callbacks that would have been invoked if the updates
+   * had been propagated synchronously and n_callbacks is the number
+   * that were actually invoked. n_callbacks_saved accumulates the
+   * difference after each flush and n_cycles counts the dependency
+   * cycles that were found. */
+  unsigned int n_notifications;
+  unsigned int n_callbacks;
+  unsigned int n_callbacks_saved;
+  unsigned int n_cycles;
 } RutPropertyContext;
 
 typedef enum _RutPropertyType
@@ -315,6 +342,35 @@ rut_property_context_init (RutPropertyContext *context);
 void
 rut_property_context_destroy (RutPropertyContext *context);
 
+/**
+ * rut_property_context_set_defer_updates:
+ * @context: A #RutPropertyContext
+ * @defer_updates: Whether to defer updates
+ *
+ * When updates are deferred, dirtying a property doesn't immediately
+ * invoke the binding callbacks of its dependants. Instead the
+ * property is queued and all of the dependants of all of the queued
+ * properties are updated once each, in dependency order, by
+ * rut_property_context_flush(). This is called by the shell before
+ * painting. Disabling deferred updates flushes any queued updates.
+ */
+void
+rut_property_context_set_defer_updates (RutPropertyContext *context,
+                                        CoglBool defer_updates);
+
+/**
+ * rut_property_context_flush:
+ * @context: A #RutPropertyContext
+ *
+ * Invokes the binding callbacks for the dependants of all of the
+ * properties that have been dirtied since the last flush. If a
+ * dependant depends on more than one dirty property, directly or
+ * indirectly, its callback is only invoked once after all of its
+ * dirty dependencies have been updated.
+ */
+void
+rut_property_context_flush (RutPropertyContext *context);
+
 void
 rut_property_destroy (RutProperty *property);
 
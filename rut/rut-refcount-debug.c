@@ -73,6 +73,10 @@ typedef struct
   void *backtrace_addresses[1];
 } RutRefcountDebugAction;
 
+/* Objects may be created and referenced on the asset decoding threads
+ * so the table of objects needs to be locked */
+G_LOCK_DEFINE_STATIC (refcount_debug);
+
 static void
 atexit_cb (void);
 
@@ -488,6 +492,8 @@ _rut_refcount_debug_object_created (void *object)
   if (!state->enabled)
     return;
 
+  G_LOCK (refcount_debug);
+
   if (g_hash_table_contains (state->hash, object))
     g_warning ("Address of existing object reused for newly created object");
   else
@@ -502,6 +508,8 @@ _rut_refcount_debug_object_created (void *object)
 
       g_hash_table_insert (state->hash, object, object_data);
     }
+
+  G_UNLOCK (refcount_debug);
 }
 
 void
@@ -513,16 +521,19 @@ _rut_refcount_debug_ref (void *object)
   if (!state->enabled)
     return;
 
+  G_LOCK (refcount_debug);
+
   object_data = g_hash_table_lookup (state->hash, object);
 
   if (object_data == NULL)
+    g_warning ("Reference taken on object that does not exist");
+  else
     {
-      g_warning ("Reference taken on object that does not exist");
-      return;
+      object_data->ref_count++;
+      log_action (object_data, RUT_REFCOUNT_DEBUG_ACTION_TYPE_REF);
     }
 
-  object_data->ref_count++;
-  log_action (object_data, RUT_REFCOUNT_DEBUG_ACTION_TYPE_REF);
+  G_UNLOCK (refcount_debug);
 }
 
 void
@@ -534,18 +545,18 @@ _rut_refcount_debug_unref (void *object)
   if (!state->enabled)
     return;
 
+  G_LOCK (refcount_debug);
+
   object_data = g_hash_table_lookup (state->hash, object);
 
   if (object_data == NULL)
-    {
-      g_warning ("Reference removed on object that does not exist");
-      return;
-    }
-
-  if (--object_data->ref_count <= 0)
+    g_warning ("Reference removed on object that does not exist");
+  else if (--object_data->ref_count <= 0)
     g_hash_table_remove (state->hash, object);
   else
     log_action (object_data, RUT_REFCOUNT_DEBUG_ACTION_TYPE_UNREF);
+
+  G_UNLOCK (refcount_debug);
 }
 
 #endif /* RUT_ENABLE_REFCOUNT_DEBUG */
@@ -20,6 +20,9 @@
 
 #include <config.h>
 
+#include <math.h>
+#include <string.h>
+
 #include <glib.h>
 
 #include <cogl/cogl.h>
@@ -62,6 +65,11 @@ typedef struct
 typedef void (*RutSDLEventHandler) (RutShell *shell,
                                     SDL_Event *event,
                                     void *user_data);
+
+/* The longest time in microseconds that the SDL source will spend
+ * handling events while a redraw is queued before it leaves the rest
+ * of the events until after the frame has been painted */
+#define RUT_SHELL_INPUT_BUDGET 8000
 #endif
 
 struct _RutShell
@@ -123,6 +131,21 @@ struct _RutShell
 
   /* A list of onscreen windows that the shell is manipulating */
   RutList onscreens;
+
+#ifdef USE_SDL
+  /* Consecutive motion events are compressed so that at most one is
+   * handled per frame. The latest one is kept here until the frame is
+   * painted or until a different kind of event arrives. The positions
+   * of the motion events that were dropped in favour of it are kept
+   * in motion_history as pairs of floats */
+  CoglBool have_pending_motion;
+  SDL_Event pending_motion;
+  GArray *motion_history;
+
+  /* Set when RUT_SHELL_INPUT_BUDGET has been used up so that the SDL
+   * source won't dispatch again until the next frame is painted */
+  CoglBool input_budget_exhausted;
+#endif
 };
 
 /* PRIVATE */
@@ -251,6 +274,11 @@ struct _RutInputEvent
   void *native;
   RutCamera *camera;
   const CoglMatrix *input_transform;
+
+  /* Positions of earlier motion events that were compressed into this
+   * one as pairs of floats in window coordinates */
+  const float *motion_history;
+  int n_motion_history;
 };
 
 /* XXX: The vertices must be 4 components: [x, y, z, w] */
@@ -421,6 +449,26 @@ point_in_screen_poly (float point_x,
   return c;
 }
 
+static const CoglMatrix *
+get_inputable_modelview (RutCamera *camera,
+                         RutObject *inputable,
+                         RutInputRegion *region,
+                         CoglMatrix *matrix)
+{
+  const CoglMatrix *view = rut_camera_get_view_transform (camera);
+
+  if (region->hud_mode)
+    return &camera->ctx->identity_matrix;
+  else if (rut_object_is (inputable, RUT_INTERFACE_ID_GRAPHABLE))
+    {
+      *matrix = *view;
+      rut_graphable_apply_transform (inputable, matrix);
+      return matrix;
+    }
+  else
+    return view;
+}
+
 CoglBool
 rut_camera_pick_inputable (RutCamera *camera,
                            RutObject *inputable,
@@ -430,19 +478,9 @@ rut_camera_pick_inputable (RutCamera *camera,
   CoglMatrix matrix;
   const CoglMatrix *modelview = NULL;
   float poly[16];
-  const CoglMatrix *view = rut_camera_get_view_transform (camera);
   RutInputRegion *region = rut_inputable_get_input_region (inputable);
 
-  if (region->hud_mode)
-    modelview = &camera->ctx->identity_matrix;
-  else if (rut_object_is (inputable, RUT_INTERFACE_ID_GRAPHABLE))
-    {
-      matrix = *view;
-      rut_graphable_apply_transform (inputable, &matrix);
-      modelview = &matrix;
-    }
-  else
-    modelview = view;
+  modelview = get_inputable_modelview (camera, inputable, region, &matrix);
 
   switch (region->shape.any.type)
     {
@@ -536,6 +574,8 @@ _rut_input_region_set_size (RutObject *self,
         region->shape.circle.r * region->shape.circle.r;
       break;
     }
+
+  rut_inputable_dirty (region);
 }
 
 static void
@@ -670,6 +710,7 @@ rut_input_region_set_rectangle (RutInputRegion *region,
   region->shape.rectangle.y0 = y0;
   region->shape.rectangle.x1 = x1;
   region->shape.rectangle.y1 = y1;
+  rut_inputable_dirty (region);
 }
 
 void
@@ -683,6 +724,7 @@ rut_input_region_set_circle (RutInputRegion *region,
   region->shape.circle.y = y;
   region->shape.circle.r = radius;
   region->shape.circle.r_squared = radius * radius;
+  rut_inputable_dirty (region);
 }
 
 void
@@ -690,6 +732,7 @@ rut_input_region_set_hud_mode (RutInputRegion *region,
                                CoglBool hud_mode)
 {
   region->hud_mode = hud_mode;
+  rut_inputable_dirty (region);
 }
 
 RutClosure *
@@ -704,12 +747,589 @@ rut_shell_add_input_callback (RutShell *shell,
                                destroy_cb);
 }
 
+/* To avoid having to walk the whole scenegraph of an input camera for
+ * every pointer event each input camera keeps an index of the
+ * inputables in its scenegraph. The inputables are recorded in
+ * depth-first order along with the bounds of their input regions in
+ * window coordinates. The bounds are then bucketed into a uniform
+ * grid so that picking only needs to test the inputables that overlap
+ * the cell under the pointer. These are tested starting from the last
+ * one in depth-first order so that the topmost inputable still wins.
+ *
+ * The index is rebuilt from scratch when a child is added to or
+ * removed from the camera's scenegraph or the camera moves. Otherwise
+ * the inputables report when their world transform or input region
+ * changes with rut_inputable_dirty() and only those entries are
+ * re-projected. The grid only needs refilling if an entry moves to a
+ * different set of cells.
+ */
+
+/* The size in pixels of a cell in the grid. If the inputables cover
+ * a larger area than will fit in INPUT_INDEX_MAX_CELLS cells in either
+ * direction then the cells are made bigger instead */
+#define INPUT_INDEX_CELL_SIZE 64
+#define INPUT_INDEX_MAX_CELLS 64
+
+typedef struct _InputIndexEntry
+{
+  RutObject *inputable;
+  RutInputRegion *region;
+
+  /* Set while the entry is in the index's list of dirty entries */
+  CoglBool dirty;
+
+  /* If the bounds can't be determined, for example because part of
+   * the region is behind the camera, then the entry is tested for
+   * every pick instead of being put in the grid */
+  CoglBool bounded;
+  float x0, y0, x1, y1;
+} InputIndexEntry;
+
+typedef struct _InputIndex
+{
+  CoglBool valid;
+
+  /* The state the index was built for */
+  unsigned int graph_age;
+  CoglMatrix view;
+  CoglMatrix projection;
+  float viewport[4];
+
+  GArray *entries;
+
+  /* Maps from the inputable and the input region of each entry to its
+   * position in entries plus one */
+  GHashTable *entry_map;
+  /* Entries that need re-projecting on the next update */
+  GArray *dirty_entries;
+
+  float grid_x, grid_y;
+  float cell_width, cell_height;
+  int n_columns, n_rows;
+
+  /* The entries overlapping cell N are listed in cell_entries between
+   * cell_offsets[N] and cell_offsets[N + 1] in depth-first order */
+  GArray *cell_offsets;
+  GArray *cell_entries;
+
+  GArray *unbounded_entries;
+} InputIndex;
+
+static void
+input_index_init (InputIndex *index)
+{
+  index->valid = FALSE;
+  index->entries = g_array_new (FALSE, FALSE, sizeof (InputIndexEntry));
+  index->entry_map = g_hash_table_new (NULL, NULL);
+  index->dirty_entries = g_array_new (FALSE, FALSE, sizeof (int));
+  index->cell_offsets = g_array_new (FALSE, FALSE, sizeof (int));
+  index->cell_entries = g_array_new (FALSE, FALSE, sizeof (int));
+  index->unbounded_entries = g_array_new (FALSE, FALSE, sizeof (int));
+  index->n_columns = 0;
+  index->n_rows = 0;
+}
+
+static void
+input_index_destroy (InputIndex *index)
+{
+  g_array_free (index->entries, TRUE);
+  g_hash_table_destroy (index->entry_map);
+  g_array_free (index->dirty_entries, TRUE);
+  g_array_free (index->cell_offsets, TRUE);
+  g_array_free (index->cell_entries, TRUE);
+  g_array_free (index->unbounded_entries, TRUE);
+}
+
+static void
+input_index_update_entry_bounds (RutCamera *camera,
+                                 InputIndexEntry *entry)
+{
+  RutInputRegion *region = entry->region;
+  CoglMatrix matrix;
+  const CoglMatrix *modelview;
+  int i;
+
+  /* Make sure the world transform is cached even for HUD regions
+   * because the inputable is only marked as dirty when a valid
+   * cached transform is invalidated */
+  if (rut_object_is (entry->inputable, RUT_INTERFACE_ID_GRAPHABLE))
+    rut_graphable_get_world_transform (entry->inputable);
+
+  modelview = get_inputable_modelview (camera, entry->inputable,
+                                       region, &matrix);
+
+  switch (region->shape.any.type)
+    {
+    case RUT_INPUT_SHAPE_TYPE_RECTANGLE:
+      {
+        float poly[16];
+
+        if (!region->hud_mode)
+          {
+            rect_to_screen_polygon (&region->shape.rectangle,
+                                    modelview,
+                                    &camera->projection,
+                                    camera->viewport,
+                                    poly);
+          }
+        else
+          rectangle_poly_init (&region->shape.rectangle, poly);
+
+        entry->x0 = entry->x1 = poly[0];
+        entry->y0 = entry->y1 = poly[1];
+
+        for (i = 1; i < 4; i++)
+          {
+            entry->x0 = MIN (entry->x0, poly[i * 4]);
+            entry->x1 = MAX (entry->x1, poly[i * 4]);
+            entry->y0 = MIN (entry->y0, poly[i * 4 + 1]);
+            entry->y1 = MAX (entry->y1, poly[i * 4 + 1]);
+          }
+      }
+      break;
+
+    case RUT_INPUT_SHAPE_TYPE_CIRCLE:
+      {
+        RutInputShapeCircle *circle = &region->shape.circle;
+        float center_x = circle->x;
+        float center_y = circle->y;
+        float z = 0;
+        float w = 1;
+
+        /* This matches the billboarding in rut_camera_pick_inputable */
+        cogl_matrix_transform_point (modelview,
+                                     &center_x, &center_y, &z, &w);
+
+        entry->x0 = center_x - circle->r;
+        entry->x1 = center_x + circle->r;
+        entry->y0 = center_y - circle->r;
+        entry->y1 = center_y + circle->r;
+      }
+      break;
+    }
+
+  entry->bounded = (isfinite (entry->x0) && isfinite (entry->x1) &&
+                    isfinite (entry->y0) && isfinite (entry->y1));
+
+  /* point_in_screen_poly() rounds the vertices to whole pixels so the
+   * bounds are grown slightly to make sure they still contain every
+   * point that could hit */
+  entry->x0 -= 1;
+  entry->y0 -= 1;
+  entry->x1 += 1;
+  entry->y1 += 1;
+}
+
+typedef struct _InputIndexBuildState
+{
+  RutCamera *camera;
+  InputIndex *index;
+} InputIndexBuildState;
+
+static RutTraverseVisitFlags
+input_index_add_entry_cb (RutObject *object,
+                          int depth,
+                          void *user_data)
+{
+  InputIndexBuildState *state = user_data;
+  InputIndexEntry *entry;
+
+  if (!rut_object_is (object, RUT_INTERFACE_ID_INPUTABLE))
+    return RUT_TRAVERSE_VISIT_CONTINUE;
+
+  g_array_set_size (state->index->entries, state->index->entries->len + 1);
+  entry = &g_array_index (state->index->entries,
+                          InputIndexEntry,
+                          state->index->entries->len - 1);
+
+  entry->inputable = object;
+  entry->region = rut_inputable_get_input_region (object);
+  entry->dirty = FALSE;
+
+  input_index_update_entry_bounds (state->camera, entry);
+
+  g_hash_table_insert (state->index->entry_map,
+                       entry->inputable,
+                       GINT_TO_POINTER (state->index->entries->len));
+  g_hash_table_insert (state->index->entry_map,
+                       entry->region,
+                       GINT_TO_POINTER (state->index->entries->len));
+
+  return RUT_TRAVERSE_VISIT_CONTINUE;
+}
+
+static void
+input_index_get_cell_range (InputIndex *index,
+                            const InputIndexEntry *entry,
+                            int *column0, int *row0,
+                            int *column1, int *row1)
+{
+  *column0 = (entry->x0 - index->grid_x) / index->cell_width;
+  *column1 = (entry->x1 - index->grid_x) / index->cell_width;
+  *row0 = (entry->y0 - index->grid_y) / index->cell_height;
+  *row1 = (entry->y1 - index->grid_y) / index->cell_height;
+
+  *column0 = CLAMP (*column0, 0, index->n_columns - 1);
+  *column1 = CLAMP (*column1, 0, index->n_columns - 1);
+  *row0 = CLAMP (*row0, 0, index->n_rows - 1);
+  *row1 = CLAMP (*row1, 0, index->n_rows - 1);
+}
+
+static void
+input_index_fill_grid (InputIndex *index)
+{
+  InputIndexEntry *entries = (InputIndexEntry *) index->entries->data;
+  int n_entries = index->entries->len;
+  float x0 = G_MAXFLOAT, y0 = G_MAXFLOAT;
+  float x1 = -G_MAXFLOAT, y1 = -G_MAXFLOAT;
+  int *offsets;
+  int *cell_entries;
+  int n_cells;
+  int i, row, column;
+
+  g_array_set_size (index->unbounded_entries, 0);
+
+  for (i = 0; i < n_entries; i++)
+    {
+      if (entries[i].bounded)
+        {
+          x0 = MIN (x0, entries[i].x0);
+          y0 = MIN (y0, entries[i].y0);
+          x1 = MAX (x1, entries[i].x1);
+          y1 = MAX (y1, entries[i].y1);
+        }
+      else
+        g_array_append_val (index->unbounded_entries, i);
+    }
+
+  if (x0 > x1)
+    {
+      index->n_columns = 0;
+      index->n_rows = 0;
+      g_array_set_size (index->cell_offsets, 0);
+      g_array_set_size (index->cell_entries, 0);
+      return;
+    }
+
+  index->grid_x = x0;
+  index->grid_y = y0;
+  index->n_columns = CLAMP (ceilf ((x1 - x0) / INPUT_INDEX_CELL_SIZE),
+                            1, INPUT_INDEX_MAX_CELLS);
+  index->n_rows = CLAMP (ceilf ((y1 - y0) / INPUT_INDEX_CELL_SIZE),
+                         1, INPUT_INDEX_MAX_CELLS);
+  index->cell_width = MAX (x1 - x0, 1) / index->n_columns;
+  index->cell_height = MAX (y1 - y0, 1) / index->n_rows;
+
+  n_cells = index->n_columns * index->n_rows;
+  g_array_set_size (index->cell_offsets, n_cells + 1);
+  offsets = (int *) index->cell_offsets->data;
+  memset (offsets, 0, sizeof (int) * (n_cells + 1));
+
+  /* First count the entries overlapping each cell... */
+  for (i = 0; i < n_entries; i++)
+    {
+      int column0, row0, column1, row1;
+
+      if (!entries[i].bounded)
+        continue;
+
+      input_index_get_cell_range (index, &entries[i],
+                                  &column0, &row0, &column1, &row1);
+
+      for (row = row0; row <= row1; row++)
+        for (column = column0; column <= column1; column++)
+          offsets[row * index->n_columns + column]++;
+    }
+
+  /* ...then make each offset point to the end of its cell... */
+  for (i = 1; i <= n_cells; i++)
+    offsets[i] += offsets[i - 1];
+
+  g_array_set_size (index->cell_entries, offsets[n_cells]);
+  cell_entries = (int *) index->cell_entries->data;
+
+  /* ...and fill the cells backwards so that each offset ends up
+   * pointing to the start of its cell with the entries still in
+   * depth-first order */
+  for (i = n_entries - 1; i >= 0; i--)
+    {
+      int column0, row0, column1, row1;
+
+      if (!entries[i].bounded)
+        continue;
+
+      input_index_get_cell_range (index, &entries[i],
+                                  &column0, &row0, &column1, &row1);
+
+      for (row = row0; row <= row1; row++)
+        for (column = column0; column <= column1; column++)
+          cell_entries[--offsets[row * index->n_columns + column]] = i;
+    }
+}
+
+/* Returns whether an entry whose bounds have changed from @old is
+ * still in the right cells of the grid */
+static CoglBool
+input_index_entry_fits_grid (InputIndex *index,
+                             const InputIndexEntry *old,
+                             const InputIndexEntry *entry)
+{
+  int old_range[4], new_range[4];
+
+  if (old->bounded != entry->bounded)
+    return FALSE;
+
+  if (!entry->bounded)
+    return TRUE;
+
+  if (index->n_columns == 0 ||
+      entry->x0 < index->grid_x ||
+      entry->y0 < index->grid_y ||
+      entry->x1 > index->grid_x + index->cell_width * index->n_columns ||
+      entry->y1 > index->grid_y + index->cell_height * index->n_rows)
+    return FALSE;
+
+  input_index_get_cell_range (index, old,
+                              &old_range[0], &old_range[1],
+                              &old_range[2], &old_range[3]);
+  input_index_get_cell_range (index, entry,
+                              &new_range[0], &new_range[1],
+                              &new_range[2], &new_range[3]);
+
+  return memcmp (old_range, new_range, sizeof (old_range)) == 0;
+}
+
+static void
+input_index_mark_dirty (InputIndex *index,
+                        RutObject *object)
+{
+  int pos = GPOINTER_TO_INT (g_hash_table_lookup (index->entry_map, object));
+  InputIndexEntry *entry;
+
+  if (pos == 0)
+    return;
+
+  entry = &g_array_index (index->entries, InputIndexEntry, pos - 1);
+
+  if (!entry->dirty)
+    {
+      pos--;
+      entry->dirty = TRUE;
+      g_array_append_val (index->dirty_entries, pos);
+    }
+}
+
+static void
+input_index_update (InputIndex *index,
+                    RutCamera *camera,
+                    RutObject *scenegraph)
+{
+  const CoglMatrix *view = rut_camera_get_view_transform (camera);
+  unsigned int graph_age = rut_graphable_get_graph_age (scenegraph);
+  CoglBool refill = FALSE;
+  int i;
+
+  if (!index->valid ||
+      index->graph_age != graph_age ||
+      !cogl_matrix_equal (&index->view, view) ||
+      !cogl_matrix_equal (&index->projection, &camera->projection) ||
+      memcmp (index->viewport, camera->viewport, sizeof (index->viewport)))
+    {
+      InputIndexBuildState state;
+
+      state.camera = camera;
+      state.index = index;
+
+      g_array_set_size (index->entries, 0);
+      g_hash_table_remove_all (index->entry_map);
+      g_array_set_size (index->dirty_entries, 0);
+
+      rut_graphable_traverse (scenegraph,
+                              RUT_TRAVERSE_DEPTH_FIRST,
+                              input_index_add_entry_cb,
+                              NULL, /* post_children_cb */
+                              &state);
+
+      index->graph_age = graph_age;
+      index->view = *view;
+      index->projection = camera->projection;
+      memcpy (index->viewport, camera->viewport, sizeof (index->viewport));
+      index->valid = TRUE;
+
+      refill = TRUE;
+    }
+
+  for (i = 0; i < index->dirty_entries->len; i++)
+    {
+      int pos = g_array_index (index->dirty_entries, int, i);
+      InputIndexEntry *entry =
+        &g_array_index (index->entries, InputIndexEntry, pos);
+      RutInputRegion *region =
+        rut_inputable_get_input_region (entry->inputable);
+      InputIndexEntry old = *entry;
+
+      entry->dirty = FALSE;
+
+      if (region != entry->region)
+        {
+          g_hash_table_remove (index->entry_map, entry->region);
+          entry->region = region;
+          g_hash_table_insert (index->entry_map,
+                               region,
+                               GINT_TO_POINTER (pos + 1));
+        }
+
+      input_index_update_entry_bounds (camera, entry);
+
+      if (!refill && !input_index_entry_fits_grid (index, &old, entry))
+        refill = TRUE;
+    }
+
+  g_array_set_size (index->dirty_entries, 0);
+
+  if (refill)
+    input_index_fill_grid (index);
+}
+
+static CoglBool
+ui_viewport_contains_point (RutCamera *camera,
+                            RutUIViewport *ui_viewport,
+                            float x,
+                            float y)
+{
+  CoglMatrix transform;
+  RutInputShapeRectange rect;
+  float poly[16];
+  RutObject *parent = rut_graphable_get_parent (ui_viewport);
+  const CoglMatrix *view = rut_camera_get_view_transform (camera);
+
+  transform = *view;
+  rut_graphable_apply_transform (parent, &transform);
+
+  rect.x0 = 0;
+  rect.y0 = 0;
+  rect.x1 = rut_ui_viewport_get_width (ui_viewport);
+  rect.y1 = rut_ui_viewport_get_height (ui_viewport);
+
+  rect_to_screen_polygon (&rect,
+                          &transform,
+                          &camera->projection,
+                          camera->viewport,
+                          poly);
+
+  return point_in_screen_poly (x, y, poly, sizeof (float) * 4, 4);
+}
+
+static CoglBool
+input_index_pick_entry (InputIndexEntry *entry,
+                        RutCamera *camera,
+                        RutObject *scenegraph,
+                        float x,
+                        float y)
+{
+  RutObject *object;
+
+  if (entry->bounded &&
+      (x < entry->x0 || x > entry->x1 || y < entry->y0 || y > entry->y1))
+    return FALSE;
+
+  if (!rut_camera_pick_inputable (camera, entry->inputable, x, y))
+    return FALSE;
+
+  /* UI viewports clip the input of everything inside them, including
+   * themselves */
+  for (object = entry->inputable;
+       object;
+       object = rut_graphable_get_parent (object))
+    {
+      if (rut_object_get_type (object) == &rut_ui_viewport_type &&
+          !ui_viewport_contains_point (camera, object, x, y))
+        return FALSE;
+
+      if (object == scenegraph)
+        break;
+    }
+
+  return TRUE;
+}
+
+static RutObject *
+input_index_pick (InputIndex *index,
+                  RutCamera *camera,
+                  RutObject *scenegraph,
+                  float x,
+                  float y)
+{
+  InputIndexEntry *entries;
+  int *unbounded;
+  int picked = -1;
+  int i;
+
+  input_index_update (index, camera, scenegraph);
+
+  entries = (InputIndexEntry *) index->entries->data;
+  unbounded = (int *) index->unbounded_entries->data;
+
+  if (index->n_columns > 0 &&
+      x >= index->grid_x &&
+      x < index->grid_x + index->cell_width * index->n_columns &&
+      y >= index->grid_y &&
+      y < index->grid_y + index->cell_height * index->n_rows)
+    {
+      int column = (x - index->grid_x) / index->cell_width;
+      int row = (y - index->grid_y) / index->cell_height;
+      int *offsets = (int *) index->cell_offsets->data;
+      int *cell_entries = (int *) index->cell_entries->data;
+      int cell;
+
+      column = MIN (column, index->n_columns - 1);
+      row = MIN (row, index->n_rows - 1);
+      cell = row * index->n_columns + column;
+
+      for (i = offsets[cell + 1] - 1; i >= offsets[cell]; i--)
+        if (input_index_pick_entry (&entries[cell_entries[i]],
+                                    camera, scenegraph, x, y))
+          {
+            picked = cell_entries[i];
+            break;
+          }
+    }
+
+  for (i = index->unbounded_entries->len - 1;
+       i >= 0 && unbounded[i] > picked;
+       i--)
+    if (input_index_pick_entry (&entries[unbounded[i]],
+                                camera, scenegraph, x, y))
+      {
+        picked = unbounded[i];
+        break;
+      }
+
+  return picked == -1 ? NULL : entries[picked].inputable;
+}
+
 typedef struct _InputCamera
 {
   RutCamera *camera;
   RutObject *scenegraph;
+  InputIndex index;
 } InputCamera;
 
+static void
+input_camera_mark_dirty_cb (RutObject *inputable,
+                            void *user_data)
+{
+  RutShell *shell = user_data;
+  GList *l;
+
+  for (l = shell->input_cameras; l; l = l->next)
+    {
+      InputCamera *input_camera = l->data;
+
+      input_index_mark_dirty (&input_camera->index, inputable);
+    }
+}
+
 void
 rut_shell_add_input_camera (RutShell *shell,
                             RutCamera *camera,
@@ -724,6 +1344,8 @@ rut_shell_add_input_camera (RutShell *shell,
   else
     input_camera->scenegraph = NULL;
 
+  input_index_init (&input_camera->index);
+
   shell->input_cameras = g_list_prepend (shell->input_cameras, input_camera);
 }
 
@@ -733,6 +1355,7 @@ input_camera_free (InputCamera *input_camera)
   rut_refable_unref (input_camera->camera);
   if (input_camera->scenegraph)
     rut_refable_unref (input_camera->scenegraph);
+  input_index_destroy (&input_camera->index);
   g_slice_free (InputCamera, input_camera);
 }
 
@@ -1114,13 +1737,25 @@ rut_motion_event_get_modifier_state (RutInputEvent *event)
 #endif
 }
 
+static void
+rut_input_event_transform_xy (RutInputEvent *event,
+                              float *x,
+                              float *y)
+{
+  const CoglMatrix *transform = event->input_transform;
+
+  if (transform)
+    {
+      *x = transform->xx * *x + transform->xy * *y + transform->xw;
+      *y = transform->yx * *x + transform->yy * *y + transform->yw;
+    }
+}
+
 static void
 rut_motion_event_get_transformed_xy (RutInputEvent *event,
                                      float *x,
                                      float *y)
 {
-  const CoglMatrix *transform = event->input_transform;
-
 #ifdef __ANDROID__
   *x = AMotionEvent_getX (event->native, 0);
   *y = AMotionEvent_getY (event->native, 0);
@@ -1145,11 +1780,7 @@ rut_motion_event_get_transformed_xy (RutInputEvent *event,
 #error "Unknown input system"
 #endif
 
-  if (transform)
-    {
-      *x = transform->xx * *x + transform->xy * *y + transform->xw;
-      *y = transform->yx * *x + transform->yy * *y + transform->yw;
-    }
+  rut_input_event_transform_xy (event, x, y);
 }
 
 float
@@ -1172,6 +1803,36 @@ rut_motion_event_get_y (RutInputEvent *event)
   return y;
 }
 
+int
+rut_motion_event_get_n_history (RutInputEvent *event)
+{
+#ifdef __ANDROID__
+  return AMotionEvent_getHistorySize (event->native);
+#else
+  return event->n_motion_history;
+#endif
+}
+
+void
+rut_motion_event_get_history_xy (RutInputEvent *event,
+                                 int index,
+                                 float *x,
+                                 float *y)
+{
+  g_return_if_fail (index >= 0 &&
+                    index < rut_motion_event_get_n_history (event));
+
+#ifdef __ANDROID__
+  *x = AMotionEvent_getHistoricalX (event->native, 0, index);
+  *y = AMotionEvent_getHistoricalY (event->native, 0, index);
+#else
+  *x = event->motion_history[index * 2];
+  *y = event->motion_history[index * 2 + 1];
+#endif
+
+  rut_input_event_transform_xy (event, x, y);
+}
+
 CoglBool
 rut_motion_event_unproject (RutInputEvent *event,
                             RutObject *graphable,
@@ -1227,58 +1888,6 @@ rut_text_event_get_text (RutInputEvent *event)
 #endif
 }
 
-typedef struct _CameraPickState
-{
-  RutCamera *camera;
-  RutInputEvent *event;
-  float x, y;
-  RutObject *picked_object;
-} CameraPickState;
-
-static RutTraverseVisitFlags
-camera_pre_pick_region_cb (RutObject *object,
-                           int depth,
-                           void *user_data)
-{
-  CameraPickState *state = user_data;
-
-  if (rut_object_get_type (object) == &rut_ui_viewport_type)
-    {
-      RutUIViewport *ui_viewport = RUT_UI_VIEWPORT (object);
-      CoglMatrix transform;
-      RutInputShapeRectange rect;
-      float poly[16];
-      RutObject *parent = rut_graphable_get_parent (object);
-      const CoglMatrix *view = rut_camera_get_view_transform (state->camera);
-
-      transform = *view;
-      rut_graphable_apply_transform (parent, &transform);
-
-      rect.x0 = 0;
-      rect.y0 = 0;
-      rect.x1 = rut_ui_viewport_get_width (ui_viewport);
-      rect.y1 = rut_ui_viewport_get_height (ui_viewport);
-
-      rect_to_screen_polygon (&rect,
-                              &transform,
-                              &state->camera->projection,
-                              state->camera->viewport,
-                              poly);
-
-      if (!point_in_screen_poly (state->x, state->y,
-                                 poly, sizeof (float) * 4, 4))
-        return RUT_TRAVERSE_VISIT_SKIP_CHILDREN;
-    }
-
-  if (rut_object_is (object, RUT_INTERFACE_ID_INPUTABLE) &&
-      rut_camera_pick_inputable (state->camera,
-                                 object,
-                                 state->x, state->y))
-    state->picked_object = object;
-
-  return RUT_TRAVERSE_VISIT_CONTINUE;
-}
-
 static RutObject *
 _rut_shell_get_scenegraph_event_target (RutShell *shell,
                                         RutInputEvent *event)
@@ -1287,6 +1896,12 @@ _rut_shell_get_scenegraph_event_target (RutShell *shell,
   RutCamera *picked_camera = NULL;
   GList *l;
 
+  RUT_STATIC_TIMER (pick_timer,
+                    NULL, /* no parent */
+                    "Input pick",
+                    "Time spent finding the target of an input event",
+                    0 /* no application private data */);
+
   /* Key events by default go to the object that has key focus. If
    * there is no object with key focus then we will let them go to
    * whichever object the pointer is over to implement a kind of
@@ -1296,6 +1911,10 @@ _rut_shell_get_scenegraph_event_target (RutShell *shell,
        rut_input_event_get_type (event) == RUT_INPUT_EVENT_TYPE_TEXT))
     return shell->keyboard_focus_object;
 
+  RUT_TIMER_START (_rut_uprof_context, pick_timer);
+
+  rut_inputable_flush_dirty (input_camera_mark_dirty_cb, shell);
+
   for (l = shell->input_cameras; l; l = l->next)
     {
       InputCamera *input_camera = l->data;
@@ -1303,28 +1922,20 @@ _rut_shell_get_scenegraph_event_target (RutShell *shell,
       RutObject *scenegraph = input_camera->scenegraph;
       float x = shell->mouse_x;
       float y = shell->mouse_y;
-      CameraPickState state;
 
       event->camera = camera;
       event->input_transform = &camera->input_transform;
 
       if (scenegraph)
         {
-          state.camera = camera;
-          state.event = event;
-          state.x = x;
-          state.y = y;
-          state.picked_object = NULL;
-
-          rut_graphable_traverse (scenegraph,
-                                  RUT_TRAVERSE_DEPTH_FIRST,
-                                  camera_pre_pick_region_cb,
-                                  NULL, /* post_children_cb */
-                                  &state);
-
-          if (state.picked_object)
+          RutObject *object = input_index_pick (&input_camera->index,
+                                                camera,
+                                                scenegraph,
+                                                x, y);
+
+          if (object)
             {
-              picked_object = state.picked_object;
+              picked_object = object;
               picked_camera = camera;
             }
         }
@@ -1336,6 +1947,8 @@ _rut_shell_get_scenegraph_event_target (RutShell *shell,
       event->input_transform = &picked_camera->input_transform;
     }
 
+  RUT_TIMER_STOP (_rut_uprof_context, pick_timer);
+
   return picked_object;
 }
 
@@ -1490,6 +2103,8 @@ android_handle_input (struct android_app* app, AInputEvent *event)
   rut_event.native = event;
   rut_event.shell = shell;
   rut_event.input_transform = NULL;
+  rut_event.motion_history = NULL;
+  rut_event.n_motion_history = 0;
 
   switch (AInputEvent_getType (event))
     {
@@ -1599,6 +2214,10 @@ _rut_shell_free (void *object)
 
   _rut_shell_remove_all_input_cameras (shell);
 
+#ifdef USE_SDL
+  g_array_free (shell->motion_history, TRUE);
+#endif
+
   _rut_shell_fini (shell);
 
   g_free (shell);
@@ -1657,6 +2276,10 @@ rut_shell_new (RutShellInitCallback init,
   rut_list_init (&shell->pre_paint_callbacks);
   shell->flushing_pre_paints = FALSE;
 
+#ifdef USE_SDL
+  shell->motion_history = g_array_new (FALSE, FALSE, sizeof (float));
+#endif
+
   return shell;
 }
 
@@ -1894,13 +2517,34 @@ flush_pre_paint_callbacks (RutShell *shell)
   shell->flushing_pre_paints = FALSE;
 }
 
+#ifdef USE_SDL
+static void
+sdl_flush_pending_motion (RutShell *shell);
+#endif
+
 static void
 _rut_shell_paint (RutShell *shell)
 {
   GSList *l;
+  CoglBool needs_redraw;
+
+  RUT_STATIC_TIMER (paint_timer,
+                    NULL, /* no parent */
+                    "Paint",
+                    "Time spent updating and painting a frame",
+                    0 /* no application private data */);
 
   g_return_if_fail (shell->redraw_queued == TRUE);
 
+  RUT_TIMER_START (_rut_uprof_context, paint_timer);
+
+#ifdef USE_SDL
+  /* Handle the motion event that was held back for this frame before
+   * anything is updated */
+  shell->input_budget_exhausted = FALSE;
+  sdl_flush_pending_motion (shell);
+#endif
+
   shell->redraw_queued = FALSE;
 #ifndef __ANDROID__
   g_source_remove (shell->glib_paint_idle);
@@ -1910,31 +2554,123 @@ _rut_shell_paint (RutShell *shell)
   for (l = shell->rut_ctx->timelines; l; l = l->next)
     _rut_timeline_update (l->data);
 
+  /* If property updates are being deferred then the bindings need to
+   * be up to date before anything is laid out or painted */
+  rut_property_context_flush (&shell->rut_ctx->property_ctx);
+
   flush_pre_paint_callbacks (shell);
 
-  if (shell->paint_cb (shell, shell->user_data))
-    goto queue_redraw;
+  rut_property_context_flush (&shell->rut_ctx->property_ctx);
 
-  for (l = shell->rut_ctx->timelines; l; l = l->next)
+  needs_redraw = shell->paint_cb (shell, shell->user_data);
+
+  for (l = shell->rut_ctx->timelines; l && !needs_redraw; l = l->next)
     if (rut_timeline_is_running (l->data))
-      goto queue_redraw;
+      needs_redraw = TRUE;
 
-  return;
+  RUT_TIMER_STOP (_rut_uprof_context, paint_timer);
 
-queue_redraw:
-  rut_shell_queue_redraw (shell);
+  rut_profile_end_frame ();
+
+  if (needs_redraw)
+    rut_shell_queue_redraw (shell);
+}
+
+void
+rut_shell_paint (RutShell *shell)
+{
+  if (!shell->redraw_queued)
+    rut_shell_queue_redraw (shell);
+
+  _rut_shell_paint (shell);
 }
 
 #ifdef USE_SDL
 
+static void
+sdl_flush_pending_motion (RutShell *shell)
+{
+  SDL_Event event;
+  RutInputEvent rut_event;
+
+  if (!shell->have_pending_motion)
+    return;
+
+  /* The event is copied in case a handler causes more events to be
+   * queued */
+  event = shell->pending_motion;
+  shell->have_pending_motion = FALSE;
+
+  rut_event.type = RUT_INPUT_EVENT_TYPE_MOTION;
+  rut_event.native = &event;
+  rut_event.shell = shell;
+  rut_event.input_transform = NULL;
+  rut_event.motion_history = (float *) shell->motion_history->data;
+  rut_event.n_motion_history = shell->motion_history->len / 2;
+
+  _rut_shell_handle_input (shell, &rut_event);
+
+  g_array_set_size (shell->motion_history, 0);
+}
+
+static CoglBool
+sdl_can_compress_motion (SDL_Event *pending,
+                         SDL_Event *event)
+{
+#if SDL_MAJOR_VERSION >= 2
+  if (pending->motion.windowID != event->motion.windowID)
+    return FALSE;
+#endif
+
+  /* Motion events with a different button state are kept separate
+   * so that handlers can still see exactly where a drag started */
+  return pending->motion.state == event->motion.state;
+}
+
+static void
+sdl_queue_motion (RutShell *shell, SDL_Event *event)
+{
+  if (shell->have_pending_motion)
+    {
+      SDL_Event *pending = &shell->pending_motion;
+
+      if (sdl_can_compress_motion (pending, event))
+        {
+          float position[2] = { pending->motion.x, pending->motion.y };
+
+          g_array_append_vals (shell->motion_history, position, 2);
+
+          event->motion.xrel += pending->motion.xrel;
+          event->motion.yrel += pending->motion.yrel;
+        }
+      else
+        sdl_flush_pending_motion (shell);
+    }
+
+  shell->pending_motion = *event;
+  shell->have_pending_motion = TRUE;
+}
+
 static void
 sdl_handle_event (RutShell *shell, SDL_Event *event)
 {
   RutInputEvent rut_event;
 
+  if (event->type == SDL_MOUSEMOTION)
+    {
+      sdl_queue_motion (shell, event);
+      return;
+    }
+
+  /* Any other event is handled after the pending motion so that the
+   * ordering of events is preserved */
+  sdl_flush_pending_motion (shell);
+
   rut_event.native = event;
   rut_event.shell = shell;
   rut_event.input_transform = NULL;
+  rut_event.motion_history = NULL;
+  rut_event.n_motion_history = 0;
 
   switch (event->type)
     {
@@ -1957,7 +2693,6 @@ sdl_handle_event (RutShell *shell, SDL_Event *event)
       break;
 #endif /* SDL_MAJOR_VERSION < 2 */
 
-    case SDL_MOUSEMOTION:
     case SDL_MOUSEBUTTONDOWN:
     case SDL_MOUSEBUTTONUP:
       rut_event.type = RUT_INPUT_EVENT_TYPE_MOTION;
@@ -2034,6 +2769,11 @@ typedef struct _SDLSource
 static gboolean
 sdl_glib_source_prepare (GSource *source, int *timeout)
 {
+  SDLSource *sdl_source = (SDLSource *) source;
+
+  if (sdl_source->shell->input_budget_exhausted)
+    return FALSE;
+
   if (SDL_PollEvent (NULL))
     return TRUE;
 
@@ -2045,6 +2785,11 @@ sdl_glib_source_prepare (GSource *source, int *timeout)
 static gboolean
 sdl_glib_source_check (GSource *source)
 {
+  SDLSource *sdl_source = (SDLSource *) source;
+
+  if (sdl_source->shell->input_budget_exhausted)
+    return FALSE;
+
   if (SDL_PollEvent (NULL))
     return TRUE;
 
@@ -2057,16 +2802,33 @@ sdl_glib_source_dispatch (GSource *source,
                            void *user_data)
 {
   SDLSource *sdl_source = (SDLSource *) source;
+  RutShell *shell = sdl_source->shell;
+  gint64 start_time = g_get_monotonic_time ();
   SDL_Event event;
 
   while (SDL_PollEvent (&event))
     {
-      cogl_sdl_handle_event (sdl_source->shell->rut_ctx->cogl_context,
-                             &event);
+      cogl_sdl_handle_event (shell->rut_ctx->cogl_context, &event);
 
-      sdl_handle_event (sdl_source->shell, &event);
+      sdl_handle_event (shell, &event);
+
+      /* Don't let a flood of events hold up a frame that is waiting
+       * to be painted */
+      if (shell->redraw_queued &&
+          g_get_monotonic_time () - start_time > RUT_SHELL_INPUT_BUDGET)
+        {
+          shell->input_budget_exhausted = TRUE;
+          break;
+        }
     }
 
+  /* If a frame is going to be painted then the last motion event is
+   * held back until just before it so that any more motion events
+   * that arrive in the meantime can be compressed into it. Otherwise
+   * it is handled straight away */
+  if (!shell->redraw_queued)
+    sdl_flush_pending_motion (shell);
+
   return TRUE;
 }
 
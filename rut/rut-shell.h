@@ -75,6 +75,19 @@ rut_shell_get_context (RutShell *shell);
 void
 rut_shell_main (RutShell *shell);
 
+/**
+ * rut_shell_paint:
+ * @shell: The #RutShell
+ *
+ * Immediately runs a frame in the same way that the main loop would
+ * for a queued redraw. This updates the timelines, runs the pre-paint
+ * callbacks and then calls the paint callback. It is intended for
+ * programs such as benchmarks that drive the shell themselves instead
+ * of calling rut_shell_main().
+ */
+void
+rut_shell_paint (RutShell *shell);
+
 void
 rut_shell_add_input_camera (RutShell *shell,
                             RutCamera *camera,
@@ -261,6 +274,39 @@ rut_motion_event_get_x (RutInputEvent *event);
 float
 rut_motion_event_get_y (RutInputEvent *event);
 
+/**
+ * rut_motion_event_get_n_history:
+ * @event: A motion event
+ *
+ * When the pointer moves several times within a frame the motion
+ * events may be compressed so that only the latest position is
+ * delivered. This can be used along with
+ * rut_motion_event_get_history_xy() by handlers that need the full
+ * path of the pointer rather than just where it ended up.
+ *
+ * Return value: The number of earlier positions that were dropped in
+ *   favour of @event.
+ */
+int
+rut_motion_event_get_n_history (RutInputEvent *event);
+
+/**
+ * rut_motion_event_get_history_xy:
+ * @event: A motion event
+ * @index: The index of the position, where 0 is the oldest
+ * @x: Output location for the x coordinate
+ * @y: Output location for the y coordinate
+ *
+ * Retrieves one of the positions that were compressed into @event.
+ * The position is transformed in the same way as
+ * rut_motion_event_get_x() and rut_motion_event_get_y().
+ */
+void
+rut_motion_event_get_history_xy (RutInputEvent *event,
+                                 int index,
+                                 float *x,
+                                 float *y);
+
 /**
  * rut_motion_event_unproject:
  * @event: A motion event
@@ -29,6 +29,7 @@
 
 #include "rut-text.h"
 #include "rut-paintable.h"
+#include "rut-profile.h"
 #include "components/rut-camera.h"
 
 /* This is only defined since GLib 2.31.0. The documentation says that
@@ -39,18 +40,6 @@
 
 #define RUT_NOTE(type,...)         G_STMT_START { } G_STMT_END
 
-#ifdef __COUNTER__
-#define RUT_STATIC_TIMER(A,B,C,D,E) extern void G_PASTE (_rut_dummy_decl, __COUNTER__) (void)
-#define RUT_STATIC_COUNTER(A,B,C,D) extern void G_PASTE (_rut_dummy_decl, __COUNTER__) (void)
-#else
-#define RUT_STATIC_TIMER(A,B,C,D,E) extern void G_PASTE (_rut_dummy_decl, __LINE__) (void)
-#define RUT_STATIC_COUNTER(A,B,C,D) extern void G_PASTE (_rut_dummy_decl, __LINE__) (void)
-#endif
-#define RUT_COUNTER_INC(A,B) G_STMT_START { } G_STMT_END
-#define RUT_COUNTER_DEC(A,B) G_STMT_START { } G_STMT_END
-#define RUT_TIMER_START(A,B) G_STMT_START { } G_STMT_END
-#define RUT_TIMER_STOP(A,B) G_STMT_START { } G_STMT_END
-
 /* cursor width in pixels */
 #define DEFAULT_CURSOR_SIZE     2
 
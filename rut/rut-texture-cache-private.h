@@ -0,0 +1,50 @@
+/*
+ * Rut
+ *
+ * A rig of UI prototyping utilities
+ *
+ * Copyright (C) 2013  Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RUT_TEXTURE_CACHE_PRIVATE_H_
+#define _RUT_TEXTURE_CACHE_PRIVATE_H_
+
+#include <cogl/cogl.h>
+
+#include "rut-context.h"
+
+/* These let textures that are uploaded without going through
+ * rut_load_texture(), such as the ones decoded for assets on another
+ * thread, share the same cache and budget. They must only be called
+ * on the main thread. */
+
+/* Returns a new reference to the texture loaded from @filename if it
+ * is in the cache, otherwise NULL */
+CoglTexture *
+_rut_texture_cache_lookup (RutContext *ctx,
+                           const char *filename);
+
+/* Adds @texture, which was loaded from @filename, to the cache. This
+ * takes ownership of the caller's reference and returns a new one
+ * which may be for a different texture if the file was already
+ * cached */
+CoglTexture *
+_rut_texture_cache_add (RutContext *ctx,
+                        const char *filename,
+                        CoglTexture *texture);
+
+#endif /* _RUT_TEXTURE_CACHE_PRIVATE_H_ */
@@ -0,0 +1,692 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <errno.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "rut-thumbnail-cache.h"
+
+#ifndef G_SOURCE_REMOVE
+#define G_SOURCE_REMOVE FALSE
+#endif
+
+#define RUT_THUMBNAIL_CACHE_MAGIC "RUTTHMB"
+#define RUT_THUMBNAIL_CACHE_VERSION 1
+
+/* The thumbnails are packed in a simple grid of RUT_THUMBNAIL_SIZE
+ * cells. The atlas is only as tall as it needs to be */
+#define ATLAS_WIDTH 2048
+#define ATLAS_MAX_HEIGHT 4096
+#define ATLAS_COLUMNS (ATLAS_WIDTH / RUT_THUMBNAIL_SIZE)
+#define ATLAS_MAX_THUMBNAILS \
+  (ATLAS_COLUMNS * (ATLAS_MAX_HEIGHT / RUT_THUMBNAIL_SIZE))
+
+typedef struct _FileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t thumbnail_size;
+  uint32_t atlas_width;
+  uint32_t atlas_height;
+  uint32_t n_entries;
+  uint32_t padding;
+
+  /* Followed by n_entries FileEntries, each followed by its path
+   * padded to a multiple of 8 bytes, and then the RGBA atlas */
+} FileHeader;
+
+typedef struct _FileEntry
+{
+  int64_t mtime;
+  uint64_t size;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+  uint32_t path_len;
+  uint32_t padding;
+} FileEntry;
+
+typedef struct _Thumbnail
+{
+  char *path;
+
+  /* The modification time and size of the image when the thumbnail
+   * was generated */
+  int64_t mtime;
+  uint64_t size;
+
+  /* A thumbnail with no size means the image couldn't be loaded */
+  int width;
+  int height;
+
+  /* The RGBA pixels. These either point into the mapped cache file
+   * or are owned by the thumbnail */
+  const uint8_t *pixels;
+  int rowstride;
+  uint8_t *owned_pixels;
+
+  /* Position within cache->atlas or -1 if the thumbnail isn't in
+   * the atlas */
+  int atlas_x;
+  int atlas_y;
+
+  /* Whether the thumbnail has been asked for since the cache was
+   * loaded. These are preferred if the atlas gets full */
+  CoglBool used;
+
+  /* Created lazily */
+  CoglTexture *texture;
+} Thumbnail;
+
+typedef struct _ThumbnailJob
+{
+  /* Cleared if the cache is destroyed before the job finishes */
+  RutThumbnailCache *cache;
+
+  char *path;
+  char *image_filename;
+  int64_t mtime;
+  uint64_t size;
+
+  /* Results */
+  CoglBool done;
+  uint8_t *pixels;
+  int width;
+  int height;
+} ThumbnailJob;
+
+struct _RutThumbnailCache
+{
+  RutContext *ctx;
+
+  char *filename;
+
+  /* The file that the thumbnails were loaded from and its atlas
+   * texture */
+  GMappedFile *mapped_file;
+  CoglTexture *atlas;
+
+  /* path -> Thumbnail */
+  GHashTable *thumbnails;
+  /* path -> ThumbnailJob */
+  GHashTable *pending;
+
+  GThreadPool *pool;
+
+  RutList ready_cb_list;
+
+  /* Whether there are thumbnails that haven't been saved yet */
+  CoglBool dirty;
+};
+
+static void
+thumbnail_free (void *data)
+{
+  Thumbnail *thumbnail = data;
+
+  if (thumbnail->texture)
+    cogl_object_unref (thumbnail->texture);
+
+  g_free (thumbnail->owned_pixels);
+  g_free (thumbnail->path);
+
+  g_slice_free (Thumbnail, thumbnail);
+}
+
+static void
+thumbnail_job_free (ThumbnailJob *job)
+{
+  g_free (job->path);
+  g_free (job->image_filename);
+  g_free (job->pixels);
+
+  g_slice_free (ThumbnailJob, job);
+}
+
+static size_t
+get_padded_path_len (size_t path_len)
+{
+  return (path_len + 7) & ~(size_t) 7;
+}
+
+static size_t
+get_pixels_offset (size_t offset)
+{
+  return (offset + 15) & ~(size_t) 15;
+}
+
+static void
+load_file (RutThumbnailCache *cache)
+{
+  const FileHeader *header;
+  const uint8_t *data, *p, *end;
+  const uint8_t *pixels;
+  size_t len, pixels_size;
+  int rowstride;
+  CoglBitmap *bitmap;
+  CoglError *error = NULL;
+  int i;
+
+  cache->mapped_file = g_mapped_file_new (cache->filename, FALSE, NULL);
+  if (cache->mapped_file == NULL)
+    return;
+
+  data = (const uint8_t *) g_mapped_file_get_contents (cache->mapped_file);
+  len = g_mapped_file_get_length (cache->mapped_file);
+  end = data + len;
+  header = (const FileHeader *) data;
+
+  if (len < sizeof (FileHeader) ||
+      memcmp (header->magic, RUT_THUMBNAIL_CACHE_MAGIC,
+              sizeof (RUT_THUMBNAIL_CACHE_MAGIC)) != 0 ||
+      header->version != RUT_THUMBNAIL_CACHE_VERSION ||
+      header->thumbnail_size != RUT_THUMBNAIL_SIZE ||
+      header->atlas_width != ATLAS_WIDTH ||
+      header->atlas_height > ATLAS_MAX_HEIGHT ||
+      header->atlas_height == 0 ||
+      header->n_entries > ATLAS_MAX_THUMBNAILS)
+    goto INVALID;
+
+  /* First check that the whole index is valid */
+  p = data + sizeof (FileHeader);
+  for (i = 0; i < header->n_entries; i++)
+    {
+      const FileEntry *entry = (const FileEntry *) p;
+
+      if ((size_t) (end - p) < sizeof (FileEntry))
+        goto INVALID;
+      p += sizeof (FileEntry);
+
+      if (entry->path_len == 0 ||
+          (size_t) (end - p) < get_padded_path_len (entry->path_len) ||
+          entry->width > RUT_THUMBNAIL_SIZE ||
+          entry->height > RUT_THUMBNAIL_SIZE ||
+          /* These are written so that they can't overflow */
+          entry->width > header->atlas_width ||
+          entry->height > header->atlas_height ||
+          entry->x > header->atlas_width - entry->width ||
+          entry->y > header->atlas_height - entry->height)
+        goto INVALID;
+      p += get_padded_path_len (entry->path_len);
+    }
+
+  rowstride = header->atlas_width * 4;
+  pixels_size = (size_t) rowstride * header->atlas_height;
+  pixels = data + get_pixels_offset (p - data);
+  if (pixels > end || (size_t) (end - pixels) < pixels_size)
+    goto INVALID;
+
+  bitmap = cogl_bitmap_new_for_data (cache->ctx->cogl_context,
+                                     header->atlas_width,
+                                     header->atlas_height,
+                                     COGL_PIXEL_FORMAT_RGBA_8888,
+                                     rowstride,
+                                     (uint8_t *) pixels);
+  cache->atlas = COGL_TEXTURE (
+    cogl_texture_2d_new_from_bitmap (bitmap,
+                                     COGL_PIXEL_FORMAT_ANY,
+                                     &error));
+  cogl_object_unref (bitmap);
+
+  if (!cache->atlas)
+    {
+      g_warning ("Failed to upload thumbnail atlas: %s", error->message);
+      cogl_error_free (error);
+      goto INVALID;
+    }
+
+  p = data + sizeof (FileHeader);
+  for (i = 0; i < header->n_entries; i++)
+    {
+      const FileEntry *entry = (const FileEntry *) p;
+      Thumbnail *thumbnail = g_slice_new0 (Thumbnail);
+
+      p += sizeof (FileEntry);
+
+      thumbnail->path = g_strndup ((const char *) p, entry->path_len);
+      thumbnail->mtime = entry->mtime;
+      thumbnail->size = entry->size;
+      thumbnail->width = entry->width;
+      thumbnail->height = entry->height;
+      thumbnail->pixels = pixels + entry->y * rowstride + entry->x * 4;
+      thumbnail->rowstride = rowstride;
+      thumbnail->atlas_x = entry->x;
+      thumbnail->atlas_y = entry->y;
+
+      g_hash_table_replace (cache->thumbnails, thumbnail->path, thumbnail);
+
+      p += get_padded_path_len (entry->path_len);
+    }
+
+  return;
+
+INVALID:
+  g_hash_table_remove_all (cache->thumbnails);
+  g_mapped_file_unref (cache->mapped_file);
+  cache->mapped_file = NULL;
+}
+
+RutThumbnailCache *
+rut_thumbnail_cache_new (RutContext *ctx,
+                         const char *filename)
+{
+  RutThumbnailCache *cache = g_slice_new0 (RutThumbnailCache);
+
+  cache->ctx = ctx;
+  cache->filename = g_strdup (filename);
+
+  cache->thumbnails = g_hash_table_new_full (g_str_hash,
+                                             g_str_equal,
+                                             NULL, /* key is owned by value */
+                                             thumbnail_free);
+  cache->pending = g_hash_table_new (g_str_hash, g_str_equal);
+
+  rut_list_init (&cache->ready_cb_list);
+
+  load_file (cache);
+
+  return cache;
+}
+
+static Thumbnail *
+add_thumbnail_from_job (RutThumbnailCache *cache,
+                        ThumbnailJob *job)
+{
+  Thumbnail *thumbnail = g_slice_new0 (Thumbnail);
+
+  thumbnail->path = g_strdup (job->path);
+  thumbnail->mtime = job->mtime;
+  thumbnail->size = job->size;
+  thumbnail->width = job->width;
+  thumbnail->height = job->height;
+  thumbnail->owned_pixels = job->pixels;
+  thumbnail->pixels = job->pixels;
+  thumbnail->rowstride = job->width * 4;
+  thumbnail->atlas_x = -1;
+  thumbnail->atlas_y = -1;
+  thumbnail->used = TRUE;
+
+  job->pixels = NULL;
+
+  g_hash_table_replace (cache->thumbnails, thumbnail->path, thumbnail);
+
+  return thumbnail;
+}
+
+static CoglBool
+job_done_idle_cb (void *user_data)
+{
+  ThumbnailJob *job = user_data;
+  RutThumbnailCache *cache = job->cache;
+
+  if (cache == NULL)
+    {
+      thumbnail_job_free (job);
+      return G_SOURCE_REMOVE;
+    }
+
+  g_hash_table_remove (cache->pending, job->path);
+
+  /* If the image couldn't be loaded we still add an empty thumbnail
+   * so that we don't keep on trying to load it */
+  add_thumbnail_from_job (cache, job);
+
+  if (job->width)
+    {
+      cache->dirty = TRUE;
+
+      rut_closure_list_invoke (&cache->ready_cb_list,
+                               RutThumbnailReadyCallback,
+                               cache,
+                               job->path);
+    }
+
+  /* Write out the new thumbnails once everything has been generated
+   * rather than after every single one */
+  if (cache->dirty && g_hash_table_size (cache->pending) == 0)
+    {
+      GError *error = NULL;
+
+      if (!rut_thumbnail_cache_save (cache, &error))
+        {
+          g_warning ("Failed to save thumbnails: %s", error->message);
+          g_error_free (error);
+        }
+    }
+
+  thumbnail_job_free (job);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+generate_thread_cb (void *data, void *user_data)
+{
+  ThumbnailJob *job = data;
+  GdkPixbuf *pixbuf;
+
+  /* This lets the image loader decode at a reduced size where the
+   * format supports it */
+  pixbuf = gdk_pixbuf_new_from_file_at_scale (job->image_filename,
+                                              RUT_THUMBNAIL_SIZE,
+                                              RUT_THUMBNAIL_SIZE,
+                                              TRUE, /* preserve aspect */
+                                              NULL);
+  if (pixbuf)
+    {
+      const uint8_t *src;
+      int src_rowstride;
+      int y;
+
+      if (!gdk_pixbuf_get_has_alpha (pixbuf))
+        {
+          GdkPixbuf *rgba = gdk_pixbuf_add_alpha (pixbuf, FALSE, 0, 0, 0);
+          g_object_unref (pixbuf);
+          pixbuf = rgba;
+        }
+
+      job->width = gdk_pixbuf_get_width (pixbuf);
+      job->height = gdk_pixbuf_get_height (pixbuf);
+      job->pixels = g_malloc (job->width * job->height * 4);
+
+      src = gdk_pixbuf_get_pixels (pixbuf);
+      src_rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+      for (y = 0; y < job->height; y++)
+        memcpy (job->pixels + y * job->width * 4,
+                src + y * src_rowstride,
+                job->width * 4);
+
+      g_object_unref (pixbuf);
+    }
+
+  job->done = TRUE;
+
+  g_idle_add (job_done_idle_cb, job);
+}
+
+static void
+queue_thumbnail (RutThumbnailCache *cache,
+                 const char *path,
+                 const char *image_filename,
+                 GStatBuf *buf)
+{
+  ThumbnailJob *job;
+
+  if (g_hash_table_lookup (cache->pending, path))
+    return;
+
+  if (cache->pool == NULL)
+    {
+      cache->pool = g_thread_pool_new (generate_thread_cb,
+                                       NULL, /* user data */
+#if GLIB_CHECK_VERSION (2, 36, 0)
+                                       g_get_num_processors (),
+#else
+                                       4,
+#endif
+                                       FALSE, /* not exclusive */
+                                       NULL); /* error */
+    }
+
+  job = g_slice_new0 (ThumbnailJob);
+  job->cache = cache;
+  job->path = g_strdup (path);
+  job->image_filename = g_strdup (image_filename);
+  job->mtime = buf->st_mtime;
+  job->size = buf->st_size;
+
+  g_hash_table_insert (cache->pending, job->path, job);
+
+  g_thread_pool_push (cache->pool, job, NULL);
+}
+
+CoglTexture *
+rut_thumbnail_cache_get (RutThumbnailCache *cache,
+                         const char *path,
+                         const char *image_filename)
+{
+  Thumbnail *thumbnail;
+  GStatBuf buf;
+
+  if (g_stat (image_filename, &buf) == -1)
+    return NULL;
+
+  thumbnail = g_hash_table_lookup (cache->thumbnails, path);
+
+  if (thumbnail == NULL ||
+      thumbnail->mtime != (int64_t) buf.st_mtime ||
+      thumbnail->size != (uint64_t) buf.st_size)
+    {
+      queue_thumbnail (cache, path, image_filename, &buf);
+      return NULL;
+    }
+
+  thumbnail->used = TRUE;
+
+  if (thumbnail->width == 0)
+    return NULL;
+
+  if (thumbnail->texture == NULL)
+    {
+      if (thumbnail->atlas_x >= 0)
+        {
+          thumbnail->texture = COGL_TEXTURE (
+            cogl_sub_texture_new (cache->ctx->cogl_context,
+                                  cache->atlas,
+                                  thumbnail->atlas_x,
+                                  thumbnail->atlas_y,
+                                  thumbnail->width,
+                                  thumbnail->height));
+        }
+      else
+        {
+          CoglBitmap *bitmap =
+            cogl_bitmap_new_for_data (cache->ctx->cogl_context,
+                                      thumbnail->width,
+                                      thumbnail->height,
+                                      COGL_PIXEL_FORMAT_RGBA_8888,
+                                      thumbnail->rowstride,
+                                      (uint8_t *) thumbnail->pixels);
+
+          thumbnail->texture = COGL_TEXTURE (
+            cogl_texture_2d_new_from_bitmap (bitmap,
+                                             COGL_PIXEL_FORMAT_ANY,
+                                             NULL));
+          cogl_object_unref (bitmap);
+        }
+    }
+
+  return thumbnail->texture;
+}
+
+RutClosure *
+rut_thumbnail_cache_add_ready_callback (RutThumbnailCache *cache,
+                                        RutThumbnailReadyCallback callback,
+                                        void *user_data,
+                                        RutClosureDestroyCallback destroy_cb)
+{
+  return rut_closure_list_add (&cache->ready_cb_list,
+                               callback,
+                               user_data,
+                               destroy_cb);
+}
+
+static int
+compare_thumbnails_cb (const void *a, const void *b)
+{
+  const Thumbnail *thumbnail_a = *(const Thumbnail **) a;
+  const Thumbnail *thumbnail_b = *(const Thumbnail **) b;
+
+  /* Put the thumbnails that have been used first so that if the atlas
+   * is full then it's the stale ones that get dropped */
+  return thumbnail_b->used - thumbnail_a->used;
+}
+
+CoglBool
+rut_thumbnail_cache_save (RutThumbnailCache *cache,
+                          GError **error)
+{
+  GHashTableIter iter;
+  Thumbnail *thumbnail;
+  GPtrArray *thumbnails;
+  FileHeader *header;
+  uint8_t *data, *p, *pixels;
+  size_t len, pixels_offset;
+  int n_entries, n_rows;
+  int rowstride;
+  char *dirname;
+  CoglBool ret;
+  int i, y;
+
+  thumbnails = g_ptr_array_new ();
+
+  g_hash_table_iter_init (&iter, cache->thumbnails);
+  while (g_hash_table_iter_next (&iter, NULL, (void **) &thumbnail))
+    if (thumbnail->width)
+      g_ptr_array_add (thumbnails, thumbnail);
+
+  g_ptr_array_sort (thumbnails, compare_thumbnails_cb);
+
+  n_entries = MIN (thumbnails->len, ATLAS_MAX_THUMBNAILS);
+  n_rows = MAX ((n_entries + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS, 1);
+  rowstride = ATLAS_WIDTH * 4;
+
+  len = sizeof (FileHeader);
+  for (i = 0; i < n_entries; i++)
+    {
+      thumbnail = g_ptr_array_index (thumbnails, i);
+      len += sizeof (FileEntry);
+      len += get_padded_path_len (strlen (thumbnail->path));
+    }
+  pixels_offset = get_pixels_offset (len);
+  len = pixels_offset + (size_t) rowstride * n_rows * RUT_THUMBNAIL_SIZE;
+
+  data = g_malloc0 (len);
+  header = (FileHeader *) data;
+
+  memcpy (header->magic, RUT_THUMBNAIL_CACHE_MAGIC,
+          sizeof (RUT_THUMBNAIL_CACHE_MAGIC));
+  header->version = RUT_THUMBNAIL_CACHE_VERSION;
+  header->thumbnail_size = RUT_THUMBNAIL_SIZE;
+  header->atlas_width = ATLAS_WIDTH;
+  header->atlas_height = n_rows * RUT_THUMBNAIL_SIZE;
+  header->n_entries = n_entries;
+
+  p = data + sizeof (FileHeader);
+  pixels = data + pixels_offset;
+
+  for (i = 0; i < n_entries; i++)
+    {
+      FileEntry *entry = (FileEntry *) p;
+      size_t path_len;
+      uint8_t *dst;
+
+      thumbnail = g_ptr_array_index (thumbnails, i);
+      path_len = strlen (thumbnail->path);
+
+      entry->mtime = thumbnail->mtime;
+      entry->size = thumbnail->size;
+      entry->x = (i % ATLAS_COLUMNS) * RUT_THUMBNAIL_SIZE;
+      entry->y = (i / ATLAS_COLUMNS) * RUT_THUMBNAIL_SIZE;
+      entry->width = thumbnail->width;
+      entry->height = thumbnail->height;
+      entry->path_len = path_len;
+
+      p += sizeof (FileEntry);
+      memcpy (p, thumbnail->path, path_len);
+      p += get_padded_path_len (path_len);
+
+      dst = pixels + entry->y * rowstride + entry->x * 4;
+      for (y = 0; y < thumbnail->height; y++)
+        memcpy (dst + y * rowstride,
+                thumbnail->pixels + y * thumbnail->rowstride,
+                thumbnail->width * 4);
+    }
+
+  g_ptr_array_free (thumbnails, TRUE);
+
+  dirname = g_path_get_dirname (cache->filename);
+  if (g_mkdir_with_parents (dirname, 0755) == -1)
+    {
+      g_set_error (error, G_FILE_ERROR,
+                   g_file_error_from_errno (errno),
+                   "Failed to create directory %s", dirname);
+      ret = FALSE;
+    }
+  else
+    ret = g_file_set_contents (cache->filename, (char *) data, len, error);
+
+  g_free (dirname);
+  g_free (data);
+
+  if (ret)
+    cache->dirty = FALSE;
+
+  return ret;
+}
+
+void
+rut_thumbnail_cache_free (RutThumbnailCache *cache)
+{
+  GHashTableIter iter;
+  ThumbnailJob *job;
+
+  if (cache->pool)
+    g_thread_pool_free (cache->pool,
+                        TRUE, /* drop queued jobs */
+                        TRUE); /* wait for running jobs */
+
+  /* Jobs that have finished have an idle callback queued which will
+   * free them. The rest will never run */
+  g_hash_table_iter_init (&iter, cache->pending);
+  while (g_hash_table_iter_next (&iter, NULL, (void **) &job))
+    {
+      if (job->done)
+        job->cache = NULL;
+      else
+        thumbnail_job_free (job);
+    }
+  g_hash_table_destroy (cache->pending);
+
+  if (cache->dirty)
+    rut_thumbnail_cache_save (cache, NULL);
+
+  rut_closure_list_disconnect_all (&cache->ready_cb_list);
+
+  /* The thumbnails may point into the mapped file */
+  g_hash_table_destroy (cache->thumbnails);
+
+  if (cache->atlas)
+    cogl_object_unref (cache->atlas);
+  if (cache->mapped_file)
+    g_mapped_file_unref (cache->mapped_file);
+
+  g_free (cache->filename);
+
+  g_slice_free (RutThumbnailCache, cache);
+}
@@ -0,0 +1,107 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RUT_THUMBNAIL_CACHE_H_
+#define _RUT_THUMBNAIL_CACHE_H_
+
+#include <glib.h>
+
+#include <cogl/cogl.h>
+
+#include "rut-context.h"
+#include "rut-closure.h"
+
+G_BEGIN_DECLS
+
+/*
+ * A persistent cache of small thumbnails of image assets so that
+ * something like an asset browser doesn't need to keep the full
+ * resolution textures around.
+ *
+ * All of the thumbnails are stored in a single file as one RGBA atlas
+ * which is uploaded as one texture when the cache is opened. Each
+ * thumbnail is keyed by the asset's path and is only used if the
+ * modification time and size of the image still match. Missing or
+ * out of date thumbnails are generated on a separate thread and the
+ * file is rewritten once there's nothing left to generate.
+ */
+
+/* The maximum width and height of a thumbnail */
+#define RUT_THUMBNAIL_SIZE 64
+
+typedef struct _RutThumbnailCache RutThumbnailCache;
+
+typedef void (*RutThumbnailReadyCallback) (RutThumbnailCache *cache,
+                                           const char *path,
+                                           void *user_data);
+
+/**
+ * rut_thumbnail_cache_new:
+ * @ctx: A #RutContext
+ * @filename: The file to load the thumbnails from and save them to
+ *
+ * Return value: A new cache. If @filename doesn't exist or can't be
+ *   read then the cache starts empty.
+ */
+RutThumbnailCache *
+rut_thumbnail_cache_new (RutContext *ctx,
+                         const char *filename);
+
+void
+rut_thumbnail_cache_free (RutThumbnailCache *cache);
+
+/**
+ * rut_thumbnail_cache_get:
+ * @cache: A #RutThumbnailCache
+ * @path: The key for the thumbnail, normally the asset path
+ * @image_filename: The image to create the thumbnail from
+ *
+ * Return value: The thumbnail of @image_filename or %NULL if there is
+ *   no up to date thumbnail yet. In that case the thumbnail will be
+ *   generated and the ready callbacks will be invoked with @path once
+ *   it is available. The texture is owned by the cache.
+ */
+CoglTexture *
+rut_thumbnail_cache_get (RutThumbnailCache *cache,
+                         const char *path,
+                         const char *image_filename);
+
+RutClosure *
+rut_thumbnail_cache_add_ready_callback (RutThumbnailCache *cache,
+                                        RutThumbnailReadyCallback callback,
+                                        void *user_data,
+                                        RutClosureDestroyCallback destroy_cb);
+
+/**
+ * rut_thumbnail_cache_save:
+ * @cache: A #RutThumbnailCache
+ * @error: Return location for an error
+ *
+ * Packs all of the thumbnails into a new atlas and writes it to the
+ * cache's file. This is done automatically after new thumbnails
+ * have been generated.
+ */
+CoglBool
+rut_thumbnail_cache_save (RutThumbnailCache *cache,
+                          GError **error);
+
+G_END_DECLS
+
+#endif /* _RUT_THUMBNAIL_CACHE_H_ */
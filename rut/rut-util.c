@@ -20,11 +20,15 @@
 
 #include <config.h>
 
+#include <string.h>
+#include <stdint.h>
+
 #include <glib.h>
 #include <cogl/cogl.h>
 
 #include "rut-global.h"
 #include "rut-mesh.h"
+#include "rut-mesh-bvh.h"
 #include "rut-util.h"
 
 /* Help macros to scale from OpenGL <-1,1> coordinates system to
@@ -262,47 +266,55 @@ rut_util_intersect_triangle (float v0[3], float v1[3], float v2[3],
   return TRUE;
 }
 
-typedef struct _IntersectState
-{
-  float *ray_origin;
-  float *ray_direction;
-  float min_t;
-  int index;
-  int hit_index;
-  bool found;
-} IntersectState;
-
-static CoglBool
-intersect_triangle_cb (void **attributes_v0,
-                       void **attributes_v1,
-                       void **attributes_v2,
-                       int index_v0,
-                       int index_v1,
-                       int index_v2,
-                       void *user_data)
+bool
+rut_util_intersect_box (float min[3], float max[3],
+                        float ray_origin[3], float ray_direction[3],
+                        float *t_near, float *t_far)
 {
-  IntersectState *state = user_data;
-  float *pos_v0 = attributes_v0[0];
-  float *pos_v1 = attributes_v1[0];
-  float *pos_v2 = attributes_v2[0];
-  float u, v, t;
-  bool hit;
-
-  hit = rut_util_intersect_triangle (pos_v0, pos_v1, pos_v2,
-                                     state->ray_origin,
-                                     state->ray_direction,
-                                     &u, &v, &t);
-
-  /* found a closer triangle. t > 0 means that we don't want results
-   * behind the ray origin */
-  if (hit && t > 0 && t < state->min_t)
+  float near = -G_MAXFLOAT;
+  float far = G_MAXFLOAT;
+  int i;
+
+  /* This uses the "slab" method where the ray is clipped against the
+   * pair of planes bounding the box on each axis in turn */
+  for (i = 0; i < 3; i++)
     {
-      state->min_t = t;
-      state->found = TRUE;
-      state->hit_index = state->index;
+      float pad = (max[i] - min[i]) * 0.0001f + EPSILON;
+      float slab_min = min[i] - pad;
+      float slab_max = max[i] + pad;
+
+      if (ray_direction[i] == 0)
+        {
+          /* The ray is parallel to the slab so it either always or
+           * never lies between the planes */
+          if (ray_origin[i] < slab_min || ray_origin[i] > slab_max)
+            return FALSE;
+        }
+      else
+        {
+          float inv_direction = 1.0f / ray_direction[i];
+          float t0 = (slab_min - ray_origin[i]) * inv_direction;
+          float t1 = (slab_max - ray_origin[i]) * inv_direction;
+
+          if (t0 > t1)
+            {
+              float tmp = t0;
+              t0 = t1;
+              t1 = tmp;
+            }
+
+          if (t0 > near)
+            near = t0;
+          if (t1 < far)
+            far = t1;
+
+          if (near > far)
+            return FALSE;
+        }
     }
 
-  state->index++;
+  *t_near = near;
+  *t_far = far;
 
   return TRUE;
 }
@@ -314,42 +326,195 @@ rut_util_intersect_mesh (RutMesh *mesh,
                          int *index,
                          float *t_out)
 {
-  IntersectState state;
+  /* Testing every triangle of a dense model is too slow to do
+   * interactively so we lazily build a hierarchy of the triangle
+   * bounds and cache it on the mesh */
+  if (mesh->bvh == NULL)
+    mesh->bvh = rut_mesh_bvh_new (mesh);
+
+  return rut_mesh_bvh_intersect_ray (mesh->bvh,
+                                     ray_origin,
+                                     ray_direction,
+                                     index,
+                                     t_out);
+}
 
-  state.ray_origin = ray_origin;
-  state.ray_direction = ray_direction;
-  state.min_t = G_MAXFLOAT;
-  state.found = FALSE;
-  state.index = 0;
+unsigned int
+rut_util_one_at_a_time_mix (unsigned int hash)
+{
+  hash += ( hash << 3 );
+  hash ^= ( hash >> 11 );
+  hash += ( hash << 15 );
 
-  rut_mesh_foreach_triangle (mesh,
-                             intersect_triangle_cb,
-                             &state,
-                             "cogl_position_in",
-                             NULL);
+  return hash;
+}
 
-  if (state.found)
+/* Buckets with this many elements or less are finished with an
+ * insertion sort instead of continuing to recurse */
+#define RADIX_SORT_INSERTION_THRESHOLD 32
+
+static inline uint64_t
+radix_sort_get_key (const uint8_t *element,
+                    size_t key_offset)
+{
+  uint64_t key;
+
+  /* NB: the elements aren't necessarily aligned for a 64-bit read */
+  memcpy (&key, element + key_offset, sizeof (key));
+
+  return key;
+}
+
+static void
+radix_sort_insertion (uint8_t *elements,
+                      size_t n_elements,
+                      size_t element_size,
+                      size_t key_offset,
+                      uint8_t *tmp)
+{
+  size_t i;
+
+  for (i = 1; i < n_elements; i++)
     {
-      if (t_out)
-        *t_out = state.min_t;
+      uint8_t *element = elements + i * element_size;
+      uint64_t key = radix_sort_get_key (element, key_offset);
+      size_t j = i;
+
+      if (radix_sort_get_key (element - element_size, key_offset) <= key)
+        continue;
 
-      if (index)
-        *index = state.hit_index;
+      memcpy (tmp, element, element_size);
 
-      return TRUE;
+      while (j > 0 &&
+             radix_sort_get_key (elements + (j - 1) * element_size,
+                                 key_offset) > key)
+        j--;
+
+      memmove (elements + (j + 1) * element_size,
+               elements + j * element_size,
+               (i - j) * element_size);
+      memcpy (elements + j * element_size, tmp, element_size);
     }
+}
 
-  return FALSE;
+/* This is an "American flag" sort which permutes the elements into
+ * their buckets in place for the digit at @shift and then recurses
+ * into each bucket for the next digit */
+static void
+radix_sort_range (uint8_t *elements,
+                  size_t n_elements,
+                  size_t element_size,
+                  size_t key_offset,
+                  int shift,
+                  uint8_t *tmp,
+                  uint8_t *tmp2)
+{
+  size_t counts[256] = { 0 };
+  size_t heads[256];
+  size_t tails[256];
+  size_t offset;
+  size_t i;
+  int bucket;
+
+  if (n_elements <= RADIX_SORT_INSERTION_THRESHOLD)
+    {
+      radix_sort_insertion (elements, n_elements,
+                            element_size, key_offset, tmp);
+      return;
+    }
+
+  for (i = 0; i < n_elements; i++)
+    {
+      uint64_t key = radix_sort_get_key (elements + i * element_size,
+                                         key_offset);
+      counts[(key >> shift) & 0xff]++;
+    }
+
+  offset = 0;
+  for (bucket = 0; bucket < 256; bucket++)
+    {
+      heads[bucket] = offset;
+      offset += counts[bucket];
+      tails[bucket] = offset;
+    }
+
+  /* If all of the elements have the same digit there's nothing to
+   * permute */
+  if (counts[(radix_sort_get_key (elements, key_offset) >> shift) & 0xff] !=
+      n_elements)
+    {
+      for (bucket = 0; bucket < 256; bucket++)
+        {
+          while (heads[bucket] < tails[bucket])
+            {
+              uint8_t *element = elements + heads[bucket] * element_size;
+              uint64_t key = radix_sort_get_key (element, key_offset);
+              int digit = (key >> shift) & 0xff;
+
+              if (digit == bucket)
+                {
+                  heads[bucket]++;
+                  continue;
+                }
+
+              /* Follow the cycle of displaced elements until we find
+               * one that belongs in this bucket */
+              memcpy (tmp, element, element_size);
+              do
+                {
+                  uint8_t *dest = elements + heads[digit] * element_size;
+
+                  heads[digit]++;
+
+                  memcpy (tmp2, dest, element_size);
+                  memcpy (dest, tmp, element_size);
+                  memcpy (tmp, tmp2, element_size);
+
+                  key = radix_sort_get_key (tmp, key_offset);
+                  digit = (key >> shift) & 0xff;
+                }
+              while (digit != bucket);
+
+              memcpy (element, tmp, element_size);
+              heads[bucket]++;
+            }
+        }
+    }
+
+  if (shift == 0)
+    return;
+
+  offset = 0;
+  for (bucket = 0; bucket < 256; bucket++)
+    {
+      if (counts[bucket] > 1)
+        radix_sort_range (elements + offset * element_size,
+                          counts[bucket],
+                          element_size,
+                          key_offset,
+                          shift - 8,
+                          tmp, tmp2);
+      offset += counts[bucket];
+    }
 }
 
-unsigned int
-rut_util_one_at_a_time_mix (unsigned int hash)
+void
+rut_util_radix_sort (void *elements,
+                     size_t n_elements,
+                     size_t element_size,
+                     size_t key_offset)
 {
-  hash += ( hash << 3 );
-  hash ^= ( hash >> 11 );
-  hash += ( hash << 15 );
+  uint8_t *tmp;
 
-  return hash;
+  if (n_elements < 2)
+    return;
+
+  tmp = g_alloca (element_size * 2);
+
+  radix_sort_range (elements, n_elements,
+                    element_size, key_offset,
+                    56, /* start with the most significant byte */
+                    tmp, tmp + element_size);
 }
 
 CoglPipeline *
@@ -93,6 +93,18 @@ bool
 rut_util_intersect_triangle (float v0[3], float v1[3], float v2[3],
                              float ray_origin[3], float ray_direction[3],
                              float *u, float *v, float *t);
+/*
+ * Tests whether a ray intersects the axis aligned box between @min
+ * and @max. If it does then the ray parameters where it enters and
+ * leaves the box are returned in @t_near and @t_far. The box is
+ * padded slightly so that a ray which hits a triangle lying on the
+ * surface of the box is never rejected due to rounding errors.
+ */
+bool
+rut_util_intersect_box (float min[3], float max[3],
+                        float ray_origin[3], float ray_direction[3],
+                        float *t_near, float *t_far);
+
 bool
 rut_util_intersect_model (const void       *vertices,
                           int               n_points,
@@ -139,6 +151,19 @@ rut_util_draw_jittered_primitive3f (CoglFramebuffer *fb,
                                     float green,
                                     float blue);
 
+/*
+ * Sorts an array of @n_elements elements of @element_size bytes in
+ * place according to an unsigned 64-bit key stored at @key_offset
+ * bytes into each element. This uses an in-place MSD radix sort so
+ * unlike qsort it doesn't need to call back into a comparison
+ * function. The sort is not stable.
+ */
+void
+rut_util_radix_sort (void *elements,
+                     size_t n_elements,
+                     size_t element_size,
+                     size_t key_offset);
+
 CoglBool
 rut_util_find_tag (const GList *tags,
                    const char *tag);
@@ -0,0 +1,615 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "rut.h"
+#include "rut-virtual-grid.h"
+
+/* The number of extra rows above and below the viewport that have
+ * cells so that there is something to show straight away when
+ * scrolling a small amount */
+#define RUT_VIRTUAL_GRID_OVERSCAN_ROWS 1
+
+typedef struct
+{
+  RutList link;
+
+  RutTransform *transform;
+  RutObject *widget;
+
+  /* The item that the cell is showing or -1 if it is in the pool */
+  int index;
+} RutVirtualGridCell;
+
+struct _RutVirtualGrid
+{
+  RutObjectProps _parent;
+
+  RutContext *context;
+
+  RutList preferred_size_cb_list;
+
+  float width, height;
+
+  float cell_width, cell_height;
+  float x_padding, y_padding;
+
+  int n_items;
+
+  RutUIViewport *viewport;
+  /* This is bound to the scroll position and size of the viewport so
+   * that the visible cells can be updated when they change */
+  RutProperty viewport_prop;
+  /* The ages of the world transforms of the grid and the viewport
+   * when the visible rows were last worked out. These are checked
+   * when painting to catch the grid moving within the viewport
+   * without scrolling, such as when something above it resizes */
+  unsigned int grid_transform_age;
+  unsigned int viewport_transform_age;
+
+  /* The cells that are showing an item, sorted by index */
+  RutList cells;
+  /* Cells that aren't showing anything and can be reused */
+  RutList pool;
+
+  RutVirtualGridCreateCallback create_cb;
+  RutVirtualGridBindCallback bind_cb;
+  RutVirtualGridBindCallback unbind_cb;
+  void *user_data;
+
+  RutGraphableProps graphable;
+  RutPaintableProps paintable;
+
+  int ref_count;
+};
+
+static RutPropertySpec
+viewport_property_spec =
+  {
+    .name = "viewport",
+    .flags = RUT_PROPERTY_FLAG_READWRITE,
+    .type = RUT_PROPERTY_TYPE_FLOAT,
+    .data_offset = offsetof (RutVirtualGrid, ref_count),
+    .setter.any_type = abort,
+    .getter.any_type = abort
+  };
+
+RutType rut_virtual_grid_type;
+
+static void
+release_cell (RutVirtualGrid *grid,
+              RutVirtualGridCell *cell)
+{
+  grid->unbind_cb (grid, cell->widget, cell->index, grid->user_data);
+  cell->index = -1;
+
+  rut_graphable_remove_child (cell->transform);
+
+  rut_list_remove (&cell->link);
+  rut_list_insert (&grid->pool, &cell->link);
+}
+
+static void
+release_all_cells (RutVirtualGrid *grid)
+{
+  RutVirtualGridCell *cell, *tmp;
+
+  rut_list_for_each_safe (cell, tmp, &grid->cells, link)
+    release_cell (grid, cell);
+}
+
+static RutVirtualGridCell *
+acquire_cell (RutVirtualGrid *grid)
+{
+  RutVirtualGridCell *cell;
+
+  if (!rut_list_empty (&grid->pool))
+    {
+      cell = rut_container_of (grid->pool.next, cell, link);
+      rut_list_remove (&cell->link);
+    }
+  else
+    {
+      cell = g_slice_new (RutVirtualGridCell);
+      cell->widget = grid->create_cb (grid, grid->user_data);
+      cell->transform = rut_transform_new (grid->context);
+      rut_graphable_add_child (cell->transform, cell->widget);
+    }
+
+  rut_graphable_add_child (grid, cell->transform);
+
+  return cell;
+}
+
+static void
+free_cell (RutVirtualGridCell *cell)
+{
+  rut_graphable_remove_child (cell->widget);
+  rut_refable_unref (cell->widget);
+
+  rut_graphable_remove_child (cell->transform);
+  rut_refable_unref (cell->transform);
+
+  g_slice_free (RutVirtualGridCell, cell);
+}
+
+static void
+_rut_virtual_grid_free (void *object)
+{
+  RutVirtualGrid *grid = object;
+  RutVirtualGridCell *cell, *tmp;
+
+  rut_closure_list_disconnect_all (&grid->preferred_size_cb_list);
+
+  rut_property_destroy (&grid->viewport_prop);
+
+  release_all_cells (grid);
+
+  rut_list_for_each_safe (cell, tmp, &grid->pool, link)
+    free_cell (cell);
+
+  rut_shell_remove_pre_paint_callback (grid->context->shell, grid);
+
+  rut_refable_unref (grid->context);
+
+  rut_graphable_destroy (grid);
+
+  g_slice_free (RutVirtualGrid, grid);
+}
+
+RutRefCountableVTable _rut_virtual_grid_ref_countable_vtable = {
+  rut_refable_simple_ref,
+  rut_refable_simple_unref,
+  _rut_virtual_grid_free
+};
+
+static RutGraphableVTable _rut_virtual_grid_graphable_vtable = {
+  NULL, /* child removed */
+  NULL, /* child addded */
+  NULL /* parent changed */
+};
+
+static int
+get_n_columns (RutVirtualGrid *grid,
+               float width)
+{
+  if (width < 0)
+    return MAX (grid->n_items, 1);
+
+  return MAX ((int) ((width + grid->x_padding) /
+                     (grid->cell_width + grid->x_padding)),
+              1);
+}
+
+static int
+get_n_rows (RutVirtualGrid *grid,
+            int n_columns)
+{
+  return (grid->n_items + n_columns - 1) / n_columns;
+}
+
+/* Works out which rows can be seen through the viewport by mapping
+ * the viewport's rectangle into the coordinate space of the grid */
+static void
+get_visible_rows (RutVirtualGrid *grid,
+                  int n_rows,
+                  int *first_row,
+                  int *end_row)
+{
+  const CoglMatrix *viewport_transform;
+  CoglMatrix inverse, transform;
+  float row_height = grid->cell_height + grid->y_padding;
+  float min_y = G_MAXFLOAT, max_y = -G_MAXFLOAT;
+  float viewport_width, viewport_height;
+  int i;
+
+  *first_row = 0;
+  *end_row = n_rows;
+
+  if (grid->viewport == NULL)
+    return;
+
+  grid->grid_transform_age = rut_graphable_get_world_transform_age (grid);
+  grid->viewport_transform_age =
+    rut_graphable_get_world_transform_age (grid->viewport);
+
+  if (row_height <= 0)
+    return;
+
+  if (!cogl_matrix_get_inverse (rut_graphable_get_world_transform (grid),
+                                &inverse))
+    return;
+
+  viewport_transform = rut_graphable_get_world_transform (grid->viewport);
+  cogl_matrix_multiply (&transform, &inverse, viewport_transform);
+
+  viewport_width = rut_ui_viewport_get_width (grid->viewport);
+  viewport_height = rut_ui_viewport_get_height (grid->viewport);
+
+  for (i = 0; i < 4; i++)
+    {
+      float x = (i & 1) ? viewport_width : 0;
+      float y = (i & 2) ? viewport_height : 0;
+      float z = 0, w = 1;
+
+      cogl_matrix_transform_point (&transform, &x, &y, &z, &w);
+
+      min_y = MIN (min_y, y / w);
+      max_y = MAX (max_y, y / w);
+    }
+
+  *first_row = floorf (min_y / row_height) - RUT_VIRTUAL_GRID_OVERSCAN_ROWS;
+  *end_row = ceilf (max_y / row_height) + RUT_VIRTUAL_GRID_OVERSCAN_ROWS;
+
+  *first_row = CLAMP (*first_row, 0, n_rows);
+  *end_row = CLAMP (*end_row, *first_row, n_rows);
+}
+
+static void
+position_cell (RutVirtualGrid *grid,
+               RutVirtualGridCell *cell,
+               int n_columns)
+{
+  int column = cell->index % n_columns;
+  int row = cell->index / n_columns;
+
+  rut_transform_init_identity (cell->transform);
+  rut_transform_translate (cell->transform,
+                           column * (grid->cell_width + grid->x_padding),
+                           row * (grid->cell_height + grid->y_padding),
+                           0.0f);
+  rut_sizable_set_size (cell->widget, grid->cell_width, grid->cell_height);
+}
+
+static void
+allocate_cb (RutObject *graphable,
+             void *user_data)
+{
+  RutVirtualGrid *grid = graphable;
+  int n_columns = get_n_columns (grid, grid->width);
+  int n_rows = get_n_rows (grid, n_columns);
+  int first_row, end_row;
+  int first, end, index;
+  RutVirtualGridCell *cell, *tmp;
+  RutList *pos;
+
+  get_visible_rows (grid, n_rows, &first_row, &end_row);
+
+  first = first_row * n_columns;
+  end = MIN (end_row * n_columns, grid->n_items);
+
+  /* Put any cells that have scrolled out of view back in the pool
+   * first so they can be reused for the cells that have scrolled in */
+  rut_list_for_each_safe (cell, tmp, &grid->cells, link)
+    if (cell->index < first || cell->index >= end)
+      release_cell (grid, cell);
+
+  pos = grid->cells.next;
+
+  for (index = first; index < end; index++)
+    {
+      if (pos != &grid->cells)
+        cell = rut_container_of (pos, cell, link);
+      else
+        cell = NULL;
+
+      if (cell && cell->index == index)
+        pos = pos->next;
+      else
+        {
+          cell = acquire_cell (grid);
+          cell->index = index;
+          rut_list_insert (pos->prev, &cell->link);
+
+          grid->bind_cb (grid, cell->widget, index, grid->user_data);
+        }
+
+      position_cell (grid, cell, n_columns);
+    }
+}
+
+static void
+queue_allocation (RutVirtualGrid *grid)
+{
+  rut_shell_add_pre_paint_callback (grid->context->shell,
+                                    grid,
+                                    allocate_cb,
+                                    NULL /* user_data */);
+}
+
+static void
+preferred_size_changed (RutVirtualGrid *grid)
+{
+  rut_closure_list_invoke (&grid->preferred_size_cb_list,
+                           RutSizablePreferredSizeCallback,
+                           grid);
+}
+
+static void
+rut_virtual_grid_set_size (void *object,
+                           float width,
+                           float height)
+{
+  RutVirtualGrid *grid = object;
+
+  if (width == grid->width && height == grid->height)
+    return;
+
+  grid->width = width;
+  grid->height = height;
+
+  queue_allocation (grid);
+}
+
+static void
+rut_virtual_grid_get_size (void *object,
+                           float *width,
+                           float *height)
+{
+  RutVirtualGrid *grid = object;
+
+  *width = grid->width;
+  *height = grid->height;
+}
+
+static void
+rut_virtual_grid_get_preferred_width (void *sizable,
+                                      float for_height,
+                                      float *min_width_p,
+                                      float *natural_width_p)
+{
+  RutVirtualGrid *grid = sizable;
+
+  /* Like a flow layout, the natural width puts everything on one
+   * line and the minimum width is a single column */
+  if (min_width_p)
+    *min_width_p = grid->cell_width;
+  if (natural_width_p)
+    {
+      if (grid->n_items > 0)
+        *natural_width_p = (grid->n_items * grid->cell_width +
+                            (grid->n_items - 1) * grid->x_padding);
+      else
+        *natural_width_p = 0;
+    }
+}
+
+static void
+rut_virtual_grid_get_preferred_height (void *sizable,
+                                       float for_width,
+                                       float *min_height_p,
+                                       float *natural_height_p)
+{
+  RutVirtualGrid *grid = sizable;
+  int n_rows = get_n_rows (grid, get_n_columns (grid, for_width));
+  float height = 0;
+
+  if (n_rows > 0)
+    height = n_rows * grid->cell_height + (n_rows - 1) * grid->y_padding;
+
+  if (min_height_p)
+    *min_height_p = height;
+  if (natural_height_p)
+    *natural_height_p = height;
+}
+
+static RutClosure *
+rut_virtual_grid_add_preferred_size_callback (void *object,
+                                              RutSizablePreferredSizeCallback cb,
+                                              void *user_data,
+                                              RutClosureDestroyCallback destroy)
+{
+  RutVirtualGrid *grid = object;
+
+  return rut_closure_list_add (&grid->preferred_size_cb_list,
+                               cb,
+                               user_data,
+                               destroy);
+}
+
+static RutSizableVTable _rut_virtual_grid_sizable_vtable = {
+  rut_virtual_grid_set_size,
+  rut_virtual_grid_get_size,
+  rut_virtual_grid_get_preferred_width,
+  rut_virtual_grid_get_preferred_height,
+  rut_virtual_grid_add_preferred_size_callback
+};
+
+static void
+_rut_virtual_grid_paint (RutObject *object,
+                         RutPaintContext *paint_ctx)
+{
+  RutVirtualGrid *grid = object;
+
+  /* The grid doesn't draw anything itself. If it has moved relative
+   * to the viewport since the visible rows were worked out then they
+   * are recomputed for the next frame */
+  if (grid->viewport &&
+      (rut_graphable_get_world_transform_age (grid) !=
+       grid->grid_transform_age ||
+       rut_graphable_get_world_transform_age (grid->viewport) !=
+       grid->viewport_transform_age))
+    {
+      queue_allocation (grid);
+      rut_shell_queue_redraw (grid->context->shell);
+    }
+}
+
+static RutPaintableVTable _rut_virtual_grid_paintable_vtable = {
+  _rut_virtual_grid_paint
+};
+
+static void
+_rut_virtual_grid_init_type (void)
+{
+  rut_type_init (&rut_virtual_grid_type, "RutVirtualGrid");
+  rut_type_add_interface (&rut_virtual_grid_type,
+                          RUT_INTERFACE_ID_REF_COUNTABLE,
+                          offsetof (RutVirtualGrid, ref_count),
+                          &_rut_virtual_grid_ref_countable_vtable);
+  rut_type_add_interface (&rut_virtual_grid_type,
+                          RUT_INTERFACE_ID_GRAPHABLE,
+                          offsetof (RutVirtualGrid, graphable),
+                          &_rut_virtual_grid_graphable_vtable);
+  rut_type_add_interface (&rut_virtual_grid_type,
+                          RUT_INTERFACE_ID_PAINTABLE,
+                          offsetof (RutVirtualGrid, paintable),
+                          &_rut_virtual_grid_paintable_vtable);
+  rut_type_add_interface (&rut_virtual_grid_type,
+                          RUT_INTERFACE_ID_SIZABLE,
+                          0, /* no implied properties */
+                          &_rut_virtual_grid_sizable_vtable);
+}
+
+RutVirtualGrid *
+rut_virtual_grid_new (RutContext *ctx,
+                      float cell_width,
+                      float cell_height,
+                      RutVirtualGridCreateCallback create_cb,
+                      RutVirtualGridBindCallback bind_cb,
+                      RutVirtualGridBindCallback unbind_cb,
+                      void *user_data)
+{
+  RutVirtualGrid *grid = g_slice_new0 (RutVirtualGrid);
+  static CoglBool initialized = FALSE;
+
+  if (initialized == FALSE)
+    {
+      _rut_virtual_grid_init_type ();
+      initialized = TRUE;
+    }
+
+  grid->ref_count = 1;
+  grid->context = rut_refable_ref (ctx);
+
+  grid->cell_width = cell_width;
+  grid->cell_height = cell_height;
+
+  grid->create_cb = create_cb;
+  grid->bind_cb = bind_cb;
+  grid->unbind_cb = unbind_cb;
+  grid->user_data = user_data;
+
+  rut_list_init (&grid->preferred_size_cb_list);
+  rut_list_init (&grid->cells);
+  rut_list_init (&grid->pool);
+
+  rut_object_init (&grid->_parent, &rut_virtual_grid_type);
+
+  rut_graphable_init (RUT_OBJECT (grid));
+  rut_paintable_init (RUT_OBJECT (grid));
+
+  rut_property_init (&grid->viewport_prop,
+                     &viewport_property_spec,
+                     grid);
+
+  return grid;
+}
+
+static void
+viewport_changed_cb (RutProperty *target_property,
+                     RutProperty *source_property,
+                     void *user_data)
+{
+  queue_allocation (user_data);
+}
+
+void
+rut_virtual_grid_set_viewport (RutVirtualGrid *grid,
+                               RutUIViewport *viewport)
+{
+  if (grid->viewport == viewport)
+    return;
+
+  /* Passing a NULL callback removes the existing binding */
+  if (grid->viewport)
+    rut_property_set_binding (&grid->viewport_prop, NULL, NULL, NULL);
+
+  /* No reference is taken on the viewport because the grid is
+   * normally one of its descendants */
+  grid->viewport = viewport;
+
+  if (viewport)
+    {
+      rut_property_set_binding (&grid->viewport_prop,
+                                viewport_changed_cb,
+                                grid,
+                                rut_introspectable_lookup_property (viewport,
+                                                                    "doc-x"),
+                                rut_introspectable_lookup_property (viewport,
+                                                                    "doc-y"),
+                                rut_introspectable_lookup_property (viewport,
+                                                                    "width"),
+                                rut_introspectable_lookup_property (viewport,
+                                                                    "height"),
+                                NULL);
+    }
+
+  queue_allocation (grid);
+}
+
+void
+rut_virtual_grid_set_n_items (RutVirtualGrid *grid,
+                              int n_items)
+{
+  release_all_cells (grid);
+
+  grid->n_items = n_items;
+
+  preferred_size_changed (grid);
+  queue_allocation (grid);
+}
+
+int
+rut_virtual_grid_get_n_items (RutVirtualGrid *grid)
+{
+  return grid->n_items;
+}
+
+void
+rut_virtual_grid_set_x_padding (RutVirtualGrid *grid,
+                                float x_padding)
+{
+  if (grid->x_padding == x_padding)
+    return;
+
+  grid->x_padding = x_padding;
+
+  preferred_size_changed (grid);
+  queue_allocation (grid);
+}
+
+void
+rut_virtual_grid_set_y_padding (RutVirtualGrid *grid,
+                                float y_padding)
+{
+  if (grid->y_padding == y_padding)
+    return;
+
+  grid->y_padding = y_padding;
+
+  preferred_size_changed (grid);
+  queue_allocation (grid);
+}
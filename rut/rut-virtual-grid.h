@@ -0,0 +1,108 @@
+/*
+ * Rut
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _RUT_VIRTUAL_GRID_H_
+#define _RUT_VIRTUAL_GRID_H_
+
+#include "rut-type.h"
+#include "rut-object.h"
+#include "rut-context.h"
+#include "rut-ui-viewport.h"
+
+/*
+ * RutVirtualGrid lays out a large number of items as a grid of fixed
+ * size cells that wraps to its width, like a #RutFlowLayout with
+ * homogeneous children. Instead of having a widget for every item it
+ * only creates widgets for the rows that can be seen through a
+ * #RutUIViewport. When a cell is scrolled out of view its widget is
+ * put in a pool and is reused for the next item that scrolls into
+ * view so the number of widgets only depends on the size of the
+ * viewport.
+ *
+ * The application supplies a callback to create an empty cell
+ * widget and callbacks to make a cell show a particular item and to
+ * release it again.
+ */
+
+extern RutType rut_virtual_grid_type;
+
+typedef struct _RutVirtualGrid RutVirtualGrid;
+
+#define RUT_VIRTUAL_GRID(x) ((RutVirtualGrid *) x)
+
+/* Returns a new sizable widget that can be used for any item. The
+ * grid takes ownership of the reference */
+typedef RutObject *(*RutVirtualGridCreateCallback) (RutVirtualGrid *grid,
+                                                    void *user_data);
+
+/* Called when @cell is about to show @index or when it stops
+ * showing it and is put back in the pool */
+typedef void (*RutVirtualGridBindCallback) (RutVirtualGrid *grid,
+                                            RutObject *cell,
+                                            int index,
+                                            void *user_data);
+
+RutVirtualGrid *
+rut_virtual_grid_new (RutContext *ctx,
+                      float cell_width,
+                      float cell_height,
+                      RutVirtualGridCreateCallback create_cb,
+                      RutVirtualGridBindCallback bind_cb,
+                      RutVirtualGridBindCallback unbind_cb,
+                      void *user_data);
+
+/**
+ * rut_virtual_grid_set_viewport:
+ * @grid: A #RutVirtualGrid
+ * @viewport: The viewport that @grid is shown through or %NULL
+ *
+ * Sets the viewport that is used to work out which cells are visible.
+ * The grid doesn't need to be a direct child of the viewport. If
+ * there is no viewport then a cell is created for every item.
+ */
+void
+rut_virtual_grid_set_viewport (RutVirtualGrid *grid,
+                               RutUIViewport *viewport);
+
+/**
+ * rut_virtual_grid_set_n_items:
+ * @grid: A #RutVirtualGrid
+ * @n_items: The number of items in the grid
+ *
+ * Sets the number of items. All of the visible cells are released and
+ * bound again so this can also be used when the items have changed.
+ */
+void
+rut_virtual_grid_set_n_items (RutVirtualGrid *grid,
+                              int n_items);
+
+int
+rut_virtual_grid_get_n_items (RutVirtualGrid *grid);
+
+void
+rut_virtual_grid_set_x_padding (RutVirtualGrid *grid,
+                                float x_padding);
+
+void
+rut_virtual_grid_set_y_padding (RutVirtualGrid *grid,
+                                float y_padding);
+
+#endif /* _RUT_VIRTUAL_GRID_H_ */
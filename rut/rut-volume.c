@@ -335,7 +335,7 @@ rut_volume_union (RutVolume *volume,
   /* left vertices 0, 3, 4, 7 */
   if (another_volume->vertices[0].x < volume->vertices[0].x)
     {
-      int min_x = another_volume->vertices[0].x;
+      float min_x = another_volume->vertices[0].x;
       volume->vertices[0].x = min_x;
       volume->vertices[3].x = min_x;
       volume->vertices[4].x = min_x;
@@ -346,7 +346,7 @@ rut_volume_union (RutVolume *volume,
   /* right vertices 1, 2, 5, 6 */
   if (another_volume->vertices[1].x > volume->vertices[1].x)
     {
-      int max_x = another_volume->vertices[1].x;
+      float max_x = another_volume->vertices[1].x;
       volume->vertices[1].x = max_x;
       /* volume->vertices[2].x = max_x; */
       /* volume->vertices[5].x = max_x; */
@@ -357,7 +357,7 @@ rut_volume_union (RutVolume *volume,
   /* top vertices 0, 1, 4, 5 */
   if (another_volume->vertices[0].y < volume->vertices[0].y)
     {
-      int min_y = another_volume->vertices[0].y;
+      float min_y = another_volume->vertices[0].y;
       volume->vertices[0].y = min_y;
       volume->vertices[1].y = min_y;
       volume->vertices[4].y = min_y;
@@ -368,7 +368,7 @@ rut_volume_union (RutVolume *volume,
   /* bottom vertices 2, 3, 6, 7 */
   if (another_volume->vertices[3].y > volume->vertices[3].y)
     {
-      int may_y = another_volume->vertices[3].y;
+      float may_y = another_volume->vertices[3].y;
       /* volume->vertices[2].y = may_y; */
       volume->vertices[3].y = may_y;
       /* volume->vertices[6].y = may_y; */
@@ -379,7 +379,7 @@ rut_volume_union (RutVolume *volume,
   /* front vertices 0, 1, 2, 3 */
   if (another_volume->vertices[0].z < volume->vertices[0].z)
     {
-      int min_z = another_volume->vertices[0].z;
+      float min_z = another_volume->vertices[0].z;
       volume->vertices[0].z = min_z;
       volume->vertices[1].z = min_z;
       /* volume->vertices[2].z = min_z; */
@@ -390,7 +390,7 @@ rut_volume_union (RutVolume *volume,
   /* back vertices 4, 5, 6, 7 */
   if (another_volume->vertices[4].z > volume->vertices[4].z)
     {
-      int maz_z = another_volume->vertices[4].z;
+      float maz_z = another_volume->vertices[4].z;
       volume->vertices[4].z = maz_z;
       /* volume->vertices[5].z = maz_z; */
       /* volume->vertices[6].z = maz_z; */
@@ -475,8 +475,8 @@ _rut_volume_complete (RutVolume *volume)
  * rut_box_clamp_to_pixel()</note>
  */
 void
-_rut_volume_get_bounding_box (RutVolume *volume,
-                              RutBox *box)
+rut_volume_get_bounding_box (RutVolume *volume,
+                             RutBox *box)
 {
   float x_min, y_min, x_max, y_max;
   RutVector3 *vertices;
@@ -529,10 +529,10 @@ _rut_volume_get_bounding_box (RutVolume *volume,
 }
 
 void
-_rut_volume_project (RutVolume *volume,
-                     const CoglMatrix *modelview,
-                     const CoglMatrix *projection,
-                     const float *viewport)
+rut_volume_project (RutVolume *volume,
+                    const CoglMatrix *modelview,
+                    const CoglMatrix *projection,
+                    const float *viewport)
 {
   int transform_count;
 
@@ -570,8 +570,8 @@ _rut_volume_project (RutVolume *volume,
 }
 
 void
-_rut_volume_transform (RutVolume *volume,
-                       const CoglMatrix *matrix)
+rut_volume_transform (RutVolume *volume,
+                      const CoglMatrix *matrix)
 {
   int transform_count;
 
@@ -760,12 +760,12 @@ _rut_volume_get_stable_bounding_int_rectangle (RutVolume *volume,
 
   _rut_volume_copy_static (volume, &projected_volume);
 
-  _rut_volume_project (&projected_volume,
-                       modelview,
-                       projection,
-                       viewport);
+  rut_volume_project (&projected_volume,
+                      modelview,
+                      projection,
+                      viewport);
 
-  _rut_volume_get_bounding_box (&projected_volume, box);
+  rut_volume_get_bounding_box (&projected_volume, box);
 
   /* The aim here is that for a given rectangle defined with floating point
    * coordinates we want to determine a stable quantized size in pixels
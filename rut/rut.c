@@ -39,6 +39,7 @@
 #include "rut-context.h"
 #include "rut-camera-private.h"
 #include "rut-transform-private.h"
+#include "rut-texture-cache-private.h"
 #include "rut-text.h"
 #include "rut-timeline.h"
 #include "rut-text-buffer.h"
@@ -46,12 +47,26 @@
 #include "rut-components.h"
 #include "rut-geometry.h"
 #include "rut-scroll-bar.h"
+#include "rut-profile.h"
+
+/* The amount of memory that released textures can keep using unless
+ * rut_set_texture_cache_budget() is called */
+#define RUT_TEXTURE_CACHE_DEFAULT_BUDGET (64 * 1024 * 1024)
 
 typedef struct _RutTextureCacheEntry
 {
+  /* This is cleared if the context is destroyed before the texture */
   RutContext *ctx;
   char *filename;
   CoglTexture *texture;
+
+  /* Estimated size of the texture in GPU memory */
+  size_t size;
+
+  /* Whether the cache holds a reference on the texture. If so the
+   * entry is linked into ctx->texture_cache_lru */
+  CoglBool cached;
+  RutList lru_link;
 } RutTextureCacheEntry;
 #define RUT_TEXTURE_CACHE_ENTRY(X) ((RutTextureCacheEntry *)X)
 
@@ -165,6 +180,121 @@ rut_settings_get_font_name (RutSettings *settings)
   return g_strdup ("Sans 12");
 }
 
+static void
+_rut_texture_cache_entry_free (RutTextureCacheEntry *entry)
+{
+  g_free (entry->filename);
+  g_slice_free (RutTextureCacheEntry, entry);
+}
+
+static void
+texture_destroyed_cb (void *user_data)
+{
+  RutTextureCacheEntry *entry = user_data;
+
+  if (entry->ctx)
+    g_hash_table_remove (entry->ctx->texture_cache, entry->filename);
+
+  _rut_texture_cache_entry_free (entry);
+}
+
+static void
+_rut_texture_cache_uncache_entry (RutContext *ctx,
+                                  RutTextureCacheEntry *entry)
+{
+  rut_list_remove (&entry->lru_link);
+  entry->cached = FALSE;
+  ctx->texture_cache_stats.resident_bytes -= entry->size;
+
+  /* If nothing else is using the texture then this will free the
+   * entry too */
+  cogl_object_unref (entry->texture);
+}
+
+/* Drops the cache's reference on the least recently used textures
+ * until the cache is within its budget */
+static void
+_rut_texture_cache_trim (RutContext *ctx)
+{
+  while (ctx->texture_cache_stats.resident_bytes >
+         ctx->texture_cache_budget &&
+         !rut_list_empty (&ctx->texture_cache_lru))
+    {
+      RutTextureCacheEntry *entry =
+        rut_container_of (ctx->texture_cache_lru.prev, entry, lru_link);
+
+      ctx->texture_cache_stats.evictions++;
+      _rut_texture_cache_uncache_entry (ctx, entry);
+    }
+}
+
+static void
+_rut_texture_cache_destroy (RutContext *ctx)
+{
+  GHashTableIter iter;
+  RutTextureCacheEntry *entry;
+
+  while (!rut_list_empty (&ctx->texture_cache_lru))
+    {
+      entry = rut_container_of (ctx->texture_cache_lru.next, entry, lru_link);
+      _rut_texture_cache_uncache_entry (ctx, entry);
+    }
+
+  /* The remaining textures are still in use elsewhere so their
+   * entries will be freed when they are destroyed */
+  g_hash_table_iter_init (&iter, ctx->texture_cache);
+  while (g_hash_table_iter_next (&iter, NULL, (void **) &entry))
+    entry->ctx = NULL;
+
+  g_hash_table_destroy (ctx->texture_cache);
+}
+
+static size_t
+get_texture_size (CoglTexture *texture)
+{
+  size_t bpp;
+
+  switch (cogl_texture_get_format (texture) & ~COGL_PREMULT_BIT)
+    {
+    case COGL_PIXEL_FORMAT_A_8:
+    case COGL_PIXEL_FORMAT_G_8:
+      bpp = 1;
+      break;
+    case COGL_PIXEL_FORMAT_RGB_565:
+    case COGL_PIXEL_FORMAT_RGBA_4444:
+    case COGL_PIXEL_FORMAT_RGBA_5551:
+      bpp = 2;
+      break;
+    case COGL_PIXEL_FORMAT_RGB_888:
+    case COGL_PIXEL_FORMAT_BGR_888:
+      bpp = 3;
+      break;
+    default:
+      bpp = 4;
+      break;
+    }
+
+  /* This doesn't account for mipmaps or any padding the driver adds
+   * but it's good enough to compare textures with each other */
+  return ((size_t) cogl_texture_get_width (texture) *
+          cogl_texture_get_height (texture) * bpp);
+}
+
+void
+rut_set_texture_cache_budget (RutContext *ctx,
+                              size_t budget)
+{
+  ctx->texture_cache_budget = budget;
+  _rut_texture_cache_trim (ctx);
+}
+
+void
+rut_get_texture_cache_stats (RutContext *ctx,
+                             RutTextureCacheStats *stats)
+{
+  *stats = ctx->texture_cache_stats;
+}
+
 static void
 _rut_context_free (void *object)
 {
@@ -176,7 +306,17 @@ _rut_context_free (void *object)
   g_object_unref (ctx->pango_font_map);
   pango_font_description_free (ctx->pango_font_desc);
 
-  g_hash_table_destroy (ctx->texture_cache);
+  /* The queued loads are still handed to the threads so that they
+   * can drop their references but they won't be decoded */
+  if (ctx->asset_decode_pool)
+    {
+      g_atomic_int_set (&ctx->asset_decode_cancelled, TRUE);
+      g_thread_pool_free (ctx->asset_decode_pool,
+                          FALSE, /* run the queued jobs */
+                          TRUE); /* wait for them */
+    }
+
+  _rut_texture_cache_destroy (ctx);
 
   if (rut_cogl_context == ctx->cogl_context)
     {
@@ -209,28 +349,6 @@ _rut_context_init_type (void)
                           &_rut_context_ref_countable_vtable);
 }
 
-static void
-_rut_texture_cache_entry_free (RutTextureCacheEntry *entry)
-{
-  g_free (entry->filename);
-  g_slice_free (RutTextureCacheEntry, entry);
-}
-
-static void
-_rut_texture_cache_entry_destroy_cb (void *entry)
-{
-  _rut_texture_cache_entry_free (entry);
-}
-
-static void
-texture_destroyed_cb (void *user_data)
-{
-  RutTextureCacheEntry *entry = user_data;
-
-  g_hash_table_remove (entry->ctx->texture_cache, entry->filename);
-  _rut_texture_cache_entry_free (entry);
-}
-
 char *
 rut_find_data_file (const char *base_filename)
 {
@@ -251,41 +369,108 @@ rut_find_data_file (const char *base_filename)
   return NULL;
 }
 
+/* Moves the entry's texture to the front of the LRU, taking a new
+ * reference if it had been dropped from the cache while something
+ * else was still using it. Returns a reference for the caller */
+static CoglTexture *
+_rut_texture_cache_use_entry (RutContext *ctx,
+                              RutTextureCacheEntry *entry)
+{
+  if (entry->cached)
+    rut_list_remove (&entry->lru_link);
+  else
+    {
+      cogl_object_ref (entry->texture);
+      entry->cached = TRUE;
+      ctx->texture_cache_stats.resident_bytes += entry->size;
+    }
+  rut_list_insert (&ctx->texture_cache_lru, &entry->lru_link);
+
+  _rut_texture_cache_trim (ctx);
+
+  return cogl_object_ref (entry->texture);
+}
+
 CoglTexture *
-rut_load_texture (RutContext *ctx, const char *filename, CoglError **error)
+_rut_texture_cache_lookup (RutContext *ctx,
+                           const char *filename)
 {
   RutTextureCacheEntry *entry =
     g_hash_table_lookup (ctx->texture_cache, filename);
-  CoglTexture *texture;
 
-  if (entry)
-    return cogl_object_ref (entry->texture);
+  if (entry == NULL)
+    {
+      ctx->texture_cache_stats.misses++;
+      return NULL;
+    }
 
-  texture = cogl_texture_new_from_file (ctx->cogl_context,
-                                        filename,
-                                        COGL_TEXTURE_NO_SLICING,
-                                        COGL_PIXEL_FORMAT_ANY,
-                                        error);
-  if (!texture)
-    return NULL;
+  ctx->texture_cache_stats.hits++;
+
+  return _rut_texture_cache_use_entry (ctx, entry);
+}
+
+CoglTexture *
+_rut_texture_cache_add (RutContext *ctx,
+                        const char *filename,
+                        CoglTexture *texture)
+{
+  RutTextureCacheEntry *entry =
+    g_hash_table_lookup (ctx->texture_cache, filename);
+
+  /* Another load of the same file may have finished first in which
+   * case that texture is shared instead */
+  if (entry)
+    {
+      cogl_object_unref (texture);
+      return _rut_texture_cache_use_entry (ctx, entry);
+    }
 
   entry = g_slice_new0 (RutTextureCacheEntry);
   entry->ctx = ctx;
   entry->filename = g_strdup (filename);
-  /* Note: we don't take a reference on the texture. The aim of this
-   * cache is simply to avoid multiple loads of the same file and
-   * doesn't affect the lifetime of the tracked textures. */
   entry->texture = texture;
+  entry->size = get_texture_size (texture);
 
-  /* Track when the texture is freed... */
+  /* The texture stays in the table for as long as it is alive so
+   * that it is never loaded twice... */
   cogl_object_set_user_data (COGL_OBJECT (texture),
                              &texture_cache_key,
                              entry,
                              texture_destroyed_cb);
+  g_hash_table_insert (ctx->texture_cache, entry->filename, entry);
+
+  /* ...and the cache's own reference keeps it alive for a while after
+   * everything else has released it. The caller's reference is
+   * passed back to it */
+  cogl_object_ref (texture);
+  entry->cached = TRUE;
+  ctx->texture_cache_stats.resident_bytes += entry->size;
+  rut_list_insert (&ctx->texture_cache_lru, &entry->lru_link);
+
+  _rut_texture_cache_trim (ctx);
 
   return texture;
 }
 
+CoglTexture *
+rut_load_texture (RutContext *ctx, const char *filename, CoglError **error)
+{
+  CoglTexture *texture = _rut_texture_cache_lookup (ctx, filename);
+
+  if (texture)
+    return texture;
+
+  texture = cogl_texture_new_from_file (ctx->cogl_context,
+                                        filename,
+                                        COGL_TEXTURE_NO_SLICING,
+                                        COGL_PIXEL_FORMAT_ANY,
+                                        error);
+  if (!texture)
+    return NULL;
+
+  return _rut_texture_cache_add (ctx, filename, texture);
+}
+
 CoglTexture *
 rut_load_texture_from_data_file (RutContext *ctx,
                                  const char *filename,
@@ -343,10 +528,10 @@ rut_context_new (RutShell *shell)
 
   context->settings = rut_settings_new ();
 
-  context->texture_cache =
-    g_hash_table_new_full (g_str_hash, g_str_equal,
-                           NULL,
-                           _rut_texture_cache_entry_destroy_cb);
+  /* The entries are freed when their textures are destroyed */
+  context->texture_cache = g_hash_table_new (g_str_hash, g_str_equal);
+  rut_list_init (&context->texture_cache_lru);
+  context->texture_cache_budget = RUT_TEXTURE_CACHE_DEFAULT_BUDGET;
 
   context->nine_slice_indices =
     cogl_indices_new (context->cogl_context,
@@ -423,6 +608,8 @@ _rut_init (void)
 
       g_type_init ();
 
+      _rut_profile_init ();
+
       _rut_context_init_type ();
       _rut_text_buffer_init_type ();
       _rut_text_init_type ();
@@ -19,6 +19,7 @@
 #include "rut-shell.h"
 #include "rut-bitmask.h"
 #include "rut-memory-stack.h"
+#include "rut-object-pool.h"
 #include "rut-graph.h"
 #include "rut-transform.h"
 #include "rut-rectangle.h"
@@ -50,6 +51,7 @@
 #include "rut-bin.h"
 #include "rut-icon.h"
 #include "rut-flow-layout.h"
+#include "rut-virtual-grid.h"
 #include "rut-button.h"
 #include "rut-fixed.h"
 #include "rut-fold.h"
@@ -57,5 +59,6 @@
 /* entity/components system */
 #include "rut-entity.h"
 #include "rut-components.h"
+#include "rut-profile.h"
 
 #endif /* _RUT_H_ */
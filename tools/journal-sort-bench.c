@@ -0,0 +1,219 @@
+/*
+ * Journal Sort Benchmark
+ *
+ * Copyright (C) 2013  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This measures the CPU cost of ordering the renderer's journal
+ * before it is flushed. It compares the old approach of calling
+ * g_array_sort() with a comparison function on the depth against
+ * sorting the packed 64-bit state/depth keys that the renderer uses.
+ * The keys are made and sorted with the same functions as the
+ * renderer from rig-journal-sort.h.
+ *
+ * The entries have the same layout as a RigJournalEntry so the cost
+ * of moving them around is representative.
+ *
+ * Usage:
+ * rig-journal-sort-bench [OPTION...]
+ *
+ * Application Options:
+ *   -i, --iterations=N    Number of times to sort each journal
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <cogl/cogl.h>
+
+#include "rut-util.h"
+
+#include "rig/jni/rig-journal-sort.h"
+
+typedef struct _BenchEntry
+{
+  void *entity;
+  void *pipeline;
+  CoglMatrix matrix;
+  uint64_t sort_key;
+} BenchEntry;
+
+/* How many distinct pipelines and materials to spread the entries
+ * across. A real scene will typically have many entities sharing a
+ * small number of pipelines. */
+#define N_PIPELINES 64
+#define N_MATERIALS 256
+
+static int iterations = 20;
+
+static const GOptionEntry options[] =
+{
+  { "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations,
+    "Number of times to sort each journal", "N" },
+  { 0 }
+};
+
+static int
+sort_entry_cb (const BenchEntry *entry0,
+               const BenchEntry *entry1)
+{
+  float z0 = entry0->matrix.zw;
+  float z1 = entry1->matrix.zw;
+
+  if (z0 < z1)
+    return -1;
+  else if (z0 > z1)
+    return 1;
+
+  return 0;
+}
+
+static void
+fill_journal (GArray *journal, int n_entries, GRand *rand)
+{
+  int i;
+
+  g_array_set_size (journal, n_entries);
+
+  for (i = 0; i < n_entries; i++)
+    {
+      BenchEntry *entry = &g_array_index (journal, BenchEntry, i);
+      /* Small integers stand in for the pipeline and material
+       * pointers. Only their identity is used for the key */
+      int pipeline = g_rand_int_range (rand, 1, N_PIPELINES + 1);
+      int material = g_rand_int_range (rand, 1, N_MATERIALS + 1);
+
+      cogl_matrix_init_identity (&entry->matrix);
+      cogl_matrix_translate (&entry->matrix,
+                             g_rand_double_range (rand, -100, 100),
+                             g_rand_double_range (rand, -100, 100),
+                             g_rand_double_range (rand, -1000, -1));
+
+      entry->entity = NULL;
+      entry->pipeline = GINT_TO_POINTER (pipeline);
+      entry->sort_key =
+        rig_journal_make_sort_key (0, /* pass */
+                                   FALSE, /* blended */
+                                   entry->pipeline,
+                                   GINT_TO_POINTER (material),
+                                   NULL, /* geometry */
+                                   -entry->matrix.zw);
+    }
+}
+
+static int
+count_pipeline_changes (GArray *journal)
+{
+  void *last_pipeline = NULL;
+  int n_changes = 0;
+  int i;
+
+  for (i = 0; i < journal->len; i++)
+    {
+      BenchEntry *entry = &g_array_index (journal, BenchEntry, i);
+
+      if (i == 0 || entry->pipeline != last_pipeline)
+        n_changes++;
+      last_pipeline = entry->pipeline;
+    }
+
+  return n_changes;
+}
+
+static void
+run_benchmark (int n_entries)
+{
+  GRand *rand = g_rand_new_with_seed (n_entries);
+  GArray *original = g_array_new (FALSE, FALSE, sizeof (BenchEntry));
+  GArray *journal = g_array_new (FALSE, FALSE, sizeof (BenchEntry));
+  int64_t qsort_time = 0, radix_time = 0;
+  int qsort_changes, radix_changes;
+  int i;
+
+  fill_journal (original, n_entries, rand);
+  g_array_set_size (journal, n_entries);
+
+  for (i = 0; i < iterations; i++)
+    {
+      int64_t start;
+
+      memcpy (journal->data, original->data,
+              n_entries * sizeof (BenchEntry));
+      start = g_get_monotonic_time ();
+      g_array_sort (journal, (void *)sort_entry_cb);
+      qsort_time += g_get_monotonic_time () - start;
+    }
+  qsort_changes = count_pipeline_changes (journal);
+
+  for (i = 0; i < iterations; i++)
+    {
+      int64_t start;
+
+      memcpy (journal->data, original->data,
+              n_entries * sizeof (BenchEntry));
+      start = g_get_monotonic_time ();
+      rig_journal_sort (journal->data,
+                        journal->len,
+                        sizeof (BenchEntry),
+                        G_STRUCT_OFFSET (BenchEntry, sort_key));
+      radix_time += g_get_monotonic_time () - start;
+    }
+  radix_changes = count_pipeline_changes (journal);
+
+  g_print ("%7d entries: g_array_sort %9.1fus (%6d pipeline changes), "
+           "radix sort %9.1fus (%6d pipeline changes)\n",
+           n_entries,
+           qsort_time / (double) iterations,
+           qsort_changes,
+           radix_time / (double) iterations,
+           radix_changes);
+
+  g_array_free (journal, TRUE);
+  g_array_free (original, TRUE);
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context = g_option_context_new (NULL);
+  GError *error = NULL;
+
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("option parsing failed: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  if (iterations < 1)
+    iterations = 1;
+
+  run_benchmark (1000);
+  run_benchmark (10000);
+  run_benchmark (100000);
+
+  return EXIT_SUCCESS;
+}